@@ -0,0 +1,193 @@
+#include <benchmark/benchmark.h>
+#include <random>
+#include <vector>
+#include "es-util.h"
+#include "culling.h"
+
+// 视锥剔除：物体随机分布在 1000x1000 的场景中，相机在中心看向 -z，
+// 比较逐个测试（标量/SIMD/并行）与 BVH 的耗时，计数器给出可见/剔除的物体数。
+
+#define SCENE_SIZE 1000.0f
+
+static void sceneFrustum(Frustum *frustum) {
+    Matrix view, projection, viewProjection;
+    matrixLoadIdentity(&view);
+    translate(&view, 0.0f, -10.0f, 0.0f);
+    matrixLoadIdentity(&projection);
+    perspective(&projection, 60.0f, 16.0f / 9.0f, 0.1f, 400.0f);
+    matrixMultiply(&viewProjection, &view, &projection);
+    frustumFromMatrix(frustum, &viewProjection);
+}
+
+static void sceneBoxes(CullAabbs *boxes, int n) {
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> position(-0.5f * SCENE_SIZE, 0.5f * SCENE_SIZE);
+    std::uniform_real_distribution<float> extent(0.5f, 4.0f);
+    cullAabbsInit(boxes, n);
+    for (int i = 0; i < n; i++) {
+        float center[3] = {position(rng), extent(rng) * 4.0f, position(rng)};
+        float half = extent(rng);
+        float min[3] = {center[0] - half, center[1] - half, center[2] - half};
+        float max[3] = {center[0] + half, center[1] + half, center[2] + half};
+        cullAabbsSet(boxes, i, min, max);
+    }
+}
+
+static void reportStats(benchmark::State &state, const CullStats &stats) {
+    state.counters["visible"] = (double) stats.visible;
+    state.counters["culled"] = (double) stats.culled;
+    state.counters["objects_tested"] = (double) stats.objectsTested;
+    state.counters["nodes_visited"] = (double) stats.nodesVisited;
+    state.SetItemsProcessed(state.iterations() * (long) (stats.visible + stats.culled));
+}
+
+// 参照实现：逐个物体逐个平面测试 p 顶点，不使用 SoA 的向量化
+static int cullScalar(const Frustum *frustum, const CullAabbs *boxes, uint8_t *visible) {
+    int visibleCount = 0;
+    for (int i = 0; i < boxes->count; i++) {
+        bool inside = true;
+        for (int p = 0; p < 6 && inside; p++) {
+            const float *plane = frustum->planes[p];
+            float x = plane[0] >= 0.0f ? boxes->maxX[i] : boxes->minX[i];
+            float y = plane[1] >= 0.0f ? boxes->maxY[i] : boxes->minY[i];
+            float z = plane[2] >= 0.0f ? boxes->maxZ[i] : boxes->minZ[i];
+            inside = plane[0] * x + plane[1] * y + plane[2] * z + plane[3] >= 0.0f;
+        }
+        visible[i] = inside;
+        visibleCount += inside;
+    }
+    return visibleCount;
+}
+
+static void BM_CullAabbsScalar(benchmark::State &state) {
+    Frustum frustum;
+    CullAabbs boxes;
+    int n = (int) state.range(0);
+    std::vector<uint8_t> visible(n);
+    CullStats stats = {};
+    sceneFrustum(&frustum);
+    sceneBoxes(&boxes, n);
+    for (auto _ : state) {
+        stats.visible = cullScalar(&frustum, &boxes, visible.data());
+        benchmark::DoNotOptimize(visible.data());
+    }
+    stats.culled = n - stats.visible;
+    stats.objectsTested = n;
+    reportStats(state, stats);
+    cullAabbsRelease(&boxes);
+}
+BENCHMARK(BM_CullAabbsScalar)->RangeMultiplier(8)->Range(1 << 10, 1 << 19);
+
+static void BM_CullAabbsSimd(benchmark::State &state) {
+    Frustum frustum;
+    CullAabbs boxes;
+    int n = (int) state.range(0);
+    std::vector<uint8_t> visible(n);
+    CullStats stats = {};
+    sceneFrustum(&frustum);
+    sceneBoxes(&boxes, n);
+    for (auto _ : state) {
+        cullAabbsParallel(&frustum, &boxes, visible.data(), NULL, &stats);
+        benchmark::DoNotOptimize(visible.data());
+    }
+    reportStats(state, stats);
+    cullAabbsRelease(&boxes);
+}
+BENCHMARK(BM_CullAabbsSimd)->RangeMultiplier(8)->Range(1 << 10, 1 << 19);
+
+static void BM_CullAabbsParallel(benchmark::State &state) {
+    Frustum frustum;
+    CullAabbs boxes;
+    ThreadPool pool;
+    int n = (int) state.range(0);
+    std::vector<uint8_t> visible(n);
+    CullStats stats = {};
+    sceneFrustum(&frustum);
+    sceneBoxes(&boxes, n);
+    for (auto _ : state) {
+        cullAabbsParallel(&frustum, &boxes, visible.data(), &pool, &stats);
+        benchmark::DoNotOptimize(visible.data());
+    }
+    reportStats(state, stats);
+    cullAabbsRelease(&boxes);
+}
+BENCHMARK(BM_CullAabbsParallel)->RangeMultiplier(8)->Range(1 << 10, 1 << 19)->UseRealTime();
+
+static void runBvh(benchmark::State &state, ThreadPool *pool) {
+    Frustum frustum;
+    CullAabbs boxes;
+    Bvh bvh;
+    int n = (int) state.range(0);
+    std::vector<uint8_t> visible(n);
+    CullStats stats = {};
+    sceneFrustum(&frustum);
+    sceneBoxes(&boxes, n);
+    bvhBuild(&bvh, &boxes);
+    for (auto _ : state) {
+        bvhCull(&bvh, &frustum, visible.data(), pool, &stats);
+        benchmark::DoNotOptimize(visible.data());
+    }
+    reportStats(state, stats);
+    bvhRelease(&bvh);
+    cullAabbsRelease(&boxes);
+}
+
+static void BM_CullBvh(benchmark::State &state) {
+    runBvh(state, NULL);
+}
+BENCHMARK(BM_CullBvh)->RangeMultiplier(8)->Range(1 << 10, 1 << 19);
+
+static void BM_CullBvhParallel(benchmark::State &state) {
+    ThreadPool pool;
+    runBvh(state, &pool);
+}
+BENCHMARK(BM_CullBvhParallel)->RangeMultiplier(8)->Range(1 << 10, 1 << 19)->UseRealTime();
+
+// 每帧移动 1% 的物体后 bvhRefit，再剔除
+static void BM_CullBvhRefit(benchmark::State &state) {
+    Frustum frustum;
+    CullAabbs boxes;
+    Bvh bvh;
+    int n = (int) state.range(0);
+    std::vector<uint8_t> visible(n);
+    int frame = 0;
+    sceneFrustum(&frustum);
+    sceneBoxes(&boxes, n);
+    bvhBuild(&bvh, &boxes);
+    for (auto _ : state) {
+        float offset = (frame++ & 1) ? 0.5f : -0.5f;
+        for (int i = 0; i < n; i += 100) {
+            float min[3] = {boxes.minX[i] + offset, boxes.minY[i], boxes.minZ[i]};
+            float max[3] = {boxes.maxX[i] + offset, boxes.maxY[i], boxes.maxZ[i]};
+            bvhUpdateObject(&bvh, i, min, max);
+        }
+        benchmark::DoNotOptimize(bvhCull(&bvh, &frustum, visible.data(), NULL, NULL));
+    }
+    state.SetItemsProcessed(state.iterations() * (long) n);
+    bvhRelease(&bvh);
+    cullAabbsRelease(&boxes);
+}
+BENCHMARK(BM_CullBvhRefit)->RangeMultiplier(8)->Range(1 << 13, 1 << 19);
+
+static void BM_CullSpheresSimd(benchmark::State &state) {
+    Frustum frustum;
+    CullSpheres spheres;
+    int n = (int) state.range(0);
+    std::vector<uint8_t> visible(n);
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> position(-0.5f * SCENE_SIZE, 0.5f * SCENE_SIZE);
+    CullStats stats = {};
+    sceneFrustum(&frustum);
+    cullSpheresInit(&spheres, n);
+    for (int i = 0; i < n; i++) {
+        float center[3] = {position(rng), 8.0f, position(rng)};
+        cullSpheresSet(&spheres, i, center, 2.0f);
+    }
+    for (auto _ : state) {
+        cullSpheresParallel(&frustum, &spheres, visible.data(), NULL, &stats);
+        benchmark::DoNotOptimize(visible.data());
+    }
+    reportStats(state, stats);
+    cullSpheresRelease(&spheres);
+}
+BENCHMARK(BM_CullSpheresSimd)->RangeMultiplier(8)->Range(1 << 10, 1 << 19);
@@ -0,0 +1,453 @@
+#include <benchmark/benchmark.h>
+#include <math.h>
+#include <vector>
+#include "es-util.h"
+#include "mesh-generator.h"
+#include "mesh-optimizer.h"
+#include "thread-pool.h"
+
+// es-util 的 CPU 基准测试，运行方式：
+//   cmake --build <build> --target run-benchmarks
+// 结果保存为 <build>/es-util-benchmark.json。
+
+static void fillMatrix(Matrix *m, float seed) {
+    int i, j;
+    for (i = 0; i < 4; i++) {
+        for (j = 0; j < 4; j++) {
+            m->m[i][j] = seed + (float) (i * 4 + j) * 0.25f;
+        }
+    }
+}
+
+// 原来的 rotate/frustum/ortho：先构造完整的 4x4 矩阵再做一次矩阵乘法，作为原地计算版本的对照
+static void baselineFrustum(Matrix *result, float w, float h, float nearZ, float farZ) {
+    float left = -w;
+    float right = w;
+    float bottom = -h;
+    float top = h;
+    float deltaX = right - left;
+    float deltaY = top - bottom;
+    float deltaZ = farZ - nearZ;
+    Matrix frust;
+    if ((nearZ <= 0.0f) || (farZ <= 0.0f) ||
+        (deltaX <= 0.0f) || (deltaY <= 0.0f) || (deltaZ <= 0.0f)) {
+        return;
+    }
+    frust.m[0][0] = 2.0f * nearZ / deltaX;
+    frust.m[0][1] = frust.m[0][2] = frust.m[0][3] = 0.0f;
+    frust.m[1][1] = 2.0f * nearZ / deltaY;
+    frust.m[1][0] = frust.m[1][2] = frust.m[1][3] = 0.0f;
+    frust.m[2][0] = (right + left) / deltaX;
+    frust.m[2][1] = (top + bottom) / deltaY;
+    frust.m[2][2] = -(nearZ + farZ) / deltaZ;
+    frust.m[2][3] = -1.0f;
+    frust.m[3][2] = -2.0f * nearZ * farZ / deltaZ;
+    frust.m[3][0] = frust.m[3][1] = frust.m[3][3] = 0.0f;
+    matrixMultiply(result, &frust, result);
+}
+
+static void baselinePerspective(Matrix *result, float fovy, float aspect, float nearZ,
+                                float farZ) {
+    GLfloat frustumH = tanf(float(fovy / 360.0f * PI)) * nearZ;
+    baselineFrustum(result, frustumH * aspect, frustumH, nearZ, farZ);
+}
+
+static void baselineRotate(Matrix *result, GLfloat angle, GLfloat x, GLfloat y, GLfloat z) {
+    GLfloat sinAngle, cosAngle;
+    GLfloat mag = sqrtf(x * x + y * y + z * z);
+    sinAngle = sinf(float(angle * PI / 180.0f));
+    cosAngle = cosf(float(angle * PI / 180.0f));
+    if (mag > 0.0f) {
+        GLfloat xx, yy, zz, xy, yz, zx, xs, ys, zs;
+        GLfloat oneMinusCos;
+        Matrix rotMat;
+        x /= mag;
+        y /= mag;
+        z /= mag;
+        xx = x * x;
+        yy = y * y;
+        zz = z * z;
+        xy = x * y;
+        yz = y * z;
+        zx = z * x;
+        xs = x * sinAngle;
+        ys = y * sinAngle;
+        zs = z * sinAngle;
+        oneMinusCos = 1.0f - cosAngle;
+        rotMat.m[0][0] = (oneMinusCos * xx) + cosAngle;
+        rotMat.m[0][1] = (oneMinusCos * xy) - zs;
+        rotMat.m[0][2] = (oneMinusCos * zx) + ys;
+        rotMat.m[0][3] = 0.0F;
+        rotMat.m[1][0] = (oneMinusCos * xy) + zs;
+        rotMat.m[1][1] = (oneMinusCos * yy) + cosAngle;
+        rotMat.m[1][2] = (oneMinusCos * yz) - xs;
+        rotMat.m[1][3] = 0.0F;
+        rotMat.m[2][0] = (oneMinusCos * zx) - ys;
+        rotMat.m[2][1] = (oneMinusCos * yz) + xs;
+        rotMat.m[2][2] = (oneMinusCos * zz) + cosAngle;
+        rotMat.m[2][3] = 0.0F;
+        rotMat.m[3][0] = 0.0F;
+        rotMat.m[3][1] = 0.0F;
+        rotMat.m[3][2] = 0.0F;
+        rotMat.m[3][3] = 1.0F;
+        matrixMultiply(result, &rotMat, result);
+    }
+}
+
+static void baselineOrtho(Matrix *result, float left, float right, float bottom, float top,
+                          float nearZ, float farZ) {
+    float deltaX = right - left;
+    float deltaY = top - bottom;
+    float deltaZ = farZ - nearZ;
+    Matrix ortho;
+    if ((deltaX == 0.0f) || (deltaY == 0.0f) || (deltaZ == 0.0f)) {
+        return;
+    }
+    matrixLoadIdentity(&ortho);
+    ortho.m[0][0] = 2.0f / deltaX;
+    ortho.m[3][0] = -(right + left) / deltaX;
+    ortho.m[1][1] = 2.0f / deltaY;
+    ortho.m[3][1] = -(top + bottom) / deltaY;
+    ortho.m[2][2] = -2.0f / deltaZ;
+    ortho.m[3][2] = -(nearZ + farZ) / deltaZ;
+    matrixMultiply(result, &ortho, result);
+}
+
+// 原来的 createSphere/createSquareGrid 的生成部分：逐顶点调用 sinf/cosf、按下标计算写入位置，
+// 作为系数表 + 按行分块生成的对照。写入预先分配的缓冲区，两边都不计 malloc 和缺页的开销
+static void baselineSphereInto(int numSlices, float radius, GLfloat *vertices, GLfloat *normals,
+                               GLfloat *texCoords, GLuint *indices) {
+    int i;
+    int j;
+    int numParallels = numSlices / 2;
+    float angleStep = (float) (2.0f * PI) / numSlices;
+    for (i = 0; i < numParallels + 1; i++) {
+        for (j = 0; j < numSlices + 1; j++) {
+            int vertex = (i * (numSlices + 1) + j) * 3;
+            int texIndex = (i * (numSlices + 1) + j) * 2;
+            vertices[vertex + 0] = radius * sinf(angleStep * (float) i) *
+                                   sinf(angleStep * (float) j);
+            vertices[vertex + 1] = radius * cosf(angleStep * (float) i);
+            vertices[vertex + 2] = radius * sinf(angleStep * (float) i) *
+                                   cosf(angleStep * (float) j);
+            normals[vertex + 0] = vertices[vertex + 0] / radius;
+            normals[vertex + 1] = vertices[vertex + 1] / radius;
+            normals[vertex + 2] = vertices[vertex + 2] / radius;
+            texCoords[texIndex + 0] = (float) j / (float) numSlices;
+            texCoords[texIndex + 1] = (1.0f - (float) i) / (float) (numParallels - 1);
+        }
+    }
+    for (i = 0; i < numParallels; i++) {
+        for (j = 0; j < numSlices; j++) {
+            *indices++ = (GLuint) (i * (numSlices + 1) + j);
+            *indices++ = (GLuint) (i + 1) * (numSlices + 1) + j;
+            *indices++ = (GLuint) (i + 1) * (numSlices + 1) + (j + 1);
+            *indices++ = (GLuint) i * (numSlices + 1) + j;
+            *indices++ = (GLuint) (i + 1) * (numSlices + 1) + (j + 1);
+            *indices++ = (GLuint) i * (numSlices + 1) + (j + 1);
+        }
+    }
+}
+
+static void baselineSquareGridInto(int size, GLfloat *vertices, GLuint *indices) {
+    GLuint i, j;
+    float stepSize = (float) size - 1;
+    for (i = 0; i < size; ++i) {
+        for (j = 0; j < size; ++j) {
+            vertices[3 * (j + i * size)] = i / stepSize;
+            vertices[3 * (j + i * size) + 1] = j / stepSize;
+            vertices[3 * (j + i * size) + 2] = 0.0f;
+        }
+    }
+    for (i = 0; i < size - 1; ++i) {
+        for (j = 0; j < size - 1; ++j) {
+            // two triangles per quad
+            indices[6 * (j + i * (size - 1))] = j + (i) * (size);
+            indices[6 * (j + i * (size - 1)) + 1] = j + (i) * (size) + 1;
+            indices[6 * (j + i * (size - 1)) + 2] = j + (i + 1) * (size) + 1;
+            indices[6 * (j + i * (size - 1)) + 3] = j + (i) * (size);
+            indices[6 * (j + i * (size - 1)) + 4] = j + (i + 1) * (size) + 1;
+            indices[6 * (j + i * (size - 1)) + 5] = j + (i + 1) * (size);
+        }
+    }
+}
+
+static void BM_MatrixMultiply(benchmark::State &state) {
+    Matrix a, b, result;
+    fillMatrix(&a, 1.0f);
+    fillMatrix(&b, -2.0f);
+    for (auto _ : state) {
+        matrixMultiply(&result, &a, &b);
+        benchmark::DoNotOptimize(result);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MatrixMultiply);
+
+static void BM_MatrixMultiplyN(benchmark::State &state) {
+    int n = (int) state.range(0);
+    std::vector<Matrix> a(n), b(n), result(n);
+    for (int i = 0; i < n; i++) {
+        fillMatrix(&a[i], (float) i);
+        fillMatrix(&b[i], (float) -i);
+    }
+    for (auto _ : state) {
+        matrixMultiplyN(result.data(), a.data(), b.data(), n);
+        benchmark::DoNotOptimize(result.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_MatrixMultiplyN)->RangeMultiplier(8)->Range(8, 4096);
+
+static void BM_MatrixMultiplyBatch(benchmark::State &state) {
+    int n = (int) state.range(0);
+    std::vector<Matrix> a(n), result(n);
+    Matrix b;
+    for (int i = 0; i < n; i++) {
+        fillMatrix(&a[i], (float) i);
+    }
+    fillMatrix(&b, 0.5f);
+    for (auto _ : state) {
+        matrixMultiplyBatch(result.data(), sizeof(Matrix), a.data(), &b, n);
+        benchmark::DoNotOptimize(result.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_MatrixMultiplyBatch)->RangeMultiplier(8)->Range(8, 4096);
+
+static void BM_Rotate(benchmark::State &state) {
+    Matrix m;
+    float angle = 0.0f;
+    matrixLoadIdentity(&m);
+    for (auto _ : state) {
+        rotate(&m, angle, 0.3f, 0.5f, 0.8f);
+        angle += 1.0f;
+        benchmark::DoNotOptimize(m);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Rotate);
+
+static void BM_RotateBaseline(benchmark::State &state) {
+    Matrix m;
+    float angle = 0.0f;
+    matrixLoadIdentity(&m);
+    for (auto _ : state) {
+        baselineRotate(&m, angle, 0.3f, 0.5f, 0.8f);
+        angle += 1.0f;
+        benchmark::DoNotOptimize(m);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RotateBaseline);
+
+static void BM_Perspective(benchmark::State &state) {
+    Matrix m;
+    float fovy = 60.0f;
+    for (auto _ : state) {
+        // 参数对编译器不透明，原来的实现与基准测试在同一个文件中，否则 tanf 会在编译期求值
+        benchmark::DoNotOptimize(fovy);
+        matrixLoadIdentity(&m);
+        perspective(&m, fovy, 16.0f / 9.0f, 0.1f, 100.0f);
+        benchmark::DoNotOptimize(m);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Perspective);
+
+static void BM_PerspectiveBaseline(benchmark::State &state) {
+    Matrix m;
+    float fovy = 60.0f;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(fovy);
+        matrixLoadIdentity(&m);
+        baselinePerspective(&m, fovy, 16.0f / 9.0f, 0.1f, 100.0f);
+        benchmark::DoNotOptimize(m);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PerspectiveBaseline);
+
+static void BM_Ortho(benchmark::State &state) {
+    Matrix m;
+    float farZ = 100.0f;
+    fillMatrix(&m, 1.0f);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(farZ);
+        ortho(&m, -1.0f, 1.0f, -1.0f, 1.0f, 0.1f, farZ);
+        benchmark::DoNotOptimize(m);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Ortho);
+
+static void BM_OrthoBaseline(benchmark::State &state) {
+    Matrix m;
+    float farZ = 100.0f;
+    fillMatrix(&m, 1.0f);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(farZ);
+        baselineOrtho(&m, -1.0f, 1.0f, -1.0f, 1.0f, 0.1f, farZ);
+        benchmark::DoNotOptimize(m);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_OrthoBaseline);
+
+static void BM_MatrixLookAt(benchmark::State &state) {
+    Matrix m;
+    float x = 0.0f;
+    for (auto _ : state) {
+        matrixLookAt(&m, x, 2.0f, 5.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f);
+        x += 0.001f;
+        benchmark::DoNotOptimize(m);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MatrixLookAt);
+
+// 原来的做法：依次调用 translate、原来的 rotate、scale、matrixLookAt、原来的 perspective，
+// 再做两次矩阵乘法，与 BM_ModelViewProjection 对比
+static void BM_ModelViewProjectionChained(benchmark::State &state) {
+    Matrix model, view, projection, modelView, m;
+    float angle = 0.0f;
+    float fovy = 60.0f;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(fovy);
+        matrixLoadIdentity(&model);
+        translate(&model, 1.0f, 0.0f, -2.0f);
+        baselineRotate(&model, angle, 0.0f, 1.0f, 0.0f);
+        scale(&model, 1.0f, 1.0f, 1.0f);
+        matrixLookAt(&view, 0.0f, 2.0f, 5.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f);
+        matrixLoadIdentity(&projection);
+        baselinePerspective(&projection, fovy, 16.0f / 9.0f, 0.1f, 100.0f);
+        matrixMultiply(&modelView, &model, &view);
+        matrixMultiply(&m, &modelView, &projection);
+        angle += 1.0f;
+        benchmark::DoNotOptimize(m);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ModelViewProjectionChained);
+
+static void BM_ModelViewProjection(benchmark::State &state) {
+    const GLfloat eye[3] = {0.0f, 2.0f, 5.0f};
+    const GLfloat target[3] = {0.0f, 0.0f, 0.0f};
+    const GLfloat up[3] = {0.0f, 1.0f, 0.0f};
+    const GLfloat translation[3] = {1.0f, 0.0f, -2.0f};
+    const GLfloat axis[3] = {0.0f, 1.0f, 0.0f};
+    const GLfloat scaling[3] = {1.0f, 1.0f, 1.0f};
+    Matrix m;
+    float angle = 0.0f;
+    for (auto _ : state) {
+        modelViewProjection(&m, eye, target, up, 60.0f, 16.0f / 9.0f, 0.1f, 100.0f,
+                            translation, angle, axis, scaling);
+        angle += 1.0f;
+        benchmark::DoNotOptimize(m);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ModelViewProjection);
+
+// 第二个参数为 1 时开启网格优化，对比生成本身与优化的耗时
+static void BM_CreateSphere(benchmark::State &state) {
+    int numSlices = (int) state.range(0);
+    bool optimize = state.range(1) != 0;
+    for (auto _ : state) {
+        GLfloat *vertices, *normals, *texCoords;
+        GLuint *indices;
+        int numIndices = createSphere(numSlices, 1.0f, &vertices, &normals, &texCoords, &indices,
+                                      optimize);
+        benchmark::DoNotOptimize(numIndices);
+        free(vertices);
+        free(normals);
+        free(texCoords);
+        free(indices);
+    }
+    state.SetItemsProcessed(state.iterations() * sphereVertexCount(numSlices));
+}
+BENCHMARK(BM_CreateSphere)->ArgsProduct({{16, 64, 256, 1024}, {0, 1}})
+        ->Unit(benchmark::kMicrosecond);
+
+static void BM_CreateSquareGrid(benchmark::State &state) {
+    int size = (int) state.range(0);
+    bool optimize = state.range(1) != 0;
+    for (auto _ : state) {
+        GLfloat *vertices;
+        GLuint *indices;
+        int numIndices = createSquareGrid(size, &vertices, &indices, optimize);
+        benchmark::DoNotOptimize(numIndices);
+        free(vertices);
+        free(indices);
+    }
+    state.SetItemsProcessed(state.iterations() * squareGridVertexCount(size));
+}
+BENCHMARK(BM_CreateSquareGrid)->ArgsProduct({{16, 64, 256, 1024}, {0, 1}})
+        ->Unit(benchmark::kMicrosecond);
+
+// 写入预先分配的缓冲区，比较单线程与线程池按行并行生成
+static void BM_CreateSphereInto(benchmark::State &state) {
+    int numSlices = (int) state.range(0);
+    std::vector<GLfloat> vertices(sphereVertexCount(numSlices) * 3);
+    std::vector<GLfloat> normals(sphereVertexCount(numSlices) * 3);
+    std::vector<GLfloat> texCoords(sphereVertexCount(numSlices) * 2);
+    std::vector<GLuint> indices(sphereIndexCount(numSlices));
+    ThreadPool pool((int) state.range(1));
+    for (auto _ : state) {
+        createSphereInto(numSlices, 1.0f, vertices.data(), normals.data(), texCoords.data(),
+                         indices.data(), &pool, false);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * sphereVertexCount(numSlices));
+}
+BENCHMARK(BM_CreateSphereInto)->ArgsProduct({{64, 256, 1024}, {1, 4}})
+        ->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+// 原来的逐顶点生成，与 BM_CreateSphereInto 的单线程结果对比
+static void BM_CreateSphereIntoBaseline(benchmark::State &state) {
+    int numSlices = (int) state.range(0);
+    std::vector<GLfloat> vertices(sphereVertexCount(numSlices) * 3);
+    std::vector<GLfloat> normals(sphereVertexCount(numSlices) * 3);
+    std::vector<GLfloat> texCoords(sphereVertexCount(numSlices) * 2);
+    std::vector<GLuint> indices(sphereIndexCount(numSlices));
+    for (auto _ : state) {
+        baselineSphereInto(numSlices, 1.0f, vertices.data(), normals.data(), texCoords.data(),
+                           indices.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * sphereVertexCount(numSlices));
+}
+BENCHMARK(BM_CreateSphereIntoBaseline)->Arg(64)->Arg(256)->Arg(1024)
+        ->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+static void BM_CreateSquareGridInto(benchmark::State &state) {
+    int size = (int) state.range(0);
+    std::vector<GLfloat> vertices(squareGridVertexCount(size) * 3);
+    std::vector<GLuint> indices(squareGridIndexCount(size));
+    ThreadPool pool((int) state.range(1));
+    for (auto _ : state) {
+        createSquareGridInto(size, vertices.data(), indices.data(), &pool, false);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * squareGridVertexCount(size));
+}
+BENCHMARK(BM_CreateSquareGridInto)->ArgsProduct({{64, 256, 1024}, {1, 4}})
+        ->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+static void BM_CreateSquareGridIntoBaseline(benchmark::State &state) {
+    int size = (int) state.range(0);
+    std::vector<GLfloat> vertices(squareGridVertexCount(size) * 3);
+    std::vector<GLuint> indices(squareGridIndexCount(size));
+    for (auto _ : state) {
+        baselineSquareGridInto(size, vertices.data(), indices.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * squareGridVertexCount(size));
+}
+BENCHMARK(BM_CreateSquareGridIntoBaseline)->Arg(64)->Arg(256)->Arg(1024)
+        ->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,103 @@
+#include <benchmark/benchmark.h>
+#include <vector>
+#include "es-util.h"
+#include "mesh-generator.h"
+
+// 模拟反复重建 LOD：每帧把 MESH_COUNT 个球体按不同的细分级别重新生成一遍，
+// 比较原来的 createSphere（每个网格 4 个数组加生成器系数表共 5 次 malloc）与 Mesh + 各种分配器。
+// createSphereMesh 的系数表是生成器内部的 malloc，不计入 system_allocs。
+// 各个函数都关闭网格优化，只比较分配本身的开销。
+
+#define MESH_COUNT 64
+
+static const int LOD_SLICES[] = {8, 12, 16, 24, 32, 48, 64, 96};
+#define LOD_LEVELS ((int) (sizeof(LOD_SLICES) / sizeof(LOD_SLICES[0])))
+
+static int lodSlices(int frame, int mesh) {
+    return LOD_SLICES[(frame * 7 + mesh * 3) % LOD_LEVELS];
+}
+
+static void reportStats(benchmark::State &state, const AllocatorStats &stats) {
+    state.counters["system_allocs"] = benchmark::Counter((double) stats.systemAllocations,
+                                                         benchmark::Counter::kAvgIterations);
+    state.counters["peak_bytes"] = (double) stats.peakBytes;
+}
+
+static void BM_LodRegenerateMalloc(benchmark::State &state) {
+    struct Arrays {
+        GLfloat *vertices, *normals, *texCoords;
+        GLuint *indices;
+    };
+    std::vector<Arrays> meshes(MESH_COUNT, Arrays{NULL, NULL, NULL, NULL});
+    int frame = 0;
+    for (auto _ : state) {
+        for (int i = 0; i < MESH_COUNT; i++) {
+            Arrays &mesh = meshes[i];
+            free(mesh.vertices);
+            free(mesh.normals);
+            free(mesh.texCoords);
+            free(mesh.indices);
+            createSphere(lodSlices(frame, i), 1.0f, &mesh.vertices, &mesh.normals,
+                         &mesh.texCoords, &mesh.indices, false);
+        }
+        frame++;
+    }
+    for (Arrays &mesh : meshes) {
+        free(mesh.vertices);
+        free(mesh.normals);
+        free(mesh.texCoords);
+        free(mesh.indices);
+    }
+    state.counters["system_allocs"] = benchmark::Counter(5.0 * MESH_COUNT * state.iterations(),
+                                                         benchmark::Counter::kAvgIterations);
+    state.SetItemsProcessed(state.iterations() * MESH_COUNT);
+}
+BENCHMARK(BM_LodRegenerateMalloc);
+
+static void regenerateMeshes(benchmark::State &state, MeshAllocator *allocator) {
+    std::vector<Mesh> meshes;
+    int frame = 0;
+    for (int i = 0; i < MESH_COUNT; i++) {
+        meshes.emplace_back(allocator);
+    }
+    allocator->resetStats();
+    for (auto _ : state) {
+        for (int i = 0; i < MESH_COUNT; i++) {
+            createSphereMesh(&meshes[i], lodSlices(frame, i), 1.0f, NULL, false);
+        }
+        frame++;
+    }
+    reportStats(state, allocator->stats());
+    state.SetItemsProcessed(state.iterations() * MESH_COUNT);
+}
+
+static void BM_LodRegenerateMallocMesh(benchmark::State &state) {
+    MallocAllocator allocator;
+    regenerateMeshes(state, &allocator);
+}
+BENCHMARK(BM_LodRegenerateMallocMesh);
+
+static void BM_LodRegeneratePool(benchmark::State &state) {
+    PoolAllocator allocator;
+    regenerateMeshes(state, &allocator);
+}
+BENCHMARK(BM_LodRegeneratePool);
+
+// 每帧 reset 整个 arena 后重新生成所有网格
+static void BM_LodRegenerateArena(benchmark::State &state) {
+    LinearArena arena(16 * 1024 * 1024);
+    int frame = 0;
+    arena.resetStats();
+    for (auto _ : state) {
+        arena.reset();
+        for (int i = 0; i < MESH_COUNT; i++) {
+            Mesh mesh(&arena);
+            createSphereMesh(&mesh, lodSlices(frame, i), 1.0f, NULL, false);
+            benchmark::DoNotOptimize(mesh.vertices());
+        }
+        frame++;
+    }
+    reportStats(state, arena.stats());
+    state.SetItemsProcessed(state.iterations() * MESH_COUNT);
+}
+BENCHMARK(BM_LodRegenerateArena);
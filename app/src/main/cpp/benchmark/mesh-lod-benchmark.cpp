@@ -0,0 +1,70 @@
+#include <benchmark/benchmark.h>
+#include <vector>
+#include "es-util.h"
+#include "mesh-lod.h"
+
+// LOD 选择：场景中的物体沿视线方向分布在不同距离上，
+// 统计按 LOD 选择后实际处理的顶点数与全部使用第 0 级时的顶点数。
+
+#define VIEWPORT_HEIGHT 1080.0f
+
+static void sceneProjection(Matrix *projection) {
+    matrixLoadIdentity(projection);
+    perspective(projection, 60.0f, 16.0f / 9.0f, 0.1f, 1000.0f);
+}
+
+// 第 i 个物体放在 (x, y, -z) 处，z 在 [near, far) 内均匀分布
+static std::vector<Matrix> sceneModelViews(int n, float nearZ, float farZ, float objectScale) {
+    std::vector<Matrix> modelViews(n);
+    for (int i = 0; i < n; i++) {
+        float z = nearZ + (farZ - nearZ) * (float) i / (float) n;
+        // 变换函数左乘，最后调用的最先作用于顶点：先缩放再平移
+        matrixLoadIdentity(&modelViews[i]);
+        translate(&modelViews[i], (float) (i % 16) - 8.0f, (float) (i % 7) - 3.0f, -z);
+        scale(&modelViews[i], objectScale, objectScale, objectScale);
+    }
+    return modelViews;
+}
+
+static void runSelection(benchmark::State &state, const LodKey &key,
+                         const std::vector<Matrix> &modelViews) {
+    LodCache cache;
+    const LodChain *chain = cache.acquire(key);
+    Matrix projection;
+    LodParams params = {VIEWPORT_HEIGHT, 8.0f, 0.2f};
+    std::vector<LodSelection> selections(modelViews.size());
+    long vertices = 0;
+    sceneProjection(&projection);
+    for (auto _ : state) {
+        vertices = lodSelectBatch(chain, modelViews.data(), (int) modelViews.size(), &projection,
+                                  &params, selections.data());
+        benchmark::DoNotOptimize(vertices);
+    }
+    long fullVertices = (long) chain->levels[0].vertexCount() * (long) modelViews.size();
+    state.counters["lod_vertices"] = (double) vertices;
+    state.counters["full_vertices"] = (double) fullVertices;
+    state.counters["vertex_ratio"] = (double) vertices / (double) fullVertices;
+    state.SetItemsProcessed(state.iterations() * (long) modelViews.size());
+}
+
+static void BM_LodSelectSpheres(benchmark::State &state) {
+    LodKey key = {LOD_SHAPE_SPHERE, 128, MAX_LOD_LEVELS, 1.0f};
+    runSelection(state, key, sceneModelViews((int) state.range(0), 3.0f, 300.0f, 1.0f));
+}
+BENCHMARK(BM_LodSelectSpheres)->RangeMultiplier(8)->Range(64, 4096);
+
+// 地形：每块网格缩放为 64x64 单位
+static void BM_LodSelectTerrainTiles(benchmark::State &state) {
+    LodKey key = {LOD_SHAPE_GRID, 257, MAX_LOD_LEVELS, 0.0f};
+    runSelection(state, key, sceneModelViews((int) state.range(0), 50.0f, 900.0f, 64.0f));
+}
+BENCHMARK(BM_LodSelectTerrainTiles)->RangeMultiplier(4)->Range(16, 1024);
+
+static void BM_LodChainBuild(benchmark::State &state) {
+    LodKey key = {LOD_SHAPE_SPHERE, (int) state.range(0), MAX_LOD_LEVELS, 1.0f};
+    for (auto _ : state) {
+        LodCache cache;
+        benchmark::DoNotOptimize(cache.acquire(key));
+    }
+}
+BENCHMARK(BM_LodChainBuild)->Arg(64)->Arg(256)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,60 @@
+#include <benchmark/benchmark.h>
+#include <stdint.h>
+#include "resolution-controller.h"
+#include "resolution-trace.h"
+
+// 用模拟的帧时间序列（见 resolution-trace.h）回放动态分辨率控制，range(0) 选择负载。
+// Fixed 为始终使用原分辨率，Adaptive 使用控制器；计数器给出超出预算的帧的比例、平均 scale 和调整次数。
+
+static float replayTrace(ResolutionController *controller, int trace, bool adaptive,
+                         long *overBudget) {
+    uint32_t seed = 12345;
+    float scale = 1.0f;
+    float scaleSum = 0.0f;
+    *overBudget = 0;
+    for (int i = 0; i < TRACE_FRAMES; i++) {
+        float gpuMs = traceGpuMs(traceLoad(trace, i), scale, &seed);
+        float cpuMs = 4.0f + traceNoise(&seed);
+        if (gpuMs > TRACE_BUDGET_MS) {
+            (*overBudget)++;
+        }
+        scaleSum += scale;
+        if (adaptive) {
+            scale = resolutionControllerUpdate(controller, cpuMs, gpuMs);
+        }
+    }
+    return scaleSum / (float) TRACE_FRAMES;
+}
+
+static void BM_ResolutionFixed(benchmark::State &state) {
+    ResolutionController controller;
+    long overBudget = 0;
+    float meanScale = 1.0f;
+    for (auto _ : state) {
+        meanScale = replayTrace(&controller, (int) state.range(0), false, &overBudget);
+        benchmark::DoNotOptimize(meanScale);
+    }
+    state.SetItemsProcessed((int64_t) state.iterations() * TRACE_FRAMES);
+    state.counters["over_budget_ratio"] = (double) overBudget / TRACE_FRAMES;
+    state.counters["mean_scale"] = meanScale;
+}
+BENCHMARK(BM_ResolutionFixed)->DenseRange(0, 2);
+
+static void BM_ResolutionAdaptive(benchmark::State &state) {
+    ResolutionConfig config;
+    ResolutionController controller;
+    long overBudget = 0;
+    float meanScale = 1.0f;
+    resolutionConfigDefault(&config, TRACE_BUDGET_MS);
+    for (auto _ : state) {
+        resolutionControllerInit(&controller, &config);
+        meanScale = replayTrace(&controller, (int) state.range(0), true, &overBudget);
+        benchmark::DoNotOptimize(meanScale);
+    }
+    state.SetItemsProcessed((int64_t) state.iterations() * TRACE_FRAMES);
+    state.counters["over_budget_ratio"] = (double) overBudget / TRACE_FRAMES;
+    state.counters["mean_scale"] = meanScale;
+    state.counters["increases"] = controller.stats.increases;
+    state.counters["decreases"] = controller.stats.decreases;
+}
+BENCHMARK(BM_ResolutionAdaptive)->DenseRange(0, 2);
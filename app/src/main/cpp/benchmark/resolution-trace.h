@@ -0,0 +1,49 @@
+#ifndef GLES_RESOLUTION_TRACE_H
+#define GLES_RESOLUTION_TRACE_H
+
+#include <stdint.h>
+
+// 动态分辨率的模拟帧时间序列，基准测试和 test/resolution-controller-test.cpp 共用：
+// GPU 耗时 = 固定部分 + 与像素数（scale 的平方）成正比的部分，再乘以负载系数并加上噪声。
+// trace 选择负载：0 稳定且低于预算；1 降频，负载在 1.0 → 1.7 → 1.0 之间缓慢变化；2 每 120 帧有 10 帧负载翻倍。
+
+#define TRACE_STEADY 0
+#define TRACE_THROTTLE 1
+#define TRACE_SPIKE 2
+#define TRACE_FRAMES 2400
+#define TRACE_BUDGET_MS 14.0f
+#define TRACE_FIXED_MS 1.0f
+#define TRACE_PIXEL_MS 11.0f
+
+static inline float traceLoad(int trace, int frame) {
+    float t = (float) frame / (float) TRACE_FRAMES;
+    switch (trace) {
+        case TRACE_THROTTLE:
+            if (t < 0.2f) {
+                return 1.0f;
+            } else if (t < 0.4f) {
+                return 1.0f + 0.7f * (t - 0.2f) / 0.2f;
+            } else if (t < 0.6f) {
+                return 1.7f;
+            } else if (t < 0.8f) {
+                return 1.7f - 0.7f * (t - 0.6f) / 0.2f;
+            }
+            return 1.0f;
+        case TRACE_SPIKE:
+            return frame % 120 < 10 ? 2.0f : 1.0f;
+        default:
+            return 0.9f;
+    }
+}
+
+// 固定种子的噪声，[-0.5, 0.5) 毫秒，每次回放都相同
+static inline float traceNoise(uint32_t *seed) {
+    *seed = *seed * 1664525u + 1013904223u;
+    return (float) (*seed >> 8) / (float) (1u << 24) - 0.5f;
+}
+
+static inline float traceGpuMs(float load, float scale, uint32_t *seed) {
+    return TRACE_FIXED_MS + TRACE_PIXEL_MS * scale * scale * load + traceNoise(seed);
+}
+
+#endif
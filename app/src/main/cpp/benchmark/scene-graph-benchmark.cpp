@@ -0,0 +1,112 @@
+#include <benchmark/benchmark.h>
+#include <vector>
+#include "es-util.h"
+#include "scene-graph.h"
+
+// 变换层次：一个根节点下 64 组，每组若干个子节点，共 range(0) 个叶子。
+// Rebuild 为原来的做法：每帧对每个叶子重新拼出 根 → 组 → 叶子 的整条矩阵链；
+// Static 为没有修改时的更新；Partial 每帧修改 1/64 的组；All 修改根节点，所有节点都要重新计算。
+
+#define SCENE_GROUPS 64
+
+static void buildScene(SceneGraph *graph, int leaves, std::vector<SceneNode> *groups) {
+    static const float axis[3] = {0.0f, 0.0f, 1.0f};
+    sceneGraphInit(graph, 1 + SCENE_GROUPS + leaves);
+    SceneNode root = sceneNodeCreate(graph, -1);
+    groups->clear();
+    for (int g = 0; g < SCENE_GROUPS; g++) {
+        float position[3] = {(float) (g % 8) * 10.0f, (float) (g / 8) * 10.0f, 0.0f};
+        SceneNode group = sceneNodeCreate(graph, root);
+        sceneNodeSetTransform(graph, group, position, axis, (float) g, 1.0f);
+        groups->push_back(group);
+    }
+    for (int i = 0; i < leaves; i++) {
+        float position[3] = {(float) (i % 7), (float) (i % 5), (float) (i % 3)};
+        SceneNode leaf = sceneNodeCreate(graph, (*groups)[i % SCENE_GROUPS]);
+        sceneNodeSetTransform(graph, leaf, position, axis, (float) (i % 360), 0.5f);
+    }
+    sceneGraphUpdate(graph, NULL);
+}
+
+static void BM_SceneGraphRebuild(benchmark::State &state) {
+    int leaves = (int) state.range(0);
+    std::vector<Matrix> groups(SCENE_GROUPS);
+    std::vector<Matrix> world(leaves);
+    Matrix root, local, groupWorld;
+    for (auto _ : state) {
+        matrixLoadIdentity(&root);
+        translate(&root, 1.0f, 2.0f, 3.0f);
+        for (int i = 0; i < leaves; i++) {
+            int g = i % SCENE_GROUPS;
+            matrixLoadIdentity(&groups[g]);
+            translate(&groups[g], (float) (g % 8) * 10.0f, (float) (g / 8) * 10.0f, 0.0f);
+            rotate(&groups[g], (float) g, 0.0f, 0.0f, 1.0f);
+            matrixMultiply(&groupWorld, &groups[g], &root);
+            matrixLoadIdentity(&local);
+            translate(&local, (float) (i % 7), (float) (i % 5), (float) (i % 3));
+            rotate(&local, (float) (i % 360), 0.0f, 0.0f, 1.0f);
+            scale(&local, 0.5f, 0.5f, 0.5f);
+            matrixMultiply(&world[i], &local, &groupWorld);
+        }
+        benchmark::DoNotOptimize(world.data());
+    }
+    state.SetItemsProcessed((int64_t) state.iterations() * leaves);
+}
+BENCHMARK(BM_SceneGraphRebuild)->RangeMultiplier(8)->Range(1 << 10, 1 << 16);
+
+static void BM_SceneGraphStatic(benchmark::State &state) {
+    SceneGraph graph;
+    std::vector<SceneNode> groups;
+    buildScene(&graph, (int) state.range(0), &groups);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(sceneGraphUpdate(&graph, NULL));
+    }
+    sceneGraphRelease(&graph);
+}
+BENCHMARK(BM_SceneGraphStatic)->RangeMultiplier(8)->Range(1 << 10, 1 << 16);
+
+static void BM_SceneGraphPartial(benchmark::State &state) {
+    static const float axis[3] = {0.0f, 0.0f, 1.0f};
+    SceneGraph graph;
+    std::vector<SceneNode> groups;
+    long frame = 0;
+    buildScene(&graph, (int) state.range(0), &groups);
+    for (auto _ : state) {
+        int g = (int) (frame % SCENE_GROUPS);
+        float position[3] = {(float) (g % 8) * 10.0f, (float) (g / 8) * 10.0f, 0.0f};
+        sceneNodeSetTransform(&graph, groups[g], position, axis, (float) (frame % 360), 1.0f);
+        benchmark::DoNotOptimize(sceneGraphUpdate(&graph, NULL));
+        frame++;
+    }
+    state.counters["updated"] = graph.stats.lastUpdated;
+    sceneGraphRelease(&graph);
+}
+BENCHMARK(BM_SceneGraphPartial)->RangeMultiplier(8)->Range(1 << 10, 1 << 16);
+
+static void runAll(benchmark::State &state, ThreadPool *pool) {
+    SceneGraph graph;
+    std::vector<SceneNode> groups;
+    Matrix root;
+    long frame = 0;
+    buildScene(&graph, (int) state.range(0), &groups);
+    for (auto _ : state) {
+        matrixLoadIdentity(&root);
+        translate(&root, (float) (frame % 100), 2.0f, 3.0f);
+        sceneNodeSetLocal(&graph, 0, &root);
+        benchmark::DoNotOptimize(sceneGraphUpdate(&graph, pool));
+        frame++;
+    }
+    state.SetItemsProcessed((int64_t) state.iterations() * graph.stats.lastUpdated);
+    sceneGraphRelease(&graph);
+}
+
+static void BM_SceneGraphAll(benchmark::State &state) {
+    runAll(state, NULL);
+}
+BENCHMARK(BM_SceneGraphAll)->RangeMultiplier(8)->Range(1 << 10, 1 << 16);
+
+static void BM_SceneGraphAllParallel(benchmark::State &state) {
+    ThreadPool pool;
+    runAll(state, &pool);
+}
+BENCHMARK(BM_SceneGraphAllParallel)->RangeMultiplier(8)->Range(1 << 10, 1 << 16)->UseRealTime();
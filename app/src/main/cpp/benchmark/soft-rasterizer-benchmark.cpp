@@ -0,0 +1,80 @@
+#include <benchmark/benchmark.h>
+#include <thread>
+#include "es-util.h"
+#include "mesh-generator.h"
+#include "soft-rasterizer.h"
+
+// 软件光栅化的吞吐量：720p 帧缓冲区中排成方阵的球体和立方体，
+// 每次迭代清屏、提交全部物体并 flush，triangles_per_second 为每秒处理的三角形数（含被剔除的），
+// fragments 为每帧写入的像素数；参数为线程数及着色方式（0 flat，1 Gouraud）。
+
+#define RASTER_WIDTH 1280
+#define RASTER_HEIGHT 720
+#define RASTER_GRID 8
+
+static void rasterArgs(benchmark::internal::Benchmark *bench) {
+    int maxThreads = (int) std::thread::hardware_concurrency();
+    if (maxThreads < 1) {
+        maxThreads = 1;
+    }
+    for (int shading = 0; shading <= 1; shading++) {
+        for (int threads = 1; threads < maxThreads; threads *= 2) {
+            bench->Args({threads, shading});
+        }
+        bench->Args({maxThreads, shading});
+    }
+}
+
+static void drawGrid(SoftRasterizer *rasterizer, SoftDrawState *state, const Mesh &mesh) {
+    for (int row = 0; row < RASTER_GRID; row++) {
+        for (int column = 0; column < RASTER_GRID; column++) {
+            matrixLoadIdentity(&state->model);
+            translate(&state->model, (float) column * 2.5f - 8.75f, (float) row * 2.5f - 8.75f, 0.0f);
+            rotate(&state->model, (float) (row * RASTER_GRID + column) * 11.0f, 0.3f, 1.0f, 0.2f);
+            softRasterizerDrawMesh(rasterizer, state, &mesh);
+        }
+    }
+}
+
+static void rasterize(benchmark::State &state, Mesh &mesh) {
+    static const GLfloat clearColor[4] = {0.1f, 0.1f, 0.1f, 1.0f};
+    ThreadPool pool((int) state.range(0));
+    SoftFramebuffer framebuffer;
+    SoftRasterizer rasterizer;
+    SoftDrawState drawState;
+    Matrix view, projection;
+    softFramebufferInit(&framebuffer, RASTER_WIDTH, RASTER_HEIGHT);
+    softRasterizerInit(&rasterizer, &framebuffer, &pool);
+    softDrawStateDefault(&drawState);
+    drawState.shading = state.range(1) ? SOFT_SHADE_GOURAUD : SOFT_SHADE_FLAT;
+    matrixLookAt(&view, 0.0f, 0.0f, 22.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f);
+    matrixLoadIdentity(&projection);
+    perspective(&projection, 60.0f, (float) RASTER_WIDTH / RASTER_HEIGHT, 0.1f, 100.0f);
+    matrixMultiply(&drawState.viewProj, &view, &projection);
+    for (auto _ : state) {
+        softFramebufferClear(&framebuffer, clearColor, 1.0f);
+        drawGrid(&rasterizer, &drawState, mesh);
+        softRasterizerFlush(&rasterizer);
+        benchmark::ClobberMemory();
+    }
+    state.counters["triangles_per_second"] = benchmark::Counter(
+            (double) rasterizer.stats.triangles, benchmark::Counter::kIsRate);
+    state.counters["fragments"] = benchmark::Counter((double) rasterizer.stats.fragments,
+                                                     benchmark::Counter::kAvgIterations);
+    softRasterizerRelease(&rasterizer);
+    softFramebufferRelease(&framebuffer);
+}
+
+static void BM_SoftRasterSpheres(benchmark::State &state) {
+    Mesh mesh;
+    createSphereMesh(&mesh, 64, 1.0f);
+    rasterize(state, mesh);
+}
+BENCHMARK(BM_SoftRasterSpheres)->Apply(rasterArgs)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_SoftRasterCubes(benchmark::State &state) {
+    Mesh mesh;
+    createCubeMesh(&mesh, 1.0f);
+    rasterize(state, mesh);
+}
+BENCHMARK(BM_SoftRasterCubes)->Apply(rasterArgs)->Unit(benchmark::kMillisecond)->UseRealTime();
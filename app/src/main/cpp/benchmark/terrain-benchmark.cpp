@@ -0,0 +1,116 @@
+#include <benchmark/benchmark.h>
+#include <string>
+#include <vector>
+#include "terrain-tiles.h"
+
+// 地形缓存：相机沿对角线来回移动（TERRAIN_PATROL 块）时每次更新视野的开销。
+// 增量更新只处理进入和离开视野的块，与视野的边长成正比；作为对比，全量更新每次清空缓存后重新设置整个视野矩形。
+// Load 同时把需要加载的块从映射的文件拷贝到暂存区，即 I/O 线程的工作量（文件在页缓存中）。
+
+#define TERRAIN_TILE_SIZE 65
+#define TERRAIN_TILES 64
+#define TERRAIN_CACHE_TILES 64
+#define TERRAIN_PATROL 8
+
+static uint16_t sampleHeight(int x, int y, void *) {
+    return (uint16_t) ((x * 7919 + y * 104729) & 0xffff);
+}
+
+//第 step 次更新时相机所在的块，在 [16, 16 + TERRAIN_PATROL] 之间往返，返回时经过的块可能仍在缓存中
+static int patrolTile(int step) {
+    int phase = step % (2 * TERRAIN_PATROL);
+    return 16 + (phase < TERRAIN_PATROL ? phase : 2 * TERRAIN_PATROL - phase);
+}
+
+static const std::string &terrainPath() {
+    static std::string path;
+    if (path.empty()) {
+        const char *dir = getenv("TMPDIR");
+        path = std::string(dir ? dir : "/tmp") + "/es-util-benchmark.terrain";
+        terrainFileWrite(path.c_str(), TERRAIN_TILE_SIZE, TERRAIN_TILES, TERRAIN_TILES, 1.0f,
+                         0.01f, 0.0f, sampleHeight, NULL);
+    }
+    return path;
+}
+
+static void BM_TerrainViewIncremental(benchmark::State &state) {
+    int radius = (int) state.range(0);
+    int side = 2 * radius + 1;
+    TerrainCache cache;
+    std::vector<TerrainLoad> loads(side * side);
+    int step = 0;
+    terrainCacheInit(&cache, TERRAIN_TILES, TERRAIN_TILES, side * side + TERRAIN_CACHE_TILES);
+    for (auto _ : state) {
+        int x = patrolTile(step);
+        int count = terrainCacheSetView(&cache, x - radius, x - radius, x + radius + 1,
+                                        x + radius + 1, loads.data());
+        for (int i = 0; i < count; i++) {
+            terrainCacheLoaded(&cache, loads[i].tile);
+        }
+        step++;
+    }
+    state.counters["entered"] = benchmark::Counter((double) cache.stats.entered,
+                                                   benchmark::Counter::kAvgIterations);
+    state.counters["hitRate"] = (double) cache.stats.hits /
+                                (double) (cache.stats.hits + cache.stats.misses);
+    terrainCacheRelease(&cache);
+}
+BENCHMARK(BM_TerrainViewIncremental)->Arg(2)->Arg(4)->Arg(8);
+
+static void BM_TerrainViewFull(benchmark::State &state) {
+    int radius = (int) state.range(0);
+    int side = 2 * radius + 1;
+    TerrainCache cache;
+    std::vector<TerrainLoad> loads(side * side);
+    int step = 0;
+    terrainCacheInit(&cache, TERRAIN_TILES, TERRAIN_TILES, side * side + TERRAIN_CACHE_TILES);
+    for (auto _ : state) {
+        int x = patrolTile(step);
+        // 先移出地图再设置，等价于每次重新处理整个视野
+        terrainCacheSetView(&cache, 0, 0, 0, 0, loads.data());
+        int count = terrainCacheSetView(&cache, x - radius, x - radius, x + radius + 1,
+                                        x + radius + 1, loads.data());
+        for (int i = 0; i < count; i++) {
+            terrainCacheLoaded(&cache, loads[i].tile);
+        }
+        step++;
+    }
+    state.counters["entered"] = benchmark::Counter((double) cache.stats.entered,
+                                                   benchmark::Counter::kAvgIterations);
+    terrainCacheRelease(&cache);
+}
+BENCHMARK(BM_TerrainViewFull)->Arg(2)->Arg(4)->Arg(8);
+
+static void BM_TerrainViewLoad(benchmark::State &state) {
+    int radius = (int) state.range(0);
+    int side = 2 * radius + 1;
+    int slotCount = side * side + TERRAIN_CACHE_TILES;
+    TerrainFile file;
+    TerrainCache cache;
+    std::vector<TerrainLoad> loads(side * side);
+    int step = 0;
+    long bytes = 0;
+    if (!terrainFileOpen(&file, terrainPath().c_str())) {
+        state.SkipWithError("could not open terrain");
+        return;
+    }
+    std::vector<unsigned char> staging(file.tileBytes * slotCount);
+    terrainCacheInit(&cache, TERRAIN_TILES, TERRAIN_TILES, slotCount);
+    for (auto _ : state) {
+        int x = patrolTile(step);
+        int count = terrainCacheSetView(&cache, x - radius, x - radius, x + radius + 1,
+                                        x + radius + 1, loads.data());
+        for (int i = 0; i < count; i++) {
+            memcpy(staging.data() + file.tileBytes * loads[i].slot,
+                   terrainFileTile(&file, loads[i].tile), file.tileBytes);
+            terrainCacheLoaded(&cache, loads[i].tile);
+        }
+        bytes += (long) (count * file.tileBytes);
+        benchmark::ClobberMemory();
+        step++;
+    }
+    state.SetBytesProcessed(bytes);
+    terrainCacheRelease(&cache);
+    terrainFileClose(&file);
+}
+BENCHMARK(BM_TerrainViewLoad)->Arg(2)->Arg(4)->Arg(8);
@@ -0,0 +1,102 @@
+#include <benchmark/benchmark.h>
+#include <fcntl.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+#include "texture-container.h"
+
+// 纹理容器：打开（映射 + 解析文件头）的开销，以及把最大级别按 PBO 大小的片段拷贝到上传缓冲区的吞吐量。
+// mmap 方式直接从映射的文件拷贝到 PBO，只有一次拷贝；read 方式先 pread 到中间缓冲区再拷贝到 PBO。
+// 文件在页缓存中，测量的是 CPU 拷贝开销而不是存储设备。
+
+#define TEXTURE_SIZE 2048
+#define TEXTURE_LEVELS 12
+#define TEXTURE_VK_FORMAT 151  // VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK
+#define TEXTURE_CHUNK (1024 * 1024)
+
+static const std::string &texturePath() {
+    static std::string path;
+    if (path.empty()) {
+        const char *dir = getenv("TMPDIR");
+        TextureFormat format;
+        std::vector<std::vector<unsigned char>> levels(TEXTURE_LEVELS);
+        std::vector<const void *> levelData(TEXTURE_LEVELS);
+        path = std::string(dir ? dir : "/tmp") + "/es-util-benchmark.ktx2";
+        textureFormatFromVk(TEXTURE_VK_FORMAT, &format);
+        for (int level = 0; level < TEXTURE_LEVELS; level++) {
+            levels[level].resize(textureLevelSize(&format, TEXTURE_SIZE, TEXTURE_SIZE, level));
+            for (size_t i = 0; i < levels[level].size(); i++) {
+                levels[level][i] = (unsigned char) (i * 31 + level);
+            }
+            levelData[level] = levels[level].data();
+        }
+        textureContainerWrite(path.c_str(), TEXTURE_VK_FORMAT, TEXTURE_SIZE, TEXTURE_SIZE,
+                              TEXTURE_LEVELS, levelData.data());
+    }
+    return path;
+}
+
+static void BM_TextureContainerOpen(benchmark::State &state) {
+    const std::string &path = texturePath();
+    TextureContainer container;
+    for (auto _ : state) {
+        if (!textureContainerOpen(&container, path.c_str())) {
+            state.SkipWithError("could not open texture");
+            break;
+        }
+        benchmark::DoNotOptimize(container.levels[0].data);
+        textureContainerClose(&container);
+    }
+}
+BENCHMARK(BM_TextureContainerOpen)->Unit(benchmark::kMicrosecond);
+
+static void BM_TextureLevelCopyMmap(benchmark::State &state) {
+    TextureContainer container;
+    std::vector<unsigned char> pbo(TEXTURE_CHUNK);
+    if (!textureContainerOpen(&container, texturePath().c_str())) {
+        state.SkipWithError("could not open texture");
+        return;
+    }
+    const TextureLevel *level = &container.levels[0];
+    for (auto _ : state) {
+        for (size_t offset = 0; offset < level->size; offset += TEXTURE_CHUNK) {
+            size_t size = level->size - offset < TEXTURE_CHUNK ? level->size - offset : TEXTURE_CHUNK;
+            memcpy(pbo.data(), level->data + offset, size);
+            benchmark::ClobberMemory();
+        }
+    }
+    state.SetBytesProcessed((int64_t) state.iterations() * (int64_t) level->size);
+    textureContainerClose(&container);
+}
+BENCHMARK(BM_TextureLevelCopyMmap)->Unit(benchmark::kMicrosecond);
+
+static void BM_TextureLevelCopyRead(benchmark::State &state) {
+    TextureContainer container;
+    std::vector<unsigned char> staging(TEXTURE_CHUNK);
+    std::vector<unsigned char> pbo(TEXTURE_CHUNK);
+    int fd = open(texturePath().c_str(), O_RDONLY);
+    if (fd < 0 || !textureContainerOpen(&container, texturePath().c_str())) {
+        state.SkipWithError("could not open texture");
+        if (fd >= 0) {
+            close(fd);
+        }
+        return;
+    }
+    const TextureLevel *level = &container.levels[0];
+    off_t base = (off_t) (level->data - (const unsigned char *) container.mapping);
+    for (auto _ : state) {
+        for (size_t offset = 0; offset < level->size; offset += TEXTURE_CHUNK) {
+            size_t size = level->size - offset < TEXTURE_CHUNK ? level->size - offset : TEXTURE_CHUNK;
+            if (pread(fd, staging.data(), size, base + (off_t) offset) != (ssize_t) size) {
+                state.SkipWithError("short read");
+                break;
+            }
+            memcpy(pbo.data(), staging.data(), size);
+            benchmark::ClobberMemory();
+        }
+    }
+    state.SetBytesProcessed((int64_t) state.iterations() * (int64_t) level->size);
+    textureContainerClose(&container);
+    close(fd);
+}
+BENCHMARK(BM_TextureLevelCopyRead)->Unit(benchmark::kMicrosecond);
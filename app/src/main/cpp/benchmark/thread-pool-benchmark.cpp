@@ -0,0 +1,98 @@
+#include <benchmark/benchmark.h>
+#include <cmath>
+#include <thread>
+#include <vector>
+#include "es-util.h"
+#include "instance-recorder.h"
+#include "thread-pool.h"
+
+// 线程池的扩展性：线程数从 1 增加到 CPU 核数，
+// 比较录制实例（变换 + 剔除 + 写入实例缓冲区）及负载不均的 parallelFor 的耗时。
+// 计时使用实际时间，items_per_second 随线程数的变化即为加速比。
+
+static void threadCounts(benchmark::internal::Benchmark *bench, const std::vector<int> &sizes) {
+    int maxThreads = (int) std::thread::hardware_concurrency();
+    if (maxThreads < 1) {
+        maxThreads = 1;
+    }
+    for (int size : sizes) {
+        for (int threads = 1; threads < maxThreads; threads *= 2) {
+            bench->Args({size, threads});
+        }
+        bench->Args({size, maxThreads});
+    }
+}
+
+static void sceneObjects(std::vector<RecordObject> &objects) {
+    int side = (int) sqrtf((float) objects.size());
+    for (size_t i = 0; i < objects.size(); i++) {
+        RecordObject &object = objects[i];
+        // 物体在 x-z 平面上排成方阵，相机在中心，约一半在视锥外
+        object.position[0] = (float) ((int) i % side - side / 2) * 2.0f;
+        object.position[1] = 0.0f;
+        object.position[2] = (float) ((int) i / side - side / 2) * 2.0f;
+        object.axis[0] = 0.0f;
+        object.axis[1] = 1.0f;
+        object.axis[2] = 0.0f;
+        object.angle = (float) (i % 360);
+        object.scale = 0.5f;
+        object.radius = 1.0f;
+        object.color[0] = object.color[1] = object.color[2] = object.color[3] = 1.0f;
+    }
+}
+
+static void BM_RecordInstances(benchmark::State &state) {
+    int count = (int) state.range(0);
+    std::vector<RecordObject> objects(count);
+    std::vector<InstanceData> instances(count);
+    InstanceRecorder recorder;
+    ThreadPool pool((int) state.range(1));
+    Matrix view, projection, viewProj;
+    Frustum frustum;
+    int written = 0;
+    sceneObjects(objects);
+    instanceRecorderInit(&recorder, count);
+    matrixLookAt(&view, 0.0f, 10.0f, 0.0f, 0.0f, 0.0f, -50.0f, 0.0f, 1.0f, 0.0f);
+    matrixLoadIdentity(&projection);
+    perspective(&projection, 60.0f, 16.0f / 9.0f, 0.1f, 500.0f);
+    matrixMultiply(&viewProj, &view, &projection);
+    frustumFromMatrix(&frustum, &viewProj);
+    for (auto _ : state) {
+        written = recordInstances(&recorder, objects.data(), count, &viewProj, &frustum,
+                                  instances.data(), count, &pool);
+        benchmark::ClobberMemory();
+    }
+    state.counters["visible"] = (double) written;
+    state.counters["steals"] = benchmark::Counter((double) pool.steals(),
+                                                  benchmark::Counter::kAvgIterations);
+    state.SetItemsProcessed(state.iterations() * count);
+    instanceRecorderRelease(&recorder);
+}
+BENCHMARK(BM_RecordInstances)->Apply([](benchmark::internal::Benchmark *bench) {
+    threadCounts(bench, {4096, 65536});
+})->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+// 第 i 个元素的计算量与 i 成正比，平均切分后最后一个线程的工作量最大，需要靠窃取平衡
+static void BM_ParallelForImbalanced(benchmark::State &state) {
+    int count = (int) state.range(0);
+    std::vector<float> results(count);
+    ThreadPool pool((int) state.range(1));
+    for (auto _ : state) {
+        pool.parallelFor(0, count, 16, [&](int begin, int end) {
+            for (int i = begin; i < end; i++) {
+                float sum = 0.0f;
+                for (int k = 0; k < i; k++) {
+                    sum += sinf((float) k);
+                }
+                results[i] = sum;
+            }
+        });
+        benchmark::ClobberMemory();
+    }
+    state.counters["steals"] = benchmark::Counter((double) pool.steals(),
+                                                  benchmark::Counter::kAvgIterations);
+    state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_ParallelForImbalanced)->Apply([](benchmark::internal::Benchmark *bench) {
+    threadCounts(bench, {2048});
+})->Unit(benchmark::kMillisecond)->UseRealTime();
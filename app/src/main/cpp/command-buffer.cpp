@@ -0,0 +1,220 @@
+#include "include/command-buffer.h"
+
+//缓冲区初始可容纳的命令数
+#define INITIAL_COMMANDS 32
+
+bool commandBufferInit(CommandBuffer *buffer, int capacity) {
+    memset(buffer, 0, sizeof(CommandBuffer));
+    buffer->commands = (RenderCommand *) malloc(sizeof(RenderCommand) * capacity);
+    if (!buffer->commands) {
+        return false;
+    }
+    buffer->capacity = capacity;
+    return true;
+}
+
+void commandBufferRelease(CommandBuffer *buffer) {
+    free(buffer->commands);
+    memset(buffer, 0, sizeof(CommandBuffer));
+}
+
+void commandBufferReset(CommandBuffer *buffer) {
+    buffer->count = 0;
+    buffer->endsFrame = false;
+}
+
+RenderCommand *commandBufferPush(CommandBuffer *buffer, RenderCommandType type) {
+    if (buffer->count == buffer->capacity) {
+        int capacity = buffer->capacity > 0 ? buffer->capacity * 2 : INITIAL_COMMANDS;
+        RenderCommand *commands = (RenderCommand *) realloc(buffer->commands,
+                                                            sizeof(RenderCommand) * capacity);
+        if (!commands) {
+            ALOGE("Could not grow command buffer to %d commands", capacity);
+            return NULL;
+        }
+        buffer->commands = commands;
+        buffer->capacity = capacity;
+    }
+    RenderCommand *command = &buffer->commands[buffer->count++];
+    command->type = type;
+    return command;
+}
+
+bool commandCall(CommandBuffer *buffer, void (*fn)(void *data), void *data) {
+    RenderCommand *command = commandBufferPush(buffer, CMD_CALL);
+    if (!command) {
+        return false;
+    }
+    command->call.fn = fn;
+    command->call.data = data;
+    return true;
+}
+
+bool commandViewport(CommandBuffer *buffer, GLint x, GLint y, GLsizei width, GLsizei height) {
+    RenderCommand *command = commandBufferPush(buffer, CMD_VIEWPORT);
+    if (!command) {
+        return false;
+    }
+    command->viewport.x = x;
+    command->viewport.y = y;
+    command->viewport.width = width;
+    command->viewport.height = height;
+    return true;
+}
+
+bool commandClearColor(CommandBuffer *buffer, GLfloat r, GLfloat g, GLfloat b, GLfloat a) {
+    RenderCommand *command = commandBufferPush(buffer, CMD_CLEAR_COLOR);
+    if (!command) {
+        return false;
+    }
+    command->clearColor.color[0] = r;
+    command->clearColor.color[1] = g;
+    command->clearColor.color[2] = b;
+    command->clearColor.color[3] = a;
+    return true;
+}
+
+bool commandClear(CommandBuffer *buffer, GLbitfield mask) {
+    RenderCommand *command = commandBufferPush(buffer, CMD_CLEAR);
+    if (!command) {
+        return false;
+    }
+    command->clear.mask = mask;
+    return true;
+}
+
+bool commandDrawMesh(CommandBuffer *buffer, const MeshBuffer *mesh, const ProgramHandle *program,
+                     GLuint texture, float depth) {
+    RenderCommand *command = commandBufferPush(buffer, CMD_DRAW_MESH);
+    if (!command) {
+        return false;
+    }
+    command->draw.mesh = mesh;
+    command->draw.program = program;
+    command->draw.texture = texture;
+    command->draw.depth = depth;
+    return true;
+}
+
+bool commandDrawInstances(CommandBuffer *buffer, InstanceStream *stream,
+                          const ProgramHandle *program, int segment, int count, float depth) {
+    RenderCommand *command = commandBufferPush(buffer, CMD_DRAW_INSTANCES);
+    if (!command) {
+        return false;
+    }
+    command->instances.stream = stream;
+    command->instances.program = program;
+    command->instances.segment = segment;
+    command->instances.count = count;
+    command->instances.depth = depth;
+    return true;
+}
+
+bool commandPresent(CommandBuffer *buffer) {
+    if (!commandBufferPush(buffer, CMD_PRESENT)) {
+        return false;
+    }
+    buffer->endsFrame = true;
+    return true;
+}
+
+SpscQueue::SpscQueue(int capacity) {
+    unsigned size = 1;
+    while (size < (unsigned) capacity) {
+        size <<= 1;
+    }
+    slots = (CommandBuffer **) calloc(size, sizeof(CommandBuffer *));
+    mask = size - 1;
+}
+
+SpscQueue::~SpscQueue() {
+    free(slots);
+}
+
+bool SpscQueue::push(CommandBuffer *buffer) {
+    unsigned t = tail.load(std::memory_order_relaxed);
+    if (t - cachedHead > mask) {
+        // 缓存的 head 显示队列已满时才重新读取，减少对消费者缓存行的访问
+        cachedHead = head.load(std::memory_order_acquire);
+        if (t - cachedHead > mask) {
+            return false;
+        }
+    }
+    slots[t & mask] = buffer;
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+}
+
+CommandBuffer *SpscQueue::pop() {
+    unsigned h = head.load(std::memory_order_relaxed);
+    if (h == cachedTail) {
+        cachedTail = tail.load(std::memory_order_acquire);
+        if (h == cachedTail) {
+            return NULL;
+        }
+    }
+    CommandBuffer *buffer = slots[h & mask];
+    head.store(h + 1, std::memory_order_release);
+    return buffer;
+}
+
+CommandChannel::CommandChannel(std::thread::id owner)
+        : ownerId(owner), submitted(CHANNEL_MAX_BUFFERS), recycled(CHANNEL_MAX_BUFFERS) {
+    memset(buffers, 0, sizeof(buffers));
+}
+
+CommandChannel::~CommandChannel() {
+    int i;
+    for (i = 0; i < allocatedBuffers; i++) {
+        commandBufferRelease(&buffers[i]);
+    }
+}
+
+CommandBuffer *CommandChannel::begin() {
+    CommandBuffer *buffer = recycled.pop();
+    if (!buffer) {
+        // 没有可复用的缓冲区时新建一个，上限之内不会阻塞
+        if (allocatedBuffers == CHANNEL_MAX_BUFFERS) {
+            return NULL;
+        }
+        buffer = &buffers[allocatedBuffers];
+        if (!commandBufferInit(buffer, INITIAL_COMMANDS)) {
+            return NULL;
+        }
+        allocatedBuffers++;
+    }
+    commandBufferReset(buffer);
+    return buffer;
+}
+
+bool CommandChannel::submit(CommandBuffer *buffer) {
+    // 先计数再入队，保证 framesInFlight 不会因渲染线程先完成而变为负数；
+    // 队列容量等于缓冲区上限，正常情况下不会满
+    if (buffer->endsFrame) {
+        submittedFrames.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (!submitted.push(buffer)) {
+        if (buffer->endsFrame) {
+            submittedFrames.fetch_sub(1, std::memory_order_relaxed);
+        }
+        return false;
+    }
+    return true;
+}
+
+int CommandChannel::framesInFlight() const {
+    return submittedFrames.load(std::memory_order_relaxed) -
+           completedFrames.load(std::memory_order_acquire);
+}
+
+CommandBuffer *CommandChannel::acquire() {
+    return submitted.pop();
+}
+
+void CommandChannel::recycle(CommandBuffer *buffer) {
+    bool endsFrame = buffer->endsFrame;
+    recycled.push(buffer);
+    if (endsFrame) {
+        completedFrames.fetch_add(1, std::memory_order_release);
+    }
+}
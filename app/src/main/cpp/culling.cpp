@@ -0,0 +1,519 @@
+#include <algorithm>
+#include <atomic>
+#include <vector>
+#include "include/culling.h"
+#include "include/es-simd.h"
+
+//逐个测试时每个并行任务处理的物体数
+#define CULL_GRAIN 2048
+
+void frustumFromMatrix(Frustum *frustum, const Matrix *viewProjection) {
+    // 行向量约定下 clip = v * M，clip 的第 j 个分量对应 M 的第 j 列
+    const GLfloat (*m)[4] = viewProjection->m;
+    int p, i;
+    for (i = 0; i < 4; i++) {
+        frustum->planes[0][i] = m[i][3] + m[i][0];
+        frustum->planes[1][i] = m[i][3] - m[i][0];
+        frustum->planes[2][i] = m[i][3] + m[i][1];
+        frustum->planes[3][i] = m[i][3] - m[i][1];
+        frustum->planes[4][i] = m[i][3] + m[i][2];
+        frustum->planes[5][i] = m[i][3] - m[i][2];
+    }
+    for (p = 0; p < 6; p++) {
+        float *plane = frustum->planes[p];
+        float length = sqrtf(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+        if (length > 0.0f) {
+            for (i = 0; i < 4; i++) {
+                plane[i] /= length;
+            }
+        }
+    }
+}
+
+static float *allocFloats(int count) {
+    void *ptr = NULL;
+    if (posix_memalign(&ptr, 32, sizeof(float) * (count > 0 ? count : 1)) != 0) {
+        return NULL;
+    }
+    return (float *) ptr;
+}
+
+bool cullSpheresInit(CullSpheres *spheres, int capacity) {
+    memset(spheres, 0, sizeof(CullSpheres));
+    spheres->x = allocFloats(capacity);
+    spheres->y = allocFloats(capacity);
+    spheres->z = allocFloats(capacity);
+    spheres->radius = allocFloats(capacity);
+    if (!spheres->x || !spheres->y || !spheres->z || !spheres->radius) {
+        cullSpheresRelease(spheres);
+        return false;
+    }
+    spheres->capacity = capacity;
+    return true;
+}
+
+void cullSpheresRelease(CullSpheres *spheres) {
+    free(spheres->x);
+    free(spheres->y);
+    free(spheres->z);
+    free(spheres->radius);
+    memset(spheres, 0, sizeof(CullSpheres));
+}
+
+bool cullAabbsInit(CullAabbs *boxes, int capacity) {
+    memset(boxes, 0, sizeof(CullAabbs));
+    boxes->minX = allocFloats(capacity);
+    boxes->minY = allocFloats(capacity);
+    boxes->minZ = allocFloats(capacity);
+    boxes->maxX = allocFloats(capacity);
+    boxes->maxY = allocFloats(capacity);
+    boxes->maxZ = allocFloats(capacity);
+    if (!boxes->minX || !boxes->minY || !boxes->minZ ||
+        !boxes->maxX || !boxes->maxY || !boxes->maxZ) {
+        cullAabbsRelease(boxes);
+        return false;
+    }
+    boxes->capacity = capacity;
+    return true;
+}
+
+void cullAabbsRelease(CullAabbs *boxes) {
+    free(boxes->minX);
+    free(boxes->minY);
+    free(boxes->minZ);
+    free(boxes->maxX);
+    free(boxes->maxY);
+    free(boxes->maxZ);
+    memset(boxes, 0, sizeof(CullAabbs));
+}
+
+void cullAabbsSet(CullAabbs *boxes, int index, const float min[3], const float max[3]) {
+    boxes->minX[index] = min[0];
+    boxes->minY[index] = min[1];
+    boxes->minZ[index] = min[2];
+    boxes->maxX[index] = max[0];
+    boxes->maxY[index] = max[1];
+    boxes->maxZ[index] = max[2];
+    if (index >= boxes->count) {
+        boxes->count = index + 1;
+    }
+}
+
+void cullSpheresSet(CullSpheres *spheres, int index, const float center[3], float radius) {
+    spheres->x[index] = center[0];
+    spheres->y[index] = center[1];
+    spheres->z[index] = center[2];
+    spheres->radius[index] = radius;
+    if (index >= spheres->count) {
+        spheres->count = index + 1;
+    }
+}
+
+bool frustumContainsSphere(const Frustum *frustum, const float center[3], float radius) {
+    int p;
+    for (p = 0; p < 6; p++) {
+        const float *plane = frustum->planes[p];
+        if (plane[0] * center[0] + plane[1] * center[1] + plane[2] * center[2] + plane[3] <
+            -radius) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int cullSpheres(const Frustum *frustum, const CullSpheres *spheres, int begin, int end,
+                uint8_t *visible) {
+    int visibleCount = 0;
+    int i = begin;
+    int p, k;
+#ifdef ES_SIMD
+    vfloat a[6], b[6], c[6], d[6];
+    vfloat zero = vsplat(0.0f);
+    for (p = 0; p < 6; p++) {
+        a[p] = vsplat(frustum->planes[p][0]);
+        b[p] = vsplat(frustum->planes[p][1]);
+        c[p] = vsplat(frustum->planes[p][2]);
+        d[p] = vsplat(frustum->planes[p][3]);
+    }
+    for (; i + ES_SIMD_WIDTH <= end; i += ES_SIMD_WIDTH) {
+        vfloat x = vload(spheres->x + i);
+        vfloat y = vload(spheres->y + i);
+        vfloat z = vload(spheres->z + i);
+        vfloat r = vload(spheres->radius + i);
+        vfloat inside = vtrue();
+        for (p = 0; p < 6; p++) {
+            // 到平面的距离 + 半径 >= 0 时与内侧相交
+            vfloat dist = vmadd(c[p], z, vmadd(b[p], y, vmadd(a[p], x, d[p])));
+            inside = vand(inside, vge(vadd(dist, r), zero));
+        }
+        int mask = vmask(inside);
+        for (k = 0; k < ES_SIMD_WIDTH; k++) {
+            visible[i + k] = (uint8_t) ((mask >> k) & 1);
+        }
+        visibleCount += __builtin_popcount(mask);
+    }
+#endif
+    for (; i < end; i++) {
+        const float center[3] = {spheres->x[i], spheres->y[i], spheres->z[i]};
+        visible[i] = frustumContainsSphere(frustum, center, spheres->radius[i]);
+        visibleCount += visible[i];
+    }
+    return visibleCount;
+}
+
+// 每个平面只需测试包围盒在法线方向上最远的顶点（p 顶点）
+static inline bool aabbVisible(const Frustum *frustum, const float min[3], const float max[3]) {
+    int p;
+    for (p = 0; p < 6; p++) {
+        const float *plane = frustum->planes[p];
+        float x = plane[0] >= 0.0f ? max[0] : min[0];
+        float y = plane[1] >= 0.0f ? max[1] : min[1];
+        float z = plane[2] >= 0.0f ? max[2] : min[2];
+        if (plane[0] * x + plane[1] * y + plane[2] * z + plane[3] < 0.0f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int cullAabbs(const Frustum *frustum, const CullAabbs *boxes, int begin, int end,
+              uint8_t *visible) {
+    int visibleCount = 0;
+    int i = begin;
+    int p, k;
+#ifdef ES_SIMD
+    // 法线各分量的符号对所有物体相同，p 顶点取 min 还是 max 数组可以提前确定
+    const float *px[6], *py[6], *pz[6];
+    vfloat a[6], b[6], c[6], d[6];
+    vfloat zero = vsplat(0.0f);
+    for (p = 0; p < 6; p++) {
+        const float *plane = frustum->planes[p];
+        px[p] = plane[0] >= 0.0f ? boxes->maxX : boxes->minX;
+        py[p] = plane[1] >= 0.0f ? boxes->maxY : boxes->minY;
+        pz[p] = plane[2] >= 0.0f ? boxes->maxZ : boxes->minZ;
+        a[p] = vsplat(plane[0]);
+        b[p] = vsplat(plane[1]);
+        c[p] = vsplat(plane[2]);
+        d[p] = vsplat(plane[3]);
+    }
+    for (; i + ES_SIMD_WIDTH <= end; i += ES_SIMD_WIDTH) {
+        vfloat inside = vtrue();
+        for (p = 0; p < 6; p++) {
+            vfloat dist = vmadd(c[p], vload(pz[p] + i),
+                                vmadd(b[p], vload(py[p] + i), vmadd(a[p], vload(px[p] + i), d[p])));
+            inside = vand(inside, vge(dist, zero));
+        }
+        int mask = vmask(inside);
+        for (k = 0; k < ES_SIMD_WIDTH; k++) {
+            visible[i + k] = (uint8_t) ((mask >> k) & 1);
+        }
+        visibleCount += __builtin_popcount(mask);
+    }
+#endif
+    for (; i < end; i++) {
+        const float min[3] = {boxes->minX[i], boxes->minY[i], boxes->minZ[i]};
+        const float max[3] = {boxes->maxX[i], boxes->maxY[i], boxes->maxZ[i]};
+        visible[i] = aabbVisible(frustum, min, max);
+        visibleCount += visible[i];
+    }
+    return visibleCount;
+}
+
+static int cullRanges(int count, ThreadPool *pool, const std::function<int(int, int)> &fn) {
+    if (!pool) {
+        return fn(0, count);
+    }
+    std::atomic<int> total{0};
+    pool->parallelFor(0, count, CULL_GRAIN, [&](int begin, int end) {
+        total.fetch_add(fn(begin, end), std::memory_order_relaxed);
+    });
+    return total.load();
+}
+
+static void fillStats(CullStats *stats, int count, int visibleCount, int nodesVisited,
+                      int objectsTested) {
+    if (stats) {
+        stats->visible = visibleCount;
+        stats->culled = count - visibleCount;
+        stats->nodesVisited = nodesVisited;
+        stats->objectsTested = objectsTested;
+    }
+}
+
+int cullSpheresParallel(const Frustum *frustum, const CullSpheres *spheres, uint8_t *visible,
+                        ThreadPool *pool, CullStats *stats) {
+    int visibleCount = cullRanges(spheres->count, pool, [&](int begin, int end) {
+        return cullSpheres(frustum, spheres, begin, end, visible);
+    });
+    fillStats(stats, spheres->count, visibleCount, 0, spheres->count);
+    return visibleCount;
+}
+
+int cullAabbsParallel(const Frustum *frustum, const CullAabbs *boxes, uint8_t *visible,
+                      ThreadPool *pool, CullStats *stats) {
+    int visibleCount = cullRanges(boxes->count, pool, [&](int begin, int end) {
+        return cullAabbs(frustum, boxes, begin, end, visible);
+    });
+    fillStats(stats, boxes->count, visibleCount, 0, boxes->count);
+    return visibleCount;
+}
+
+static void copyBox(const CullAabbs *boxes, int index, float min[3], float max[3]) {
+    min[0] = boxes->minX[index];
+    min[1] = boxes->minY[index];
+    min[2] = boxes->minZ[index];
+    max[0] = boxes->maxX[index];
+    max[1] = boxes->maxY[index];
+    max[2] = boxes->maxZ[index];
+}
+
+static void growBox(float min[3], float max[3], const float otherMin[3], const float otherMax[3]) {
+    int k;
+    for (k = 0; k < 3; k++) {
+        min[k] = std::min(min[k], otherMin[k]);
+        max[k] = std::max(max[k], otherMax[k]);
+    }
+}
+
+// 叶节点由其物体的包围盒计算，内部节点由两个子节点计算
+static void computeNodeBounds(Bvh *bvh, int index) {
+    BvhNode *node = &bvh->nodes[index];
+    float min[3], max[3];
+    int i;
+    if (node->left < 0) {
+        copyBox(&bvh->boxes, node->first, node->min, node->max);
+        for (i = node->first + 1; i < node->first + node->count; i++) {
+            copyBox(&bvh->boxes, i, min, max);
+            growBox(node->min, node->max, min, max);
+        }
+    } else {
+        const BvhNode *left = &bvh->nodes[node->left];
+        const BvhNode *right = &bvh->nodes[node->left + 1];
+        memcpy(node->min, left->min, sizeof(node->min));
+        memcpy(node->max, left->max, sizeof(node->max));
+        growBox(node->min, node->max, right->min, right->max);
+    }
+}
+
+static void buildNode(Bvh *bvh, int index, int first, int count, const float *centroids) {
+    BvhNode *node = &bvh->nodes[index];
+    float cmin[3] = {INFINITY, INFINITY, INFINITY};
+    float cmax[3] = {-INFINITY, -INFINITY, -INFINITY};
+    int i, k;
+    node->first = first;
+    node->count = count;
+    node->left = -1;
+    if (count <= BVH_LEAF_SIZE) {
+        for (i = first; i < first + count; i++) {
+            bvh->leafOf[i] = index;
+        }
+        return;
+    }
+    for (i = first; i < first + count; i++) {
+        const float *c = &centroids[bvh->objectIds[i] * 3];
+        for (k = 0; k < 3; k++) {
+            cmin[k] = std::min(cmin[k], c[k]);
+            cmax[k] = std::max(cmax[k], c[k]);
+        }
+    }
+    int axis = 0;
+    for (k = 1; k < 3; k++) {
+        if (cmax[k] - cmin[k] > cmax[axis] - cmin[axis]) {
+            axis = k;
+        }
+    }
+    int mid = first + count / 2;
+    std::nth_element(bvh->objectIds + first, bvh->objectIds + mid, bvh->objectIds + first + count,
+                     [&](int a, int b) {
+                         return centroids[a * 3 + axis] < centroids[b * 3 + axis];
+                     });
+    // 节点按先序分配，子节点的编号总是大于父节点，bvhRefit 可以倒序处理
+    int left = bvh->nodeCount;
+    bvh->nodeCount += 2;
+    node->left = left;
+    bvh->nodes[left].parent = index;
+    bvh->nodes[left + 1].parent = index;
+    buildNode(bvh, left, first, mid - first, centroids);
+    buildNode(bvh, left + 1, mid, first + count - mid, centroids);
+}
+
+bool bvhBuild(Bvh *bvh, const CullAabbs *boxes) {
+    int n = boxes->count;
+    int i;
+    memset(bvh, 0, sizeof(Bvh));
+    if (n <= 0) {
+        return false;
+    }
+    bvh->nodes = (BvhNode *) malloc(sizeof(BvhNode) * 2 * n);
+    bvh->objectIds = (int *) malloc(sizeof(int) * n);
+    bvh->objectSlots = (int *) malloc(sizeof(int) * n);
+    bvh->leafOf = (int *) malloc(sizeof(int) * n);
+    bvh->slotVisible = (uint8_t *) malloc(n);
+    float *centroids = (float *) malloc(sizeof(float) * 3 * n);
+    if (!bvh->nodes || !bvh->objectIds || !bvh->objectSlots || !bvh->leafOf ||
+        !bvh->slotVisible || !centroids || !cullAabbsInit(&bvh->boxes, n)) {
+        free(centroids);
+        bvhRelease(bvh);
+        return false;
+    }
+    bvh->count = n;
+    for (i = 0; i < n; i++) {
+        bvh->objectIds[i] = i;
+        centroids[i * 3] = 0.5f * (boxes->minX[i] + boxes->maxX[i]);
+        centroids[i * 3 + 1] = 0.5f * (boxes->minY[i] + boxes->maxY[i]);
+        centroids[i * 3 + 2] = 0.5f * (boxes->minZ[i] + boxes->maxZ[i]);
+    }
+    bvh->nodeCount = 1;
+    bvh->nodes[0].parent = -1;
+    buildNode(bvh, 0, 0, n, centroids);
+    free(centroids);
+    for (i = 0; i < n; i++) {
+        float min[3], max[3];
+        copyBox(boxes, bvh->objectIds[i], min, max);
+        cullAabbsSet(&bvh->boxes, i, min, max);
+        bvh->objectSlots[bvh->objectIds[i]] = i;
+    }
+    bvhRefit(bvh);
+    return true;
+}
+
+void bvhRelease(Bvh *bvh) {
+    free(bvh->nodes);
+    free(bvh->objectIds);
+    free(bvh->objectSlots);
+    free(bvh->leafOf);
+    free(bvh->slotVisible);
+    cullAabbsRelease(&bvh->boxes);
+    memset(bvh, 0, sizeof(Bvh));
+}
+
+void bvhUpdateObject(Bvh *bvh, int object, const float min[3], const float max[3]) {
+    int slot = bvh->objectSlots[object];
+    int node = bvh->leafOf[slot];
+    cullAabbsSet(&bvh->boxes, slot, min, max);
+    while (node >= 0) {
+        computeNodeBounds(bvh, node);
+        node = bvh->nodes[node].parent;
+    }
+}
+
+void bvhSetObject(Bvh *bvh, int object, const float min[3], const float max[3]) {
+    cullAabbsSet(&bvh->boxes, bvh->objectSlots[object], min, max);
+}
+
+void bvhRefit(Bvh *bvh) {
+    int i;
+    for (i = bvh->nodeCount - 1; i >= 0; i--) {
+        computeNodeBounds(bvh, i);
+    }
+}
+
+typedef enum {
+    BOX_OUTSIDE,
+    BOX_INTERSECT,
+    BOX_INSIDE,
+} BoxClass;
+
+static BoxClass classifyBox(const Frustum *frustum, const float min[3], const float max[3]) {
+    BoxClass result = BOX_INSIDE;
+    int p;
+    for (p = 0; p < 6; p++) {
+        const float *plane = frustum->planes[p];
+        // p 顶点在外侧则整个包围盒在外侧，n 顶点在外侧则与平面相交
+        float px = plane[0] >= 0.0f ? max[0] : min[0];
+        float py = plane[1] >= 0.0f ? max[1] : min[1];
+        float pz = plane[2] >= 0.0f ? max[2] : min[2];
+        if (plane[0] * px + plane[1] * py + plane[2] * pz + plane[3] < 0.0f) {
+            return BOX_OUTSIDE;
+        }
+        float nx = plane[0] >= 0.0f ? min[0] : max[0];
+        float ny = plane[1] >= 0.0f ? min[1] : max[1];
+        float nz = plane[2] >= 0.0f ? min[2] : max[2];
+        if (plane[0] * nx + plane[1] * ny + plane[2] * nz + plane[3] < 0.0f) {
+            result = BOX_INTERSECT;
+        }
+    }
+    return result;
+}
+
+//遍历栈的深度，中位数划分的树深度约为 log2(n / BVH_LEAF_SIZE)
+#define BVH_STACK_SIZE 64
+
+static int cullSubtree(Bvh *bvh, const Frustum *frustum, int root, int *nodesVisited,
+                       int *objectsTested) {
+    int stack[BVH_STACK_SIZE];
+    int top = 0;
+    int visibleCount = 0;
+    stack[top++] = root;
+    while (top > 0) {
+        const BvhNode *node = &bvh->nodes[stack[--top]];
+        (*nodesVisited)++;
+        BoxClass cls = classifyBox(frustum, node->min, node->max);
+        if (cls == BOX_OUTSIDE) {
+            continue;
+        }
+        if (cls == BOX_INSIDE) {
+            memset(bvh->slotVisible + node->first, 1, node->count);
+            visibleCount += node->count;
+        } else if (node->left < 0) {
+            visibleCount += cullAabbs(frustum, &bvh->boxes, node->first,
+                                      node->first + node->count, bvh->slotVisible);
+            *objectsTested += node->count;
+        } else {
+            stack[top++] = node->left + 1;
+            stack[top++] = node->left;
+        }
+    }
+    return visibleCount;
+}
+
+int bvhCull(Bvh *bvh, const Frustum *frustum, uint8_t *visible, ThreadPool *pool,
+            CullStats *stats) {
+    int visibleCount = 0;
+    int nodesVisited = 0;
+    int objectsTested = 0;
+    int i;
+    if (bvh->count == 0) {
+        fillStats(stats, 0, 0, 0, 0);
+        return 0;
+    }
+    memset(bvh->slotVisible, 0, bvh->count);
+    if (!pool || pool->size() == 1) {
+        visibleCount = cullSubtree(bvh, frustum, 0, &nodesVisited, &objectsTested);
+    } else {
+        // 从根向下展开，得到足够多的互不相交的子树，每棵子树作为一个任务
+        std::vector<int> subtrees(1, 0);
+        size_t target = (size_t) pool->size() * 4;
+        size_t next = 0;
+        while (subtrees.size() < target && next < subtrees.size()) {
+            const BvhNode *node = &bvh->nodes[subtrees[next]];
+            if (node->left < 0) {
+                next++;
+                continue;
+            }
+            subtrees[next] = node->left;
+            subtrees.push_back(node->left + 1);
+        }
+        std::atomic<int> total{0}, visited{0}, tested{0};
+        pool->parallelFor(0, (int) subtrees.size(), 1, [&](int begin, int end) {
+            int localVisited = 0;
+            int localTested = 0;
+            int localVisible = 0;
+            for (int s = begin; s < end; s++) {
+                localVisible += cullSubtree(bvh, frustum, subtrees[s], &localVisited,
+                                            &localTested);
+            }
+            total.fetch_add(localVisible, std::memory_order_relaxed);
+            visited.fetch_add(localVisited, std::memory_order_relaxed);
+            tested.fetch_add(localTested, std::memory_order_relaxed);
+        });
+        visibleCount = total.load();
+        nodesVisited = visited.load();
+        objectsTested = tested.load();
+    }
+    for (i = 0; i < bvh->count; i++) {
+        visible[bvh->objectIds[i]] = bvh->slotVisible[i];
+    }
+    fillStats(stats, bvh->count, visibleCount, nodesVisited, objectsTested);
+    return visibleCount;
+}
@@ -1,7 +1,11 @@
 #include <cstring>
 #include <GLES3/gl3.h>
 #include "include/es-util.h"
+#include "include/mesh-generator.h"
+#include "include/mesh-optimizer.h"
 
+// 主机基准测试只编译 CPU 部分，不链接 GL 库
+#ifndef ES_UTIL_CPU_ONLY
 
 bool checkGlError(const char *funcName) {
     GLenum err = glGetError();
@@ -12,6 +16,19 @@ bool checkGlError(const char *funcName) {
     return false;
 }
 
+bool hasGlExtension(const char *name) {
+    GLint count = 0;
+    GLint i;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (i = 0; i < count; i++) {
+        const char *ext = (const char *) glGetStringi(GL_EXTENSIONS, i);
+        if (ext && strcmp(ext, name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
 GLuint createShader(GLenum shaderType, const char *src) {
     GLuint shader = glCreateShader(shaderType);
     if (!shader) {
@@ -41,7 +58,7 @@ GLuint createShader(GLenum shaderType, const char *src) {
     return shader;
 }
 
-GLuint createProgram(const char *vtxSrc, const char *fragSrc) {
+GLuint createProgram(const char *vtxSrc, const char *fragSrc, bool binaryRetrievable) {
     GLuint vtxShader = 0;
     GLuint fragShader = 0;
     GLuint program = 0;
@@ -59,6 +76,9 @@ GLuint createProgram(const char *vtxSrc, const char *fragSrc) {
     }
     glAttachShader(program, vtxShader);
     glAttachShader(program, fragShader);
+    if (binaryRetrievable) {
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
     glLinkProgram(program);
     glGetProgramiv(program, GL_LINK_STATUS, &linked);
     if (!linked) {
@@ -82,8 +102,19 @@ GLuint createProgram(const char *vtxSrc, const char *fragSrc) {
     return program;
 }
 
+#endif
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define ES_MATRIX_NEON
+#elif defined(__SSE__) || defined(__i386__) || defined(__x86_64__)
+#include <xmmintrin.h>
+#define ES_MATRIX_SSE
+#endif
+
+// 标量版本，也是 SIMD 版本的参考；本文件以 -ffp-contract=off 编译，乘加不会被合并为 FMA
 void
-matrixMultiply(Matrix *result, Matrix *srcA, Matrix *srcB) {
+matrixMultiplyScalar(Matrix *result, const Matrix *srcA, const Matrix *srcB) {
     Matrix tmp;
     int i;
     for (i = 0; i < 4; i++) {
@@ -107,119 +138,148 @@ matrixMultiply(Matrix *result, Matrix *srcA, Matrix *srcB) {
     memcpy(result, &tmp, sizeof(Matrix));
 }
 
-int createSquareGrid(int size, GLfloat **vertices, GLuint **indices) {
-    GLuint i, j;
-    int numIndices = (size - 1) * (size - 1) * 2 * 3;
-    // Allocate memory for buffers
-    if (vertices != NULL) {
-        int numVertices = size * size;
-        float stepSize = (float) size - 1;
-        *vertices = (GLfloat *) malloc(sizeof(GLfloat) * 3 * numVertices);
-        for (i = 0; i < size; ++i) // row
-        {
-            for (j = 0; j < size; ++j) // column
-            {
-                (*vertices)[3 * (j + i * size)] = i / stepSize;
-                (*vertices)[3 * (j + i * size) + 1] = j / stepSize;
-                (*vertices)[3 * (j + i * size) + 2] = 0.0f;
+// result = srcA * srcB，按行计算：result 第 i 行 = Σ srcA[i][k] * srcB 第 k 行
+// 先把 srcB 整体读入寄存器，result 与 srcA 或 srcB 重叠时结果依然正确；
+// 乘加顺序与标量版本一致（不使用 FMA），保证各实现结果逐位相同
+static inline void
+multiplyKernel(Matrix *result, const Matrix *srcA, const Matrix *srcB) {
+#if defined(ES_MATRIX_NEON)
+    float32x4_t b0 = vld1q_f32(srcB->m[0]);
+    float32x4_t b1 = vld1q_f32(srcB->m[1]);
+    float32x4_t b2 = vld1q_f32(srcB->m[2]);
+    float32x4_t b3 = vld1q_f32(srcB->m[3]);
+    for (int i = 0; i < 4; i++) {
+        float32x4_t a = vld1q_f32(srcA->m[i]);
+        float32x4_t row = vmulq_lane_f32(b0, vget_low_f32(a), 0);
+        row = vaddq_f32(row, vmulq_lane_f32(b1, vget_low_f32(a), 1));
+        row = vaddq_f32(row, vmulq_lane_f32(b2, vget_high_f32(a), 0));
+        row = vaddq_f32(row, vmulq_lane_f32(b3, vget_high_f32(a), 1));
+        vst1q_f32(result->m[i], row);
+    }
+#elif defined(ES_MATRIX_SSE)
+    __m128 b0 = _mm_load_ps(srcB->m[0]);
+    __m128 b1 = _mm_load_ps(srcB->m[1]);
+    __m128 b2 = _mm_load_ps(srcB->m[2]);
+    __m128 b3 = _mm_load_ps(srcB->m[3]);
+    for (int i = 0; i < 4; i++) {
+        __m128 row = _mm_mul_ps(b0, _mm_set1_ps(srcA->m[i][0]));
+        row = _mm_add_ps(row, _mm_mul_ps(b1, _mm_set1_ps(srcA->m[i][1])));
+        row = _mm_add_ps(row, _mm_mul_ps(b2, _mm_set1_ps(srcA->m[i][2])));
+        row = _mm_add_ps(row, _mm_mul_ps(b3, _mm_set1_ps(srcA->m[i][3])));
+        _mm_store_ps(result->m[i], row);
+    }
+#else
+    matrixMultiplyScalar(result, srcA, srcB);
+#endif
+}
+
+void
+matrixMultiply(Matrix *result, Matrix *srcA, Matrix *srcB) {
+    multiplyKernel(result, srcA, srcB);
+}
+
+void
+matrixMultiplyN(Matrix *result, const Matrix *srcA, const Matrix *srcB, int n) {
+    int i;
+    for (i = 0; i < n; i++) {
+        multiplyKernel(&result[i], &srcA[i], &srcB[i]);
+    }
+}
+
+void
+matrixMultiplyBatch(Matrix *result, size_t resultStride, const Matrix *srcA, const Matrix *srcB,
+                    int n) {
+    // srcB 拷到局部变量，编译器可以确定它不与 result 重叠，循环中只读入一次
+    Matrix b = *srcB;
+    int i;
+    for (i = 0; i < n; i++) {
+        multiplyKernel((Matrix *) ((GLubyte *) result + i * resultStride), &srcA[i], &b);
+    }
+}
+
+// 释放输出缓冲区并把指针置为 NULL
+static void freeOutputs(GLfloat **vertices, GLfloat **normals, GLfloat **texCoords,
+                        GLuint **indices) {
+    GLfloat **streams[] = {vertices, normals, texCoords};
+    int i;
+    for (i = 0; i < 3; i++) {
+        if (streams[i]) {
+            free(*streams[i]);
+            *streams[i] = NULL;
+        }
+    }
+    if (indices) {
+        free(*indices);
+        *indices = NULL;
+    }
+}
+
+// 为 createCube/createSquareGrid/createSphere 分配输出缓冲区，指针为 NULL 的输出不分配；
+// 任何一个分配失败时释放已分配的部分并返回 false
+static bool allocateOutputs(int numVertices, int numIndices, GLfloat **vertices, GLfloat **normals,
+                            GLfloat **texCoords, GLuint **indices) {
+    GLfloat **streams[] = {vertices, normals, texCoords};
+    const int components[] = {3, 3, 2};
+    int i;
+    for (i = 0; i < 3; i++) {
+        if (streams[i]) {
+            *streams[i] = NULL;
+        }
+    }
+    if (indices) {
+        *indices = NULL;
+    }
+    for (i = 0; i < 3; i++) {
+        if (streams[i]) {
+            *streams[i] = (GLfloat *) malloc(sizeof(GLfloat) * components[i] * numVertices);
+            if (!*streams[i]) {
+                goto fail;
             }
         }
     }
-    // Generate the indices
-    if (indices != NULL) {
+    if (indices) {
         *indices = (GLuint *) malloc(sizeof(GLuint) * numIndices);
-        for (i = 0; i < size - 1; ++i) {
-            for (j = 0; j < size - 1; ++j) {
-                // two triangles per quad
-                (*indices)[6 * (j + i * (size - 1))] = j + (i) * (size);
-                (*indices)[6 * (j + i * (size - 1)) + 1] = j + (i) * (size) + 1;
-                (*indices)[6 * (j + i * (size - 1)) + 2] = j + (i + 1) * (size) + 1;
-                (*indices)[6 * (j + i * (size - 1)) + 3] = j + (i) * (size);
-                (*indices)[6 * (j + i * (size - 1)) + 4] = j + (i + 1) * (size) + 1;
-                (*indices)[6 * (j + i * (size - 1)) + 5] = j + (i + 1) * (size);
-            }
+        if (!*indices) {
+            goto fail;
         }
     }
+    return true;
+    fail:
+    ALOGE("Failed to allocate mesh buffers for %d vertices", numVertices);
+    freeOutputs(vertices, normals, texCoords, indices);
+    return false;
+}
+
+int createSquareGrid(int size, GLfloat **vertices, GLuint **indices, bool optimize,
+                     MeshOptimizeStats *stats) {
+    int numIndices;
+    // 尺寸非法时 createSquareGridInto 返回 0，在下面统一释放
+    if (!allocateOutputs(squareGridVertexCount(size), squareGridIndexCount(size), vertices, NULL,
+                         NULL, indices)) {
+        return 0;
+    }
+    numIndices = createSquareGridInto(size, vertices ? *vertices : NULL,
+                                      indices ? *indices : NULL, NULL, optimize, stats);
+    if (numIndices == 0) {
+        freeOutputs(vertices, NULL, NULL, indices);
+    }
     return numIndices;
 }
 
 void
 frustum(Matrix *result, float w, float h, float nearZ,
         float farZ) {
-    float left = -w;
-    float right = w;
-    float bottom = -h;
-    float top = h;
-    float deltaX = right - left;
-    float deltaY = top - bottom;
-    float deltaZ = farZ - nearZ;
-    Matrix frust;
-    if ((nearZ <= 0.0f) || (farZ <= 0.0f) ||
-        (deltaX <= 0.0f) || (deltaY <= 0.0f) || (deltaZ <= 0.0f)) {
-        return;
-    }
-    frust.m[0][0] = 2.0f * nearZ / deltaX;
-    frust.m[0][1] = frust.m[0][2] = frust.m[0][3] = 0.0f;
-    frust.m[1][1] = 2.0f * nearZ / deltaY;
-    frust.m[1][0] = frust.m[1][2] = frust.m[1][3] = 0.0f;
-    frust.m[2][0] = (right + left) / deltaX;
-    frust.m[2][1] = (top + bottom) / deltaY;
-    frust.m[2][2] = -(nearZ + farZ) / deltaZ;
-    frust.m[2][3] = -1.0f;
-    frust.m[3][2] = -2.0f * nearZ * farZ / deltaZ;
-    frust.m[3][0] = frust.m[3][1] = frust.m[3][3] = 0.0f;
-    matrixMultiply(result, &frust, result);
+    es::frustumRows(result->m, w, h, nearZ, farZ);
 }
 
 void
 rotate(Matrix *result, GLfloat angle, GLfloat x, GLfloat y, GLfloat z) {
-    GLfloat sinAngle, cosAngle;
-    GLfloat mag = sqrtf(x * x + y * y + z * z);
-    sinAngle = sinf(float(angle * PI / 180.0f));
-    cosAngle = cosf(float(angle * PI / 180.0f));
-    if (mag > 0.0f) {
-        GLfloat xx, yy, zz, xy, yz, zx, xs, ys, zs;
-        GLfloat oneMinusCos;
-        Matrix rotMat;
-        x /= mag;
-        y /= mag;
-        z /= mag;
-        xx = x * x;
-        yy = y * y;
-        zz = z * z;
-        xy = x * y;
-        yz = y * z;
-        zx = z * x;
-        xs = x * sinAngle;
-        ys = y * sinAngle;
-        zs = z * sinAngle;
-        oneMinusCos = 1.0f - cosAngle;
-        rotMat.m[0][0] = (oneMinusCos * xx) + cosAngle;
-        rotMat.m[0][1] = (oneMinusCos * xy) - zs;
-        rotMat.m[0][2] = (oneMinusCos * zx) + ys;
-        rotMat.m[0][3] = 0.0F;
-        rotMat.m[1][0] = (oneMinusCos * xy) + zs;
-        rotMat.m[1][1] = (oneMinusCos * yy) + cosAngle;
-        rotMat.m[1][2] = (oneMinusCos * yz) - xs;
-        rotMat.m[1][3] = 0.0F;
-        rotMat.m[2][0] = (oneMinusCos * zx) - ys;
-        rotMat.m[2][1] = (oneMinusCos * yz) + xs;
-        rotMat.m[2][2] = (oneMinusCos * zz) + cosAngle;
-        rotMat.m[2][3] = 0.0F;
-        rotMat.m[3][0] = 0.0F;
-        rotMat.m[3][1] = 0.0F;
-        rotMat.m[3][2] = 0.0F;
-        rotMat.m[3][3] = 1.0F;
-        matrixMultiply(result, &rotMat, result);
-    }
+    es::rotateRows(result->m, angle, x, y, z);
 }
 
 void
 translate(Matrix *result, GLfloat tx, GLfloat ty, GLfloat tz) {
-    result->m[3][0] += (result->m[0][0] * tx + result->m[1][0] * ty + result->m[2][0] * tz);
-    result->m[3][1] += (result->m[0][1] * tx + result->m[1][1] * ty + result->m[2][1] * tz);
-    result->m[3][2] += (result->m[0][2] * tx + result->m[1][2] * ty + result->m[2][2] * tz);
-    result->m[3][3] += (result->m[0][3] * tx + result->m[1][3] * ty + result->m[2][3] * tz);
+    es::translateRows(result->m, tx, ty, tz);
 }
 
 void
@@ -232,11 +292,11 @@ matrixLoadIdentity(Matrix *result) {
 }
 
 int
-createCube(float scale, GLfloat **vertices, GLfloat **normals,
-           GLfloat **texCoords, GLuint **indices) {
+createCubeInto(float scale, GLfloat *vertices, GLfloat *normals, GLfloat *texCoords,
+               GLuint *indices, bool optimize) {
     int i;
-    int numVertices = 24;
-    int numIndices = 36;
+    int numVertices = CUBE_VERTEX_COUNT;
+    int numIndices = CUBE_INDEX_COUNT;
     GLfloat cubeVerts[] =
             {
                     -0.5f, -0.5f, -0.5f,
@@ -318,65 +378,64 @@ createCube(float scale, GLfloat **vertices, GLfloat **normals,
                     1.0f, 1.0f,
                     1.0f, 0.0f,
             };
+    GLuint cubeIndices[] =
+            {
+                    0, 2, 1,
+                    0, 3, 2,
+                    4, 5, 6,
+                    4, 6, 7,
+                    8, 9, 10,
+                    8, 10, 11,
+                    12, 15, 14,
+                    12, 14, 13,
+                    16, 17, 18,
+                    16, 18, 19,
+                    20, 23, 22,
+                    20, 22, 21
+            };
+    if (optimize) {
+        GLuint remap[CUBE_VERTEX_COUNT];
+        optimizeMesh(cubeIndices, numIndices, numVertices, remap, NULL);
+        remapVertexStream(cubeVerts, sizeof(GLfloat) * 3, numVertices, remap);
+        remapVertexStream(cubeNormals, sizeof(GLfloat) * 3, numVertices, remap);
+        remapVertexStream(cubeTex, sizeof(GLfloat) * 2, numVertices, remap);
+    }
     if (vertices != NULL) {
-        *vertices = (GLfloat *) malloc(sizeof(GLfloat) * 3 * numVertices);
-        memcpy(*vertices, cubeVerts, sizeof(cubeVerts));
         for (i = 0; i < numVertices * 3; i++) {
-            (*vertices)[i] *= scale;
+            vertices[i] = cubeVerts[i] * scale;
         }
     }
     if (normals != NULL) {
-        *normals = (GLfloat *) malloc(sizeof(GLfloat) * 3 * numVertices);
-        memcpy(*normals, cubeNormals, sizeof(cubeNormals));
+        memcpy(normals, cubeNormals, sizeof(cubeNormals));
     }
     if (texCoords != NULL) {
-        *texCoords = (GLfloat *) malloc(sizeof(GLfloat) * 2 * numVertices);
-        memcpy(*texCoords, cubeTex, sizeof(cubeTex));
+        memcpy(texCoords, cubeTex, sizeof(cubeTex));
     }
     if (indices != NULL) {
-        GLuint cubeIndices[] =
-                {
-                        0, 2, 1,
-                        0, 3, 2,
-                        4, 5, 6,
-                        4, 6, 7,
-                        8, 9, 10,
-                        8, 10, 11,
-                        12, 15, 14,
-                        12, 14, 13,
-                        16, 17, 18,
-                        16, 18, 19,
-                        20, 23, 22,
-                        20, 22, 21
-                };
-        *indices = (GLuint *) malloc(sizeof(GLuint) * numIndices);
-        memcpy(*indices, cubeIndices, sizeof(cubeIndices));
+        memcpy(indices, cubeIndices, sizeof(cubeIndices));
     }
     return numIndices;
 }
 
+int
+createCube(float scale, GLfloat **vertices, GLfloat **normals,
+           GLfloat **texCoords, GLuint **indices, bool optimize) {
+    if (!allocateOutputs(CUBE_VERTEX_COUNT, CUBE_INDEX_COUNT, vertices, normals, texCoords,
+                         indices)) {
+        return 0;
+    }
+    return createCubeInto(scale, vertices ? *vertices : NULL, normals ? *normals : NULL,
+                          texCoords ? *texCoords : NULL, indices ? *indices : NULL, optimize);
+}
+
 void
 perspective(Matrix *result, float fovy, float aspect, float nearZ, float farZ) {
-    GLfloat frustumW, frustumH;
-    frustumH = tanf(float(fovy / 360.0f * PI)) * nearZ;
-    frustumW = frustumH * aspect;
-    frustum(result, frustumW, frustumH, nearZ, farZ);
+    es::perspectiveRows(result->m, fovy, aspect, nearZ, farZ);
 }
 
 void
 scale(Matrix *result, GLfloat sx, GLfloat sy, GLfloat sz) {
-    result->m[0][0] *= sx;
-    result->m[0][1] *= sx;
-    result->m[0][2] *= sx;
-    result->m[0][3] *= sx;
-    result->m[1][0] *= sy;
-    result->m[1][1] *= sy;
-    result->m[1][2] *= sy;
-    result->m[1][3] *= sy;
-    result->m[2][0] *= sz;
-    result->m[2][1] *= sz;
-    result->m[2][2] *= sz;
-    result->m[2][3] *= sz;
+    es::scaleRows(result->m, sx, sy, sz);
 }
 
 void
@@ -384,135 +443,83 @@ matrixLookAt(Matrix *result,
              float posX, float posY, float posZ,
              float lookAtX, float lookAtY, float lookAtZ,
              float upX, float upY, float upZ) {
-    float axisX[3], axisY[3], axisZ[3];
-    float length;
-// axisZ = lookAt - pos
-    axisZ[0] = lookAtX - posX;
-    axisZ[1] = lookAtY - posY;
-    axisZ[2] = lookAtZ - posZ;
-// normalize axisZ
-    length = sqrtf(axisZ[0] * axisZ[0] + axisZ[1] * axisZ[1] + axisZ[2] * axisZ[2]);
-    if (length != 0.0f) {
-        axisZ[0] /= length;
-        axisZ[1] /= length;
-        axisZ[2] /= length;
-    }
-// axisX = up X axisZ
-    axisX[0] = upY * axisZ[2] - upZ * axisZ[1];
-    axisX[1] = upZ * axisZ[0] - upX * axisZ[2];
-    axisX[2] = upX * axisZ[1] - upY * axisZ[0];
-// normalize axisX
-    length = sqrtf(axisX[0] * axisX[0] + axisX[1] * axisX[1] + axisX[2] * axisX[2]);
-    if (length != 0.0f) {
-        axisX[0] /= length;
-        axisX[1] /= length;
-        axisX[2] /= length;
-    }
-// axisY = axisZ x axisX
-    axisY[0] = axisZ[1] * axisX[2] - axisZ[2] * axisX[1];
-    axisY[1] = axisZ[2] * axisX[0] - axisZ[0] * axisX[2];
-    axisY[2] = axisZ[0] * axisX[1] - axisZ[1] * axisX[0];
-// normalize axisY
-    length = sqrtf(axisY[0] * axisY[0] + axisY[1] * axisY[1] + axisY[2] * axisY[2]);
-    if (length != 0.0f) {
-        axisY[0] /= length;
-        axisY[1] /= length;
-        axisY[2] /= length;
-    }
-    memset(result, 0x0, sizeof(Matrix));
-    result->m[0][0] = -axisX[0];
-    result->m[0][1] = axisY[0];
-    result->m[0][2] = -axisZ[0];
-    result->m[1][0] = -axisX[1];
-    result->m[1][1] = axisY[1];
-    result->m[1][2] = -axisZ[1];
-    result->m[2][0] = -axisX[2];
-    result->m[2][1] = axisY[2];
-    result->m[2][2] = -axisZ[2];
-// translate (-posX, -posY, -posZ)
-    result->m[3][0] = axisX[0] * posX + axisX[1] * posY + axisX[2] * posZ;
-    result->m[3][1] = -axisY[0] * posX - axisY[1] * posY - axisY[2] * posZ;
-    result->m[3][2] = axisZ[0] * posX + axisZ[1] * posY + axisZ[2] * posZ;
-    result->m[3][3] = 1.0f;
+    es::lookAtRows(result->m, es::Vec3f(posX, posY, posZ),
+                   es::Vec3f(lookAtX, lookAtY, lookAtZ), es::Vec3f(upX, upY, upZ));
 }
 
 void
 ortho(Matrix *result, float left, float right, float bottom, float top, float nearZ,
       float farZ) {
-    float deltaX = right - left;
-    float deltaY = top - bottom;
-    float deltaZ = farZ - nearZ;
-    Matrix ortho;
-    if ((deltaX == 0.0f) || (deltaY == 0.0f) || (deltaZ == 0.0f)) {
-        return;
-    }
-    matrixLoadIdentity(&ortho);
-    ortho.m[0][0] = 2.0f / deltaX;
-    ortho.m[3][0] = -(right + left) / deltaX;
-    ortho.m[1][1] = 2.0f / deltaY;
-    ortho.m[3][1] = -(top + bottom) / deltaY;
-    ortho.m[2][2] = -2.0f / deltaZ;
-    ortho.m[3][2] = -(nearZ + farZ) / deltaZ;
-    matrixMultiply(result, &ortho, result);
+    es::orthoRows(result->m, left, right, bottom, top, nearZ, farZ);
 }
 
-int
-createSphere(int numSlices, float radius, GLfloat **vertices, GLfloat **normals,
-             GLfloat **texCoords, GLuint **indices) {
-    int i;
-    int j;
-    int numParallels = numSlices / 2;
-    int numVertices = (numParallels + 1) * (numSlices + 1);
-    int numIndices = numParallels * numSlices * 6;
-    float angleStep = (float) (2.0f * PI) / numSlices;
-    // Allocate memory for buffers
-    if (vertices != NULL) {
-        *vertices = (GLfloat *) malloc(sizeof(GLfloat) * 3 * numVertices);
+void
+modelViewProjection(Matrix *result,
+                    const GLfloat eye[3], const GLfloat target[3], const GLfloat up[3],
+                    float fovy, float aspect, float nearZ, float farZ,
+                    const GLfloat translation[3],
+                    GLfloat angle, const GLfloat axis[3],
+                    const GLfloat scaling[3]) {
+    Matrix view;
+    GLfloat model[3][3];
+    GLfloat mv[4][4];
+    GLfloat p[6];
+    GLfloat frustumH;
+    bool hasProjection;
+    int i, j;
+    // model = S * R * T，与依次调用 translate、rotate、scale 相同
+    if (!es::rotationTerms(angle, axis[0], axis[1], axis[2], model)) {
+        memset(model, 0, sizeof(model));
+        model[0][0] = model[1][1] = model[2][2] = 1.0f;
     }
-    if (normals != NULL) {
-        *normals = (GLfloat *) malloc(sizeof(GLfloat) * 3 * numVertices);
+    for (i = 0; i < 3; i++) {
+        model[i][0] *= scaling[i];
+        model[i][1] *= scaling[i];
+        model[i][2] *= scaling[i];
     }
-    if (texCoords != NULL) {
-        *texCoords = (GLfloat *) malloc(sizeof(GLfloat) * 2 * numVertices);
+    matrixLookAt(&view, eye[0], eye[1], eye[2], target[0], target[1], target[2],
+                 up[0], up[1], up[2]);
+    // mv = model * view，二者都是仿射矩阵，第 4 列固定为 (0, 0, 0, 1)
+    for (j = 0; j < 3; j++) {
+        for (i = 0; i < 3; i++) {
+            mv[i][j] = model[i][0] * view.m[0][j] +
+                       model[i][1] * view.m[1][j] +
+                       model[i][2] * view.m[2][j];
+        }
+        mv[3][j] = translation[0] * view.m[0][j] +
+                   translation[1] * view.m[1][j] +
+                   translation[2] * view.m[2][j] + view.m[3][j];
     }
-    if (indices != NULL) {
-        *indices = (GLuint *) malloc(sizeof(GLuint) * numIndices);
+    mv[0][3] = mv[1][3] = mv[2][3] = 0.0f;
+    mv[3][3] = 1.0f;
+    // result = mv * projection，与 perspective 作用于单位矩阵的结果相乘
+    frustumH = tanf(float(fovy / 360.0f * es::kPi)) * nearZ;
+    hasProjection = es::frustumTerms(frustumH * aspect, frustumH, nearZ, farZ, p);
+    if (!hasProjection) {
+        memcpy(result, mv, sizeof(Matrix));
+        return;
     }
-    for (i = 0; i < numParallels + 1; i++) {
-        for (j = 0; j < numSlices + 1; j++) {
-            int vertex = (i * (numSlices + 1) + j) * 3;
-            if (vertices) {
-                (*vertices)[vertex + 0] = radius * sinf(angleStep * (float) i) *
-                                          sinf(angleStep * (float) j);
-                (*vertices)[vertex + 1] = radius * cosf(angleStep * (float) i);
-                (*vertices)[vertex + 2] = radius * sinf(angleStep * (float) i) *
-                                          cosf(angleStep * (float) j);
-            }
-            if (normals) {
-                (*normals)[vertex + 0] = (*vertices)[vertex + 0] / radius;
-                (*normals)[vertex + 1] = (*vertices)[vertex + 1] / radius;
-                (*normals)[vertex + 2] = (*vertices)[vertex + 2] / radius;
-            }
-            if (texCoords) {
-                int texIndex = (i * (numSlices + 1) + j) * 2;
-                (*texCoords)[texIndex + 0] = (float) j / (float) numSlices;
-                (*texCoords)[texIndex + 1] = (1.0f - (float) i) / (float) (numParallels - 1);
-            }
-        }
+    for (i = 0; i < 4; i++) {
+        result->m[i][0] = mv[i][0] * p[0] + mv[i][2] * p[2];
+        result->m[i][1] = mv[i][1] * p[1] + mv[i][2] * p[3];
+        result->m[i][2] = mv[i][2] * p[4] + mv[i][3] * p[5];
+        result->m[i][3] = -mv[i][2];
     }
-    // Generate the indices
-    if (indices != NULL) {
-        GLuint *indexBuf = (*indices);
-        for (i = 0; i < numParallels; i++) {
-            for (j = 0; j < numSlices; j++) {
-                *indexBuf++ = (GLuint) (i * (numSlices + 1) + j);
-                *indexBuf++ = (GLuint) (i + 1) * (numSlices + 1) + j;
-                *indexBuf++ = (GLuint) (i + 1) * (numSlices + 1) + (j + 1);
-                *indexBuf++ = (GLuint) i * (numSlices + 1) + j;
-                *indexBuf++ = (GLuint) (i + 1) * (numSlices + 1) + (j + 1);
-                *indexBuf++ = (GLuint) i * (numSlices + 1) + (j + 1);
-            }
-        }
+}
+
+int
+createSphere(int numSlices, float radius, GLfloat **vertices, GLfloat **normals,
+             GLfloat **texCoords, GLuint **indices, bool optimize, MeshOptimizeStats *stats) {
+    int numIndices;
+    if (!allocateOutputs(sphereVertexCount(numSlices), sphereIndexCount(numSlices), vertices,
+                         normals, texCoords, indices)) {
+        return 0;
+    }
+    numIndices = createSphereInto(numSlices, radius, vertices ? *vertices : NULL,
+                                  normals ? *normals : NULL, texCoords ? *texCoords : NULL,
+                                  indices ? *indices : NULL, NULL, optimize, stats);
+    if (numIndices == 0) {
+        freeOutputs(vertices, normals, texCoords, indices);
     }
     return numIndices;
-}
\ No newline at end of file
+}
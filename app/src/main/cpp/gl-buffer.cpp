@@ -0,0 +1,230 @@
+#include "include/gl-buffer.h"
+
+// 等待 fence 时每次的超时时间（纳秒）
+#define FENCE_WAIT_TIMEOUT 1000000
+
+static GLuint uploadBuffer(GLenum target, GLsizeiptr size, const void *data,
+                           GLenum usage = GL_STATIC_DRAW) {
+    GLuint buffer = 0;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(target, buffer);
+    glBufferData(target, size, data, usage);
+    return buffer;
+}
+
+static void bindAttribBuffer(GLuint buffer, GLuint location, GLint size) {
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    glVertexAttribPointer(location, size, GL_FLOAT, GL_FALSE, 0, (const void *) 0);
+    glEnableVertexAttribArray(location);
+}
+
+bool createMeshBuffer(MeshBuffer *mesh, int numVertices, const GLfloat *vertices,
+                      const GLfloat *normals, const GLfloat *texCoords,
+                      int numIndices, const GLuint *indices) {
+    memset(mesh, 0, sizeof(MeshBuffer));
+    glGenVertexArrays(1, &mesh->vao);
+    glBindVertexArray(mesh->vao);
+    mesh->vbo[VERTEX_ATTRIB_POSITION] = uploadBuffer(GL_ARRAY_BUFFER,
+                                                     sizeof(GLfloat) * 3 * numVertices, vertices);
+    bindAttribBuffer(mesh->vbo[VERTEX_ATTRIB_POSITION], VERTEX_ATTRIB_POSITION, 3);
+    if (normals) {
+        mesh->vbo[VERTEX_ATTRIB_NORMAL] = uploadBuffer(GL_ARRAY_BUFFER,
+                                                       sizeof(GLfloat) * 3 * numVertices, normals);
+        bindAttribBuffer(mesh->vbo[VERTEX_ATTRIB_NORMAL], VERTEX_ATTRIB_NORMAL, 3);
+    }
+    if (texCoords) {
+        mesh->vbo[VERTEX_ATTRIB_TEXCOORD] = uploadBuffer(GL_ARRAY_BUFFER,
+                                                         sizeof(GLfloat) * 2 * numVertices,
+                                                         texCoords);
+        bindAttribBuffer(mesh->vbo[VERTEX_ATTRIB_TEXCOORD], VERTEX_ATTRIB_TEXCOORD, 2);
+    }
+    if (indices) {
+        // IBO 绑定记录在 VAO 中，解绑 VAO 之前不能解绑 IBO
+        mesh->ibo = uploadBuffer(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * numIndices, indices);
+        mesh->indexCount = numIndices;
+        mesh->indexType = GL_UNSIGNED_INT;
+    }
+    mesh->vertexCount = numVertices;
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return !checkGlError("createMeshBuffer");
+}
+
+bool allocateMeshBuffer(MeshBuffer *mesh, int numVertices, bool normals, bool texCoords,
+                        int numIndices, GLenum usage) {
+    memset(mesh, 0, sizeof(MeshBuffer));
+    glGenVertexArrays(1, &mesh->vao);
+    glBindVertexArray(mesh->vao);
+    mesh->vbo[VERTEX_ATTRIB_POSITION] = uploadBuffer(GL_ARRAY_BUFFER,
+                                                     sizeof(GLfloat) * 3 * numVertices, NULL,
+                                                     usage);
+    bindAttribBuffer(mesh->vbo[VERTEX_ATTRIB_POSITION], VERTEX_ATTRIB_POSITION, 3);
+    if (normals) {
+        mesh->vbo[VERTEX_ATTRIB_NORMAL] = uploadBuffer(GL_ARRAY_BUFFER,
+                                                       sizeof(GLfloat) * 3 * numVertices, NULL,
+                                                       usage);
+        bindAttribBuffer(mesh->vbo[VERTEX_ATTRIB_NORMAL], VERTEX_ATTRIB_NORMAL, 3);
+    }
+    if (texCoords) {
+        mesh->vbo[VERTEX_ATTRIB_TEXCOORD] = uploadBuffer(GL_ARRAY_BUFFER,
+                                                         sizeof(GLfloat) * 2 * numVertices, NULL,
+                                                         usage);
+        bindAttribBuffer(mesh->vbo[VERTEX_ATTRIB_TEXCOORD], VERTEX_ATTRIB_TEXCOORD, 2);
+    }
+    if (numIndices > 0) {
+        mesh->ibo = uploadBuffer(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * numIndices, NULL,
+                                 usage);
+        mesh->indexCount = numIndices;
+        mesh->indexType = GL_UNSIGNED_INT;
+    }
+    mesh->vertexCount = numVertices;
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return !checkGlError("allocateMeshBuffer");
+}
+
+bool createInterleavedMeshBuffer(MeshBuffer *mesh, const VertexLayout *layout,
+                                 const void *vertices, const void *indices) {
+    memset(mesh, 0, sizeof(MeshBuffer));
+    glGenVertexArrays(1, &mesh->vao);
+    glBindVertexArray(mesh->vao);
+    mesh->vbo[0] = uploadBuffer(GL_ARRAY_BUFFER, (GLsizeiptr) layout->numVertices * layout->stride,
+                                vertices);
+    applyVertexLayout(layout, NULL);
+    if (indices) {
+        mesh->ibo = uploadBuffer(GL_ELEMENT_ARRAY_BUFFER,
+                                 (GLsizeiptr) layout->numIndices * layout->indexSize, indices);
+        mesh->indexCount = layout->numIndices;
+        mesh->indexType = layout->indexType;
+    }
+    mesh->vertexCount = layout->numVertices;
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return !checkGlError("createInterleavedMeshBuffer");
+}
+
+void drawMeshBuffer(const MeshBuffer *mesh) {
+    glBindVertexArray(mesh->vao);
+    if (mesh->indexCount > 0) {
+        glDrawElements(GL_TRIANGLES, mesh->indexCount, mesh->indexType, (const void *) 0);
+    } else {
+        glDrawArrays(GL_TRIANGLES, 0, mesh->vertexCount);
+    }
+}
+
+void deleteMeshBuffer(MeshBuffer *mesh) {
+    glDeleteVertexArrays(1, &mesh->vao);
+    glDeleteBuffers(MAX_VERTEX_ATTRIBS, mesh->vbo);
+    glDeleteBuffers(1, &mesh->ibo);
+    memset(mesh, 0, sizeof(MeshBuffer));
+}
+
+bool ringSubAllocate(GLsizeiptr cursor, GLsizeiptr size, GLint alignment, GLsizeiptr limit,
+                     GLsizeiptr *offset) {
+    GLsizeiptr aligned = alignment > 1 ? (cursor + alignment - 1) / alignment * alignment : cursor;
+    if (size < 0 || aligned + size > limit) {
+        return false;
+    }
+    *offset = aligned;
+    return true;
+}
+
+bool uniformRingInit(UniformRing *ring, GLsizeiptr segmentSize, UniformRingMode mode) {
+    GLint alignment = 0;
+    memset(ring, 0, sizeof(UniformRing));
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    ring->alignment = alignment > 0 ? alignment : 256;
+    ring->mode = mode;
+    // 区段大小对齐，保证每个区段的起始偏移都满足绑定要求
+    ring->segmentSize = (segmentSize + ring->alignment - 1) / ring->alignment * ring->alignment;
+    ring->segment = UNIFORM_RING_SEGMENTS - 1;
+    glGenBuffers(1, &ring->buffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, ring->buffer);
+    glBufferData(GL_UNIFORM_BUFFER,
+                 mode == UNIFORM_RING_FENCED ? ring->segmentSize * UNIFORM_RING_SEGMENTS
+                                             : ring->segmentSize,
+                 NULL, GL_STREAM_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    return !checkGlError("uniformRingInit");
+}
+
+bool uniformRingBeginFrame(UniformRing *ring) {
+    GLbitfield access = GL_MAP_WRITE_BIT;
+    GLintptr base = 0;
+    glBindBuffer(GL_UNIFORM_BUFFER, ring->buffer);
+    if (ring->mode == UNIFORM_RING_FENCED) {
+        ring->segment = (ring->segment + 1) % UNIFORM_RING_SEGMENTS;
+        GLsync fence = ring->fences[ring->segment];
+        if (fence) {
+            // GPU 可能还在读取这个区段（上上帧的数据），等待它完成
+            GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+            if (result == GL_TIMEOUT_EXPIRED) {
+                ring->waitCount++;
+                do {
+                    result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                                              FENCE_WAIT_TIMEOUT);
+                } while (result == GL_TIMEOUT_EXPIRED);
+            }
+            glDeleteSync(fence);
+            ring->fences[ring->segment] = 0;
+        }
+        base = ring->segmentSize * ring->segment;
+        access |= GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT;
+    } else {
+        glBufferData(GL_UNIFORM_BUFFER, ring->segmentSize, NULL, GL_STREAM_DRAW);
+        access |= GL_MAP_INVALIDATE_BUFFER_BIT;
+    }
+    ring->cursor = 0;
+    ring->mapped = (GLubyte *) glMapBufferRange(GL_UNIFORM_BUFFER, base, ring->segmentSize,
+                                                access);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    if (!ring->mapped) {
+        checkGlError("glMapBufferRange");
+        return false;
+    }
+    return true;
+}
+
+GLintptr uniformRingPush(UniformRing *ring, const void *data, GLsizeiptr size) {
+    GLsizeiptr offset;
+    if (!ring->mapped ||
+        !ringSubAllocate(ring->cursor, size, ring->alignment, ring->segmentSize, &offset)) {
+        return -1;
+    }
+    memcpy(ring->mapped + offset, data, size);
+    ring->cursor = offset + size;
+    return (ring->mode == UNIFORM_RING_FENCED ? ring->segmentSize * ring->segment : 0) + offset;
+}
+
+void uniformRingFlush(UniformRing *ring) {
+    if (!ring->mapped) {
+        return;
+    }
+    glBindBuffer(GL_UNIFORM_BUFFER, ring->buffer);
+    glUnmapBuffer(GL_UNIFORM_BUFFER);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    ring->mapped = NULL;
+}
+
+void uniformRingBind(const UniformRing *ring, GLuint binding, GLintptr offset, GLsizeiptr size) {
+    glBindBufferRange(GL_UNIFORM_BUFFER, binding, ring->buffer, offset, size);
+}
+
+void uniformRingEndFrame(UniformRing *ring) {
+    uniformRingFlush(ring);
+    if (ring->mode == UNIFORM_RING_FENCED) {
+        ring->fences[ring->segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+}
+
+void uniformRingRelease(UniformRing *ring) {
+    int i;
+    uniformRingFlush(ring);
+    for (i = 0; i < UNIFORM_RING_SEGMENTS; i++) {
+        if (ring->fences[i]) {
+            glDeleteSync(ring->fences[i]);
+        }
+    }
+    glDeleteBuffers(1, &ring->buffer);
+    memset(ring, 0, sizeof(UniformRing));
+}
@@ -0,0 +1,552 @@
+#include <GLES3/gl31.h>
+#include <stddef.h>
+#include "include/gpu-generator.h"
+#include "include/mesh-generator.h"
+
+// 计算着色器每个工作组的线程数
+#define GEN_LOCAL_SIZE 64
+// 计算着色器把 RecordObject 和 InstanceData 当作 float 数组访问
+#define OBJECT_FLOATS 13
+#define INSTANCE_FLOATS 20
+
+static_assert(sizeof(RecordObject) == sizeof(GLfloat) * OBJECT_FLOATS,
+              "RecordObject must be tightly packed");
+static_assert(sizeof(InstanceData) == sizeof(GLfloat) * INSTANCE_FLOATS,
+              "InstanceData must be tightly packed");
+
+typedef enum {
+    GEN_SPHERE,
+    GEN_GRID,
+    GEN_INDICES,
+    GEN_INSTANCES,
+    GEN_PROGRAM_COUNT,
+} GenProgram;
+
+// 两种后端共用的计算部分，与 mesh-generator.cpp、instance-recorder.cpp 中的 CPU 实现一一对应
+static const char GEN_COMMON_GLSL[] =
+        "precision highp float;\n"
+        "precision highp int;\n"
+        "const float PI_F = 3.1415927;\n"
+        "uniform int genSlices;\n"
+        "uniform float genRadius;\n"
+        "uniform int genSize;\n"
+        "uniform int genColumns;\n"
+        "uniform int genRowStride;\n"
+        "uniform bool genSphereOrder;\n"
+        "uniform vec4 genViewProj[4];\n"
+        "void sphereVertex(int id, out vec3 position, out vec3 normal, out vec2 texCoord) {\n"
+        "    int i = id / (genSlices + 1);\n"
+        "    int j = id - i * (genSlices + 1);\n"
+        "    float angleStep = 2.0 * PI_F / float(genSlices);\n"
+        "    float ringRadius = genRadius * sin(angleStep * float(i));\n"
+        "    position = vec3(ringRadius * sin(angleStep * float(j)),\n"
+        "                    genRadius * cos(angleStep * float(i)),\n"
+        "                    ringRadius * cos(angleStep * float(j)));\n"
+        "    normal = position / genRadius;\n"
+        "    texCoord = vec2(float(j) / float(genSlices),\n"
+        "                    1.0 - float(i) / float(genSlices / 2));\n"
+        "}\n"
+        "vec3 gridVertex(int id) {\n"
+        "    int i = id / genSize;\n"
+        "    int j = id - i * genSize;\n"
+        "    float stepSize = float(genSize - 1);\n"
+        "    return vec3(float(i) / stepSize, float(j) / stepSize, 0.0);\n"
+        "}\n"
+        "void quadIndices(int id, out uvec3 first, out uvec3 second) {\n"
+        "    int i = id / genColumns;\n"
+        "    uint j = uint(id - i * genColumns);\n"
+        "    uint row = uint(i * genRowStride);\n"
+        "    uint nextRow = row + uint(genRowStride);\n"
+        "    if (genSphereOrder) {\n"
+        "        first = uvec3(row + j, nextRow + j, nextRow + j + 1u);\n"
+        "        second = uvec3(row + j, nextRow + j + 1u, row + j + 1u);\n"
+        "    } else {\n"
+        "        first = uvec3(row + j, row + j + 1u, nextRow + j + 1u);\n"
+        "        second = uvec3(row + j, nextRow + j + 1u, nextRow + j);\n"
+        "    }\n"
+        "}\n"
+        // 模型矩阵 = scale * rotate * translate（行向量），再右乘 viewProj
+        "void instanceRows(vec3 position, vec3 axis, float angle, float scale, out vec4 rows[4]) {\n"
+        "    vec3 r0 = vec3(1.0, 0.0, 0.0);\n"
+        "    vec3 r1 = vec3(0.0, 1.0, 0.0);\n"
+        "    vec3 r2 = vec3(0.0, 0.0, 1.0);\n"
+        "    float mag = length(axis);\n"
+        "    if (angle != 0.0 && mag > 0.0) {\n"
+        "        vec3 a = axis / mag;\n"
+        "        float s = sin(angle * PI_F / 180.0);\n"
+        "        float c = cos(angle * PI_F / 180.0);\n"
+        "        float t = 1.0 - c;\n"
+        "        r0 = vec3(t * a.x * a.x + c, t * a.x * a.y - a.z * s, t * a.z * a.x + a.y * s);\n"
+        "        r1 = vec3(t * a.x * a.y + a.z * s, t * a.y * a.y + c, t * a.y * a.z - a.x * s);\n"
+        "        r2 = vec3(t * a.z * a.x - a.y * s, t * a.y * a.z + a.x * s, t * a.z * a.z + c);\n"
+        "    }\n"
+        "    rows[0] = scale * (r0.x * genViewProj[0] + r0.y * genViewProj[1] + r0.z * genViewProj[2]);\n"
+        "    rows[1] = scale * (r1.x * genViewProj[0] + r1.y * genViewProj[1] + r1.z * genViewProj[2]);\n"
+        "    rows[2] = scale * (r2.x * genViewProj[0] + r2.y * genViewProj[1] + r2.z * genViewProj[2]);\n"
+        "    rows[3] = position.x * genViewProj[0] + position.y * genViewProj[1] +\n"
+        "              position.z * genViewProj[2] + genViewProj[3];\n"
+        "}\n";
+
+// transform feedback：每个点对应一个输出项
+static const char GEN_FEEDBACK_GLSL[] =
+        "#if defined(SPHERE)\n"
+        "out vec3 genPosition;\n"
+        "out vec3 genNormal;\n"
+        "out vec2 genTexCoord;\n"
+        "#elif defined(GRID)\n"
+        "out vec3 genPosition;\n"
+        "#elif defined(INDICES)\n"
+        "flat out uvec3 genFirst;\n"
+        "flat out uvec3 genSecond;\n"
+        "#elif defined(INSTANCES)\n"
+        "layout(location = 0) in vec3 objectPosition;\n"
+        "layout(location = 1) in vec3 objectAxis;\n"
+        "layout(location = 2) in vec2 objectAngleScale;\n"
+        "layout(location = 3) in vec4 objectColor;\n"
+        "out vec4 genRow0;\n"
+        "out vec4 genRow1;\n"
+        "out vec4 genRow2;\n"
+        "out vec4 genRow3;\n"
+        "out vec4 genColor;\n"
+        "#endif\n"
+        "void main() {\n"
+        "#if defined(SPHERE)\n"
+        "    sphereVertex(gl_VertexID, genPosition, genNormal, genTexCoord);\n"
+        "#elif defined(GRID)\n"
+        "    genPosition = gridVertex(gl_VertexID);\n"
+        "#elif defined(INDICES)\n"
+        "    quadIndices(gl_VertexID, genFirst, genSecond);\n"
+        "#elif defined(INSTANCES)\n"
+        "    vec4 rows[4];\n"
+        "    instanceRows(objectPosition, objectAxis, objectAngleScale.x, objectAngleScale.y, rows);\n"
+        "    genRow0 = rows[0];\n"
+        "    genRow1 = rows[1];\n"
+        "    genRow2 = rows[2];\n"
+        "    genRow3 = rows[3];\n"
+        "    genColor = objectColor;\n"
+        "#endif\n"
+        "    gl_Position = vec4(0.0);\n"
+        "}\n";
+
+// GLES 3.0 的程序必须有片元着色器，光栅化已关闭，不会执行
+static const char GEN_FEEDBACK_FRAGMENT[] =
+        "#version 300 es\n"
+        "void main() {\n"
+        "}\n";
+
+// 计算着色器：输出缓冲区按 float/uint 数组访问，与 CPU 端的紧凑布局相同
+static const char GEN_COMPUTE_GLSL[] =
+        "layout(local_size_x = " STRV(GEN_LOCAL_SIZE) ") in;\n"
+        "uniform int genCount;\n"
+        "#if defined(SPHERE) || defined(GRID)\n"
+        "layout(std430, binding = 0) writeonly buffer Positions { float positions[]; };\n"
+        "#endif\n"
+        "#if defined(SPHERE)\n"
+        "layout(std430, binding = 1) writeonly buffer Normals { float normals[]; };\n"
+        "layout(std430, binding = 2) writeonly buffer TexCoords { float texCoords[]; };\n"
+        "#elif defined(INDICES)\n"
+        "layout(std430, binding = 0) writeonly buffer Indices { uint indices[]; };\n"
+        "#elif defined(INSTANCES)\n"
+        "layout(std430, binding = 0) readonly buffer Objects { float objects[]; };\n"
+        "layout(std430, binding = 1) writeonly buffer Instances { float instances[]; };\n"
+        "uniform int genBase;\n"
+        "#endif\n"
+        "void main() {\n"
+        "    int id = int(gl_GlobalInvocationID.x);\n"
+        "    if (id >= genCount) {\n"
+        "        return;\n"
+        "    }\n"
+        "#if defined(SPHERE)\n"
+        "    vec3 position;\n"
+        "    vec3 normal;\n"
+        "    vec2 texCoord;\n"
+        "    sphereVertex(id, position, normal, texCoord);\n"
+        "    for (int k = 0; k < 3; k++) {\n"
+        "        positions[id * 3 + k] = position[k];\n"
+        "        normals[id * 3 + k] = normal[k];\n"
+        "    }\n"
+        "    texCoords[id * 2] = texCoord.x;\n"
+        "    texCoords[id * 2 + 1] = texCoord.y;\n"
+        "#elif defined(GRID)\n"
+        "    vec3 position = gridVertex(id);\n"
+        "    for (int k = 0; k < 3; k++) {\n"
+        "        positions[id * 3 + k] = position[k];\n"
+        "    }\n"
+        "#elif defined(INDICES)\n"
+        "    uvec3 first;\n"
+        "    uvec3 second;\n"
+        "    quadIndices(id, first, second);\n"
+        "    for (int k = 0; k < 3; k++) {\n"
+        "        indices[id * 6 + k] = first[k];\n"
+        "        indices[id * 6 + 3 + k] = second[k];\n"
+        "    }\n"
+        "#elif defined(INSTANCES)\n"
+        "    int src = id * " STRV(OBJECT_FLOATS) ";\n"
+        "    int dst = genBase + id * " STRV(INSTANCE_FLOATS) ";\n"
+        "    vec4 rows[4];\n"
+        "    instanceRows(vec3(objects[src], objects[src + 1], objects[src + 2]),\n"
+        "                 vec3(objects[src + 3], objects[src + 4], objects[src + 5]),\n"
+        "                 objects[src + 6], objects[src + 7], rows);\n"
+        "    for (int r = 0; r < 4; r++) {\n"
+        "        for (int k = 0; k < 4; k++) {\n"
+        "            instances[dst + r * 4 + k] = rows[r][k];\n"
+        "        }\n"
+        "    }\n"
+        "    for (int k = 0; k < 4; k++) {\n"
+        "        instances[dst + 16 + k] = objects[src + 9 + k];\n"
+        "    }\n"
+        "#endif\n"
+        "}\n";
+
+static const char *const GEN_DEFINES[GEN_PROGRAM_COUNT] = {
+        "#define SPHERE\n",
+        "#define GRID\n",
+        "#define INDICES\n",
+        "#define INSTANCES\n",
+};
+
+static GpuGeneratorBackend backend = GPU_GENERATOR_NONE;
+static GLuint programs[GEN_PROGRAM_COUNT];
+// transform feedback 使用自己的 VAO 和反馈对象，不影响其他绘制的状态
+static GLuint vao;
+static GLuint feedback;
+// 上传 RecordObject 的缓冲区，容量不够时重新分配
+static GLuint objectBuffer;
+static GLsizeiptr objectCapacity;
+
+static char *concatSource(const char *version, const char *defines, const char *main) {
+    size_t size = strlen(version) + strlen(defines) + strlen(GEN_COMMON_GLSL) + strlen(main) + 1;
+    char *src = (char *) malloc(size);
+    if (src) {
+        snprintf(src, size, "%s%s%s%s", version, defines, GEN_COMMON_GLSL, main);
+    }
+    return src;
+}
+
+static bool linkProgram(GLuint program, const char *name) {
+    GLint linked = GL_FALSE;
+    glLinkProgram(program);
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked) {
+        GLint length = 0;
+        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+        GLchar *infoLog = length > 0 ? (GLchar *) malloc(length) : NULL;
+        if (infoLog) {
+            glGetProgramInfoLog(program, length, NULL, infoLog);
+        }
+        ALOGE("Could not link %s generator:\n%s\n", name, infoLog ? infoLog : "");
+        free(infoLog);
+        return false;
+    }
+    return true;
+}
+
+static GLuint createFeedbackProgram(GenProgram index) {
+    static const char *const SPHERE_VARYINGS[] = {"genPosition", "genNormal", "genTexCoord"};
+    static const char *const GRID_VARYINGS[] = {"genPosition"};
+    static const char *const INDEX_VARYINGS[] = {"genFirst", "genSecond"};
+    static const char *const INSTANCE_VARYINGS[] = {"genRow0", "genRow1", "genRow2", "genRow3",
+                                                    "genColor"};
+    GLuint program = 0;
+    GLuint vtxShader = 0;
+    GLuint fragShader = 0;
+    char *src = concatSource("#version 300 es\n", GEN_DEFINES[index], GEN_FEEDBACK_GLSL);
+    if (!src) {
+        return 0;
+    }
+    vtxShader = createShader(GL_VERTEX_SHADER, src);
+    fragShader = createShader(GL_FRAGMENT_SHADER, GEN_FEEDBACK_FRAGMENT);
+    free(src);
+    if (!vtxShader || !fragShader) {
+        goto done;
+    }
+    program = glCreateProgram();
+    glAttachShader(program, vtxShader);
+    glAttachShader(program, fragShader);
+    // 球体的三个属性分别写入 MeshBuffer 的三个 VBO，其余写入同一个缓冲区
+    switch (index) {
+        case GEN_SPHERE:
+            glTransformFeedbackVaryings(program, 3, SPHERE_VARYINGS, GL_SEPARATE_ATTRIBS);
+            break;
+        case GEN_GRID:
+            glTransformFeedbackVaryings(program, 1, GRID_VARYINGS, GL_INTERLEAVED_ATTRIBS);
+            break;
+        case GEN_INDICES:
+            glTransformFeedbackVaryings(program, 2, INDEX_VARYINGS, GL_INTERLEAVED_ATTRIBS);
+            break;
+        default:
+            glTransformFeedbackVaryings(program, 5, INSTANCE_VARYINGS, GL_INTERLEAVED_ATTRIBS);
+            break;
+    }
+    if (!linkProgram(program, GEN_DEFINES[index])) {
+        glDeleteProgram(program);
+        program = 0;
+    }
+
+done:
+    if (vtxShader) {
+        glDeleteShader(vtxShader);
+    }
+    if (fragShader) {
+        glDeleteShader(fragShader);
+    }
+    return program;
+}
+
+static GLuint createComputeProgram(GenProgram index) {
+    GLuint program = 0;
+    char *src = concatSource("#version 310 es\n", GEN_DEFINES[index], GEN_COMPUTE_GLSL);
+    if (!src) {
+        return 0;
+    }
+    GLuint shader = createShader(GL_COMPUTE_SHADER, src);
+    free(src);
+    if (!shader) {
+        return 0;
+    }
+    program = glCreateProgram();
+    glAttachShader(program, shader);
+    if (!linkProgram(program, GEN_DEFINES[index])) {
+        glDeleteProgram(program);
+        program = 0;
+    }
+    glDeleteShader(shader);
+    return program;
+}
+
+static void deletePrograms() {
+    int i;
+    for (i = 0; i < GEN_PROGRAM_COUNT; i++) {
+        if (programs[i]) {
+            glDeleteProgram(programs[i]);
+            programs[i] = 0;
+        }
+    }
+}
+
+static bool createPrograms(GLuint (*create)(GenProgram)) {
+    int i;
+    for (i = 0; i < GEN_PROGRAM_COUNT; i++) {
+        programs[i] = create((GenProgram) i);
+        if (!programs[i]) {
+            deletePrograms();
+            return false;
+        }
+    }
+    return true;
+}
+
+bool gpuGeneratorInit(bool allowCompute) {
+    GLint major = 0;
+    GLint minor = 0;
+    // 上下文重建后旧的对象已随上下文释放
+    memset(programs, 0, sizeof(programs));
+    vao = 0;
+    feedback = 0;
+    objectBuffer = 0;
+    objectCapacity = 0;
+    backend = GPU_GENERATOR_NONE;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    if (allowCompute && (major > 3 || (major == 3 && minor >= 1)) &&
+        createPrograms(createComputeProgram)) {
+        backend = GPU_GENERATOR_COMPUTE;
+    } else if (createPrograms(createFeedbackProgram)) {
+        backend = GPU_GENERATOR_TRANSFORM_FEEDBACK;
+        glGenVertexArrays(1, &vao);
+        glGenTransformFeedbacks(1, &feedback);
+    } else {
+        return false;
+    }
+    glGenBuffers(1, &objectBuffer);
+    ALOGD("gpu generator backend %d\n", backend);
+    if (checkGlError("gpuGeneratorInit")) {
+        gpuGeneratorRelease();
+        return false;
+    }
+    return true;
+}
+
+GpuGeneratorBackend gpuGeneratorBackend() {
+    return backend;
+}
+
+static void setMeshUniforms(GLuint program, int slices, float radius, int size, int columns,
+                            int rowStride, bool sphereOrder) {
+    glUseProgram(program);
+    glUniform1i(glGetUniformLocation(program, "genSlices"), slices);
+    glUniform1f(glGetUniformLocation(program, "genRadius"), radius);
+    glUniform1i(glGetUniformLocation(program, "genSize"), size);
+    glUniform1i(glGetUniformLocation(program, "genColumns"), columns);
+    glUniform1i(glGetUniformLocation(program, "genRowStride"), rowStride);
+    glUniform1i(glGetUniformLocation(program, "genSphereOrder"), sphereOrder);
+}
+
+// 以 count 个点执行 transform feedback，输出写入 buffers[i] 的 [offset, offset + sizes[i])
+static void runFeedback(int count, const GLuint *buffers, const GLintptr *offsets,
+                        const GLsizeiptr *sizes, int bufferCount) {
+    int i;
+    glBindVertexArray(vao);
+    glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, feedback);
+    for (i = 0; i < bufferCount; i++) {
+        glBindBufferRange(GL_TRANSFORM_FEEDBACK_BUFFER, i, buffers[i], offsets[i], sizes[i]);
+    }
+    glEnable(GL_RASTERIZER_DISCARD);
+    glBeginTransformFeedback(GL_POINTS);
+    glDrawArrays(GL_POINTS, 0, count);
+    glEndTransformFeedback();
+    glDisable(GL_RASTERIZER_DISCARD);
+    // 解除绑定，之后这些缓冲区可以作为顶点/索引缓冲区使用
+    for (i = 0; i < bufferCount; i++) {
+        glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, i, 0);
+    }
+    glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, 0);
+    glBindVertexArray(0);
+}
+
+static void runCompute(GLuint program, int count, const GLuint *buffers, int bufferCount,
+                       GLbitfield barriers) {
+    int i;
+    glUniform1i(glGetUniformLocation(program, "genCount"), count);
+    for (i = 0; i < bufferCount; i++) {
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, i, buffers[i]);
+    }
+    glDispatchCompute((GLuint) ((count + GEN_LOCAL_SIZE - 1) / GEN_LOCAL_SIZE), 1, 1);
+    // 之后读取这些缓冲区的操作（绘制或 glMapBufferRange）要看到计算着色器的写入
+    glMemoryBarrier(barriers | GL_BUFFER_UPDATE_BARRIER_BIT);
+    for (i = 0; i < bufferCount; i++) {
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, i, 0);
+    }
+}
+
+// 生成 rows 行、每行 columns 个四边形的索引
+static void generateIndices(GLuint ibo, int rows, int columns, int rowStride, bool sphereOrder) {
+    GLuint program = programs[GEN_INDICES];
+    int quads = rows * columns;
+    GLintptr offset = 0;
+    GLsizeiptr size = (GLsizeiptr) sizeof(GLuint) * 6 * quads;
+    if (quads <= 0) {
+        return;
+    }
+    setMeshUniforms(program, 0, 0.0f, 0, columns, rowStride, sphereOrder);
+    if (backend == GPU_GENERATOR_COMPUTE) {
+        runCompute(program, quads, &ibo, 1, GL_ELEMENT_ARRAY_BARRIER_BIT);
+    } else {
+        runFeedback(quads, &ibo, &offset, &size, 1);
+    }
+}
+
+bool gpuCreateSphereMesh(MeshBuffer *mesh, int numSlices, float radius) {
+    int numVertices = sphereVertexCount(numSlices);
+    int numIndices = sphereIndexCount(numSlices);
+    if (backend == GPU_GENERATOR_NONE || numSlices <= 0 ||
+        !allocateMeshBuffer(mesh, numVertices, true, true, numIndices, GL_STATIC_COPY)) {
+        return false;
+    }
+    GLuint buffers[3] = {mesh->vbo[VERTEX_ATTRIB_POSITION], mesh->vbo[VERTEX_ATTRIB_NORMAL],
+                         mesh->vbo[VERTEX_ATTRIB_TEXCOORD]};
+    setMeshUniforms(programs[GEN_SPHERE], numSlices, radius, 0, 0, 0, true);
+    if (backend == GPU_GENERATOR_COMPUTE) {
+        runCompute(programs[GEN_SPHERE], numVertices, buffers, 3, GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+    } else {
+        GLintptr offsets[3] = {0, 0, 0};
+        GLsizeiptr sizes[3] = {(GLsizeiptr) sizeof(GLfloat) * 3 * numVertices,
+                               (GLsizeiptr) sizeof(GLfloat) * 3 * numVertices,
+                               (GLsizeiptr) sizeof(GLfloat) * 2 * numVertices};
+        runFeedback(numVertices, buffers, offsets, sizes, 3);
+    }
+    generateIndices(mesh->ibo, numSlices / 2, numSlices, numSlices + 1, true);
+    glUseProgram(0);
+    if (checkGlError("gpuCreateSphereMesh")) {
+        deleteMeshBuffer(mesh);
+        return false;
+    }
+    return true;
+}
+
+bool gpuCreateSquareGridMesh(MeshBuffer *mesh, int size) {
+    int numVertices = squareGridVertexCount(size);
+    if (backend == GPU_GENERATOR_NONE || size <= 1 ||
+        !allocateMeshBuffer(mesh, numVertices, false, false, squareGridIndexCount(size),
+                            GL_STATIC_COPY)) {
+        return false;
+    }
+    GLuint positions = mesh->vbo[VERTEX_ATTRIB_POSITION];
+    setMeshUniforms(programs[GEN_GRID], 0, 0.0f, size, 0, 0, false);
+    if (backend == GPU_GENERATOR_COMPUTE) {
+        runCompute(programs[GEN_GRID], numVertices, &positions, 1,
+                   GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+    } else {
+        GLintptr offset = 0;
+        GLsizeiptr bytes = (GLsizeiptr) sizeof(GLfloat) * 3 * numVertices;
+        runFeedback(numVertices, &positions, &offset, &bytes, 1);
+    }
+    generateIndices(mesh->ibo, size - 1, size - 1, size, false);
+    glUseProgram(0);
+    if (checkGlError("gpuCreateSquareGridMesh")) {
+        deleteMeshBuffer(mesh);
+        return false;
+    }
+    return true;
+}
+
+bool gpuRecordInstances(GLuint buffer, GLintptr offset, const RecordObject *objects, int count,
+                        const Matrix *viewProj) {
+    GLuint program = programs[GEN_INSTANCES];
+    GLsizeiptr objectBytes = (GLsizeiptr) sizeof(RecordObject) * count;
+    if (backend == GPU_GENERATOR_NONE || count <= 0 || offset % 4 != 0) {
+        return count == 0;
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, objectBuffer);
+    if (objectBytes > objectCapacity) {
+        glBufferData(GL_ARRAY_BUFFER, objectBytes, objects, GL_STREAM_DRAW);
+        objectCapacity = objectBytes;
+    } else {
+        glBufferSubData(GL_ARRAY_BUFFER, 0, objectBytes, objects);
+    }
+    glUseProgram(program);
+    glUniform4fv(glGetUniformLocation(program, "genViewProj"), 4, &viewProj->m[0][0]);
+    if (backend == GPU_GENERATOR_COMPUTE) {
+        GLuint buffers[2] = {objectBuffer, buffer};
+        // SSBO 的绑定偏移有对齐要求，整个缓冲区绑定后在着色器中加上偏移
+        glUniform1i(glGetUniformLocation(program, "genBase"), (GLint) (offset / sizeof(GLfloat)));
+        runCompute(program, count, buffers, 2, GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+    } else {
+        GLsizeiptr size = (GLsizeiptr) sizeof(InstanceData) * count;
+        glBindVertexArray(vao);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(RecordObject),
+                              (const void *) offsetof(RecordObject, position));
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(RecordObject),
+                              (const void *) offsetof(RecordObject, axis));
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(RecordObject),
+                              (const void *) offsetof(RecordObject, angle));
+        glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(RecordObject),
+                              (const void *) offsetof(RecordObject, color));
+        glEnableVertexAttribArray(0);
+        glEnableVertexAttribArray(1);
+        glEnableVertexAttribArray(2);
+        glEnableVertexAttribArray(3);
+        runFeedback(count, &buffer, &offset, &size, 1);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glUseProgram(0);
+    return !checkGlError("gpuRecordInstances");
+}
+
+void gpuGeneratorRelease() {
+    deletePrograms();
+    if (vao) {
+        glDeleteVertexArrays(1, &vao);
+    }
+    if (feedback) {
+        glDeleteTransformFeedbacks(1, &feedback);
+    }
+    if (objectBuffer) {
+        glDeleteBuffers(1, &objectBuffer);
+    }
+    vao = 0;
+    feedback = 0;
+    objectBuffer = 0;
+    objectCapacity = 0;
+    backend = GPU_GENERATOR_NONE;
+}
@@ -0,0 +1,173 @@
+#ifndef GLES_COMMAND_BUFFER_H
+#define GLES_COMMAND_BUFFER_H
+
+#include <atomic>
+#include <thread>
+#include "es-util.h"
+#include "gl-buffer.h"
+#include "instancing.h"
+#include "program-builder.h"
+
+// 渲染命令缓冲：
+// 游戏/UI 线程不直接调用 GL，而是把命令录制到 CommandBuffer，再经 CommandChannel 交给渲染线程执行。
+// 每个生产者线程有自己的 CommandChannel，其中两个单生产者单消费者无锁队列：
+// submitted 把录制好的缓冲区交给渲染线程，recycled 把执行完的缓冲区还给生产者复用，
+// 两边都不加锁，生产者提交后立即返回，不等待 GL 执行。
+
+typedef enum {
+    CMD_CALL,              // 在渲染线程调用 fn(data)，用于创建/释放 GL 资源
+    CMD_VIEWPORT,
+    CMD_CLEAR_COLOR,
+    CMD_CLEAR,
+    CMD_DRAW_MESH,         // 提交到渲染队列，CMD_PRESENT 时排序回放
+    CMD_DRAW_INSTANCES,    // 以实例流中一段的数据实例化绘制 mesh，同样经过渲染队列
+    CMD_PRESENT,           // 回放渲染队列并交换缓冲区，结束一帧
+} RenderCommandType;
+
+typedef struct {
+    void (*fn)(void *data);
+    void *data;
+} CallCommand;
+
+typedef struct {
+    GLint x;
+    GLint y;
+    GLsizei width;
+    GLsizei height;
+} ViewportCommand;
+
+typedef struct {
+    GLfloat color[4];
+} ClearColorCommand;
+
+typedef struct {
+    GLbitfield mask;
+} ClearCommand;
+
+//mesh 和 program 指向只在渲染线程读写的资源（由 CMD_CALL 创建），生产者只传递指针
+typedef struct {
+    const MeshBuffer *mesh;
+    const ProgramHandle *program;
+    GLuint texture;
+    float depth;
+} DrawMeshCommand;
+
+//录制线程已把 count 个实例写入 stream 的第 segment 段；每帧每个实例流最多使用一次
+typedef struct {
+    InstanceStream *stream;
+    const ProgramHandle *program;
+    int segment;
+    int count;
+    float depth;
+} DrawInstancesCommand;
+
+typedef struct {
+    RenderCommandType type;
+    union {
+        CallCommand call;
+        ViewportCommand viewport;
+        ClearColorCommand clearColor;
+        ClearCommand clear;
+        DrawMeshCommand draw;
+        DrawInstancesCommand instances;
+    };
+} RenderCommand;
+
+typedef struct {
+    RenderCommand *commands;
+    int count;
+    int capacity;
+    bool endsFrame;        // 包含 CMD_PRESENT
+} CommandBuffer;
+
+bool commandBufferInit(CommandBuffer *buffer, int capacity);
+void commandBufferRelease(CommandBuffer *buffer);
+void commandBufferReset(CommandBuffer *buffer);
+//追加一条命令，容量不足时扩容，内存不足时返回 NULL
+RenderCommand *commandBufferPush(CommandBuffer *buffer, RenderCommandType type);
+
+bool commandCall(CommandBuffer *buffer, void (*fn)(void *data), void *data);
+bool commandViewport(CommandBuffer *buffer, GLint x, GLint y, GLsizei width, GLsizei height);
+bool commandClearColor(CommandBuffer *buffer, GLfloat r, GLfloat g, GLfloat b, GLfloat a);
+bool commandClear(CommandBuffer *buffer, GLbitfield mask);
+bool commandDrawMesh(CommandBuffer *buffer, const MeshBuffer *mesh, const ProgramHandle *program,
+                     GLuint texture, float depth);
+bool commandDrawInstances(CommandBuffer *buffer, InstanceStream *stream,
+                          const ProgramHandle *program, int segment, int count, float depth);
+bool commandPresent(CommandBuffer *buffer);
+
+//头尾索引各占一条缓存行，避免生产者和消费者互相使对方的缓存失效
+#define CACHE_LINE_SIZE 64
+
+//单生产者单消费者无锁环形队列，push 只能由一个线程调用，pop 只能由另一个线程调用
+class SpscQueue {
+public:
+    //capacity 向上取整为 2 的幂
+    explicit SpscQueue(int capacity);
+
+    ~SpscQueue();
+
+    SpscQueue(const SpscQueue &) = delete;
+
+    SpscQueue &operator=(const SpscQueue &) = delete;
+
+    //队列满时返回 false
+    bool push(CommandBuffer *buffer);
+
+    //队列空时返回 NULL
+    CommandBuffer *pop();
+
+private:
+    CommandBuffer **slots;
+    unsigned mask;
+    char padHead[CACHE_LINE_SIZE];
+    std::atomic<unsigned> head{0};     // 消费者读取位置
+    unsigned cachedTail = 0;           // 消费者上次读到的 tail
+    char padTail[CACHE_LINE_SIZE];
+    std::atomic<unsigned> tail{0};     // 生产者写入位置
+    unsigned cachedHead = 0;           // 生产者上次读到的 head
+    char padEnd[CACHE_LINE_SIZE];
+};
+
+//每个通道最多的缓冲区数
+#define CHANNEL_MAX_BUFFERS 16
+
+//一个生产者线程与渲染线程之间的通道
+class CommandChannel {
+public:
+    explicit CommandChannel(std::thread::id owner);
+
+    ~CommandChannel();
+
+    CommandChannel(const CommandChannel &) = delete;
+
+    CommandChannel &operator=(const CommandChannel &) = delete;
+
+    //生产者：取一个空的缓冲区录制命令，缓冲区都在渲染线程一侧时返回 NULL
+    CommandBuffer *begin();
+
+    //生产者：提交录制好的缓冲区，之后不能再访问它
+    bool submit(CommandBuffer *buffer);
+
+    //已提交但渲染线程尚未执行完的帧数（含 CMD_PRESENT 的缓冲区数）
+    int framesInFlight() const;
+
+    //渲染线程：取下一个已提交的缓冲区，没有时返回 NULL
+    CommandBuffer *acquire();
+
+    //渲染线程：执行完后归还
+    void recycle(CommandBuffer *buffer);
+
+    std::thread::id owner() const { return ownerId; }
+
+private:
+    std::thread::id ownerId;
+    SpscQueue submitted;
+    SpscQueue recycled;
+    CommandBuffer buffers[CHANNEL_MAX_BUFFERS];
+    int allocatedBuffers = 0;          // 只由生产者访问
+    std::atomic<int> submittedFrames{0};
+    std::atomic<int> completedFrames{0};
+};
+
+#endif
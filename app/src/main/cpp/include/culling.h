@@ -0,0 +1,109 @@
+#ifndef GLES_CULLING_H
+#define GLES_CULLING_H
+
+#include <stdint.h>
+#include "es-util.h"
+#include "thread-pool.h"
+
+// 视锥剔除：纯 CPU 计算，不调用 GL。
+// 包围球/包围盒按 SoA 布局存放（x、y、z 等各自一个数组），用 SSE/NEON 一次测试 4 个，
+// 编译时开启 AVX 时一次测试 8 个；
+// 物体很多时用 BVH 按层次剔除，整棵子树在视锥内或视锥外时不再逐个测试，
+// 物体移动后可以只更新它所在叶节点到根的路径，不必重建；
+// 逐个测试和 BVH 都可以传入 ThreadPool 并行执行。
+
+//视锥的 6 个平面 a*x + b*y + c*z + d >= 0 为内侧，顺序为左、右、下、上、近、远，已归一化
+typedef struct {
+    float planes[6][4];
+} Frustum;
+
+//从模型视图投影矩阵（行向量约定，与 matrixMultiply 的结果相同）提取视锥平面，
+//得到的平面位于该矩阵的输入空间（通常传入 view * projection，得到世界空间的平面）
+void frustumFromMatrix(Frustum *frustum, const Matrix *viewProjection);
+//单个包围球与视锥相交或在视锥内时返回 true
+bool frustumContainsSphere(const Frustum *frustum, const float center[3], float radius);
+
+typedef struct {
+    float *x;
+    float *y;
+    float *z;
+    float *radius;
+    int count;
+    int capacity;
+} CullSpheres;
+
+typedef struct {
+    float *minX;
+    float *minY;
+    float *minZ;
+    float *maxX;
+    float *maxY;
+    float *maxZ;
+    int count;
+    int capacity;
+} CullAabbs;
+
+typedef struct {
+    int visible;
+    int culled;
+    int nodesVisited;      // BVH 访问的节点数
+    int objectsTested;     // 逐个测试的物体数（BVH 中整棵子树在视锥内的物体不计入）
+} CullStats;
+
+bool cullSpheresInit(CullSpheres *spheres, int capacity);
+void cullSpheresRelease(CullSpheres *spheres);
+bool cullAabbsInit(CullAabbs *boxes, int capacity);
+void cullAabbsRelease(CullAabbs *boxes);
+//设置第 index 个包围盒，index 超过 count 时 count 随之增大
+void cullAabbsSet(CullAabbs *boxes, int index, const float min[3], const float max[3]);
+void cullSpheresSet(CullSpheres *spheres, int index, const float center[3], float radius);
+
+//测试 [begin, end) 范围内的物体，visible[i] 写入 1（可见）或 0，返回可见数
+int cullSpheres(const Frustum *frustum, const CullSpheres *spheres, int begin, int end,
+                uint8_t *visible);
+int cullAabbs(const Frustum *frustum, const CullAabbs *boxes, int begin, int end,
+              uint8_t *visible);
+//逐个测试全部物体，pool 为 NULL 时在当前线程执行，stats 可为 NULL
+int cullSpheresParallel(const Frustum *frustum, const CullSpheres *spheres, uint8_t *visible,
+                        ThreadPool *pool, CullStats *stats);
+int cullAabbsParallel(const Frustum *frustum, const CullAabbs *boxes, uint8_t *visible,
+                      ThreadPool *pool, CullStats *stats);
+
+//每个叶节点最多包含的物体数
+#define BVH_LEAF_SIZE 8
+
+typedef struct {
+    float min[3];
+    float max[3];
+    int first;             // 子树中的物体在 BVH 顺序中的起始位置
+    int count;             // 子树中的物体数
+    int left;              // 左子节点，右子节点为 left + 1，叶节点为 -1
+    int parent;            // 根节点为 -1
+} BvhNode;
+
+typedef struct {
+    BvhNode *nodes;
+    int nodeCount;
+    CullAabbs boxes;       // 按 BVH 顺序存放的包围盒副本
+    int *objectIds;        // BVH 顺序中的位置 → 物体编号
+    int *objectSlots;      // 物体编号 → BVH 顺序中的位置
+    int *leafOf;           // BVH 顺序中的位置 → 所在叶节点
+    uint8_t *slotVisible;  // 剔除时使用的临时结果（BVH 顺序）
+    int count;
+} Bvh;
+
+//用物体包围盒（按物体编号）构建 BVH，按包围盒中心沿最长轴的中位数划分
+bool bvhBuild(Bvh *bvh, const CullAabbs *boxes);
+void bvhRelease(Bvh *bvh);
+//物体移动后更新其包围盒，并向上修正祖先节点
+void bvhUpdateObject(Bvh *bvh, int object, const float min[3], const float max[3]);
+//只更新物体的包围盒，不修正节点，之后需要调用 bvhRefit
+void bvhSetObject(Bvh *bvh, int object, const float min[3], const float max[3]);
+//自底向上重新计算全部节点包围盒，大量物体移动时比逐个 bvhUpdateObject 快；
+//物体移动距离很大时树的质量会下降，需要重新 bvhBuild
+void bvhRefit(Bvh *bvh);
+//visible 按物体编号写入，返回可见数，pool 为 NULL 时在当前线程执行
+int bvhCull(Bvh *bvh, const Frustum *frustum, uint8_t *visible, ThreadPool *pool,
+            CullStats *stats);
+
+#endif
@@ -0,0 +1,388 @@
+#ifndef GLES_ESMATH_H
+#define GLES_ESMATH_H
+
+// 头文件实现的向量/矩阵模板，可内联、可在编译期求值。
+// 约定与 es-util.h 中的 Matrix 相同：行主序存储，行向量左乘（v' = v * M），
+// translate/rotate/scale/frustum/ortho 均为 M = T * M，直接在原矩阵上修改并返回自身，
+// 因此链式调用 Mat4f::identity().translate(...).rotate(...) 不会产生中间矩阵。
+
+#include <cmath>
+#include <type_traits>
+
+#if defined(__has_builtin)
+#if __has_builtin(__builtin_is_constant_evaluated)
+#define ES_MATH_HAS_CONSTANT_EVALUATED 1
+#endif
+#endif
+
+namespace es {
+
+constexpr double kPi = 3.1415927;
+
+// 编译期开方：双精度牛顿迭代后再截断为 T，运行期直接调用 std::sqrt
+template<typename T>
+constexpr T sqrt(T x) {
+#if defined(ES_MATH_HAS_CONSTANT_EVALUATED)
+    if (!__builtin_is_constant_evaluated()) {
+        return std::sqrt(x);
+    }
+#endif
+    if (!(x > T(0))) {
+        return x == T(0) ? T(0) : T(NAN);
+    }
+    double value = x;
+    double guess = value >= 1.0 ? value : 1.0;
+    for (int i = 0; i < 128; i++) {
+        double next = 0.5 * (guess + value / guess);
+        if (next >= guess) {
+            break;
+        }
+        guess = next;
+    }
+    return T(guess);
+}
+
+template<int N, typename T>
+struct Vec {
+    T v[N];
+
+    constexpr Vec() : v{} {}
+
+    template<typename... A, typename = typename std::enable_if<sizeof...(A) == N>::type>
+    constexpr Vec(A... a) : v{T(a)...} {}
+
+    constexpr T &operator[](int i) { return v[i]; }
+
+    constexpr const T &operator[](int i) const { return v[i]; }
+
+    friend constexpr Vec operator+(const Vec &a, const Vec &b) {
+        Vec r;
+        for (int i = 0; i < N; i++) r.v[i] = a.v[i] + b.v[i];
+        return r;
+    }
+
+    friend constexpr Vec operator-(const Vec &a, const Vec &b) {
+        Vec r;
+        for (int i = 0; i < N; i++) r.v[i] = a.v[i] - b.v[i];
+        return r;
+    }
+
+    friend constexpr Vec operator*(const Vec &a, T s) {
+        Vec r;
+        for (int i = 0; i < N; i++) r.v[i] = a.v[i] * s;
+        return r;
+    }
+
+    friend constexpr T dot(const Vec &a, const Vec &b) {
+        T s = a.v[0] * b.v[0];
+        for (int i = 1; i < N; i++) s = s + a.v[i] * b.v[i];
+        return s;
+    }
+
+    friend constexpr T length(const Vec &a) {
+        return es::sqrt(dot(a, a));
+    }
+
+    // 长度为 0 时保持原值，与 matrixLookAt 的处理一致
+    friend constexpr Vec normalize(const Vec &a) {
+        Vec r = a;
+        T len = length(a);
+        if (len != T(0)) {
+            for (int i = 0; i < N; i++) r.v[i] /= len;
+        }
+        return r;
+    }
+};
+
+template<typename T>
+constexpr Vec<3, T> cross(const Vec<3, T> &a, const Vec<3, T> &b) {
+    return Vec<3, T>(a.v[1] * b.v[2] - a.v[2] * b.v[1],
+                     a.v[2] * b.v[0] - a.v[0] * b.v[2],
+                     a.v[0] * b.v[1] - a.v[1] * b.v[0]);
+}
+
+// 透视投影矩阵中的非零项，依次为 p00、p11、p20、p21、p22、p32，参数非法时返回 false
+template<typename T>
+constexpr bool frustumTerms(T w, T h, T nearZ, T farZ, T p[6]) {
+    T left = -w;
+    T right = w;
+    T bottom = -h;
+    T top = h;
+    T deltaX = right - left;
+    T deltaY = top - bottom;
+    T deltaZ = farZ - nearZ;
+    if ((nearZ <= T(0)) || (farZ <= T(0)) ||
+        (deltaX <= T(0)) || (deltaY <= T(0)) || (deltaZ <= T(0))) {
+        return false;
+    }
+    p[0] = T(2) * nearZ / deltaX;
+    p[1] = T(2) * nearZ / deltaY;
+    p[2] = (right + left) / deltaX;
+    p[3] = (top + bottom) / deltaY;
+    p[4] = -(nearZ + farZ) / deltaZ;
+    p[5] = T(-2) * nearZ * farZ / deltaZ;
+    return true;
+}
+
+// 绕 (x, y, z) 旋转 angle 度的 3x3 旋转矩阵，轴长度为 0 时返回 false
+template<typename T>
+inline bool rotationTerms(T angle, T x, T y, T z, T rot[3][3]) {
+    T mag = std::sqrt(x * x + y * y + z * z);
+    if (mag <= T(0)) {
+        return false;
+    }
+    T sinAngle = std::sin(T(angle * kPi / 180.0f));
+    T cosAngle = std::cos(T(angle * kPi / 180.0f));
+    x /= mag;
+    y /= mag;
+    z /= mag;
+    T xx = x * x, yy = y * y, zz = z * z;
+    T xy = x * y, yz = y * z, zx = z * x;
+    T xs = x * sinAngle, ys = y * sinAngle, zs = z * sinAngle;
+    T oneMinusCos = T(1) - cosAngle;
+    rot[0][0] = (oneMinusCos * xx) + cosAngle;
+    rot[0][1] = (oneMinusCos * xy) - zs;
+    rot[0][2] = (oneMinusCos * zx) + ys;
+    rot[1][0] = (oneMinusCos * xy) + zs;
+    rot[1][1] = (oneMinusCos * yy) + cosAngle;
+    rot[1][2] = (oneMinusCos * yz) - xs;
+    rot[2][0] = (oneMinusCos * zx) - ys;
+    rot[2][1] = (oneMinusCos * yz) + xs;
+    rot[2][2] = (oneMinusCos * zz) + cosAngle;
+    return true;
+}
+
+// 以下函数直接修改行主序的 4x4 数组 m（M = X * M）。Mat 的成员函数和 es-util.h 的 C 接口共用这些实现，
+// C 接口直接作用于 Matrix::m，不经过 Mat4f 中转：逐项写入临时矩阵后再整块拷贝会导致 store-to-load 转发失败
+template<typename T>
+constexpr void translateRows(T m[4][4], T tx, T ty, T tz) {
+    for (int j = 0; j < 4; j++) {
+        m[3][j] += (m[0][j] * tx + m[1][j] * ty + m[2][j] * tz);
+    }
+}
+
+template<typename T>
+constexpr void scaleRows(T m[4][4], T sx, T sy, T sz) {
+    for (int j = 0; j < 4; j++) {
+        m[0][j] *= sx;
+        m[1][j] *= sy;
+        m[2][j] *= sz;
+    }
+}
+
+// 旋转矩阵第 4 行为 (0, 0, 0, 1)，只更新前 3 行
+template<typename T>
+inline void rotateRows(T m[4][4], T angle, T x, T y, T z) {
+    T rot[3][3] = {};
+    if (!rotationTerms(angle, x, y, z, rot)) {
+        return;
+    }
+    for (int j = 0; j < 4; j++) {
+        T r0 = m[0][j], r1 = m[1][j], r2 = m[2][j];
+        m[0][j] = rot[0][0] * r0 + rot[0][1] * r1 + rot[0][2] * r2;
+        m[1][j] = rot[1][0] * r0 + rot[1][1] * r1 + rot[1][2] * r2;
+        m[2][j] = rot[2][0] * r0 + rot[2][1] * r1 + rot[2][2] * r2;
+    }
+}
+
+template<typename T>
+constexpr void frustumRows(T m[4][4], T w, T h, T nearZ, T farZ) {
+    T p[6] = {};
+    if (!frustumTerms(w, h, nearZ, farZ, p)) {
+        return;
+    }
+    for (int j = 0; j < 4; j++) {
+        T r0 = m[0][j], r1 = m[1][j], r2 = m[2][j], r3 = m[3][j];
+        m[0][j] = p[0] * r0;
+        m[1][j] = p[1] * r1;
+        m[2][j] = p[2] * r0 + p[3] * r1 + p[4] * r2 - r3;
+        m[3][j] = p[5] * r2;
+    }
+}
+
+template<typename T>
+inline void perspectiveRows(T m[4][4], T fovy, T aspect, T nearZ, T farZ) {
+    T frustumH = std::tan(T(fovy / 360.0f * kPi)) * nearZ;
+    T frustumW = frustumH * aspect;
+    frustumRows(m, frustumW, frustumH, nearZ, farZ);
+}
+
+template<typename T>
+constexpr void orthoRows(T m[4][4], T left, T right, T bottom, T top, T nearZ, T farZ) {
+    T deltaX = right - left;
+    T deltaY = top - bottom;
+    T deltaZ = farZ - nearZ;
+    if ((deltaX == T(0)) || (deltaY == T(0)) || (deltaZ == T(0))) {
+        return;
+    }
+    T o00 = T(2) / deltaX;
+    T o30 = -(right + left) / deltaX;
+    T o11 = T(2) / deltaY;
+    T o31 = -(top + bottom) / deltaY;
+    T o22 = T(-2) / deltaZ;
+    T o32 = -(nearZ + farZ) / deltaZ;
+    for (int j = 0; j < 4; j++) {
+        T r0 = m[0][j], r1 = m[1][j], r2 = m[2][j];
+        m[3][j] = o30 * r0 + o31 * r1 + o32 * r2 + m[3][j];
+        m[0][j] = o00 * r0;
+        m[1][j] = o11 * r1;
+        m[2][j] = o22 * r2;
+    }
+}
+
+// 写入 m 的全部 16 项
+template<typename T>
+constexpr void lookAtRows(T m[4][4], const Vec<3, T> &eye, const Vec<3, T> &target,
+                          const Vec<3, T> &up) {
+    Vec<3, T> axisZ = normalize(target - eye);
+    Vec<3, T> axisX = normalize(cross(up, axisZ));
+    Vec<3, T> axisY = normalize(cross(axisZ, axisX));
+    for (int i = 0; i < 3; i++) {
+        m[i][0] = -axisX.v[i];
+        m[i][1] = axisY.v[i];
+        m[i][2] = -axisZ.v[i];
+        m[i][3] = T(0);
+    }
+    m[3][0] = axisX.v[0] * eye.v[0] + axisX.v[1] * eye.v[1] + axisX.v[2] * eye.v[2];
+    m[3][1] = -axisY.v[0] * eye.v[0] - axisY.v[1] * eye.v[1] - axisY.v[2] * eye.v[2];
+    m[3][2] = axisZ.v[0] * eye.v[0] + axisZ.v[1] * eye.v[1] + axisZ.v[2] * eye.v[2];
+    m[3][3] = T(1);
+}
+
+template<int N, typename T>
+struct Mat {
+    alignas(16) T m[N][N];
+
+    constexpr Mat() : m{} {}
+
+    static constexpr Mat identity() {
+        Mat r;
+        for (int i = 0; i < N; i++) r.m[i][i] = T(1);
+        return r;
+    }
+
+    constexpr T *operator[](int i) { return m[i]; }
+
+    constexpr const T *operator[](int i) const { return m[i]; }
+
+    friend constexpr Mat operator*(const Mat &a, const Mat &b) {
+        Mat r;
+        for (int i = 0; i < N; i++) {
+            for (int j = 0; j < N; j++) {
+                T s = a.m[i][0] * b.m[0][j];
+                for (int k = 1; k < N; k++) s = s + a.m[i][k] * b.m[k][j];
+                r.m[i][j] = s;
+            }
+        }
+        return r;
+    }
+
+    friend constexpr Vec<N, T> operator*(const Vec<N, T> &v, const Mat &a) {
+        Vec<N, T> r;
+        for (int j = 0; j < N; j++) {
+            T s = v.v[0] * a.m[0][j];
+            for (int k = 1; k < N; k++) s = s + v.v[k] * a.m[k][j];
+            r.v[j] = s;
+        }
+        return r;
+    }
+
+    constexpr Mat &translate(T tx, T ty, T tz) {
+        static_assert(N == 4, "translate requires a 4x4 matrix");
+        translateRows(m, tx, ty, tz);
+        return *this;
+    }
+
+    constexpr Mat &scale(T sx, T sy, T sz) {
+        static_assert(N == 4, "scale requires a 4x4 matrix");
+        scaleRows(m, sx, sy, sz);
+        return *this;
+    }
+
+    Mat &rotate(T angle, T x, T y, T z) {
+        static_assert(N == 4, "rotate requires a 4x4 matrix");
+        rotateRows(m, angle, x, y, z);
+        return *this;
+    }
+
+    constexpr Mat &frustum(T w, T h, T nearZ, T farZ) {
+        static_assert(N == 4, "frustum requires a 4x4 matrix");
+        frustumRows(m, w, h, nearZ, farZ);
+        return *this;
+    }
+
+    Mat &perspective(T fovy, T aspect, T nearZ, T farZ) {
+        static_assert(N == 4, "perspective requires a 4x4 matrix");
+        perspectiveRows(m, fovy, aspect, nearZ, farZ);
+        return *this;
+    }
+
+    constexpr Mat &ortho(T left, T right, T bottom, T top, T nearZ, T farZ) {
+        static_assert(N == 4, "ortho requires a 4x4 matrix");
+        orthoRows(m, left, right, bottom, top, nearZ, farZ);
+        return *this;
+    }
+
+    static constexpr Mat lookAt(const Vec<3, T> &eye, const Vec<3, T> &target,
+                                const Vec<3, T> &up) {
+        static_assert(N == 4, "lookAt requires a 4x4 matrix");
+        Mat r;
+        lookAtRows(r.m, eye, target, up);
+        return r;
+    }
+
+    static constexpr Mat orthographic(T left, T right, T bottom, T top, T nearZ, T farZ) {
+        Mat r = identity();
+        r.ortho(left, right, bottom, top, nearZ, farZ);
+        return r;
+    }
+};
+
+typedef Vec<2, float> Vec2f;
+typedef Vec<3, float> Vec3f;
+typedef Vec<4, float> Vec4f;
+typedef Mat<4, float> Mat4f;
+
+// 编译期自检：以下结果都必须在编译期求出，否则 static_assert 编译失败
+namespace detail {
+
+constexpr bool equals(const Mat4f &a, const Mat4f &b) {
+    for (int i = 0; i < 4; i++) {
+        for (int j = 0; j < 4; j++) {
+            if (a.m[i][j] != b.m[i][j]) return false;
+        }
+    }
+    return true;
+}
+
+constexpr Mat4f translation(float tx, float ty, float tz) {
+    Mat4f r = Mat4f::identity();
+    r.translate(tx, ty, tz);
+    return r;
+}
+
+constexpr Mat4f kModel = Mat4f::identity().translate(1.0f, 2.0f, 3.0f).scale(2.0f, 4.0f, 8.0f);
+constexpr Mat4f kOrtho = Mat4f::orthographic(-2.0f, 2.0f, -4.0f, 4.0f, 1.0f, 3.0f);
+
+static_assert(Mat4f::identity().m[0][0] == 1.0f && Mat4f::identity().m[0][1] == 0.0f &&
+              Mat4f::identity().m[3][3] == 1.0f, "identity");
+static_assert(equals(Mat4f::identity() * kModel, kModel) &&
+              equals(kModel * Mat4f::identity(), kModel), "multiply by identity");
+static_assert(equals(translation(1.0f, 2.0f, 3.0f) * translation(4.0f, 5.0f, 6.0f),
+                     translation(5.0f, 7.0f, 9.0f)), "translations compose");
+static_assert(kModel.m[0][0] == 2.0f && kModel.m[1][1] == 4.0f && kModel.m[2][2] == 8.0f &&
+              kModel.m[3][0] == 1.0f && kModel.m[3][1] == 2.0f && kModel.m[3][2] == 3.0f,
+              "translate then scale");
+static_assert((Vec4f(1.0f, 1.0f, 1.0f, 1.0f) * kModel)[0] == 3.0f &&
+              (Vec4f(1.0f, 1.0f, 1.0f, 1.0f) * kModel)[2] == 11.0f, "transform a point");
+static_assert(kOrtho.m[0][0] == 0.5f && kOrtho.m[1][1] == 0.25f && kOrtho.m[2][2] == -1.0f &&
+              kOrtho.m[3][2] == -2.0f, "orthographic");
+static_assert(dot(Vec3f(1.0f, 2.0f, 3.0f), Vec3f(4.0f, 5.0f, 6.0f)) == 32.0f, "dot");
+static_assert(cross(Vec3f(1.0f, 0.0f, 0.0f), Vec3f(0.0f, 1.0f, 0.0f))[2] == 1.0f, "cross");
+static_assert(es::sqrt(16.0f) == 4.0f && length(Vec3f(3.0f, 4.0f, 0.0f)) == 5.0f, "sqrt");
+
+}
+
+}
+
+#endif
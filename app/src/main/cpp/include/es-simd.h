@@ -0,0 +1,131 @@
+#ifndef GLES_ESSIMD_H
+#define GLES_ESSIMD_H
+
+// 以下内联函数屏蔽 AVX/SSE/NEON 的差异，剔除、光栅化等函数只写一遍；
+// 比较结果（全 1 或全 0 的掩码）也用浮点向量类型保存，vmask 取出每个通道的最高位。
+// 有 SIMD 时定义 ES_SIMD；没有时 vfloat 退化为单个 float（宽度为 1，掩码为 1.0/0.0），
+// 按 ES_SIMD_WIDTH 步进的代码不需要单独的标量版本。
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define ES_SIMD
+#define ES_SIMD_WIDTH 8
+typedef __m256 vfloat;
+
+static inline vfloat vload(const float *p) { return _mm256_loadu_ps(p); }
+static inline void vstore(float *p, vfloat v) { _mm256_storeu_ps(p, v); }
+static inline vfloat vsplat(float v) { return _mm256_set1_ps(v); }
+//0, 1, 2, ... ES_SIMD_WIDTH - 1
+static inline vfloat vramp() { return _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f); }
+static inline vfloat vadd(vfloat a, vfloat b) { return _mm256_add_ps(a, b); }
+static inline vfloat vsub(vfloat a, vfloat b) { return _mm256_sub_ps(a, b); }
+static inline vfloat vmul(vfloat a, vfloat b) { return _mm256_mul_ps(a, b); }
+static inline vfloat vmadd(vfloat a, vfloat b, vfloat c) { return _mm256_add_ps(_mm256_mul_ps(a, b), c); }
+static inline vfloat vmin(vfloat a, vfloat b) { return _mm256_min_ps(a, b); }
+static inline vfloat vmax(vfloat a, vfloat b) { return _mm256_max_ps(a, b); }
+static inline vfloat vrcp(vfloat a) { return _mm256_div_ps(_mm256_set1_ps(1.0f), a); }
+static inline vfloat vge(vfloat a, vfloat b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+static inline vfloat vgt(vfloat a, vfloat b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+static inline vfloat vlt(vfloat a, vfloat b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+static inline vfloat vand(vfloat a, vfloat b) { return _mm256_and_ps(a, b); }
+static inline vfloat vor(vfloat a, vfloat b) { return _mm256_or_ps(a, b); }
+//mask 为真的通道取 a，否则取 b
+static inline vfloat vselect(vfloat mask, vfloat a, vfloat b) { return _mm256_blendv_ps(b, a, mask); }
+static inline vfloat vtrue() { return _mm256_castsi256_ps(_mm256_set1_epi32(-1)); }
+static inline int vmask(vfloat m) { return _mm256_movemask_ps(m); }
+#elif defined(__SSE2__) || defined(__x86_64__)
+#include <emmintrin.h>
+#define ES_SIMD
+#define ES_SIMD_WIDTH 4
+typedef __m128 vfloat;
+
+static inline vfloat vload(const float *p) { return _mm_loadu_ps(p); }
+static inline void vstore(float *p, vfloat v) { _mm_storeu_ps(p, v); }
+static inline vfloat vsplat(float v) { return _mm_set1_ps(v); }
+static inline vfloat vramp() { return _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f); }
+static inline vfloat vadd(vfloat a, vfloat b) { return _mm_add_ps(a, b); }
+static inline vfloat vsub(vfloat a, vfloat b) { return _mm_sub_ps(a, b); }
+static inline vfloat vmul(vfloat a, vfloat b) { return _mm_mul_ps(a, b); }
+static inline vfloat vmadd(vfloat a, vfloat b, vfloat c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+static inline vfloat vmin(vfloat a, vfloat b) { return _mm_min_ps(a, b); }
+static inline vfloat vmax(vfloat a, vfloat b) { return _mm_max_ps(a, b); }
+static inline vfloat vrcp(vfloat a) { return _mm_div_ps(_mm_set1_ps(1.0f), a); }
+static inline vfloat vge(vfloat a, vfloat b) { return _mm_cmpge_ps(a, b); }
+static inline vfloat vgt(vfloat a, vfloat b) { return _mm_cmpgt_ps(a, b); }
+static inline vfloat vlt(vfloat a, vfloat b) { return _mm_cmplt_ps(a, b); }
+static inline vfloat vand(vfloat a, vfloat b) { return _mm_and_ps(a, b); }
+static inline vfloat vor(vfloat a, vfloat b) { return _mm_or_ps(a, b); }
+static inline vfloat vselect(vfloat mask, vfloat a, vfloat b) {
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+static inline vfloat vtrue() { return _mm_castsi128_ps(_mm_set1_epi32(-1)); }
+static inline int vmask(vfloat m) { return _mm_movemask_ps(m); }
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define ES_SIMD
+#define ES_SIMD_WIDTH 4
+typedef float32x4_t vfloat;
+
+static inline vfloat vload(const float *p) { return vld1q_f32(p); }
+static inline void vstore(float *p, vfloat v) { vst1q_f32(p, v); }
+static inline vfloat vsplat(float v) { return vdupq_n_f32(v); }
+static inline vfloat vramp() {
+    static const float ramp[4] = {0.0f, 1.0f, 2.0f, 3.0f};
+    return vld1q_f32(ramp);
+}
+static inline vfloat vadd(vfloat a, vfloat b) { return vaddq_f32(a, b); }
+static inline vfloat vsub(vfloat a, vfloat b) { return vsubq_f32(a, b); }
+static inline vfloat vmul(vfloat a, vfloat b) { return vmulq_f32(a, b); }
+static inline vfloat vmadd(vfloat a, vfloat b, vfloat c) { return vmlaq_f32(c, a, b); }
+static inline vfloat vmin(vfloat a, vfloat b) { return vminq_f32(a, b); }
+static inline vfloat vmax(vfloat a, vfloat b) { return vmaxq_f32(a, b); }
+static inline vfloat vrcp(vfloat a) {
+    // 估计值再做两次牛顿迭代，精度接近除法
+    float32x4_t r = vrecpeq_f32(a);
+    r = vmulq_f32(r, vrecpsq_f32(a, r));
+    return vmulq_f32(r, vrecpsq_f32(a, r));
+}
+static inline vfloat vge(vfloat a, vfloat b) { return vreinterpretq_f32_u32(vcgeq_f32(a, b)); }
+static inline vfloat vgt(vfloat a, vfloat b) { return vreinterpretq_f32_u32(vcgtq_f32(a, b)); }
+static inline vfloat vlt(vfloat a, vfloat b) { return vreinterpretq_f32_u32(vcltq_f32(a, b)); }
+static inline vfloat vand(vfloat a, vfloat b) {
+    return vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(a), vreinterpretq_u32_f32(b)));
+}
+static inline vfloat vor(vfloat a, vfloat b) {
+    return vreinterpretq_f32_u32(vorrq_u32(vreinterpretq_u32_f32(a), vreinterpretq_u32_f32(b)));
+}
+static inline vfloat vselect(vfloat mask, vfloat a, vfloat b) {
+    return vbslq_f32(vreinterpretq_u32_f32(mask), a, b);
+}
+static inline vfloat vtrue() { return vreinterpretq_f32_u32(vdupq_n_u32(0xFFFFFFFFu)); }
+static inline int vmask(vfloat m) {
+    uint32x4_t bits = vshrq_n_u32(vreinterpretq_u32_f32(m), 31);
+    return (int) (vgetq_lane_u32(bits, 0) | (vgetq_lane_u32(bits, 1) << 1) |
+                  (vgetq_lane_u32(bits, 2) << 2) | (vgetq_lane_u32(bits, 3) << 3));
+}
+#else
+#define ES_SIMD_WIDTH 1
+typedef float vfloat;
+
+static inline vfloat vload(const float *p) { return *p; }
+static inline void vstore(float *p, vfloat v) { *p = v; }
+static inline vfloat vsplat(float v) { return v; }
+static inline vfloat vramp() { return 0.0f; }
+static inline vfloat vadd(vfloat a, vfloat b) { return a + b; }
+static inline vfloat vsub(vfloat a, vfloat b) { return a - b; }
+static inline vfloat vmul(vfloat a, vfloat b) { return a * b; }
+static inline vfloat vmadd(vfloat a, vfloat b, vfloat c) { return a * b + c; }
+static inline vfloat vmin(vfloat a, vfloat b) { return a < b ? a : b; }
+static inline vfloat vmax(vfloat a, vfloat b) { return a > b ? a : b; }
+static inline vfloat vrcp(vfloat a) { return 1.0f / a; }
+static inline vfloat vge(vfloat a, vfloat b) { return a >= b ? 1.0f : 0.0f; }
+static inline vfloat vgt(vfloat a, vfloat b) { return a > b ? 1.0f : 0.0f; }
+static inline vfloat vlt(vfloat a, vfloat b) { return a < b ? 1.0f : 0.0f; }
+static inline vfloat vand(vfloat a, vfloat b) { return a * b; }
+static inline vfloat vor(vfloat a, vfloat b) { return a > b ? a : b; }
+static inline vfloat vselect(vfloat mask, vfloat a, vfloat b) { return mask != 0.0f ? a : b; }
+static inline vfloat vtrue() { return 1.0f; }
+static inline int vmask(vfloat m) { return m != 0.0f; }
+#endif
+
+#endif
@@ -2,8 +2,6 @@
 #define GLES_ESUTIL_H
 
 #include <GLES3/gl3.h>
-#include <android/log.h>
-#include <jni.h>
 
 #ifndef LOG_TAG
 #define LOG_TAG "ES_LIB"
@@ -12,33 +10,72 @@
 #define STR(s) #s
 #define STRV(s) STR(s)
 
+#ifdef __ANDROID__
+#include <android/log.h>
+#include <jni.h>
+
 #define ALOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
 #define ALOGD(...) __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
+#else
+//主机构建（基准测试）没有 logcat，输出到 stderr
+#include <cstdio>
+
+#define ALOGE(...) fprintf(stderr, LOG_TAG ": " __VA_ARGS__)
+#define ALOGD(...) fprintf(stderr, LOG_TAG ": " __VA_ARGS__)
+#endif
 
 #include <cstdlib>
+#include <cstring>
 #include <cmath>
+#include "es-math.h"
 
 #define  PI 3.1415927
 
 //检查当前程序错误
 bool checkGlError(const char *funcName);
+//当前上下文是否支持指定的 GL 扩展
+bool hasGlExtension(const char *name);
 //获取并编译着色器对象
 GLuint createShader(GLenum shaderType, const char *src);
-//使用着色器生成着色器程序对象
-GLuint createProgram(const char *vtxSrc, const char *fragSrc);
+//使用着色器生成着色器程序对象，binaryRetrievable 为 true 时链接后可以用 glGetProgramBinary 取出二进制
+GLuint createProgram(const char *vtxSrc, const char *fragSrc, bool binaryRetrievable = false);
+
+
+#define CUBE_VERTEX_COUNT 24
+#define CUBE_INDEX_COUNT 36
 
+//见 mesh-optimizer.h
+struct MeshOptimizeStats;
 
-//产生一个立方体
+//以下函数的 optimize 为 true 时做顶点缓存优化（见 mesh-optimizer.h），
+//stats 不为 NULL 时写入优化前后的 ACMR/ATVR，没有优化时清零
+//产生一个立方体，分配失败时返回 0
 int createCube(float scale, GLfloat **vertices, GLfloat **normals,
-               GLfloat **texCoords, GLuint **indices);
-int createSquareGrid ( int size, GLfloat **vertices, GLuint **indices );
-//生成一个球
+               GLfloat **texCoords, GLuint **indices, bool optimize = true);
+//把立方体写入调用方分配好的缓冲区（CUBE_VERTEX_COUNT 个顶点），指针可为 NULL，返回索引数
+int createCubeInto(float scale, GLfloat *vertices, GLfloat *normals, GLfloat *texCoords,
+                   GLuint *indices, bool optimize);
+//产生一个 size * size 的网格，失败时返回 0，输出指针置为 NULL
+int createSquareGrid(int size, GLfloat **vertices, GLuint **indices, bool optimize = true,
+                     MeshOptimizeStats *stats = NULL);
+//生成一个球，失败时返回 0，输出指针置为 NULL
 int createSphere(int numSlices, float radius, GLfloat **vertices, GLfloat **normals,
-                 GLfloat **texCoords, GLuint **indices);
+                 GLfloat **texCoords, GLuint **indices, bool optimize = true,
+                 MeshOptimizeStats *stats = NULL);
 
+//16 字节对齐，便于 NEON/SSE 按行整体读写
 typedef struct {
-    GLfloat m[4][4];
+    alignas(16) GLfloat m[4][4];
 } Matrix;
+//Matrix 与 es::Mat4f 内存布局相同，二者之间互相转换
+inline es::Mat4f toMat4(const Matrix *src) {
+    es::Mat4f result;
+    memcpy(result.m, src->m, sizeof(Matrix));
+    return result;
+}
+inline void fromMat4(Matrix *result, const es::Mat4f &src) {
+    memcpy(result->m, src.m, sizeof(Matrix));
+}
 //初始化一个矩阵
 void matrixLoadIdentity(Matrix *result);
 //矩阵变换
@@ -47,6 +84,13 @@ void translate(Matrix *result, GLfloat tx, GLfloat ty, GLfloat tz);
 void rotate(Matrix *result, GLfloat angle, GLfloat x, GLfloat y, GLfloat z);
 //矩阵相乘
 void matrixMultiply(Matrix *result, Matrix *srcA, Matrix *srcB);
+//标量实现，与 SIMD 实现的结果逐位相同，用于测试
+void matrixMultiplyScalar(Matrix *result, const Matrix *srcA, const Matrix *srcB);
+//批量矩阵相乘：result[i] = srcA[i] * srcB[i]
+void matrixMultiplyN(Matrix *result, const Matrix *srcA, const Matrix *srcB, int n);
+//批量右乘同一个矩阵：result[i] = srcA[i] * srcB，result 相邻元素间隔 resultStride 字节（需 16 字节对齐）
+void matrixMultiplyBatch(Matrix *result, size_t resultStride, const Matrix *srcA, const Matrix *srcB,
+                         int n);
 //矩阵截取
 void frustum(Matrix *result, float w, float h, float nearZ, float farZ);
 //矩阵透视变换
@@ -56,4 +100,11 @@ void ortho(Matrix *result, float left, float right, float bottom, float top, flo
 void scale(Matrix *result, GLfloat sx, GLfloat sy, GLfloat sz);
 void matrixLookAt(Matrix *result, float posX, float posY, float posZ, float lookAtX, float lookAtY,
                   float lookAtZ, float upX, float upY, float upZ);
+//一次生成 MVP 矩阵，等价于 model(translate→rotate→scale) * lookAt * perspective
+void modelViewProjection(Matrix *result,
+                         const GLfloat eye[3], const GLfloat target[3], const GLfloat up[3],
+                         float fovy, float aspect, float nearZ, float farZ,
+                         const GLfloat translation[3],
+                         GLfloat angle, const GLfloat axis[3],
+                         const GLfloat scaling[3]);
 #endif
\ No newline at end of file
@@ -0,0 +1,72 @@
+#ifndef GLES_GL_BUFFER_H
+#define GLES_GL_BUFFER_H
+
+#include "es-util.h"
+#include "vertex-format.h"
+
+// 缓冲区对象管理：
+// MeshBuffer：每个网格一个 VAO，顶点/索引一次性上传为静态 VBO/IBO，绘制时只需绑定 VAO；
+// UniformRing：每帧变化的 uniform 数据写入环形 UBO，按帧划分区段，用 glFenceSync 保证
+// GPU 用完之前不会覆盖；也可以选择 orphaning 模式（每帧 glBufferData(NULL)，由驱动处理同步）。
+
+typedef struct {
+    GLuint vao;
+    GLuint vbo[MAX_VERTEX_ATTRIBS];
+    GLuint ibo;
+    GLsizei vertexCount;
+    GLsizei indexCount;       // 为 0 时用 glDrawArrays 绘制
+    GLenum indexType;
+} MeshBuffer;
+
+//上传 createCube/createSphere 等函数输出的分离数组，normals/texCoords/indices 可为 NULL
+bool createMeshBuffer(MeshBuffer *mesh, int numVertices, const GLfloat *vertices,
+                      const GLfloat *normals, const GLfloat *texCoords,
+                      int numIndices, const GLuint *indices);
+//布局与 createMeshBuffer 相同，只分配存储不上传数据，由 GPU 写入（见 gpu-generator.h），numIndices 为 0 时没有 IBO
+bool allocateMeshBuffer(MeshBuffer *mesh, int numVertices, bool normals, bool texCoords,
+                        int numIndices, GLenum usage);
+//上传 vertex-format.h 生成的交错顶点和索引
+bool createInterleavedMeshBuffer(MeshBuffer *mesh, const VertexLayout *layout,
+                                 const void *vertices, const void *indices);
+void drawMeshBuffer(const MeshBuffer *mesh);
+void deleteMeshBuffer(MeshBuffer *mesh);
+
+//环形 UBO 的区段数，即允许同时在 GPU 上排队的帧数
+#define UNIFORM_RING_SEGMENTS 3
+
+typedef enum {
+    UNIFORM_RING_FENCED,      // 每帧一个区段，开始写之前等待该区段上一次的 fence
+    UNIFORM_RING_ORPHAN,      // 每帧重新分配缓冲区存储，由驱动负责同步
+} UniformRingMode;
+
+typedef struct {
+    GLuint buffer;
+    UniformRingMode mode;
+    GLint alignment;          // GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+    GLsizeiptr segmentSize;
+    int segment;              // 当前帧使用的区段
+    GLsizeiptr cursor;        // 当前区段内已分配的字节数
+    GLubyte *mapped;          // 当前区段的映射地址，帧外为 NULL
+    GLsync fences[UNIFORM_RING_SEGMENTS];
+    int waitCount;            // 因 GPU 未完成而等待 fence 的次数
+} UniformRing;
+
+//在 [cursor, limit) 中按 alignment 对齐分配 size 字节，成功时返回 true 并写入 offset
+bool ringSubAllocate(GLsizeiptr cursor, GLsizeiptr size, GLint alignment, GLsizeiptr limit,
+                     GLsizeiptr *offset);
+
+//segmentSize 为每帧可用的 uniform 字节数
+bool uniformRingInit(UniformRing *ring, GLsizeiptr segmentSize, UniformRingMode mode);
+//切换到下一个区段并映射，每帧开始时调用
+bool uniformRingBeginFrame(UniformRing *ring);
+//把 size 字节写入当前区段，返回其在缓冲区中的偏移，空间不足时返回 -1
+GLintptr uniformRingPush(UniformRing *ring, const void *data, GLsizeiptr size);
+//解除映射，映射期间不能绘制，写完本帧数据后、绘制前调用
+void uniformRingFlush(UniformRing *ring);
+//把 uniformRingPush 返回的区域绑定到 uniform block 绑定点
+void uniformRingBind(const UniformRing *ring, GLuint binding, GLintptr offset, GLsizeiptr size);
+//为当前区段插入 fence，本帧所有使用该区段的绘制提交之后调用
+void uniformRingEndFrame(UniformRing *ring);
+void uniformRingRelease(UniformRing *ring);
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef GLES_GPU_GENERATOR_H
+#define GLES_GPU_GENERATOR_H
+
+#include "es-util.h"
+#include "gl-buffer.h"
+#include "instance-recorder.h"
+
+// GPU 生成：球体/网格的顶点和索引、每个实例的 MVP 在 GPU 上计算，直接写入绘制使用的缓冲区，
+// 不经过 CPU 生成再上传。
+// 1. 支持 GLES 3.1 时用计算着色器，输出缓冲区绑定为 SSBO，完成后插入 glMemoryBarrier；
+// 2. 否则用 GLES 3.0 的 transform feedback：关闭光栅化，以 GL_POINTS 绘制，
+//    顶点着色器由 gl_VertexID 算出一个顶点（或一个四边形的 6 个索引、一个实例的 MVP）写入反馈缓冲区。
+// 结果与 CPU 实现一致：网格同关闭优化（默认）时的 createSphereInto/createSquareGridInto，GPU 不做顶点缓存优化；
+// 实例同 recordInstances（但不剔除，每个物体都输出）。test/gpu-generator-test.cpp 在 Mesa 上以 CPU 实现为参考
+// 比较两种后端的输出和绘制结果。
+// 所有函数都在 GL 线程调用，会改变 VAO、缓冲区和程序的绑定。
+
+typedef enum {
+    GPU_GENERATOR_NONE,
+    GPU_GENERATOR_TRANSFORM_FEEDBACK,
+    GPU_GENERATOR_COMPUTE,
+} GpuGeneratorBackend;
+
+//同步编译生成程序，allowCompute 为 false 时即使支持 GLES 3.1 也使用 transform feedback；上下文重建后重新调用
+bool gpuGeneratorInit(bool allowCompute = true);
+GpuGeneratorBackend gpuGeneratorBackend();
+//分配 mesh 的存储（布局同 createMeshBuffer）并在 GPU 上生成球体，包括法线、纹理坐标和索引
+bool gpuCreateSphereMesh(MeshBuffer *mesh, int numSlices, float radius);
+//分配 mesh 的存储并在 GPU 上生成 size * size 的网格（只有位置）和索引
+bool gpuCreateSquareGridMesh(MeshBuffer *mesh, int size);
+//上传 objects 后在 GPU 上计算每个物体的 模型矩阵 * viewProj 及颜色，
+//写入 buffer 中 offset（4 的倍数）开始的 InstanceData 数组。写入实例流中的一段时，
+//之后以 count 为 0 调用 instanceStreamSubmit，只设置实例属性而不上传 CPU 端的数据
+bool gpuRecordInstances(GLuint buffer, GLintptr offset, const RecordObject *objects, int count,
+                        const Matrix *viewProj);
+void gpuGeneratorRelease();
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef GLES_INSTANCE_RECORDER_H
+#define GLES_INSTANCE_RECORDER_H
+
+#include <stdint.h>
+#include "es-util.h"
+#include "culling.h"
+#include "instancing.h"
+#include "thread-pool.h"
+
+// 并行录制实例数据：物体按 RECORD_CHUNK 个一块，
+// 第一遍各块并行剔除并统计可见数，前缀和得到每块在输出中的起始位置，
+// 第二遍各块并行计算可见物体的 MVP，写入输出中属于自己的连续区间；
+// 输出可以直接是映射的实例缓冲区，各线程互不重叠，GL 线程只需提交绘制。
+// 不调用 GL，可以在任意线程执行。
+
+//每块的物体数
+#define RECORD_CHUNK 256
+
+typedef struct {
+    float position[3];
+    float axis[3];         // 旋转轴（单位向量）
+    float angle;           // 旋转角度（度）
+    float scale;
+    float radius;          // 模型空间包围球半径（中心在原点），0 表示不剔除
+    GLfloat color[4];
+} RecordObject;
+
+typedef struct {
+    int *chunkOffsets;     // 每块的可见数，前缀和之后为写入位置
+    uint8_t *visible;
+    int capacity;
+} InstanceRecorder;
+
+bool instanceRecorderInit(InstanceRecorder *recorder, int capacity);
+void instanceRecorderRelease(InstanceRecorder *recorder);
+
+//把 objects 中可见物体的 模型矩阵 * viewProj 及颜色紧凑地写入 out，返回写入的实例数；
+//模型矩阵为 translate(position) → rotate(angle, axis) → scale(scale)，
+//frustum 为 NULL 时不剔除，可见数超过 outCapacity 时截断；pool 为 NULL 时在当前线程执行
+int recordInstances(InstanceRecorder *recorder, const RecordObject *objects, int count,
+                    const Matrix *viewProj, const Frustum *frustum, InstanceData *out,
+                    int outCapacity, ThreadPool *pool);
+
+#endif
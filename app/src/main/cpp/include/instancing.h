@@ -0,0 +1,70 @@
+#ifndef GLES_INSTANCING_H
+#define GLES_INSTANCING_H
+
+#include <atomic>
+#include "es-util.h"
+#include "gl-buffer.h"
+
+// 实例化绘制：同一个网格的 N 个实例（各自的变换矩阵和颜色）打包进实例缓冲区，
+// 一次 glDrawElementsInstanced 画完。实例属性挂在网格的 VAO 上，
+// 矩阵占用 location 4~7（每行一个 vec4），颜色占用 location 8。
+
+#define INSTANCE_ATTRIB_MATRIX 4
+#define INSTANCE_ATTRIB_COLOR 8
+
+//顶点着色器中声明实例属性的 GLSL 片段，gl_Position = instanceMatrix * position
+extern const char INSTANCE_ATTRIBS_GLSL[];
+
+typedef struct {
+    Matrix transform;
+    GLfloat color[4];
+} InstanceData;
+
+typedef struct {
+    const MeshBuffer *mesh;
+    GLuint instanceVbo;
+    int capacity;
+    int count;
+    InstanceData *staging;    // CPU 端打包区，16 字节对齐
+} InstanceBatch;
+
+//为 mesh 创建最多容纳 capacity 个实例的批次，并在 mesh 的 VAO 上设置实例属性
+bool instanceBatchInit(InstanceBatch *batch, const MeshBuffer *mesh, int capacity);
+//打包 count 个实例（超出容量的部分丢弃），colors 为 RGBA，可为 NULL（白色）；
+//viewProj 不为 NULL 时写入 transforms[i] * viewProj，即直接得到每个实例的 MVP
+void instanceBatchPack(InstanceBatch *batch, const Matrix *transforms, const GLfloat *colors,
+                       int count, const Matrix *viewProj);
+//上传实例数据并一次绘制所有实例，调用前需已 glUseProgram
+void instanceBatchDraw(InstanceBatch *batch);
+void instanceBatchRelease(InstanceBatch *batch);
+
+// 实例流：实例缓冲区分成 INSTANCE_STREAM_SEGMENTS 段，每帧写一段，供其他线程直接写入：
+// 支持 GL_EXT_buffer_storage 时整个缓冲区持久映射，录制线程写入后 GL 线程只需提交绘制；
+// 否则录制线程写入 CPU 端的同样大小的内存，GL 线程提交时再上传该段。
+// ES 3.0 没有 base instance，提交时把实例属性的偏移指向该段。
+// 同步约定：录制线程最多领先 GL 线程 INSTANCE_STREAM_SEGMENTS - 2 帧，
+// GL 线程每帧结束时等待再早两帧的那一段被 GPU 读完，于是录制线程开始写某段时它一定已经空闲。
+
+#define INSTANCE_STREAM_SEGMENTS 4
+
+typedef struct {
+    const MeshBuffer *mesh;
+    GLuint buffer;
+    int capacity;                 // 每段的实例数
+    InstanceData *mapped;         // 持久映射的地址，不支持时为 NULL
+    InstanceData *staging;        // 不支持持久映射时 CPU 端的各段数据
+    GLsync fences[INSTANCE_STREAM_SEGMENTS];
+    std::atomic<bool> ready;      // GL 线程初始化完成后置位，之后其他线程才能写入
+} InstanceStream;
+
+//GL 线程：为 mesh 创建实例流，每段最多 capacity 个实例
+bool instanceStreamInit(InstanceStream *stream, const MeshBuffer *mesh, int capacity);
+//任意线程：第 segment 段的写入地址，未初始化时返回 NULL
+InstanceData *instanceStreamSegment(InstanceStream *stream, int segment);
+//GL 线程：使用第 segment 段的前 count 个实例，之后以 count 个实例绘制 mesh
+void instanceStreamSubmit(InstanceStream *stream, int segment, int count);
+//GL 线程：第 segment 段的绘制提交之后调用，插入 fence 并等待两帧之前的那一段
+void instanceStreamEndFrame(InstanceStream *stream, int segment);
+void instanceStreamRelease(InstanceStream *stream);
+
+#endif
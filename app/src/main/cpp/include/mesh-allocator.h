@@ -0,0 +1,180 @@
+#ifndef GLES_MESH_ALLOCATOR_H
+#define GLES_MESH_ALLOCATOR_H
+
+#include <stddef.h>
+#include "es-util.h"
+
+// 网格内存分配：
+// MeshAllocator 是分配器接口，生成器通过 Mesh 向它申请一整块连续内存，
+// 顶点/法线/纹理坐标/索引依次放在这块内存中，每个网格只分配一次；
+// MallocAllocator：直接使用 malloc/free；
+// LinearArena：预先分配一大块内存，按顺序切分，单独释放不做任何事，reset 时整体回收，
+//              适合每帧或每次重建 LOD 时生成的临时网格；它的 bytesInUse 是已切分出去的字节数（含对齐填充），
+//              只在 reset/rewind 时减少；
+// PoolAllocator：按 2 的幂划分大小等级，释放的块挂回对应等级的空闲链表，下次直接复用，
+//                反复生成大小相近的网格时不再调用 malloc。
+// 分配器都不是线程安全的，每个线程使用自己的实例。
+
+//分配的内存按 16 字节对齐，便于 SIMD 读写
+#define MESH_ALLOC_ALIGNMENT 16
+
+typedef struct {
+    size_t allocations;        // allocate 调用次数
+    size_t frees;              // deallocate 调用次数
+    size_t failures;           // 分配失败次数
+    size_t systemAllocations;  // 向系统（malloc）申请内存的次数
+    size_t bytesInUse;         // 已分配且未释放的字节数
+    size_t peakBytes;          // bytesInUse 的峰值
+} AllocatorStats;
+
+class MeshAllocator {
+public:
+    virtual ~MeshAllocator() {}
+
+    //分配 size 字节，按 MESH_ALLOC_ALIGNMENT 对齐，失败时返回 NULL
+    virtual void *allocate(size_t size) = 0;
+
+    //释放 allocate 返回的内存，size 必须与分配时相同
+    virtual void deallocate(void *ptr, size_t size) = 0;
+
+    const AllocatorStats &stats() const { return counters; }
+
+    void resetStats();
+
+protected:
+    void countAllocation(size_t size);
+
+    void countFree(size_t size);
+
+    AllocatorStats counters = {};
+};
+
+class MallocAllocator : public MeshAllocator {
+public:
+    void *allocate(size_t size) override;
+
+    void deallocate(void *ptr, size_t size) override;
+};
+
+//进程内共享的 malloc 分配器，Mesh 未指定分配器时使用
+MeshAllocator *defaultMeshAllocator();
+
+class LinearArena : public MeshAllocator {
+public:
+    explicit LinearArena(size_t capacity);
+
+    ~LinearArena() override;
+
+    LinearArena(const LinearArena &) = delete;
+
+    LinearArena &operator=(const LinearArena &) = delete;
+
+    void *allocate(size_t size) override;
+
+    //不回收单个分配，只增加 frees 计数
+    void deallocate(void *ptr, size_t size) override;
+
+    //回收全部分配，之前分配的网格不能再使用（之后仍可以对它们调用 deallocate）
+    void reset();
+
+    //当前位置，之后可以用 rewind 回收此后的所有分配
+    size_t marker() const { return offset; }
+
+    //回收 mark 之后的所有分配，mark 必须来自 marker()
+    void rewind(size_t mark);
+
+    size_t capacity() const { return size; }
+
+    size_t used() const { return offset; }
+
+private:
+    unsigned char *base;
+    size_t size;
+    size_t offset = 0;
+};
+
+//最小和最大的大小等级（2 的幂），超过最大等级的分配直接使用 malloc
+#define POOL_MIN_CLASS_SHIFT 8
+#define POOL_MAX_CLASS_SHIFT 24
+#define POOL_CLASS_COUNT (POOL_MAX_CLASS_SHIFT - POOL_MIN_CLASS_SHIFT + 1)
+
+class PoolAllocator : public MeshAllocator {
+public:
+    //maxCachedBytes 为空闲链表中最多保留的字节数，超过时直接还给系统
+    explicit PoolAllocator(size_t maxCachedBytes = 64 * 1024 * 1024);
+
+    ~PoolAllocator() override;
+
+    PoolAllocator(const PoolAllocator &) = delete;
+
+    PoolAllocator &operator=(const PoolAllocator &) = delete;
+
+    void *allocate(size_t size) override;
+
+    void deallocate(void *ptr, size_t size) override;
+
+    //释放所有空闲块
+    void trim();
+
+    size_t cachedBytes() const { return cached; }
+
+private:
+    struct FreeBlock {
+        FreeBlock *next;
+    };
+
+    FreeBlock *freeLists[POOL_CLASS_COUNT] = {};
+    size_t maxCached;
+    size_t cached = 0;
+};
+
+//一个网格的顶点和索引数据，所有数组位于同一块内存中。
+//析构时把内存还给分配器，只能移动不能复制；使用 LinearArena 时不能在 reset 之后继续使用
+class Mesh {
+public:
+    explicit Mesh(MeshAllocator *allocator = NULL);
+
+    ~Mesh();
+
+    Mesh(Mesh &&other) noexcept;
+
+    Mesh &operator=(Mesh &&other) noexcept;
+
+    Mesh(const Mesh &) = delete;
+
+    Mesh &operator=(const Mesh &) = delete;
+
+    //按数量分配各数组，原有数据被释放；hasNormals/hasTexCoords 为 false 时对应数组为 NULL
+    bool allocate(int numVertices, int numIndices, bool hasNormals, bool hasTexCoords);
+
+    void release();
+
+    GLfloat *vertices() const { return vertexData; }
+
+    GLfloat *normals() const { return normalData; }
+
+    GLfloat *texCoords() const { return texCoordData; }
+
+    GLuint *indices() const { return indexData; }
+
+    int vertexCount() const { return numVertices; }
+
+    int indexCount() const { return numIndices; }
+
+    size_t byteSize() const { return blockSize; }
+
+    MeshAllocator *allocator() const { return owner; }
+
+private:
+    MeshAllocator *owner;
+    void *block = NULL;
+    size_t blockSize = 0;
+    GLfloat *vertexData = NULL;
+    GLfloat *normalData = NULL;
+    GLfloat *texCoordData = NULL;
+    GLuint *indexData = NULL;
+    int numVertices = 0;
+    int numIndices = 0;
+};
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef GLES_MESH_GENERATOR_H
+#define GLES_MESH_GENERATOR_H
+
+#include "es-util.h"
+#include "thread-pool.h"
+#include "mesh-allocator.h"
+#include "mesh-optimizer.h"
+
+// 球体/网格生成器：预先计算每行、每列的 sin/cos 等系数，
+// 顶点和索引可以按行分块生成，直接写入调用方提供的缓冲区（包括 glMapBufferRange 映射的内存），
+// 大网格不需要再拷贝一次；分块之间互不依赖，可交给 ThreadPool 并行生成。
+// 系数表和优化用的临时缓冲区用 malloc 申请并在返回前释放，不经过网格的分配器：
+// LinearArena 不回收单独释放的内存，临时内存放在里面会一直占用到 reset。
+
+typedef struct {
+    int numSlices;
+    int numParallels;
+    float radius;
+    GLfloat *sinLat;   // numParallels + 1 项，sinf(angleStep * i)
+    GLfloat *cosLat;   // numParallels + 1 项
+    GLfloat *sinLon;   // numSlices + 1 项，sinf(angleStep * j)
+    GLfloat *cosLon;   // numSlices + 1 项
+    GLfloat *texU;     // numSlices + 1 项，j / numSlices
+} SphereGenerator;
+
+typedef struct {
+    int size;
+    GLfloat *coord;    // size 项，i / (size - 1)
+} GridGenerator;
+
+//球体顶点数（每行 numSlices + 1 个顶点，共 numSlices / 2 + 1 行）
+int sphereVertexCount(int numSlices);
+int sphereIndexCount(int numSlices);
+int squareGridVertexCount(int size);
+int squareGridIndexCount(int size);
+
+//初始化球体生成器，计算 sin/cos 表，numSlices 小于 2 时返回 false
+bool sphereGeneratorInit(SphereGenerator *gen, int numSlices, float radius);
+void sphereGeneratorRelease(SphereGenerator *gen);
+//生成第 [rowBegin, rowEnd) 行的顶点，指针指向这些行在目标缓冲区中的起始位置，可为 NULL
+void sphereGeneratorVertices(const SphereGenerator *gen, int rowBegin, int rowEnd,
+                             GLfloat *vertices, GLfloat *normals, GLfloat *texCoords);
+//生成第 [rowBegin, rowEnd) 行四边形的索引（每行 numSlices * 6 个），indices 指向这些行的起始位置
+void sphereGeneratorIndices(const SphereGenerator *gen, int rowBegin, int rowEnd, GLuint *indices);
+
+//初始化网格生成器，size 小于 2 时返回 false
+bool gridGeneratorInit(GridGenerator *gen, int size);
+void gridGeneratorRelease(GridGenerator *gen);
+//生成第 [rowBegin, rowEnd) 行的顶点（每行 size 个）
+void gridGeneratorVertices(const GridGenerator *gen, int rowBegin, int rowEnd, GLfloat *vertices);
+//生成第 [rowBegin, rowEnd) 行四边形的索引（每行 (size - 1) * 6 个）
+void gridGeneratorIndices(const GridGenerator *gen, int rowBegin, int rowEnd, GLuint *indices);
+
+//以下两个函数生成完整网格，optimize 为 true 时做顶点缓存优化（见 mesh-optimizer.h），
+//优化在临时缓冲区中进行，输出缓冲区只写不读；stats 不为 NULL 时写入优化前后的 ACMR/ATVR，
+//没有优化（关闭或临时内存不足）时清零；按行生成的函数不做优化
+//把整个球体写入调用方分配好的缓冲区，pool 不为 NULL 时按行并行生成，返回索引数；
+//numSlices 非法或系数表分配失败时返回 0，不写入输出
+int createSphereInto(int numSlices, float radius, GLfloat *vertices, GLfloat *normals,
+                     GLfloat *texCoords, GLuint *indices, ThreadPool *pool, bool optimize,
+                     MeshOptimizeStats *stats = NULL);
+//把整个网格写入调用方分配好的缓冲区，pool 不为 NULL 时按行并行生成，返回索引数；失败时返回 0
+int createSquareGridInto(int size, GLfloat *vertices, GLuint *indices, ThreadPool *pool,
+                         bool optimize, MeshOptimizeStats *stats = NULL);
+
+//以下函数从 mesh 的分配器申请一整块内存并生成网格，分配器中只有网格本身这一次分配；
+//默认做顶点缓存优化，mesh 原有的数据被释放，失败时 mesh 为空并返回 false
+bool createSphereMesh(Mesh *mesh, int numSlices, float radius, ThreadPool *pool = NULL,
+                      bool optimize = true, MeshOptimizeStats *stats = NULL);
+bool createSquareGridMesh(Mesh *mesh, int size, ThreadPool *pool = NULL, bool optimize = true,
+                          MeshOptimizeStats *stats = NULL);
+bool createCubeMesh(Mesh *mesh, float scale, bool optimize = true);
+
+#endif
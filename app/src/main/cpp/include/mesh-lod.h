@@ -0,0 +1,95 @@
+#ifndef GLES_MESH_LOD_H
+#define GLES_MESH_LOD_H
+
+#include <memory>
+#include <vector>
+#include "es-util.h"
+#include "mesh-allocator.h"
+#include "thread-pool.h"
+
+// 网格 LOD：
+// 每种形状（球体/网格）按参数生成一条细分级别链，第 0 级最精细，之后每级分段数减半，
+// 生成后缓存在 LodCache 中，同样参数的物体共用一条链；
+// 绘制时按物体在屏幕上的投影大小选择级别：让每条边投影到屏幕上约 targetEdgePixels 像素，
+// 在两级交界处可以返回一个混合系数，由渲染端做淡入淡出或抖动过渡，避免级别切换时跳变。
+
+#define MAX_LOD_LEVELS 8
+
+typedef enum {
+    LOD_SHAPE_SPHERE,
+    LOD_SHAPE_GRID,        // createSquareGrid 生成的 [0,1]x[0,1] 网格
+} LodShape;
+
+typedef struct {
+    LodShape shape;
+    int resolution;        // 第 0 级的 numSlices（球体）或 size（网格）
+    int maxLevels;         // 最多生成的级别数，不超过 MAX_LOD_LEVELS
+    float radius;          // 球体半径，网格忽略
+} LodKey;
+
+typedef struct {
+    float viewportHeight;  // 视口高度（像素）
+    float targetEdgePixels;// 期望每条边在屏幕上的长度（像素）
+    float blendRange;      // 每级区间末尾用于过渡的比例（0~1），0 表示不混合
+} LodParams;
+
+typedef struct {
+    int level;             // 绘制的级别
+    int nextLevel;         // 过渡中的下一级（更粗），不在过渡区时与 level 相同
+    float blend;           // nextLevel 的权重（0~1）
+    float projectedRadius; // 包围球投影半径（像素）
+} LodSelection;
+
+class LodChain {
+public:
+    LodKey key;
+    int levelCount = 0;
+    int resolution[MAX_LOD_LEVELS];
+    Mesh levels[MAX_LOD_LEVELS];
+    float boundingRadius = 0.0f;  // 模型空间包围球半径
+    float center[3] = {0.0f, 0.0f, 0.0f};  // 模型空间包围球中心
+
+    //第 0 级每条边的长度（模型空间），之后每级加倍
+    float baseEdgeLength = 0.0f;
+
+    explicit LodChain(MeshAllocator *allocator);
+};
+
+typedef struct {
+    int hits;
+    int misses;
+    size_t bytes;          // 所有级别网格占用的字节数
+} LodCacheStats;
+
+//LOD 链缓存，不是线程安全的
+class LodCache {
+public:
+    //allocator 为 NULL 时使用 malloc，pool 不为 NULL 时并行生成各级网格
+    explicit LodCache(MeshAllocator *allocator = NULL, ThreadPool *pool = NULL);
+
+    //查找或生成 LOD 链，参数非法或内存不足时返回 NULL；返回的指针在 clear 之前有效
+    const LodChain *acquire(const LodKey &key);
+
+    void clear();
+
+    const LodCacheStats &stats() const { return counters; }
+
+private:
+    MeshAllocator *allocator;
+    ThreadPool *pool;
+    std::vector<std::unique_ptr<LodChain>> chains;
+    LodCacheStats counters = {};
+};
+
+//模型包围球投影到屏幕上的半径（像素），modelView 为物体的模型视图矩阵，
+//projection 为 perspective 生成的投影矩阵；包围球与相机相交时返回 FLT_MAX
+float projectedRadius(const Matrix *modelView, const Matrix *projection, const float center[3],
+                      float radius, float viewportHeight);
+//按投影大小选择级别
+void lodSelect(const LodChain *chain, const Matrix *modelView, const Matrix *projection,
+               const LodParams *params, LodSelection *selection);
+//批量选择，modelViews 和 selections 各 n 项，返回所选级别（含过渡中的下一级）的顶点总数
+long lodSelectBatch(const LodChain *chain, const Matrix *modelViews, int n,
+                    const Matrix *projection, const LodParams *params, LodSelection *selections);
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef GLES_MESH_OPTIMIZER_H
+#define GLES_MESH_OPTIMIZER_H
+
+#include "es-util.h"
+
+// 网格优化：纯 CPU 计算，不调用 GL。
+// 1. 三角形重排（Forsyth 算法），提高 GPU 顶点后变换缓存命中率；
+// 2. 顶点按首次使用顺序重排，提高顶点读取的局部性。
+// 优化是串行的，大网格上比生成本身慢一个数量级。生成完整网格的函数通过 optimize 参数决定是否优化：
+// 分配内存的 createSphere/createSphereMesh 等默认优化，适合生成一次、绘制多次的网格；
+// 写入调用方缓冲区的 *Into 函数必须显式指定。没有全局状态，不同线程可以使用不同的选项。
+// 工作内存用 malloc 申请并在返回前释放，可以同时在多个线程中使用。
+
+//统计时模拟的 FIFO 顶点缓存大小
+#define VERTEX_CACHE_SIZE 16
+
+typedef struct {
+    float acmr;   // 平均每个三角形的缓存缺失数（1 为理想的上限，0.5 为规则网格的极限）
+    float atvr;   // 缓存缺失数 / 顶点数（1 为理想值）
+} VertexCacheStats;
+
+//es-util.h 中前向声明了这个结构体
+typedef struct MeshOptimizeStats {
+    VertexCacheStats before;
+    VertexCacheStats after;
+} MeshOptimizeStats;
+
+//模拟大小为 cacheSize 的 FIFO 缓存，计算 ACMR/ATVR
+void analyzeVertexCache(const GLuint *indices, int numIndices, int numVertices, int cacheSize,
+                        VertexCacheStats *stats);
+//重排三角形顺序，结果写入 dst（可以与 indices 相同）
+void optimizeVertexCache(GLuint *dst, const GLuint *indices, int numIndices, int numVertices);
+//按索引中首次出现的顺序给顶点重新编号，原地改写 indices，remap[旧编号] = 新编号
+void optimizeVertexFetch(GLuint *indices, int numIndices, int numVertices, GLuint *remap);
+//按 remap 原地重排一个顶点属性数组，每个顶点 stride 字节
+void remapVertexStream(void *data, size_t stride, int numVertices, const GLuint *remap);
+//依次执行三角形重排和顶点重排，remap 可为 NULL，stats 可为 NULL
+void optimizeMesh(GLuint *indices, int numIndices, int numVertices, GLuint *remap,
+                  MeshOptimizeStats *stats);
+
+#endif
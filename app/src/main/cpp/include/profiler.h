@@ -0,0 +1,82 @@
+#ifndef GLES_PROFILER_H
+#define GLES_PROFILER_H
+
+#include <stdint.h>
+#include "es-util.h"
+
+// 性能统计：
+// CPU：PROFILE_SCOPE 记录一段代码的起止时间，每个线程写自己的无锁环形缓冲区（单生产者单消费者），
+//      profilerEndFrame 时统一收集到 trace 缓冲区，可以导出为 Chrome trace JSON（chrome://tracing）；
+// GPU：支持 EXT_disjoint_timer_query 时每帧用 GL_TIME_ELAPSED_EXT 计时，查询对象轮流使用，
+//      每帧读取所有已经可用的结果，不会阻塞；GPU 通常落后 CPU 两三帧，查询数太少时结果来不及可用就被复用；
+// 最近 PROFILER_FRAME_HISTORY 帧的 CPU/GPU 耗时用于计算 p50/p95/p99。
+
+//每个线程环形缓冲区的样本数，必须是 2 的幂
+#define PROFILER_RING_SIZE 1024
+//最多记录样本的线程数
+#define PROFILER_MAX_THREADS 16
+//导出 trace 时保留的最近样本数
+#define PROFILER_TRACE_CAPACITY 16384
+//计算分位数的帧数
+#define PROFILER_FRAME_HISTORY 240
+//轮流使用的 GPU 计时查询数，需要大于 GPU 落后 CPU 的帧数
+#define PROFILER_GPU_QUERIES 4
+
+typedef struct {
+    const char *name;     // 必须是静态字符串，只保存指针
+    uint64_t beginNs;
+    uint64_t endNs;
+    uint32_t tid;
+} ProfileSample;
+
+typedef struct {
+    int frames;           // 参与统计的帧数
+    float cpuP50;         // 毫秒
+    float cpuP95;
+    float cpuP99;
+    int gpuFrames;        // 得到 GPU 耗时的帧数，为 0 时 gpu 各项无效
+    float gpuP50;
+    float gpuP95;
+    float gpuP99;
+    int gpuDisjoint;      // 因 GPU 频率变化等原因丢弃的查询数
+    int gpuDropped;       // 复用时结果仍不可用而丢弃的查询数
+    int droppedSamples;   // 环形缓冲区已满而丢弃的 CPU 样本数
+} ProfileFrameStats;
+
+uint64_t profilerNowNs();
+//在 GL 线程调用，检查是否支持 GPU 计时；上下文重建后需要重新调用
+void profilerInit();
+//记录一个 CPU 样本，可以在任意线程调用
+void profilerRecord(const char *name, uint64_t beginNs, uint64_t endNs);
+//每帧开始和结束时在 GL 线程调用
+void profilerBeginFrame();
+void profilerEndFrame();
+//可以在任意线程调用，还没有完整的帧时返回 false
+bool profilerGetFrameStats(ProfileFrameStats *stats);
+//最近一帧的 CPU 耗时，以及上次调用之后新得到的 GPU 耗时（通常晚两三帧，同时得到多个时取最新的），
+//单位毫秒，没有时为 -1；同一个 GPU 耗时只返回一次，由渲染线程每帧调用一次
+void profilerLastFrameTimes(float *cpuMs, float *gpuMs);
+//把 trace 缓冲区中的样本写为 Chrome trace JSON
+bool profilerExportTrace(const char *path);
+
+class ProfileScope {
+public:
+    explicit ProfileScope(const char *name) : name(name), beginNs(profilerNowNs()) {}
+
+    ~ProfileScope() { profilerRecord(name, beginNs, profilerNowNs()); }
+
+    ProfileScope(const ProfileScope &) = delete;
+
+    ProfileScope &operator=(const ProfileScope &) = delete;
+
+private:
+    const char *name;
+    uint64_t beginNs;
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+//记录当前作用域的耗时，name 必须是字符串常量
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+
+#endif
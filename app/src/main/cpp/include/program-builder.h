@@ -0,0 +1,46 @@
+#ifndef GLES_PROGRAM_BUILDER_H
+#define GLES_PROGRAM_BUILDER_H
+
+#include "es-util.h"
+
+// 异步着色器程序构建：提交后立即返回句柄，编译和链接不阻塞 GL 线程。
+// 1. 支持 GL_KHR_parallel_shader_compile 时在 GL 线程提交编译/链接，但不查询状态，
+//    每帧用 GL_COMPLETION_STATUS_KHR 轮询，由驱动在后台线程完成；
+// 2. 否则在工作线程上创建共享 EGL 上下文，在工作线程中编译链接，完成后插入 fence，
+//    GL 线程轮询到 fence 已触发后才使用该程序；
+// 3. 以上都不可用时退化为在提交时同步编译。
+// 命中程序二进制缓存（见 program-cache.h）的程序在提交时即可使用。
+// 程序就绪之前 programBuilderGet 返回占位程序，占位程序与正式程序需要使用相同的顶点属性布局。
+
+//最多可以提交的程序数
+#define MAX_BUILD_PROGRAMS 64
+
+typedef int ProgramHandle;
+
+typedef enum {
+    PROGRAM_PENDING,
+    PROGRAM_READY,
+    PROGRAM_FAILED,
+} ProgramState;
+
+typedef enum {
+    PROGRAM_BUILD_SYNC,
+    PROGRAM_BUILD_PARALLEL_KHR,
+    PROGRAM_BUILD_WORKER,
+} ProgramBuildMode;
+
+//在 GL 线程调用，同步编译占位程序并选择构建方式；上下文重建后重新调用即可，之前的句柄全部失效
+bool programBuilderInit(const char *placeholderVtx, const char *placeholderFrag);
+//复制源码并排队构建，返回句柄，程序已满时返回 -1
+ProgramHandle programBuilderSubmit(const char *vtxSrc, const char *fragSrc);
+//检查已完成的构建，每帧调用一次，不会等待
+void programBuilderPoll();
+ProgramState programBuilderState(ProgramHandle handle);
+//已就绪时返回程序，否则返回占位程序
+GLuint programBuilderGet(ProgramHandle handle);
+int programBuilderPendingCount();
+ProgramBuildMode programBuilderMode();
+//停止工作线程并删除所有程序，需要在 GL 上下文仍然有效时调用
+void programBuilderRelease();
+
+#endif
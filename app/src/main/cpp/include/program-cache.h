@@ -0,0 +1,36 @@
+#ifndef GLES_PROGRAM_CACHE_H
+#define GLES_PROGRAM_CACHE_H
+
+#include <stdint.h>
+#include "es-util.h"
+
+// 着色器程序二进制的磁盘缓存：
+// 以顶点/片元着色器源码和 GL_VENDOR/GL_RENDERER/GL_VERSION 的哈希为键，保存 glGetProgramBinary 的结果，
+// 下次先用 glProgramBinary 加载，驱动不接受（升级等原因）时删除该项并重新编译。
+// 所有函数都要在持有 GL 上下文的线程调用。读写都通过 mmap 进行，缓存总大小超过上限时按最近使用时间（文件 mtime）淘汰。
+
+typedef struct {
+    int hits;
+    int misses;
+    int rejected;     // 缓存存在但驱动拒绝加载的次数
+    int evictions;
+    size_t bytes;     // 最近一次整理后缓存目录中的总字节数
+} ProgramCacheStats;
+
+//设置缓存目录和容量上限，目录不存在时会创建，返回 false 表示不使用缓存
+bool programCacheInit(const char *dir, size_t maxBytes);
+//与 createProgram 相同，但优先从缓存加载；缓存不可用时直接编译
+GLuint createProgramCached(const char *vtxSrc, const char *fragSrc);
+//只查缓存，未命中或缓存不可用时返回 0
+GLuint loadProgramCached(const char *vtxSrc, const char *fragSrc);
+//保存已链接的程序，链接前需要设置 GL_PROGRAM_BINARY_RETRIEVABLE_HINT（见 createProgram）
+void storeProgramCached(const char *vtxSrc, const char *fragSrc, GLuint program);
+bool isProgramCacheEnabled();
+//可以在任意线程调用
+void programCacheGetStats(ProgramCacheStats *stats);
+
+//64 位 FNV-1a 哈希，hash 为上一次的结果，首次传 FNV_OFFSET_BASIS
+#define FNV_OFFSET_BASIS 0xcbf29ce484222325ULL
+uint64_t fnv1a64(uint64_t hash, const void *data, size_t size);
+
+#endif
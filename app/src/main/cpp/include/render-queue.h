@@ -0,0 +1,68 @@
+#ifndef GLES_RENDER_QUEUE_H
+#define GLES_RENDER_QUEUE_H
+
+#include <stdint.h>
+#include "es-util.h"
+#include "gl-buffer.h"
+
+// 渲染队列：绘制请求先提交到队列，按 64 位排序键（program、纹理、VAO、深度）基数排序后统一回放，
+// 回放时记录当前绑定的 GL 状态，跳过重复的 glUseProgram/glBindVertexArray/glBindTexture。
+// 队列假设这些状态只由它自己修改，外部直接改动过状态后需调用 renderQueueResetState。
+
+typedef struct {
+    uint64_t sortKey;         // 由 renderQueueSubmit 计算
+    GLuint program;
+    GLuint vao;
+    GLuint texture;           // 绑定到 GL_TEXTURE0 的 GL_TEXTURE_2D，0 表示不需要纹理
+    float depth;              // 视空间距离，同状态下按从近到远绘制，减少 overdraw
+    GLenum mode;
+    GLsizei count;
+    GLenum indexType;         // 0 表示 glDrawArrays
+    GLsizei instanceCount;    // 大于 1 时用实例化绘制
+} DrawItem;
+
+typedef struct {
+    int draws;
+    int programBinds;
+    int programBindsSkipped;
+    int vaoBinds;
+    int vaoBindsSkipped;
+    int textureBinds;
+    int textureBindsSkipped;
+} RenderQueueStats;
+
+typedef struct {
+    uint64_t key;
+    uint32_t index;
+} SortEntry;
+
+typedef struct {
+    DrawItem *items;
+    SortEntry *entries;
+    SortEntry *scratch;
+    int count;
+    int capacity;
+    GLuint currentProgram;
+    GLuint currentVao;
+    GLuint currentTexture;
+    RenderQueueStats stats;   // 最近一次 renderQueueFlush 的统计
+} RenderQueue;
+
+//排序键：program 12 位 | 纹理 12 位 | VAO 12 位 | 深度 28 位
+uint64_t makeSortKey(GLuint program, GLuint texture, GLuint vao, float depth);
+
+bool renderQueueInit(RenderQueue *queue, int capacity);
+void renderQueueRelease(RenderQueue *queue);
+//提交一个绘制请求，队列已满时返回 false
+bool renderQueueSubmit(RenderQueue *queue, const DrawItem *item);
+//按 mesh 填写绘制请求
+void drawItemFromMesh(DrawItem *item, const MeshBuffer *mesh, GLuint program, GLuint texture,
+                      float depth);
+//按排序键对已提交的请求做基数排序（不回放）
+void renderQueueSort(RenderQueue *queue);
+//排序、回放并清空队列
+void renderQueueFlush(RenderQueue *queue);
+//使记录的 GL 状态失效，例如 GL 上下文重建之后
+void renderQueueResetState(RenderQueue *queue);
+
+#endif
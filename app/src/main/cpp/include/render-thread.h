@@ -0,0 +1,121 @@
+#ifndef GLES_RENDER_THREAD_H
+#define GLES_RENDER_THREAD_H
+
+#include <EGL/egl.h>
+#include <android/native_window.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "command-buffer.h"
+#include "render-queue.h"
+#include "resolution-controller.h"
+#include "scaled-framebuffer.h"
+
+// 渲染线程：独占 EGL 上下文，所有 GL 调用都在这个线程上执行。
+// 其他线程通过 channel() 取得自己的 CommandChannel，录制命令后 submit，立即返回；
+// 渲染线程依次执行各通道提交的缓冲区，遇到 CMD_PRESENT 时回放渲染队列并交换缓冲区，
+// 因此模拟/录制下一帧与 GL 执行上一帧可以在不同核心上同时进行。
+// 没有待执行的命令时渲染线程休眠，由 submit 唤醒。
+// 开启动态分辨率后，每帧画到按 ResolutionController 的 scale 缩小的离屏帧缓冲区，
+// CMD_PRESENT 时一次 blit 放大到窗口；CMD_VIEWPORT 仍使用窗口坐标，由渲染线程换算。
+
+//最多的生产者线程数
+#define MAX_COMMAND_CHANNELS 8
+//一帧中最多使用的实例流数
+#define MAX_FRAME_STREAMS 8
+
+class RenderThread {
+public:
+    RenderThread();
+
+    ~RenderThread();
+
+    RenderThread(const RenderThread &) = delete;
+
+    RenderThread &operator=(const RenderThread &) = delete;
+
+    //启动渲染线程并在其上为 window 创建 EGL 上下文，等待创建结果；
+    //成功后持有 window 的引用，stop 时释放
+    bool start(ANativeWindow *window);
+
+    //执行完已提交的命令后销毁 EGL 上下文并等待线程退出，Surface 销毁前必须调用；
+    //cleanup 不为 NULL 时在销毁上下文之前于渲染线程调用 cleanup(data)，
+    //不依赖命令缓冲区，缓冲区用尽时 GL 资源也能释放
+    void stop(void (*cleanup)(void *data) = NULL, void *data = NULL);
+
+    //开启动态分辨率，每帧耗时的预算为 budgetMs；必须在 start 之前调用
+    void enableAdaptiveResolution(float budgetMs);
+
+    //当前帧使用的分辨率缩放，未开启时为 1
+    float resolutionScale() const { return currentScale.load(std::memory_order_relaxed); }
+
+    //当前线程的命令通道，首次调用时注册，超过 MAX_COMMAND_CHANNELS 个线程时返回 NULL
+    CommandChannel *channel();
+
+    //提交录制好的缓冲区并唤醒渲染线程，不等待执行
+    bool submit(CommandChannel *channel, CommandBuffer *buffer);
+
+    //已交换的帧数
+    long framesPresented() const { return presentedFrames.load(std::memory_order_relaxed); }
+
+private:
+    void run();
+
+    bool createContext(ANativeWindow *window);
+
+    void destroyContext();
+
+    //执行所有通道中已提交的缓冲区，返回执行的缓冲区数
+    int drainChannels();
+
+    void execute(const CommandBuffer *buffer);
+
+    void submitDraw(const DrawItem *item);
+
+    //一帧开始时按当前 scale 调整离屏帧缓冲区并绑定
+    void beginScaledFrame();
+
+    void applyViewport();
+
+    std::thread thread;
+    EGLDisplay display = EGL_NO_DISPLAY;
+    EGLSurface surface = EGL_NO_SURFACE;
+    EGLContext context = EGL_NO_CONTEXT;
+    ANativeWindow *window = NULL;
+
+    //以下只在渲染线程访问
+    RenderQueue renderQueue;
+    bool inFrame = false;
+    //本帧使用过的实例流及段号，交换缓冲区前插入 fence
+    InstanceStream *frameStreams[MAX_FRAME_STREAMS];
+    int frameSegments[MAX_FRAME_STREAMS];
+    int frameStreamCount = 0;
+
+    //动态分辨率，adaptiveResolution 在 start 之前设置
+    bool adaptiveResolution = false;
+    bool scaledFrame = false;
+    ResolutionController resolution;
+    ScaledFramebuffer scaledTarget;
+    //CMD_VIEWPORT 设置的窗口坐标视口，宽度为 0 时使用整个窗口
+    GLint viewport[4] = {0, 0, 0, 0};
+    std::atomic<float> currentScale{1.0f};
+
+    std::atomic<CommandChannel *> channels[MAX_COMMAND_CHANNELS];
+    std::mutex registerMutex;
+
+    //休眠/唤醒：submit 只在渲染线程已休眠时才加锁通知
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    std::atomic<unsigned> submittedBuffers{0};
+    std::atomic<bool> sleeping{false};
+    std::atomic<bool> stopping{false};
+    //stop 在置位 stopping 之前写入，渲染线程看到 stopping 后读取
+    void (*stopCleanup)(void *data) = NULL;
+    void *stopCleanupData = NULL;
+    unsigned executedBuffers = 0;
+
+    std::atomic<long> presentedFrames{0};
+};
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef GLES_RESOLUTION_CONTROLLER_H
+#define GLES_RESOLUTION_CONTROLLER_H
+
+// 动态分辨率控制：根据最近若干帧的耗时调整渲染分辨率的缩放（宽高同时乘以 scale），
+// 设备降频、负载变高时降低分辨率，负载恢复后逐渐提高。
+// 纯计算，不调用 GL，也不读取时钟，输入模拟的帧时间序列即可复现控制过程。
+// 1. 分辨率只影响 GPU 的耗时，有 GPU 计时时用 GPU 耗时控制，否则用渲染线程的 CPU 耗时；
+//    GPU 计时晚几帧才有结果，得到第一个 GPU 耗时之前用 CPU 耗时，之后只用 GPU 耗时，
+//    没有新 GPU 耗时的帧不参与控制（GPU 计时中断时保持当前的 scale）；
+// 2. 窗口收集满后每帧取滚动窗口内的平均值，与预算的相对误差经 PID 得到像素数（与 scale 的平方成正比）的调整比例；
+// 3. 滞回：平均值在 [budget * lowWater, budget] 内时保持不变，提高分辨率前按像素数估计新的耗时，超过预算则不提高；
+//    平均值连续 sustainFrames 次超过预算才降低分辨率，短暂的尖峰（加载、GC 等）不改变 scale；
+// 4. scale 按 scaleStep 取整，改变后清空窗口并丢弃 settleFrames 个样本，
+//    等计时（GPU 计时通常晚一到两帧）反映新的分辨率后再继续调整，避免反复分配帧缓冲区。
+
+//滚动窗口的最大帧数
+#define RESOLUTION_WINDOW 32
+
+typedef struct {
+    float budgetMs;         // 每帧的耗时预算，例如 60Hz 时留出余量取 14ms
+    float minScale;
+    float maxScale;
+    float scaleStep;
+    float lowWater;         // 低于 budget * lowWater 时才提高分辨率
+    float kp;
+    float ki;
+    float kd;
+    int window;             // 参与平均的帧数，不超过 RESOLUTION_WINDOW
+    int settleFrames;
+    int sustainFrames;      // 平均值连续超过预算的评估次数达到这个值才降低分辨率
+} ResolutionConfig;
+
+typedef struct {
+    long frames;
+    long overBudget;        // CPU 或 GPU 耗时超过预算的帧数
+    int increases;
+    int decreases;
+    float averageMs;        // 最近一次评估时窗口的平均耗时
+} ResolutionStats;
+
+typedef struct {
+    ResolutionConfig config;
+    float samples[RESOLUTION_WINDOW];
+    int sampleCount;
+    int sampleNext;
+    float scale;
+    float integral;
+    float lastError;
+    int settle;
+    int overCount;          // 平均值连续超过预算的评估次数
+    bool gpuTimed;          // 已经得到过 GPU 耗时
+    ResolutionStats stats;
+} ResolutionController;
+
+//budgetMs 预算下的默认参数：scale 在 [0.5, 1] 之间，步长 0.05，窗口 8 帧，连续 24 次超过预算才降低
+void resolutionConfigDefault(ResolutionConfig *config, float budgetMs);
+//从 maxScale 开始
+void resolutionControllerInit(ResolutionController *controller, const ResolutionConfig *config);
+//输入一帧的耗时（毫秒），gpuMs < 0 表示这一帧没有新的 GPU 耗时（见 profilerLastFrameTimes），
+//返回之后各帧使用的 scale
+float resolutionControllerUpdate(ResolutionController *controller, float cpuMs, float gpuMs);
+
+#endif
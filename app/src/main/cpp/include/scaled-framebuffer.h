@@ -0,0 +1,37 @@
+#ifndef GLES_SCALED_FRAMEBUFFER_H
+#define GLES_SCALED_FRAMEBUFFER_H
+
+#include "es-util.h"
+
+// 降低分辨率渲染：场景画到 (surface 宽高 * scale) 的离屏帧缓冲区，
+// 结束时用一次 glBlitFramebuffer（线性过滤）放大到窗口的默认帧缓冲区，
+// 之后丢弃离屏缓冲区的内容（glInvalidateFramebuffer），分块渲染的 GPU 不必写回内存。
+// scale 通常来自 ResolutionController（见 resolution-controller.h）。所有函数都在 GL 线程调用。
+
+typedef struct {
+    GLuint fbo;
+    GLuint color;           // 渲染缓冲区，RGBA8
+    GLuint depth;           // 渲染缓冲区，DEPTH_COMPONENT16，没有深度时为 0
+    bool hasDepth;
+    GLsizei surfaceWidth;
+    GLsizei surfaceHeight;
+    GLsizei width;          // 离屏缓冲区的大小
+    GLsizei height;
+    float scale;
+} ScaledFramebuffer;
+
+//只记录参数，第一次 scaledFramebufferResize 时创建 GL 对象
+void scaledFramebufferInit(ScaledFramebuffer *target, bool depth);
+//窗口大小或 scale 变化时重新分配渲染缓冲区，返回 false 表示帧缓冲区不完整
+bool scaledFramebufferResize(ScaledFramebuffer *target, GLsizei surfaceWidth, GLsizei surfaceHeight,
+                             float scale);
+//绑定离屏缓冲区
+void scaledFramebufferBind(const ScaledFramebuffer *target);
+//把窗口坐标的视口换算到离屏缓冲区并设置
+void scaledFramebufferViewport(const ScaledFramebuffer *target, GLint x, GLint y, GLsizei width,
+                               GLsizei height);
+//放大到默认帧缓冲区并丢弃离屏内容，之后默认帧缓冲区保持绑定
+void scaledFramebufferBlit(const ScaledFramebuffer *target);
+void scaledFramebufferRelease(ScaledFramebuffer *target);
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef GLES_SCENE_GRAPH_H
+#define GLES_SCENE_GRAPH_H
+
+#include <stdint.h>
+#include "es-util.h"
+#include "thread-pool.h"
+
+// 变换层次：每个节点一个局部矩阵，世界矩阵 = 局部矩阵 * 父节点的世界矩阵（行向量约定，同 matrixMultiply）。
+// 节点的属性按 SoA 分别存放在数组中，数组按广度优先的顺序排列：父节点总在子节点之前，
+// 同一深度的节点连续，同一节点的子节点也连续；数组下标称为槽，节点句柄不变，结构变化后重新排序时槽可能改变。
+// 修改局部矩阵只把节点加入待更新列表，sceneGraphUpdate 从这些节点开始逐层向下，
+// 只重新计算修改过的节点及其子树，不遍历其他节点；没有修改时直接返回，静态场景每帧几乎没有开销。
+// 同一深度的节点互不依赖，需要计算的节点较多的层可以用 ThreadPool 并行。
+// 不调用 GL，可以在任意线程使用（同一个 SceneGraph 不能同时在多个线程中修改）。
+
+//同一层中至少有两倍这么多需要处理的节点时才并行，也是每块的节点数
+#define SCENE_PARALLEL_GRAIN 256
+
+typedef int SceneNode;
+
+typedef struct {
+    long updates;           // 有节点需要重新计算的 sceneGraphUpdate 次数
+    long skipped;           // 没有修改、直接返回的次数
+    long nodesUpdated;      // 累计重新计算的世界矩阵个数
+    int lastUpdated;        // 上一次更新重新计算的个数
+    int reorders;           // 因结构变化重新排序的次数
+} SceneGraphStats;
+
+typedef struct {
+    int count;
+    int capacity;
+    // 以下数组按槽存放
+    Matrix *local;
+    Matrix *world;
+    int *parent;            // 父节点的槽，根节点为 -1
+    int *depth;
+    int *firstChild;        // 子节点位于 [firstChild, firstChild + childCount)
+    int *childCount;
+    uint8_t *flags;         // 局部矩阵已修改；更新过程中还标记已重新计算的节点
+    SceneNode *slotNode;    // 槽中的节点
+    int *nodeSlot;          // 节点所在的槽
+    SceneNode *dirtyNodes;  // 局部矩阵修改过的节点
+    int dirtyCount;
+    int *queue;             // 更新时逐层需要计算的槽
+    bool orderDirty;        // 创建过节点，需要重新排序
+    SceneGraphStats stats;
+} SceneGraph;
+
+//最多容纳 capacity 个节点
+bool sceneGraphInit(SceneGraph *graph, int capacity);
+void sceneGraphRelease(SceneGraph *graph);
+//创建局部矩阵为单位矩阵的节点，parent 为 -1 时为根节点，返回句柄，已满时返回 -1；
+//父节点在创建时确定，创建后的第一次 sceneGraphUpdate 重新排序所有节点
+SceneNode sceneNodeCreate(SceneGraph *graph, SceneNode parent);
+void sceneNodeSetLocal(SceneGraph *graph, SceneNode node, const Matrix *local);
+//局部矩阵设为 translate(position) → rotate(angle, axis) → scale(scale)，与 recordInstances 相同
+void sceneNodeSetTransform(SceneGraph *graph, SceneNode node, const float position[3],
+                           const float axis[3], float angle, float scale);
+const Matrix *sceneNodeLocal(const SceneGraph *graph, SceneNode node);
+//上一次 sceneGraphUpdate 之后的世界矩阵
+const Matrix *sceneNodeWorld(const SceneGraph *graph, SceneNode node);
+//重新计算修改过的节点及其子树的世界矩阵，返回计算的个数；pool 为 NULL 时在当前线程执行
+int sceneGraphUpdate(SceneGraph *graph, ThreadPool *pool);
+
+#endif
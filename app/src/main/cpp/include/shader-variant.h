@@ -0,0 +1,57 @@
+#ifndef GLES_SHADER_VARIANT_H
+#define GLES_SHADER_VARIANT_H
+
+#include <stdint.h>
+#include "es-util.h"
+#include "program-builder.h"
+
+// 着色器变体：一个模板（uber shader）加一组特性，每个特性对应一个 #define，
+// 按特性组合生成源码后交给 programBuilderSubmit，分支在编译时由预处理器消除，片元着色器中不需要按 uniform 分支。
+// 1. 创建模板时检查每个特性在两个阶段中是否出现，只向用到它的阶段注入 #define，
+//    两个阶段都没有用到的特性在生成键时被忽略；
+// 2. shaderVariantPrecompile 批量生成场景需要的组合，按源码的 64 位哈希去重，相同源码只提交一次；
+// 3. shaderVariantFind 用开放寻址的哈希表按（模板，特性）查找，常数时间，绘制时不编译也不拼接字符串。
+// 带值的特性用于把常量（例如颜色）编进着色器，值不同的组合需要定义成不同的特性。
+// 模板和预编译在 GL 线程调用；查找只读表，可以在录制线程调用，但不能与 shaderVariantPrecompile 同时进行。
+
+//最多可以创建的模板数
+#define MAX_SHADER_TEMPLATES 16
+//每个模板最多的特性数，特性组合用一个 32 位掩码表示
+#define MAX_SHADER_FEATURES 32
+//查找表的大小（2 的幂），保持负载不超过一半
+#define SHADER_VARIANT_TABLE_SIZE 256
+
+typedef int ShaderTemplate;
+typedef uint32_t ShaderFeatures;
+
+typedef struct {
+    const char *name;      // 宏名，同时用来检查模板是否用到该特性
+    const char *value;     // 宏的值，NULL 表示只定义宏
+} ShaderFeature;
+
+typedef struct {
+    ShaderTemplate shaderTemplate;
+    ShaderFeatures features;
+} ShaderVariantKey;
+
+typedef struct {
+    int requested;         // shaderVariantPrecompile 收到的组合数
+    int compiled;          // 实际提交构建的程序数
+    int deduplicated;      // 与已有组合或已有源码相同、没有再次提交的组合数
+} ShaderVariantStats;
+
+//复制源码和特性，返回模板句柄，失败时返回 -1；源码以 #version 开头时 #define 插入在它之后
+ShaderTemplate shaderTemplateCreate(const char *vtxSrc, const char *fragSrc,
+                                    const ShaderFeature *features, int featureCount);
+//生成一个组合的源码，*vtxSrc 和 *fragSrc 由调用方 free；用于生成占位程序等不经过 programBuilderSubmit 的程序
+bool shaderVariantAssemble(ShaderTemplate shaderTemplate, ShaderFeatures features, char **vtxSrc,
+                           char **fragSrc);
+//生成并提交 keys 中还没有的组合，返回新提交的程序数，失败时返回 -1；需在 programBuilderInit 之后调用
+int shaderVariantPrecompile(const ShaderVariantKey *keys, int count);
+//预编译过的组合返回程序句柄（可能还没就绪，见 programBuilderGet），否则返回 -1
+ProgramHandle shaderVariantFind(ShaderTemplate shaderTemplate, ShaderFeatures features);
+void shaderVariantGetStats(ShaderVariantStats *stats);
+//删除所有模板和变体，程序本身由 programBuilderRelease 删除；programBuilderInit 重新调用后需要先调用本函数
+void shaderVariantRelease();
+
+#endif
@@ -0,0 +1,96 @@
+#ifndef GLES_SOFT_RASTERIZER_H
+#define GLES_SOFT_RASTERIZER_H
+
+#include <stdint.h>
+#include "es-util.h"
+#include "mesh-allocator.h"
+#include "thread-pool.h"
+
+// 软件光栅化：没有 GLES3 设备时（主机、CI）渲染同样的网格（createCube/createSphere 的输出）和 Matrix 变换，
+// 结果写入内存中的帧缓冲区，可以保存为 PPM/PNG 作为基准图像，之后逐像素比较。
+// 约定与 GL 相同：行向量 clip = v * model * viewProj，逆时针为正面，深度 [0, 1]、小于缓冲区中的值时通过，
+// 像素中心在 (x + 0.5, y + 0.5)，共享边按左上规则只属于一个三角形；
+// 帧缓冲区第 0 行在最上面（与 glReadPixels 的结果上下相反），与图像文件的行顺序一致。
+//
+// 流程分两步：softRasterizerDraw 并行变换顶点、裁剪近平面、设置三角形并记录，
+// softRasterizerFlush 按 SOFT_TILE_SIZE 把屏幕分块，每块只由一个线程按提交顺序光栅化，
+// 块之间互不写同一像素，结果与线程数无关；块内用 SIMD 一次计算 ES_SIMD_WIDTH 个像素的边函数。
+// 不调用 GL，可以在任意线程使用，同一个 SoftRasterizer 不能同时在多个线程调用。
+
+#define SOFT_TILE_SIZE 64
+
+typedef struct {
+    int width;
+    int height;
+    int stride;            // 每行的像素数，按 8 个像素对齐
+    uint32_t *color;       // RGBA8，内存中依次为 R、G、B、A
+    float *depth;
+} SoftFramebuffer;
+
+bool softFramebufferInit(SoftFramebuffer *framebuffer, int width, int height);
+void softFramebufferRelease(SoftFramebuffer *framebuffer);
+void softFramebufferClear(SoftFramebuffer *framebuffer, const GLfloat color[4], float depth);
+//保存为 P6 格式的 PPM（只有 RGB）
+bool softFramebufferWritePpm(const SoftFramebuffer *framebuffer, const char *path);
+//保存为 RGBA 的 PNG，数据不压缩（deflate 存储块），不依赖 zlib
+bool softFramebufferWritePng(const SoftFramebuffer *framebuffer, const char *path);
+//读入 softFramebufferWritePpm 保存的图像，framebuffer 需已初始化或清零，按图像大小重新初始化，深度清为 1
+bool softFramebufferReadPpm(SoftFramebuffer *framebuffer, const char *path);
+//比较 RGB，返回任一通道相差超过 tolerance 的像素数，尺寸不同时返回 -1
+int softFramebufferCompare(const SoftFramebuffer *a, const SoftFramebuffer *b, int tolerance);
+
+typedef enum {
+    SOFT_SHADE_FLAT,       // 每个三角形用面法线计算一次光照
+    SOFT_SHADE_GOURAUD,    // 顶点法线计算光照，颜色按透视校正插值；网格没有法线时按 FLAT 处理
+} SoftShading;
+
+//单个方向光的漫反射 + 环境光：color * (ambient + (1 - ambient) * max(dot(n, lightDir), 0))
+typedef struct {
+    Matrix model;          // 法线也用它变换，只支持等比缩放
+    Matrix viewProj;
+    GLfloat color[4];
+    GLfloat lightDir[3];   // 世界空间中指向光源的方向，不需要归一化
+    float ambient;
+    SoftShading shading;
+    bool cullBackFaces;
+} SoftDrawState;
+
+//单位矩阵、白色、斜上方的光源、Gouraud、剔除背面
+void softDrawStateDefault(SoftDrawState *state);
+
+typedef struct {
+    long triangles;        // 提交的三角形数
+    long rasterized;       // 裁剪、背面剔除后进入光栅化的三角形数（近平面裁剪可能一分为二）
+    long fragments;        // 通过深度测试写入的像素数
+} SoftRasterStats;
+
+struct SoftVertex;
+struct SoftTriangle;
+
+typedef struct {
+    SoftFramebuffer *target;
+    ThreadPool *pool;      // 为 NULL 时在当前线程执行
+    int tilesX;
+    int tilesY;
+    SoftVertex *vertices;  // 当前 draw 变换后的顶点
+    int vertexCapacity;
+    SoftTriangle *triangles;   // 上次 flush 之后设置好的三角形，每个输入三角形占两个位置
+    int triangleCount;
+    int triangleCapacity;
+    int *binOffsets;       // 每块在 binTriangles 中的起始位置（tilesX * tilesY + 1 项）
+    int *binTriangles;
+    int binCapacity;
+    SoftRasterStats stats;
+} SoftRasterizer;
+
+bool softRasterizerInit(SoftRasterizer *rasterizer, SoftFramebuffer *target, ThreadPool *pool);
+void softRasterizerRelease(SoftRasterizer *rasterizer);
+//vertices 每个顶点 3 个分量，normals 可为 NULL，indices 每 3 个一个三角形；内存不足时返回 false
+bool softRasterizerDraw(SoftRasterizer *rasterizer, const SoftDrawState *state,
+                        const GLfloat *vertices, const GLfloat *normals, int vertexCount,
+                        const GLuint *indices, int indexCount);
+bool softRasterizerDrawMesh(SoftRasterizer *rasterizer, const SoftDrawState *state, const Mesh *mesh);
+//光栅化之前提交的全部三角形并写入 target
+void softRasterizerFlush(SoftRasterizer *rasterizer);
+
+#endif
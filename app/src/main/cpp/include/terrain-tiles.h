@@ -0,0 +1,100 @@
+#ifndef GLES_TERRAIN_TILES_H
+#define GLES_TERRAIN_TILES_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "es-util.h"
+
+// 地形分块的 CPU 部分，不调用 GL，可以在任意线程使用。
+// 地形文件：整个文件用 mmap 映射，文件头之后是每块的高度范围表，再之后按行存放每块的高度（uint16），
+// 每块 tileSize * tileSize 个采样，按行主序（y 为行）；相邻的块共享边上的一行/一列采样，拼接处没有裂缝。
+// 读取某块时才由内核按页从文件载入，地图可以远大于内存。
+// 地形缓存：固定数目的槽，视野按块的矩形给出，视野移动时只处理进入和离开矩形的块；
+// 离开视野的块留在槽中，按最近使用的顺序排队，需要空槽时淘汰最久未使用的块。
+
+#define TERRAIN_MAGIC 0x314e5254u   // "TRN1"
+#define TERRAIN_VERSION 1u
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t tileSize;      // 每块每边的采样数，通常为 2^n + 1
+    uint32_t tilesX;
+    uint32_t tilesY;
+    float spacing;          // 相邻采样的水平距离
+    float heightScale;      // 高度 = 采样 * heightScale + heightOffset
+    float heightOffset;
+} TerrainHeader;
+
+typedef struct {
+    void *mapping;
+    size_t mappingSize;
+    TerrainHeader header;
+    const uint16_t *ranges;  // 每块两个采样：最小值、最大值
+    const unsigned char *tiles;
+    size_t tileBytes;        // 每块数据的字节数（按 4 字节对齐）
+} TerrainFile;
+
+//映射并检查文件，失败时返回 false 并输出原因
+bool terrainFileOpen(TerrainFile *file, const char *path);
+void terrainFileClose(TerrainFile *file);
+//第 tile 块（tile = y * tilesX + x）的采样，直接指向映射内存
+const uint16_t *terrainFileTile(const TerrainFile *file, int tile);
+//提示内核预读第 tile 块，不等待
+void terrainFilePrefetch(const TerrainFile *file, int tile);
+//第 tile 块的世界空间包围盒（x、y 为水平方向，z 为高度），只读取高度范围表
+void terrainFileTileBounds(const TerrainFile *file, int tile, float min[3], float max[3]);
+//按 sample(x, y) 逐块写入地形文件，x、y 为整张地图的采样坐标，
+//地图共 tilesX * (tileSize - 1) + 1 列；供工具和基准测试生成数据，不需要整张地图在内存中
+bool terrainFileWrite(const char *path, int tileSize, int tilesX, int tilesY, float spacing,
+                      float heightScale, float heightOffset,
+                      uint16_t (*sample)(int x, int y, void *user), void *user);
+
+typedef struct {
+    int tile;
+    int slot;
+} TerrainLoad;
+
+typedef struct {
+    int resident;           // 已加载的块数（包括不在视野中的）
+    int loading;
+    int visible;            // 视野矩形中的块数
+    long hits;              // 进入视野时已在缓存中的块
+    long misses;            // 进入视野时需要加载的块
+    long evictions;
+    long entered;           // 所有更新中进入视野的块数，只有这些块被处理
+    long left;
+} TerrainCacheStats;
+
+typedef struct {
+    int tilesX;
+    int tilesY;
+    int slotCount;
+    int *tileSlot;          // 每块所在的槽，-1 表示不在缓存中
+    uint8_t *tileLoading;
+    int *slotTile;          // 每个槽中的块，-1 表示空槽
+    // 不在视野中的已加载块组成的双向链表，头部为最近离开视野的，从尾部淘汰
+    int *lruPrev;
+    int *lruNext;
+    int lruHead;
+    int lruTail;
+    int lruCount;
+    int *freeSlots;
+    int freeCount;
+    int view[4];            // 当前视野矩形 [x0, x1) x [y0, y1)
+    TerrainCacheStats stats;
+} TerrainCache;
+
+//slotCount 需要不小于视野矩形的最大面积，多出的槽用来缓存离开视野的块
+bool terrainCacheInit(TerrainCache *cache, int tilesX, int tilesY, int slotCount);
+void terrainCacheRelease(TerrainCache *cache);
+//把视野设为块矩形 [x0, x1) x [y0, y1)（裁剪到地图范围内），只处理进入和离开的块；
+//需要加载的块及分配给它的槽写入 loads（容量至少为新矩形的面积），返回个数；槽不够时返回 -1，视野不变
+int terrainCacheSetView(TerrainCache *cache, int x0, int y0, int x1, int y1, TerrainLoad *loads);
+//terrainCacheSetView 返回的块加载完成
+void terrainCacheLoaded(TerrainCache *cache, int tile);
+//已加载时返回块所在的槽，否则返回 -1
+int terrainCacheSlot(const TerrainCache *cache, int tile);
+bool terrainCacheInView(const TerrainCache *cache, int tile);
+
+#endif
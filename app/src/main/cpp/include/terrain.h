@@ -0,0 +1,48 @@
+#ifndef GLES_TERRAIN_H
+#define GLES_TERRAIN_H
+
+#include "es-util.h"
+#include "culling.h"
+#include "terrain-tiles.h"
+
+// 分块地形：地形文件（见 terrain-tiles.h）按视野流式加载，内存占用由缓存的槽数决定，与地图大小无关。
+// 所有块的拓扑相同，只共用一个 tileSize * tileSize 的网格顶点缓冲区（gridGeneratorVertices）和一个索引缓冲区，
+// 每块只有高度不同：高度缓冲区按槽切分，每个槽一个 VAO，顶点着色器用块的原点和大小算出世界坐标。
+// 1. terrainSetView 只处理进入和离开视野的块，需要加载的块交给 I/O 线程；
+// 2. I/O 线程从映射的文件拷贝到该槽的暂存区（缺页读取发生在这里），并预读下一个块；
+// 3. terrainUpdate 在 GL 线程把拷贝完成的块上传到它的槽，之后才会绘制。
+// 所有函数都在 GL 线程调用。
+
+#define TERRAIN_ATTRIB_GRID 0
+#define TERRAIN_ATTRIB_HEIGHT 3
+
+//顶点着色器中声明地形属性和 uniform 的 GLSL 片段，terrainPosition() 返回世界坐标（z 为高度）
+extern const char TERRAIN_VERTEX_GLSL[];
+
+typedef struct {
+    TerrainCacheStats cache;
+    int pendingLoads;       // 已交给 I/O 线程、还没有上传的块
+    int tilesDrawn;         // 上一次 terrainDraw 绘制的块数
+    int tilesCulled;        // 上一次 terrainDraw 中在视野矩形内但被视锥剔除的块数
+    long tilesUploaded;
+    long bytesUploaded;
+} TerrainStats;
+
+//映射地形文件，创建共用的网格和索引缓冲区、高度缓冲区和 I/O 线程；
+//视野为相机所在块周围 viewRadius 块的正方形，另外缓存 cacheTiles 个离开视野的块；
+//上下文重建后重新调用，在同一个上下文中重新调用时先删除之前的 GL 对象
+bool terrainInit(const char *path, int viewRadius, int cacheTiles);
+//相机移动到世界坐标 (x, y)，所在块变化时更新视野；槽不够（仍有离开视野的块在加载）时返回 false，下一帧重试
+bool terrainSetView(float x, float y);
+//上传最多 maxUploads 个已拷贝完成的块，不等待 I/O 线程；会改变 GL_ARRAY_BUFFER 的绑定
+void terrainUpdate(int maxUploads);
+//用 program（顶点着色器包含 TERRAIN_VERTEX_GLSL，调用前需已 glUseProgram）绘制视野中已加载的块，
+//frustum 为世界空间的视锥，可为 NULL；返回绘制的块数
+int terrainDraw(GLuint program, const Frustum *frustum);
+//整张地图的世界空间大小
+void terrainExtent(float *width, float *height);
+const TerrainStats *terrainStats();
+//停止 I/O 线程，删除所有缓冲区并解除映射，需要在 GL 上下文仍然有效时调用
+void terrainRelease();
+
+#endif
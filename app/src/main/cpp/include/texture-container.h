@@ -0,0 +1,62 @@
+#ifndef GLES_TEXTURE_CONTAINER_H
+#define GLES_TEXTURE_CONTAINER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "es-util.h"
+
+// KTX2 纹理容器：整个文件用 mmap 映射，只解析文件头和 mip 级别索引，
+// 各级别的数据直接指向映射内存，ETC2/ASTC 等压缩格式原样交给 glCompressedTexSubImage2D，CPU 不解码；
+// 读取数据时才由内核按页从文件载入，可以先用 textureContainerPrefetch 提示预读。
+// 只支持单层、单面的 2D 纹理，不支持超压缩（supercompressionScheme 必须为 0）。
+// 不调用 GL，可以在任意线程使用。
+
+#define TEXTURE_MAX_LEVELS 16
+
+typedef struct {
+    uint32_t vkFormat;     // KTX2 中的 VkFormat 编号
+    GLenum internalFormat;
+    GLenum format;         // 非压缩格式 glTexSubImage2D 的 format/type，压缩格式为 0
+    GLenum type;
+    int blockWidth;        // 压缩块的像素大小，非压缩格式为 1
+    int blockHeight;
+    int blockBytes;        // 每块（非压缩格式为每像素）的字节数
+    bool compressed;
+    bool astc;             // 需要 GL_KHR_texture_compression_astc_ldr
+} TextureFormat;
+
+typedef struct {
+    const unsigned char *data;
+    size_t size;
+    int width;
+    int height;
+    size_t rowBytes;       // 一行压缩块（非压缩格式为一行像素）的字节数
+    int blockRows;
+} TextureLevel;
+
+typedef struct {
+    void *mapping;
+    size_t mappingSize;
+    int width;
+    int height;
+    int levelCount;        // levels[0] 最大，levels[levelCount - 1] 最小
+    TextureFormat format;
+    TextureLevel levels[TEXTURE_MAX_LEVELS];
+} TextureContainer;
+
+//按 VkFormat 查找对应的 GL 格式，不支持时返回 false
+bool textureFormatFromVk(uint32_t vkFormat, TextureFormat *format);
+//映射并解析文件，失败时返回 false 并输出原因
+bool textureContainerOpen(TextureContainer *container, const char *path);
+void textureContainerClose(TextureContainer *container);
+//提示内核预读 level 中 [offset, offset + size) 的数据，不等待
+void textureContainerPrefetch(const TextureContainer *container, int level, size_t offset,
+                              size_t size);
+//写入只包含文件头、级别索引和数据的 KTX2 文件（没有数据格式描述和键值对），
+//levelData[i] 为第 i 级的数据，供工具和基准测试生成测试内容
+bool textureContainerWrite(const char *path, uint32_t vkFormat, int width, int height,
+                           int levelCount, const void *const *levelData);
+//第 level 级的数据大小
+size_t textureLevelSize(const TextureFormat *format, int width, int height, int level);
+
+#endif
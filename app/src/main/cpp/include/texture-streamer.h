@@ -0,0 +1,57 @@
+#ifndef GLES_TEXTURE_STREAMER_H
+#define GLES_TEXTURE_STREAMER_H
+
+#include "es-util.h"
+#include "texture-container.h"
+
+// 纹理流式加载：textureStreamerLoad 立即返回句柄，GL 线程不等待文件读取，也不做同步的数据拷贝。
+// 1. I/O 线程映射并解析 KTX2 文件（见 texture-container.h），GL 线程随后用 glTexStorage2D 分配全部级别；
+// 2. 每个级别按压缩块的行切分为不超过一个 PBO 大小的片段，从最小的级别开始，所有纹理中最粗的级别优先；
+// 3. GL 线程把环中空闲的 PBO 映射后交给 I/O 线程，I/O 线程从映射的文件中拷贝数据（缺页读取发生在这里），
+//    GL 线程之后的 textureStreamerPoll 中解除映射，glCompressedTexSubImage2D/glTexSubImage2D 从 PBO 上传，
+//    并插入 fence，fence 触发后该 PBO 才会再次使用；
+// 4. 每完成一级就把 GL_TEXTURE_BASE_LEVEL 降到该级，绘制立即使用已上传的最精细的级别。
+// 第一个级别上传之前 textureStreamerGet 返回 1x1 白色占位纹理。
+// 所有函数都在 GL 线程调用。
+
+//最多可以加载的纹理数
+#define MAX_STREAM_TEXTURES 64
+//环中 PBO 的个数
+#define TEXTURE_PBO_COUNT 4
+
+typedef int TextureHandle;
+
+typedef enum {
+    TEXTURE_PENDING,       // 还没有可用的级别
+    TEXTURE_PARTIAL,       // 已上传较粗的级别，较精细的级别仍在加载
+    TEXTURE_COMPLETE,
+    TEXTURE_FAILED,
+} TextureState;
+
+typedef struct {
+    long bytesUploaded;
+    int chunksUploaded;
+    int levelsCompleted;
+    int ioWaits;           // 最早的片段还在等待 I/O 线程拷贝的轮询次数（GL 线程不等待，留到下一帧）
+    int fenceWaits;        // PBO 的 fence 尚未触发、没有空闲 PBO 的轮询次数
+} TextureStreamStats;
+
+//创建 PBO 环、占位纹理和 I/O 线程，pboSize 为每个 PBO 的字节数，需大于最大级别中一行压缩块的大小；
+//上下文重建后重新调用即可，之前的句柄全部失效；在同一个上下文中重新调用时先删除之前的 GL 对象
+bool textureStreamerInit(GLsizeiptr pboSize);
+//复制路径并排队加载，返回句柄，纹理已满或未初始化时返回 -1
+TextureHandle textureStreamerLoad(const char *path);
+//处理已完成的拷贝和 fence，分配新的片段，每帧调用一次，不会等待；会改变纹理和 PBO 的绑定
+void textureStreamerPoll();
+TextureState textureStreamerState(TextureHandle handle);
+//至少有一个级别可用时返回纹理，否则返回占位纹理
+GLuint textureStreamerGet(TextureHandle handle);
+//已上传的最精细的级别，还没有可用的级别时返回 -1
+int textureStreamerResidentLevel(TextureHandle handle);
+//还没有上传完的纹理数
+int textureStreamerPendingCount();
+const TextureStreamStats *textureStreamerStats();
+//停止 I/O 线程，删除所有纹理和 PBO，需要在 GL 上下文仍然有效时调用
+void textureStreamerRelease();
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef GLES_THREAD_POOL_H
+#define GLES_THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//工作窃取线程池：每个线程一个任务队列，parallelFor 把区间按 grain 切块，
+//连续的块平均分到各线程的队列；线程先按顺序处理自己队列中的块，做完后从其他队列的尾部窃取，
+//负载不均（例如部分物体被剔除）时空闲线程自动分担。
+//parallelFor 可以在多个线程中同时调用，也可以在任务中嵌套调用，等待期间调用线程也执行任务。
+class ThreadPool {
+public:
+    //numThreads 为 0 时使用 CPU 核数，调用 parallelFor 的线程也参与计算
+    explicit ThreadPool(int numThreads = 0);
+
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    //参与计算的线程数（含调用线程）
+    int size() const { return (int) workers.size() + 1; }
+
+    //把 [begin, end) 按 grain 切块并行执行 fn(chunkBegin, chunkEnd)，全部完成后返回；
+    //块的边界总是 begin + k * grain
+    void parallelFor(int begin, int end, int grain, const std::function<void(int, int)> &fn);
+
+    //从其他线程队列窃取的块数（累计）
+    long steals() const { return stealCount.load(std::memory_order_relaxed); }
+
+private:
+    struct Job {
+        const std::function<void(int, int)> *fn;
+        std::atomic<int> remaining;
+    };
+
+    struct Chunk {
+        Job *job;
+        int begin;
+        int end;
+    };
+
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<Chunk> chunks;
+    };
+
+    void workerLoop(int index);
+
+    //执行一个块（优先取自己的队列），没有可执行的块时返回 false
+    bool runOne(int index);
+
+    //当前线程对应的队列编号，不属于本线程池的线程都使用 0 号队列
+    int queueIndex() const;
+
+    std::vector<std::thread> workers;
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    std::atomic<int> queuedChunks{0};
+    std::atomic<long> stealCount{0};
+
+    //空闲的工作线程在 wake 上等待
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+};
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef GLES_VERTEX_FORMAT_H
+#define GLES_VERTEX_FORMAT_H
+
+#include "es-util.h"
+
+// 交错、量化的顶点格式：位置/法线/纹理坐标打包进同一个顶点缓冲区，
+// 顶点数不超过 65536 时自动使用 16 位索引。返回的 VertexLayout 直接用于设置 glVertexAttribPointer。
+
+#define VERTEX_ATTRIB_POSITION 0
+#define VERTEX_ATTRIB_NORMAL 1
+#define VERTEX_ATTRIB_TEXCOORD 2
+#define MAX_VERTEX_ATTRIBS 3
+
+typedef enum {
+    POSITION_FLOAT,          // 3 x GL_FLOAT
+    POSITION_HALF,           // 4 x GL_HALF_FLOAT，w 固定为 1，补齐到 4 字节对齐
+} PositionFormat;
+
+typedef enum {
+    NORMAL_NONE,
+    NORMAL_FLOAT,            // 3 x GL_FLOAT
+    NORMAL_OCT16,            // 2 x GL_SHORT 归一化，八面体编码，着色器中用 octDecode 还原
+    NORMAL_INT_2_10_10_10,   // GL_INT_2_10_10_10_REV 归一化，w = 0
+} NormalFormat;
+
+typedef enum {
+    TEXCOORD_NONE,
+    TEXCOORD_FLOAT,          // 2 x GL_FLOAT
+    TEXCOORD_UNORM16,        // 2 x GL_UNSIGNED_SHORT 归一化，超出 [0, 1] 的值会被截断
+} TexCoordFormat;
+
+typedef struct {
+    PositionFormat position;
+    NormalFormat normal;
+    TexCoordFormat texCoord;
+} VertexFormat;
+
+typedef struct {
+    GLuint location;
+    GLint size;
+    GLenum type;
+    GLboolean normalized;
+    GLuint offset;
+} VertexAttrib;
+
+typedef struct {
+    GLsizei stride;
+    int numAttribs;
+    VertexAttrib attribs[MAX_VERTEX_ATTRIBS];
+    int numVertices;
+    int numIndices;
+    GLenum indexType;        // GL_UNSIGNED_SHORT 或 GL_UNSIGNED_INT
+    int indexSize;
+} VertexLayout;
+
+//根据格式计算各属性的偏移和步长
+void vertexLayoutInit(VertexLayout *layout, const VertexFormat *format, int numVertices,
+                      int numIndices);
+//把 [first, first + count) 个顶点按 layout 打包写入 dst（指向整个交错缓冲区起始位置），
+//remap 不为 NULL 时第 i 个顶点写到 remap[i] 的位置
+void packVertices(const VertexLayout *layout, const VertexFormat *format, int first, int count,
+                  const GLfloat *positions, const GLfloat *normals, const GLfloat *texCoords,
+                  const GLuint *remap, void *dst);
+//把 32 位索引按 layout->indexType 写入 dst（指向整个索引缓冲区起始位置）
+void packIndices(const VertexLayout *layout, int first, int count, const GLuint *src, void *dst);
+//调用 glVertexAttribPointer 并启用各属性，base 为客户端数组地址，使用 VBO 时传 NULL
+void applyVertexLayout(const VertexLayout *layout, const void *base);
+
+//生成交错格式的立方体，vertices/indices 由调用方 free，返回索引数；
+//optimize 与 createCube 相同；分配失败时返回 0，输出指针置为 NULL
+int createCubeInterleaved(float scale, const VertexFormat *format, void **vertices,
+                          void **indices, VertexLayout *layout, bool optimize = true);
+//生成交错格式的球体，按行分块生成并直接打包，不需要完整的浮点中间数组；
+//optimize 为 true（默认）时顶点按优化后的编号直接写到目标位置，stats 与 createSphere 相同；
+//纹理坐标在 [0, 1] 内，可以使用 TEXCOORD_UNORM16；
+//numSlices 小于 2 或分配失败时返回 0，输出指针置为 NULL
+int createSphereInterleaved(int numSlices, float radius, const VertexFormat *format,
+                            void **vertices, void **indices, VertexLayout *layout,
+                            bool optimize = true, MeshOptimizeStats *stats = NULL);
+
+//NORMAL_OCT16 对应的 GLSL 解码函数 vec3 octDecode(vec2)，拼接到顶点着色器中使用
+extern const char OCT_DECODE_GLSL[];
+
+//浮点数转半精度（就近舍入）
+GLushort floatToHalf(float value);
+//单位向量八面体编码，结果为 [-1, 1] 的两个分量
+void octEncode(const GLfloat normal[3], GLfloat result[2]);
+
+#endif
@@ -0,0 +1,105 @@
+#include "include/instance-recorder.h"
+
+bool instanceRecorderInit(InstanceRecorder *recorder, int capacity) {
+    int numChunks = (capacity + RECORD_CHUNK - 1) / RECORD_CHUNK;
+    memset(recorder, 0, sizeof(InstanceRecorder));
+    recorder->chunkOffsets = (int *) malloc(sizeof(int) * (numChunks + 1));
+    recorder->visible = (uint8_t *) malloc(capacity > 0 ? capacity : 1);
+    if (!recorder->chunkOffsets || !recorder->visible) {
+        instanceRecorderRelease(recorder);
+        return false;
+    }
+    recorder->capacity = capacity;
+    return true;
+}
+
+void instanceRecorderRelease(InstanceRecorder *recorder) {
+    free(recorder->chunkOffsets);
+    free(recorder->visible);
+    memset(recorder, 0, sizeof(InstanceRecorder));
+}
+
+// 第一遍：剔除 [begin, end) 内的物体，返回可见数
+static int cullChunk(const RecordObject *objects, int begin, int end, const Frustum *frustum,
+                     uint8_t *visible) {
+    int visibleCount = 0;
+    int i;
+    for (i = begin; i < end; i++) {
+        const RecordObject *object = &objects[i];
+        visible[i] = !frustum || object->radius <= 0.0f ||
+                     frustumContainsSphere(frustum, object->position,
+                                           object->radius * fabsf(object->scale));
+        visibleCount += visible[i];
+    }
+    return visibleCount;
+}
+
+// 第二遍：把一块中的可见物体写到 out[offset] 开始的位置
+static void writeChunk(const RecordObject *objects, int begin, int end, const uint8_t *visible,
+                       const Matrix *viewProj, InstanceData *out, int offset, int limit) {
+    Matrix models[RECORD_CHUNK];
+    int n = 0;
+    int i;
+    for (i = begin; i < end && offset + n < limit; i++) {
+        const RecordObject *object = &objects[i];
+        if (!visible[i]) {
+            continue;
+        }
+        // 变换函数左乘，最后调用的最先作用于顶点
+        matrixLoadIdentity(&models[n]);
+        translate(&models[n], object->position[0], object->position[1], object->position[2]);
+        if (object->angle != 0.0f) {
+            rotate(&models[n], object->angle, object->axis[0], object->axis[1], object->axis[2]);
+        }
+        scale(&models[n], object->scale, object->scale, object->scale);
+        memcpy(out[offset + n].color, object->color, sizeof(GLfloat) * 4);
+        n++;
+    }
+    matrixMultiplyBatch(&out[offset].transform, sizeof(InstanceData), models, viewProj, n);
+}
+
+int recordInstances(InstanceRecorder *recorder, const RecordObject *objects, int count,
+                    const Matrix *viewProj, const Frustum *frustum, InstanceData *out,
+                    int outCapacity, ThreadPool *pool) {
+    int numChunks = (count + RECORD_CHUNK - 1) / RECORD_CHUNK;
+    int *offsets = recorder->chunkOffsets;
+    uint8_t *visible = recorder->visible;
+    int total = 0;
+    int c;
+    if (count > recorder->capacity) {
+        count = recorder->capacity;
+        numChunks = (count + RECORD_CHUNK - 1) / RECORD_CHUNK;
+    }
+    // fn 收到的区间可能包含多块（单线程或块数较少时），按块边界拆开
+    auto forEachChunk = [&](const std::function<void(int)> &chunkFn) {
+        std::function<void(int, int)> range = [&](int begin, int end) {
+            for (int chunk = begin; chunk < end; chunk++) {
+                chunkFn(chunk);
+            }
+        };
+        if (pool) {
+            pool->parallelFor(0, numChunks, 1, range);
+        } else {
+            range(0, numChunks);
+        }
+    };
+    forEachChunk([&](int chunk) {
+        int begin = chunk * RECORD_CHUNK;
+        int end = begin + RECORD_CHUNK < count ? begin + RECORD_CHUNK : count;
+        offsets[chunk] = cullChunk(objects, begin, end, frustum, visible);
+    });
+    for (c = 0; c < numChunks; c++) {
+        int chunkCount = offsets[c];
+        offsets[c] = total;
+        total += chunkCount;
+    }
+    offsets[numChunks] = total;
+    forEachChunk([&](int chunk) {
+        int begin = chunk * RECORD_CHUNK;
+        int end = begin + RECORD_CHUNK < count ? begin + RECORD_CHUNK : count;
+        if (offsets[chunk] < outCapacity) {
+            writeChunk(objects, begin, end, visible, viewProj, out, offsets[chunk], outCapacity);
+        }
+    });
+    return total < outCapacity ? total : outCapacity;
+}
@@ -0,0 +1,201 @@
+#include <EGL/egl.h>
+#include <GLES3/gl3.h>
+#include <GLES2/gl2ext.h>
+#include <cstddef>
+#include "include/instancing.h"
+
+#ifndef GL_MAP_PERSISTENT_BIT_EXT
+#define GL_MAP_PERSISTENT_BIT_EXT 0x0040
+#define GL_MAP_COHERENT_BIT_EXT 0x0080
+typedef void (GL_APIENTRYP PFNGLBUFFERSTORAGEEXTPROC)(GLenum target, GLsizeiptr size,
+                                                     const void *data, GLbitfield flags);
+#endif
+
+const char INSTANCE_ATTRIBS_GLSL[] =
+        "layout(location = " STRV(INSTANCE_ATTRIB_MATRIX) ") in mat4 instanceMatrix;\n"
+        "layout(location = " STRV(INSTANCE_ATTRIB_COLOR) ") in vec4 instanceColor;\n";
+
+//把当前 VAO 的实例属性指向 GL_ARRAY_BUFFER 中 baseOffset 开始的 InstanceData 数组
+static void setInstanceAttribs(GLintptr baseOffset) {
+    int i;
+    for (i = 0; i < 4; i++) {
+        GLuint location = INSTANCE_ATTRIB_MATRIX + i;
+        glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                              (const void *) (baseOffset + offsetof(InstanceData, transform) +
+                                              sizeof(GLfloat) * 4 * i));
+        glEnableVertexAttribArray(location);
+        glVertexAttribDivisor(location, 1);
+    }
+    glVertexAttribPointer(INSTANCE_ATTRIB_COLOR, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                          (const void *) (baseOffset + offsetof(InstanceData, color)));
+    glEnableVertexAttribArray(INSTANCE_ATTRIB_COLOR);
+    glVertexAttribDivisor(INSTANCE_ATTRIB_COLOR, 1);
+}
+
+bool instanceBatchInit(InstanceBatch *batch, const MeshBuffer *mesh, int capacity) {
+    memset(batch, 0, sizeof(InstanceBatch));
+    batch->mesh = mesh;
+    batch->capacity = capacity;
+    if (posix_memalign((void **) &batch->staging, 16, sizeof(InstanceData) * capacity) != 0) {
+        batch->staging = NULL;
+        return false;
+    }
+    glGenBuffers(1, &batch->instanceVbo);
+    glBindVertexArray(mesh->vao);
+    glBindBuffer(GL_ARRAY_BUFFER, batch->instanceVbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(InstanceData) * capacity, NULL, GL_STREAM_DRAW);
+    setInstanceAttribs(0);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return !checkGlError("instanceBatchInit");
+}
+
+void instanceBatchPack(InstanceBatch *batch, const Matrix *transforms, const GLfloat *colors,
+                       int count, const Matrix *viewProj) {
+    static const GLfloat WHITE[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+    InstanceData *data = batch->staging;
+    int i;
+    if (count > batch->capacity) {
+        count = batch->capacity;
+    }
+    if (viewProj) {
+        matrixMultiplyBatch(&data->transform, sizeof(InstanceData), transforms, viewProj, count);
+    } else {
+        for (i = 0; i < count; i++) {
+            data[i].transform = transforms[i];
+        }
+    }
+    // 颜色每个实例 16 字节，按对齐的整块拷贝
+    for (i = 0; i < count; i++) {
+        memcpy(data[i].color, colors ? colors + i * 4 : WHITE, sizeof(GLfloat) * 4);
+    }
+    batch->count = count;
+}
+
+void instanceBatchDraw(InstanceBatch *batch) {
+    const MeshBuffer *mesh = batch->mesh;
+    if (batch->count == 0) {
+        return;
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, batch->instanceVbo);
+    // 先 orphan 再写入，避免等待 GPU 读完上一帧的实例数据
+    glBufferData(GL_ARRAY_BUFFER, sizeof(InstanceData) * batch->capacity, NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(InstanceData) * batch->count, batch->staging);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(mesh->vao);
+    if (mesh->indexCount > 0) {
+        glDrawElementsInstanced(GL_TRIANGLES, mesh->indexCount, mesh->indexType,
+                                (const void *) 0, batch->count);
+    } else {
+        glDrawArraysInstanced(GL_TRIANGLES, 0, mesh->vertexCount, batch->count);
+    }
+}
+
+void instanceBatchRelease(InstanceBatch *batch) {
+    glDeleteBuffers(1, &batch->instanceVbo);
+    free(batch->staging);
+    memset(batch, 0, sizeof(InstanceBatch));
+}
+
+bool instanceStreamInit(InstanceStream *stream, const MeshBuffer *mesh, int capacity) {
+    GLsizeiptr size = (GLsizeiptr) sizeof(InstanceData) * capacity * INSTANCE_STREAM_SEGMENTS;
+    PFNGLBUFFERSTORAGEEXTPROC bufferStorage = NULL;
+    stream->mesh = mesh;
+    stream->buffer = 0;
+    stream->capacity = capacity;
+    stream->mapped = NULL;
+    stream->staging = NULL;
+    memset(stream->fences, 0, sizeof(stream->fences));
+    glGenBuffers(1, &stream->buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, stream->buffer);
+    if (hasGlExtension("GL_EXT_buffer_storage")) {
+        bufferStorage = (PFNGLBUFFERSTORAGEEXTPROC) eglGetProcAddress("glBufferStorageEXT");
+    }
+    if (bufferStorage) {
+        // 不可变存储 + 持久、一致映射：映射一次，GPU 读取期间也不需要解除映射
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT_EXT | GL_MAP_COHERENT_BIT_EXT;
+        bufferStorage(GL_ARRAY_BUFFER, size, NULL, flags);
+        stream->mapped = (InstanceData *) glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags);
+    }
+    if (!stream->mapped) {
+        if (bufferStorage) {
+            // 不可变存储无法再 glBufferData，换一个缓冲区对象
+            glDeleteBuffers(1, &stream->buffer);
+            glGenBuffers(1, &stream->buffer);
+            glBindBuffer(GL_ARRAY_BUFFER, stream->buffer);
+        }
+        glBufferData(GL_ARRAY_BUFFER, size, NULL, GL_STREAM_DRAW);
+        if (posix_memalign((void **) &stream->staging, 16, size) != 0) {
+            stream->staging = NULL;
+        }
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    if ((!stream->mapped && !stream->staging) || checkGlError("instanceStreamInit")) {
+        instanceStreamRelease(stream);
+        return false;
+    }
+    ALOGD("instance stream: %s", stream->mapped ? "persistent mapping" : "CPU staging + upload");
+    stream->ready.store(true, std::memory_order_release);
+    return true;
+}
+
+InstanceData *instanceStreamSegment(InstanceStream *stream, int segment) {
+    InstanceData *base;
+    if (!stream->ready.load(std::memory_order_acquire)) {
+        return NULL;
+    }
+    base = stream->mapped ? stream->mapped : stream->staging;
+    return base + (size_t) stream->capacity * (segment % INSTANCE_STREAM_SEGMENTS);
+}
+
+void instanceStreamSubmit(InstanceStream *stream, int segment, int count) {
+    GLintptr offset = (GLintptr) sizeof(InstanceData) * stream->capacity *
+                      (segment % INSTANCE_STREAM_SEGMENTS);
+    glBindBuffer(GL_ARRAY_BUFFER, stream->buffer);
+    if (!stream->mapped && count > 0) {
+        glBufferSubData(GL_ARRAY_BUFFER, offset, (GLsizeiptr) sizeof(InstanceData) * count,
+                        instanceStreamSegment(stream, segment));
+    }
+    glBindVertexArray(stream->mesh->vao);
+    setInstanceAttribs(offset);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void instanceStreamEndFrame(InstanceStream *stream, int segment) {
+    int slot = segment % INSTANCE_STREAM_SEGMENTS;
+    int oldest = (slot + 2) % INSTANCE_STREAM_SEGMENTS;
+    if (stream->fences[slot]) {
+        glDeleteSync(stream->fences[slot]);
+    }
+    stream->fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    if (stream->fences[oldest]) {
+        // 正常情况下 GPU 早已读完，不会真正等待
+        while (glClientWaitSync(stream->fences[oldest], GL_SYNC_FLUSH_COMMANDS_BIT,
+                                1000000000) == GL_TIMEOUT_EXPIRED) {
+        }
+        glDeleteSync(stream->fences[oldest]);
+        stream->fences[oldest] = 0;
+    }
+}
+
+void instanceStreamRelease(InstanceStream *stream) {
+    int i;
+    stream->ready.store(false);
+    for (i = 0; i < INSTANCE_STREAM_SEGMENTS; i++) {
+        if (stream->fences[i]) {
+            glDeleteSync(stream->fences[i]);
+            stream->fences[i] = 0;
+        }
+    }
+    if (stream->mapped) {
+        glBindBuffer(GL_ARRAY_BUFFER, stream->buffer);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        stream->mapped = NULL;
+    }
+    glDeleteBuffers(1, &stream->buffer);
+    stream->buffer = 0;
+    free(stream->staging);
+    stream->staging = NULL;
+}
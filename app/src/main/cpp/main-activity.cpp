@@ -1,5 +1,6 @@
 #include <jni.h>
 #include <string>
+#include "include/profiler.h"
 
 extern "C" JNIEXPORT jstring JNICALL
 Java_com_vegeta_glndk_MainActivity_getABIString(
@@ -41,6 +42,37 @@ Java_com_vegeta_glndk_MainActivity_getABIString(
     return env->NewStringUTF("Hello from JNI !  Compiled with ABI " ABI ".");
 }
 
+//最近若干帧的 CPU/GPU 耗时分位数
+extern "C" JNIEXPORT jstring JNICALL
+Java_com_vegeta_glndk_MainActivity_getFrameStats(
+        JNIEnv *env,
+        jobject /* this */) {
+    ProfileFrameStats stats;
+    char text[256];
+    if (!profilerGetFrameStats(&stats)) {
+        return env->NewStringUTF("no frames");
+    }
+    int len = snprintf(text, sizeof(text),
+                       "frames %d cpu p50/p95/p99 %.2f/%.2f/%.2f ms",
+                       stats.frames, stats.cpuP50, stats.cpuP95, stats.cpuP99);
+    if (stats.gpuFrames > 0 && len > 0 && len < (int) sizeof(text)) {
+        snprintf(text + len, sizeof(text) - len, "\ngpu p50/p95/p99 %.2f/%.2f/%.2f ms (dropped %d)",
+                 stats.gpuP50, stats.gpuP95, stats.gpuP99, stats.gpuDropped);
+    }
+    return env->NewStringUTF(text);
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_vegeta_glndk_MainActivity_exportTrace(
+        JNIEnv *env,
+        jobject /* this */,
+        jstring path) {
+    const char *file = env->GetStringUTFChars(path, NULL);
+    bool ok = profilerExportTrace(file);
+    env->ReleaseStringUTFChars(path, file);
+    return ok ? JNI_TRUE : JNI_FALSE;
+}
+
 static int count;
 
 extern "C"
@@ -0,0 +1,252 @@
+#include <stdlib.h>
+#include <utility>
+#include "include/mesh-allocator.h"
+
+static size_t alignUp(size_t value) {
+    return (value + MESH_ALLOC_ALIGNMENT - 1) & ~(size_t) (MESH_ALLOC_ALIGNMENT - 1);
+}
+
+static void *systemAllocate(size_t size) {
+    void *ptr = NULL;
+    if (posix_memalign(&ptr, MESH_ALLOC_ALIGNMENT, size) != 0) {
+        return NULL;
+    }
+    return ptr;
+}
+
+void MeshAllocator::resetStats() {
+    size_t inUse = counters.bytesInUse;
+    memset(&counters, 0, sizeof(counters));
+    counters.bytesInUse = inUse;
+    counters.peakBytes = inUse;
+}
+
+void MeshAllocator::countAllocation(size_t size) {
+    counters.allocations++;
+    counters.bytesInUse += size;
+    if (counters.bytesInUse > counters.peakBytes) {
+        counters.peakBytes = counters.bytesInUse;
+    }
+}
+
+void MeshAllocator::countFree(size_t size) {
+    counters.frees++;
+    counters.bytesInUse -= size;
+}
+
+void *MallocAllocator::allocate(size_t size) {
+    void *ptr = systemAllocate(size);
+    if (!ptr) {
+        counters.failures++;
+        return NULL;
+    }
+    counters.systemAllocations++;
+    countAllocation(size);
+    return ptr;
+}
+
+void MallocAllocator::deallocate(void *ptr, size_t size) {
+    if (!ptr) {
+        return;
+    }
+    countFree(size);
+    free(ptr);
+}
+
+MeshAllocator *defaultMeshAllocator() {
+    static MallocAllocator allocator;
+    return &allocator;
+}
+
+LinearArena::LinearArena(size_t capacity) : size(capacity) {
+    base = (unsigned char *) systemAllocate(capacity);
+    if (!base) {
+        size = 0;
+        ALOGE("Could not allocate arena of %zu bytes", capacity);
+    } else {
+        counters.systemAllocations++;
+    }
+}
+
+LinearArena::~LinearArena() {
+    free(base);
+}
+
+void *LinearArena::allocate(size_t bytes) {
+    size_t begin = alignUp(offset);
+    if (begin > size || bytes > size - begin) {
+        counters.failures++;
+        return NULL;
+    }
+    // 对齐填充也计入使用量，bytesInUse 始终等于 offset
+    countAllocation(begin + bytes - offset);
+    offset = begin + bytes;
+    return base + begin;
+}
+
+void LinearArena::deallocate(void *ptr, size_t bytes) {
+    // 内存要到 reset/rewind 时才回收，这里不减少 bytesInUse，
+    // 所以 reset 之后再释放之前的网格也不会使计数下溢
+    if (ptr) {
+        counters.frees++;
+    }
+}
+
+void LinearArena::reset() {
+    rewind(0);
+}
+
+void LinearArena::rewind(size_t mark) {
+    if (mark < offset) {
+        size_t released = offset - mark;
+        counters.bytesInUse = counters.bytesInUse > released ? counters.bytesInUse - released : 0;
+        offset = mark;
+    }
+}
+
+// 返回 size 所在的大小等级，超过最大等级时返回 -1
+static int sizeClass(size_t size) {
+    int shift = POOL_MIN_CLASS_SHIFT;
+    while (((size_t) 1 << shift) < size) {
+        shift++;
+        if (shift > POOL_MAX_CLASS_SHIFT) {
+            return -1;
+        }
+    }
+    return shift - POOL_MIN_CLASS_SHIFT;
+}
+
+static size_t classSize(int index) {
+    return (size_t) 1 << (index + POOL_MIN_CLASS_SHIFT);
+}
+
+PoolAllocator::PoolAllocator(size_t maxCachedBytes) : maxCached(maxCachedBytes) {
+}
+
+PoolAllocator::~PoolAllocator() {
+    trim();
+}
+
+void *PoolAllocator::allocate(size_t size) {
+    int index = sizeClass(size);
+    void *ptr;
+    if (index >= 0 && freeLists[index]) {
+        FreeBlock *block = freeLists[index];
+        freeLists[index] = block->next;
+        cached -= classSize(index);
+        ptr = block;
+    } else {
+        ptr = systemAllocate(index >= 0 ? classSize(index) : size);
+        if (!ptr) {
+            counters.failures++;
+            return NULL;
+        }
+        counters.systemAllocations++;
+    }
+    countAllocation(size);
+    return ptr;
+}
+
+void PoolAllocator::deallocate(void *ptr, size_t size) {
+    int index = sizeClass(size);
+    if (!ptr) {
+        return;
+    }
+    countFree(size);
+    if (index < 0 || cached + classSize(index) > maxCached) {
+        free(ptr);
+        return;
+    }
+    FreeBlock *block = (FreeBlock *) ptr;
+    block->next = freeLists[index];
+    freeLists[index] = block;
+    cached += classSize(index);
+}
+
+void PoolAllocator::trim() {
+    int i;
+    for (i = 0; i < POOL_CLASS_COUNT; i++) {
+        while (freeLists[i]) {
+            FreeBlock *next = freeLists[i]->next;
+            free(freeLists[i]);
+            freeLists[i] = next;
+        }
+    }
+    cached = 0;
+}
+
+Mesh::Mesh(MeshAllocator *allocator)
+        : owner(allocator ? allocator : defaultMeshAllocator()) {
+}
+
+Mesh::~Mesh() {
+    release();
+}
+
+Mesh::Mesh(Mesh &&other) noexcept
+        : owner(other.owner), block(other.block), blockSize(other.blockSize),
+          vertexData(other.vertexData), normalData(other.normalData),
+          texCoordData(other.texCoordData), indexData(other.indexData),
+          numVertices(other.numVertices), numIndices(other.numIndices) {
+    other.block = NULL;
+    other.release();
+}
+
+Mesh &Mesh::operator=(Mesh &&other) noexcept {
+    if (this != &other) {
+        release();
+        std::swap(owner, other.owner);
+        std::swap(block, other.block);
+        std::swap(blockSize, other.blockSize);
+        std::swap(vertexData, other.vertexData);
+        std::swap(normalData, other.normalData);
+        std::swap(texCoordData, other.texCoordData);
+        std::swap(indexData, other.indexData);
+        std::swap(numVertices, other.numVertices);
+        std::swap(numIndices, other.numIndices);
+    }
+    return *this;
+}
+
+bool Mesh::allocate(int vertexCount, int indexCount, bool hasNormals, bool hasTexCoords) {
+    size_t vertexBytes = alignUp(sizeof(GLfloat) * 3 * vertexCount);
+    size_t normalBytes = hasNormals ? vertexBytes : 0;
+    size_t texCoordBytes = hasTexCoords ? alignUp(sizeof(GLfloat) * 2 * vertexCount) : 0;
+    size_t indexBytes = alignUp(sizeof(GLuint) * indexCount);
+    release();
+    if (vertexCount <= 0) {
+        return false;
+    }
+    blockSize = vertexBytes + normalBytes + texCoordBytes + indexBytes;
+    block = owner->allocate(blockSize);
+    if (!block) {
+        blockSize = 0;
+        return false;
+    }
+    // 各数组依次排列，起始地址都按 MESH_ALLOC_ALIGNMENT 对齐
+    unsigned char *cursor = (unsigned char *) block;
+    vertexData = (GLfloat *) cursor;
+    cursor += vertexBytes;
+    normalData = hasNormals ? (GLfloat *) cursor : NULL;
+    cursor += normalBytes;
+    texCoordData = hasTexCoords ? (GLfloat *) cursor : NULL;
+    cursor += texCoordBytes;
+    indexData = indexCount > 0 ? (GLuint *) cursor : NULL;
+    numVertices = vertexCount;
+    numIndices = indexCount;
+    return true;
+}
+
+void Mesh::release() {
+    if (block) {
+        owner->deallocate(block, blockSize);
+    }
+    block = NULL;
+    blockSize = 0;
+    vertexData = NULL;
+    normalData = NULL;
+    texCoordData = NULL;
+    indexData = NULL;
+    numVertices = 0;
+    numIndices = 0;
+}
@@ -0,0 +1,398 @@
+#include "include/mesh-generator.h"
+#include "include/mesh-optimizer.h"
+
+// 每个并行任务大约处理的顶点数
+#define ROW_CHUNK_VERTICES 16384
+
+static int rowGrain(int verticesPerRow) {
+    int grain = ROW_CHUNK_VERTICES / (verticesPerRow > 0 ? verticesPerRow : 1);
+    return grain > 0 ? grain : 1;
+}
+
+int sphereVertexCount(int numSlices) {
+    return (numSlices / 2 + 1) * (numSlices + 1);
+}
+
+int sphereIndexCount(int numSlices) {
+    return (numSlices / 2) * numSlices * 6;
+}
+
+int squareGridVertexCount(int size) {
+    return size * size;
+}
+
+int squareGridIndexCount(int size) {
+    return (size - 1) * (size - 1) * 2 * 3;
+}
+
+bool sphereGeneratorInit(SphereGenerator *gen, int numSlices, float radius) {
+    int i;
+    float angleStep = (float) (2.0f * PI) / numSlices;
+    memset(gen, 0, sizeof(SphereGenerator));
+    // 至少一行四边形（numParallels >= 1）
+    if (numSlices < 2) {
+        return false;
+    }
+    gen->numSlices = numSlices;
+    gen->numParallels = numSlices / 2;
+    gen->radius = radius;
+    // 5 张表放在一块内存里
+    gen->sinLat = (GLfloat *) malloc(
+            sizeof(GLfloat) * (2 * (gen->numParallels + 1) + 3 * (numSlices + 1)));
+    if (!gen->sinLat) {
+        return false;
+    }
+    gen->cosLat = gen->sinLat + gen->numParallels + 1;
+    gen->sinLon = gen->cosLat + gen->numParallels + 1;
+    gen->cosLon = gen->sinLon + numSlices + 1;
+    gen->texU = gen->cosLon + numSlices + 1;
+    for (i = 0; i < gen->numParallels + 1; i++) {
+        gen->sinLat[i] = sinf(angleStep * (float) i);
+        gen->cosLat[i] = cosf(angleStep * (float) i);
+    }
+    for (i = 0; i < numSlices + 1; i++) {
+        gen->sinLon[i] = sinf(angleStep * (float) i);
+        gen->cosLon[i] = cosf(angleStep * (float) i);
+        gen->texU[i] = (float) i / (float) numSlices;
+    }
+    return true;
+}
+
+void sphereGeneratorRelease(SphereGenerator *gen) {
+    free(gen->sinLat);
+    memset(gen, 0, sizeof(SphereGenerator));
+}
+
+void sphereGeneratorVertices(const SphereGenerator *gen, int rowBegin, int rowEnd,
+                             GLfloat *vertices, GLfloat *normals, GLfloat *texCoords) {
+    int i, j;
+    int numSlices = gen->numSlices;
+    float radius = gen->radius;
+    for (i = rowBegin; i < rowEnd; i++) {
+        GLfloat ringRadius = radius * gen->sinLat[i];
+        GLfloat y = radius * gen->cosLat[i];
+        // 从北极 1 到南极 0
+        GLfloat texV = 1.0f - (float) i / (float) gen->numParallels;
+        for (j = 0; j < numSlices + 1; j++) {
+            GLfloat x = ringRadius * gen->sinLon[j];
+            GLfloat z = ringRadius * gen->cosLon[j];
+            if (vertices) {
+                vertices[0] = x;
+                vertices[1] = y;
+                vertices[2] = z;
+                vertices += 3;
+            }
+            if (normals) {
+                normals[0] = x / radius;
+                normals[1] = y / radius;
+                normals[2] = z / radius;
+                normals += 3;
+            }
+            if (texCoords) {
+                texCoords[0] = gen->texU[j];
+                texCoords[1] = texV;
+                texCoords += 2;
+            }
+        }
+    }
+}
+
+void sphereGeneratorIndices(const SphereGenerator *gen, int rowBegin, int rowEnd, GLuint *indices) {
+    int i, j;
+    int numSlices = gen->numSlices;
+    for (i = rowBegin; i < rowEnd; i++) {
+        GLuint row = (GLuint) (i * (numSlices + 1));
+        GLuint nextRow = row + (GLuint) (numSlices + 1);
+        for (j = 0; j < numSlices; j++) {
+            *indices++ = row + j;
+            *indices++ = nextRow + j;
+            *indices++ = nextRow + (j + 1);
+            *indices++ = row + j;
+            *indices++ = nextRow + (j + 1);
+            *indices++ = row + (j + 1);
+        }
+    }
+}
+
+bool gridGeneratorInit(GridGenerator *gen, int size) {
+    int i;
+    float stepSize = (float) size - 1;
+    memset(gen, 0, sizeof(GridGenerator));
+    // 每边至少两个顶点，否则 stepSize 为 0
+    if (size < 2) {
+        return false;
+    }
+    gen->size = size;
+    gen->coord = (GLfloat *) malloc(sizeof(GLfloat) * size);
+    if (!gen->coord) {
+        return false;
+    }
+    for (i = 0; i < size; i++) {
+        gen->coord[i] = (float) i / stepSize;
+    }
+    return true;
+}
+
+void gridGeneratorRelease(GridGenerator *gen) {
+    free(gen->coord);
+    memset(gen, 0, sizeof(GridGenerator));
+}
+
+void gridGeneratorVertices(const GridGenerator *gen, int rowBegin, int rowEnd, GLfloat *vertices) {
+    int i, j;
+    int size = gen->size;
+    for (i = rowBegin; i < rowEnd; i++) {
+        GLfloat x = gen->coord[i];
+        for (j = 0; j < size; j++) {
+            vertices[0] = x;
+            vertices[1] = gen->coord[j];
+            vertices[2] = 0.0f;
+            vertices += 3;
+        }
+    }
+}
+
+void gridGeneratorIndices(const GridGenerator *gen, int rowBegin, int rowEnd, GLuint *indices) {
+    int i, j;
+    int size = gen->size;
+    for (i = rowBegin; i < rowEnd; i++) {
+        GLuint row = (GLuint) (i * size);
+        GLuint nextRow = row + (GLuint) size;
+        for (j = 0; j < size - 1; j++) {
+            // two triangles per quad
+            *indices++ = row + j;
+            *indices++ = row + j + 1;
+            *indices++ = nextRow + j + 1;
+            *indices++ = row + j;
+            *indices++ = nextRow + j + 1;
+            *indices++ = nextRow + j;
+        }
+    }
+}
+
+// 开启优化时只在临时缓冲区中计算：先按拓扑生成一份索引并求出 remap，顶点生成到临时缓冲区后
+// 按 remap 写入输出。输出缓冲区只写不读，可以是 glMapBufferRange 映射的只写内存；
+// 顶点编号只依赖拓扑，分别请求顶点和索引的两次调用得到的编号一致
+typedef struct {
+    GLuint *indices;    // 优化后的索引
+    GLuint *remap;      // remap[生成顺序的编号] = 输出中的编号
+    GLfloat *vertices;  // 按生成顺序存放的顶点属性，各属性依次排列
+    void *block;        // 以上三个数组所在的内存
+} OptimizeScratch;
+
+static size_t alignBytes(size_t bytes) {
+    return (bytes + MESH_ALLOC_ALIGNMENT - 1) & ~(size_t) (MESH_ALLOC_ALIGNMENT - 1);
+}
+
+static void optimizeScratchRelease(OptimizeScratch *scratch) {
+    free(scratch->block);
+    memset(scratch, 0, sizeof(OptimizeScratch));
+}
+
+static bool optimizeScratchInit(OptimizeScratch *scratch, int numVertices, int numIndices,
+                                int floatsPerVertex, MeshOptimizeStats *stats,
+                                const std::function<void(GLuint *)> &generateIndices) {
+    size_t indexBytes = alignBytes(sizeof(GLuint) * numIndices);
+    size_t remapBytes = alignBytes(sizeof(GLuint) * numVertices);
+    size_t vertexBytes = sizeof(GLfloat) * floatsPerVertex * numVertices;
+    memset(scratch, 0, sizeof(OptimizeScratch));
+    scratch->block = malloc(indexBytes + remapBytes + vertexBytes);
+    if (!scratch->block) {
+        // 内存不足时不做优化
+        optimizeScratchRelease(scratch);
+        return false;
+    }
+    scratch->indices = (GLuint *) scratch->block;
+    scratch->remap = (GLuint *) ((unsigned char *) scratch->block + indexBytes);
+    if (floatsPerVertex > 0) {
+        scratch->vertices = (GLfloat *) ((unsigned char *) scratch->block + indexBytes + remapBytes);
+    }
+    generateIndices(scratch->indices);
+    optimizeMesh(scratch->indices, numIndices, numVertices, scratch->remap, stats);
+    return true;
+}
+
+// 把按生成顺序排列的一个属性按 remap 写到输出
+static void scatterStream(GLfloat *dst, const GLfloat *src, int components, const GLuint *remap,
+                          int numVertices, ThreadPool *pool) {
+    std::function<void(int, int)> scatter = [&](int begin, int end) {
+        int i, c;
+        for (i = begin; i < end; i++) {
+            GLfloat *out = dst + remap[i] * components;
+            for (c = 0; c < components; c++) {
+                out[c] = src[i * components + c];
+            }
+        }
+    };
+    if (pool) {
+        pool->parallelFor(0, numVertices, ROW_CHUNK_VERTICES, scatter);
+    } else {
+        scatter(0, numVertices);
+    }
+}
+
+int createSphereInto(int numSlices, float radius, GLfloat *vertices, GLfloat *normals,
+                     GLfloat *texCoords, GLuint *indices, ThreadPool *pool, bool optimize,
+                     MeshOptimizeStats *stats) {
+    SphereGenerator gen;
+    OptimizeScratch scratch;
+    int numVertices = sphereVertexCount(numSlices);
+    int rowVertices = numSlices + 1;
+    int rowIndices = numSlices * 6;
+    GLfloat *outputs[] = {vertices, normals, texCoords};
+    const int components[] = {3, 3, 2};
+    int i;
+    if (stats) {
+        memset(stats, 0, sizeof(MeshOptimizeStats));
+    }
+    if (!sphereGeneratorInit(&gen, numSlices, radius)) {
+        return 0;
+    }
+    if (optimize) {
+        int floats = (vertices ? 3 : 0) + (normals ? 3 : 0) + (texCoords ? 2 : 0);
+        optimize = optimizeScratchInit(&scratch, numVertices, sphereIndexCount(numSlices), floats,
+                                       stats, [&](GLuint *work) {
+                                           sphereGeneratorIndices(&gen, 0, gen.numParallels, work);
+                                       });
+        if (optimize) {
+            // 顶点改为生成到临时缓冲区
+            GLfloat *next = scratch.vertices;
+            for (i = 0; i < 3; i++) {
+                if (outputs[i]) {
+                    outputs[i] = next;
+                    next += components[i] * numVertices;
+                }
+            }
+        }
+    }
+    std::function<void(int, int)> vertexRows = [&](int begin, int end) {
+        sphereGeneratorVertices(&gen, begin, end,
+                                outputs[0] ? outputs[0] + begin * rowVertices * 3 : NULL,
+                                outputs[1] ? outputs[1] + begin * rowVertices * 3 : NULL,
+                                outputs[2] ? outputs[2] + begin * rowVertices * 2 : NULL);
+    };
+    std::function<void(int, int)> indexRows = [&](int begin, int end) {
+        sphereGeneratorIndices(&gen, begin, end, indices + begin * rowIndices);
+    };
+    if (vertices || normals || texCoords) {
+        if (pool) {
+            pool->parallelFor(0, gen.numParallels + 1, rowGrain(rowVertices), vertexRows);
+        } else {
+            vertexRows(0, gen.numParallels + 1);
+        }
+    }
+    if (optimize) {
+        GLfloat *targets[] = {vertices, normals, texCoords};
+        for (i = 0; i < 3; i++) {
+            if (targets[i]) {
+                scatterStream(targets[i], outputs[i], components[i], scratch.remap, numVertices,
+                              pool);
+            }
+        }
+        if (indices) {
+            memcpy(indices, scratch.indices, sizeof(GLuint) * sphereIndexCount(numSlices));
+        }
+        optimizeScratchRelease(&scratch);
+    } else if (indices) {
+        if (pool) {
+            pool->parallelFor(0, gen.numParallels, rowGrain(rowVertices), indexRows);
+        } else {
+            indexRows(0, gen.numParallels);
+        }
+    }
+    sphereGeneratorRelease(&gen);
+    return sphereIndexCount(numSlices);
+}
+
+int createSquareGridInto(int size, GLfloat *vertices, GLuint *indices, ThreadPool *pool,
+                         bool optimize, MeshOptimizeStats *stats) {
+    GridGenerator gen;
+    OptimizeScratch scratch;
+    int numVertices = squareGridVertexCount(size);
+    GLfloat *output = vertices;
+    if (stats) {
+        memset(stats, 0, sizeof(MeshOptimizeStats));
+    }
+    if (!gridGeneratorInit(&gen, size)) {
+        return 0;
+    }
+    if (optimize) {
+        optimize = optimizeScratchInit(&scratch, numVertices, squareGridIndexCount(size),
+                                       vertices ? 3 : 0, stats, [&](GLuint *work) {
+                                           gridGeneratorIndices(&gen, 0, size - 1, work);
+                                       });
+        if (optimize) {
+            output = scratch.vertices;
+        }
+    }
+    std::function<void(int, int)> vertexRows = [&](int begin, int end) {
+        gridGeneratorVertices(&gen, begin, end, output + begin * size * 3);
+    };
+    std::function<void(int, int)> indexRows = [&](int begin, int end) {
+        gridGeneratorIndices(&gen, begin, end, indices + begin * (size - 1) * 6);
+    };
+    if (vertices) {
+        if (pool) {
+            pool->parallelFor(0, size, rowGrain(size), vertexRows);
+        } else {
+            vertexRows(0, size);
+        }
+    }
+    if (optimize) {
+        if (vertices) {
+            scatterStream(vertices, output, 3, scratch.remap, numVertices, pool);
+        }
+        if (indices) {
+            memcpy(indices, scratch.indices, sizeof(GLuint) * squareGridIndexCount(size));
+        }
+        optimizeScratchRelease(&scratch);
+    } else if (indices) {
+        if (pool) {
+            pool->parallelFor(0, size - 1, rowGrain(size), indexRows);
+        } else {
+            indexRows(0, size - 1);
+        }
+    }
+    gridGeneratorRelease(&gen);
+    return squareGridIndexCount(size);
+}
+
+bool createSphereMesh(Mesh *mesh, int numSlices, float radius, ThreadPool *pool, bool optimize,
+                      MeshOptimizeStats *stats) {
+    if (numSlices < 2 ||
+        !mesh->allocate(sphereVertexCount(numSlices), sphereIndexCount(numSlices), true, true)) {
+        mesh->release();
+        return false;
+    }
+    // 系数表分配失败时网格内容未写入，不能当作成功返回
+    if (createSphereInto(numSlices, radius, mesh->vertices(), mesh->normals(), mesh->texCoords(),
+                         mesh->indices(), pool, optimize, stats) == 0) {
+        mesh->release();
+        return false;
+    }
+    return true;
+}
+
+bool createSquareGridMesh(Mesh *mesh, int size, ThreadPool *pool, bool optimize,
+                          MeshOptimizeStats *stats) {
+    if (size < 2 ||
+        !mesh->allocate(squareGridVertexCount(size), squareGridIndexCount(size), false, false)) {
+        mesh->release();
+        return false;
+    }
+    if (createSquareGridInto(size, mesh->vertices(), mesh->indices(), pool, optimize,
+                             stats) == 0) {
+        mesh->release();
+        return false;
+    }
+    return true;
+}
+
+bool createCubeMesh(Mesh *mesh, float scale, bool optimize) {
+    if (!mesh->allocate(CUBE_VERTEX_COUNT, CUBE_INDEX_COUNT, true, true)) {
+        return false;
+    }
+    createCubeInto(scale, mesh->vertices(), mesh->normals(), mesh->texCoords(), mesh->indices(),
+                   optimize);
+    return true;
+}
@@ -0,0 +1,169 @@
+#include <float.h>
+#include "include/mesh-lod.h"
+#include "include/mesh-generator.h"
+
+//球体至少 4 个分段，网格至少 1 个分段
+#define MIN_SPHERE_SLICES 4
+
+LodChain::LodChain(MeshAllocator *allocator) : key() {
+    int i;
+    for (i = 0; i < MAX_LOD_LEVELS; i++) {
+        resolution[i] = 0;
+        levels[i] = Mesh(allocator);
+    }
+}
+
+LodCache::LodCache(MeshAllocator *allocator, ThreadPool *pool)
+        : allocator(allocator), pool(pool) {
+}
+
+static bool sameKey(const LodKey &a, const LodKey &b) {
+    return a.shape == b.shape && a.resolution == b.resolution && a.maxLevels == b.maxLevels &&
+           (a.shape != LOD_SHAPE_SPHERE || a.radius == b.radius);
+}
+
+static bool buildChain(LodChain *chain, ThreadPool *pool) {
+    const LodKey &key = chain->key;
+    int maxLevels = key.maxLevels < MAX_LOD_LEVELS ? key.maxLevels : MAX_LOD_LEVELS;
+    int i;
+    if (key.shape == LOD_SHAPE_SPHERE) {
+        if (key.resolution < MIN_SPHERE_SLICES || key.radius <= 0.0f) {
+            return false;
+        }
+        for (i = 0; i < maxLevels && (key.resolution >> i) >= MIN_SPHERE_SLICES; i++) {
+            chain->resolution[i] = key.resolution >> i;
+            if (!createSphereMesh(&chain->levels[i], chain->resolution[i], key.radius, pool)) {
+                return false;
+            }
+        }
+        chain->boundingRadius = key.radius;
+        chain->baseEdgeLength = (float) (2.0 * es::kPi) * key.radius / (float) key.resolution;
+    } else {
+        int segments = key.resolution - 1;
+        if (segments < 1) {
+            return false;
+        }
+        for (i = 0; i < maxLevels && (segments >> i) >= 1; i++) {
+            chain->resolution[i] = (segments >> i) + 1;
+            if (!createSquareGridMesh(&chain->levels[i], chain->resolution[i], pool)) {
+                return false;
+            }
+        }
+        chain->center[0] = 0.5f;
+        chain->center[1] = 0.5f;
+        chain->boundingRadius = sqrtf(0.5f);
+        chain->baseEdgeLength = 1.0f / (float) segments;
+    }
+    chain->levelCount = i;
+    return i > 0;
+}
+
+const LodChain *LodCache::acquire(const LodKey &key) {
+    for (const std::unique_ptr<LodChain> &chain : chains) {
+        if (sameKey(chain->key, key)) {
+            counters.hits++;
+            return chain.get();
+        }
+    }
+    counters.misses++;
+    std::unique_ptr<LodChain> chain(new LodChain(allocator));
+    chain->key = key;
+    if (!buildChain(chain.get(), pool)) {
+        return NULL;
+    }
+    for (int i = 0; i < chain->levelCount; i++) {
+        counters.bytes += chain->levels[i].byteSize();
+    }
+    chains.push_back(std::move(chain));
+    return chains.back().get();
+}
+
+void LodCache::clear() {
+    chains.clear();
+    counters.bytes = 0;
+}
+
+// 包围球中心的视空间深度及模型视图矩阵的最大缩放
+static float viewDepth(const Matrix *modelView, const float center[3], float *scaleOut) {
+    float z = center[0] * modelView->m[0][2] + center[1] * modelView->m[1][2] +
+              center[2] * modelView->m[2][2] + modelView->m[3][2];
+    float maxScale = 0.0f;
+    int i;
+    for (i = 0; i < 3; i++) {
+        float rowScale = modelView->m[i][0] * modelView->m[i][0] +
+                         modelView->m[i][1] * modelView->m[i][1] +
+                         modelView->m[i][2] * modelView->m[i][2];
+        if (rowScale > maxScale) {
+            maxScale = rowScale;
+        }
+    }
+    *scaleOut = sqrtf(maxScale);
+    // 相机看向 -z
+    return -z;
+}
+
+float projectedRadius(const Matrix *modelView, const Matrix *projection, const float center[3],
+                      float radius, float viewportHeight) {
+    float scale;
+    float depth = viewDepth(modelView, center, &scale);
+    float worldRadius = radius * scale;
+    if (depth <= worldRadius) {
+        return FLT_MAX;
+    }
+    // projection->m[1][1] = cot(fovy / 2)
+    return worldRadius * projection->m[1][1] * 0.5f * viewportHeight / depth;
+}
+
+void lodSelect(const LodChain *chain, const Matrix *modelView, const Matrix *projection,
+               const LodParams *params, LodSelection *selection) {
+    float scale;
+    float depth = viewDepth(modelView, chain->center, &scale);
+    float worldRadius = chain->boundingRadius * scale;
+    int lastLevel = chain->levelCount - 1;
+    selection->level = 0;
+    selection->nextLevel = 0;
+    selection->blend = 0.0f;
+    if (depth <= worldRadius) {
+        selection->projectedRadius = FLT_MAX;
+        return;
+    }
+    float pixelsPerUnit = projection->m[1][1] * 0.5f * params->viewportHeight / depth;
+    selection->projectedRadius = worldRadius * pixelsPerUnit;
+    // 第 i 级的边长是第 0 级的 2^i 倍，选择边长不超过 targetEdgePixels 的最粗级别
+    float edgePixels = chain->baseEdgeLength * scale * pixelsPerUnit;
+    float lod = edgePixels > 0.0f ? log2f(params->targetEdgePixels / edgePixels) : (float) lastLevel;
+    if (lod <= 0.0f) {
+        return;
+    }
+    if (lod >= (float) lastLevel) {
+        selection->level = lastLevel;
+        selection->nextLevel = lastLevel;
+        return;
+    }
+    int level = (int) lod;
+    float fraction = lod - (float) level;
+    selection->level = level;
+    selection->nextLevel = level;
+    if (params->blendRange > 0.0f) {
+        float start = 1.0f - params->blendRange;
+        if (fraction > start) {
+            selection->nextLevel = level + 1;
+            selection->blend = (fraction - start) / params->blendRange;
+        }
+    }
+}
+
+long lodSelectBatch(const LodChain *chain, const Matrix *modelViews, int n,
+                    const Matrix *projection, const LodParams *params, LodSelection *selections) {
+    long vertices = 0;
+    int i;
+    for (i = 0; i < n; i++) {
+        LodSelection *selection = &selections[i];
+        lodSelect(chain, &modelViews[i], projection, params, selection);
+        vertices += chain->levels[selection->level].vertexCount();
+        if (selection->nextLevel != selection->level) {
+            vertices += chain->levels[selection->nextLevel].vertexCount();
+        }
+    }
+    return vertices;
+}
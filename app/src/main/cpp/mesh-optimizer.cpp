@@ -0,0 +1,273 @@
+#include <mutex>
+#include "include/mesh-optimizer.h"
+#include "include/mesh-allocator.h"
+
+// Forsyth 算法中模拟的 LRU 缓存大小及评分参数
+#define FORSYTH_CACHE_SIZE 32
+#define FORSYTH_MAX_VALENCE 32
+#define CACHE_DECAY_POWER 1.5f
+#define LAST_TRI_SCORE 0.75f
+#define VALENCE_BOOST_SCALE 2.0f
+#define VALENCE_BOOST_POWER 0.5f
+
+static size_t alignBytes(size_t bytes) {
+    return (bytes + MESH_ALLOC_ALIGNMENT - 1) & ~(size_t) (MESH_ALLOC_ALIGNMENT - 1);
+}
+
+void analyzeVertexCache(const GLuint *indices, int numIndices, int numVertices, int cacheSize,
+                        VertexCacheStats *stats) {
+    size_t bytes = sizeof(GLuint) * numVertices;
+    GLuint timestamp = (GLuint) cacheSize + 1;
+    int misses = 0;
+    int referenced = 0;
+    int i;
+    memset(stats, 0, sizeof(VertexCacheStats));
+    if (numIndices < 3 || numVertices <= 0) {
+        return;
+    }
+    GLuint *cacheTime = (GLuint *) malloc(bytes);
+    if (!cacheTime) {
+        return;
+    }
+    memset(cacheTime, 0, bytes);
+    for (i = 0; i < numIndices; i++) {
+        GLuint v = indices[i];
+        if (cacheTime[v] == 0) {
+            referenced++;
+        }
+        if (timestamp - cacheTime[v] > (GLuint) cacheSize) {
+            cacheTime[v] = timestamp++;
+            misses++;
+        }
+    }
+    stats->acmr = (float) misses / (float) (numIndices / 3);
+    stats->atvr = referenced ? (float) misses / (float) referenced : 0.0f;
+    free(cacheTime);
+}
+
+static float cachePositionScore[FORSYTH_CACHE_SIZE];
+static float valenceScore[FORSYTH_MAX_VALENCE + 1];
+static std::once_flag scoreTablesOnce;
+
+//评分表只计算一次，多个线程同时优化网格时由 call_once 保证只有一个线程写入
+static void initScoreTables() {
+    int i;
+    for (i = 0; i < FORSYTH_CACHE_SIZE; i++) {
+        if (i < 3) {
+            // 刚刚用过的三个顶点得分固定，避免总是沿同一条边扩展成长条
+            cachePositionScore[i] = LAST_TRI_SCORE;
+        } else {
+            float scaled = 1.0f - (float) (i - 3) / (float) (FORSYTH_CACHE_SIZE - 3);
+            cachePositionScore[i] = powf(scaled, CACHE_DECAY_POWER);
+        }
+    }
+    valenceScore[0] = 0.0f;
+    for (i = 1; i <= FORSYTH_MAX_VALENCE; i++) {
+        valenceScore[i] = VALENCE_BOOST_SCALE * powf((float) i, -VALENCE_BOOST_POWER);
+    }
+}
+
+static inline float vertexScore(int cachePosition, int remaining) {
+    if (remaining == 0) {
+        return -1.0f;
+    }
+    float score = cachePosition >= 0 ? cachePositionScore[cachePosition] : 0.0f;
+    if (remaining <= FORSYTH_MAX_VALENCE) {
+        score += valenceScore[remaining];
+    } else {
+        score += VALENCE_BOOST_SCALE * powf((float) remaining, -VALENCE_BOOST_POWER);
+    }
+    return score;
+}
+
+void optimizeVertexCache(GLuint *dst, const GLuint *indices, int numIndices, int numVertices) {
+    int numTris = numIndices / 3;
+    int i, j;
+    if (numTris == 0) {
+        return;
+    }
+    std::call_once(scoreTablesOnce, initScoreTables);
+    // 所有工作数组放在一块内存里，只申请一次
+    size_t indexBytes = alignBytes(sizeof(GLuint) * numIndices);
+    size_t offsetBytes = alignBytes(sizeof(int) * (numVertices + 1));
+    size_t vertexBytes = alignBytes(sizeof(int) * numVertices);
+    size_t triBytes = alignBytes(sizeof(float) * numTris);
+    size_t emittedBytes = alignBytes(sizeof(bool) * numTris);
+    size_t blockSize = 2 * indexBytes + offsetBytes + 2 * vertexBytes + triBytes + emittedBytes;
+    unsigned char *block = (unsigned char *) malloc(blockSize);
+    if (!block) {
+        // 内存不足时保持原顺序
+        if (dst != indices) {
+            memcpy(dst, indices, sizeof(GLuint) * numIndices);
+        }
+        return;
+    }
+    unsigned char *cursor = block;
+    GLuint *tris = (GLuint *) cursor;
+    cursor += indexBytes;
+    int *adjacency = (int *) cursor;
+    cursor += indexBytes;
+    int *offsets = (int *) cursor;
+    cursor += offsetBytes;
+    int *remaining = (int *) cursor;
+    cursor += vertexBytes;
+    float *vScore = (float *) cursor;
+    cursor += vertexBytes;
+    float *tScore = (float *) cursor;
+    cursor += triBytes;
+    bool *emitted = (bool *) cursor;
+    memset(offsets, 0, sizeof(int) * (numVertices + 1));
+    memset(remaining, 0, sizeof(int) * numVertices);
+    memset(emitted, 0, sizeof(bool) * numTris);
+    memcpy(tris, indices, sizeof(GLuint) * numIndices);
+
+    // 每个顶点相邻的三角形列表，remaining[v] 之前的部分为尚未输出的三角形
+    for (i = 0; i < numTris * 3; i++) {
+        remaining[tris[i]]++;
+    }
+    for (i = 0; i < numVertices; i++) {
+        offsets[i + 1] = offsets[i] + remaining[i];
+        remaining[i] = 0;
+    }
+    for (i = 0; i < numTris * 3; i++) {
+        GLuint v = tris[i];
+        adjacency[offsets[v] + remaining[v]++] = i / 3;
+    }
+    for (i = 0; i < numVertices; i++) {
+        vScore[i] = vertexScore(-1, remaining[i]);
+    }
+    for (i = 0; i < numTris; i++) {
+        tScore[i] = vScore[tris[i * 3]] + vScore[tris[i * 3 + 1]] + vScore[tris[i * 3 + 2]];
+    }
+
+    {
+        int cache[FORSYTH_CACHE_SIZE + 3];
+        int newCache[FORSYTH_CACHE_SIZE + 3];
+        int cacheCount = 0;
+        int scanCursor = 0;
+        int bestTri = 0;
+        int out;
+        for (i = 1; i < numTris; i++) {
+            if (tScore[i] > tScore[bestTri]) {
+                bestTri = i;
+            }
+        }
+        for (out = 0; out < numTris; out++) {
+            if (bestTri < 0) {
+                // 缓存中的顶点已没有相邻三角形，按原顺序找下一个
+                while (emitted[scanCursor]) {
+                    scanCursor++;
+                }
+                bestTri = scanCursor;
+            }
+            GLuint *tri = &tris[bestTri * 3];
+            dst[out * 3] = tri[0];
+            dst[out * 3 + 1] = tri[1];
+            dst[out * 3 + 2] = tri[2];
+            emitted[bestTri] = true;
+
+            // 从三个顶点的相邻列表中移除该三角形
+            int newCount = 0;
+            for (i = 0; i < 3; i++) {
+                GLuint v = tri[i];
+                int *list = &adjacency[offsets[v]];
+                for (j = 0; j < remaining[v]; j++) {
+                    if (list[j] == bestTri) {
+                        list[j] = list[remaining[v] - 1];
+                        break;
+                    }
+                }
+                remaining[v]--;
+                newCache[newCount++] = (int) v;
+            }
+            for (i = 0; i < cacheCount; i++) {
+                int v = cache[i];
+                if (v != (int) tri[0] && v != (int) tri[1] && v != (int) tri[2]) {
+                    newCache[newCount++] = v;
+                }
+            }
+
+            // 更新缓存中（以及被挤出缓存的）顶点得分，同时找出得分最高的候选三角形
+            float bestScore = -1.0f;
+            bestTri = -1;
+            for (i = 0; i < newCount; i++) {
+                int v = newCache[i];
+                int position = i < FORSYTH_CACHE_SIZE ? i : -1;
+                float score = vertexScore(position, remaining[v]);
+                float delta = score - vScore[v];
+                vScore[v] = score;
+                for (j = 0; j < remaining[v]; j++) {
+                    int t = adjacency[offsets[v] + j];
+                    tScore[t] += delta;
+                }
+            }
+            for (i = 0; i < newCount && i < FORSYTH_CACHE_SIZE; i++) {
+                int v = newCache[i];
+                for (j = 0; j < remaining[v]; j++) {
+                    int t = adjacency[offsets[v] + j];
+                    if (tScore[t] > bestScore) {
+                        bestScore = tScore[t];
+                        bestTri = t;
+                    }
+                }
+            }
+            cacheCount = newCount < FORSYTH_CACHE_SIZE ? newCount : FORSYTH_CACHE_SIZE;
+            memcpy(cache, newCache, sizeof(int) * cacheCount);
+        }
+    }
+    free(block);
+}
+
+void optimizeVertexFetch(GLuint *indices, int numIndices, int numVertices, GLuint *remap) {
+    GLuint next = 0;
+    int i;
+    for (i = 0; i < numVertices; i++) {
+        remap[i] = ~0u;
+    }
+    for (i = 0; i < numIndices; i++) {
+        GLuint v = indices[i];
+        if (remap[v] == ~0u) {
+            remap[v] = next++;
+        }
+        indices[i] = remap[v];
+    }
+    // 没有被引用的顶点放到最后
+    for (i = 0; i < numVertices; i++) {
+        if (remap[i] == ~0u) {
+            remap[i] = next++;
+        }
+    }
+}
+
+void remapVertexStream(void *data, size_t stride, int numVertices, const GLuint *remap) {
+    GLubyte *tmp = (GLubyte *) malloc(stride * numVertices);
+    int i;
+    if (!tmp) {
+        return;
+    }
+    memcpy(tmp, data, stride * numVertices);
+    for (i = 0; i < numVertices; i++) {
+        memcpy((GLubyte *) data + remap[i] * stride, tmp + i * stride, stride);
+    }
+    free(tmp);
+}
+
+void optimizeMesh(GLuint *indices, int numIndices, int numVertices, GLuint *remap,
+                  MeshOptimizeStats *stats) {
+    GLuint *localRemap = NULL;
+    if (stats) {
+        analyzeVertexCache(indices, numIndices, numVertices, VERTEX_CACHE_SIZE, &stats->before);
+    }
+    optimizeVertexCache(indices, indices, numIndices, numVertices);
+    if (!remap) {
+        localRemap = (GLuint *) malloc(sizeof(GLuint) * numVertices);
+        remap = localRemap;
+    }
+    if (remap) {
+        optimizeVertexFetch(indices, numIndices, numVertices, remap);
+    }
+    if (stats) {
+        analyzeVertexCache(indices, numIndices, numVertices, VERTEX_CACHE_SIZE, &stats->after);
+    }
+    free(localRemap);
+}
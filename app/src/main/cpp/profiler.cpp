@@ -0,0 +1,297 @@
+#include <EGL/egl.h>
+#include <GLES3/gl3.h>
+#include <GLES2/gl2ext.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include "include/profiler.h"
+
+#ifndef GL_TIME_ELAPSED_EXT
+#define GL_TIME_ELAPSED_EXT 0x88BF
+#endif
+#ifndef GL_GPU_DISJOINT_EXT
+#define GL_GPU_DISJOINT_EXT 0x8FBB
+#endif
+
+//GPU 样本在 trace 中使用的线程号
+#define GPU_TRACE_TID 0
+
+// 单生产者（所属线程）单消费者（持有 traceMutex 的线程）的环形缓冲区
+typedef struct {
+    ProfileSample samples[PROFILER_RING_SIZE];
+    std::atomic<uint32_t> head;
+    std::atomic<uint32_t> tail;
+    uint32_t tid;
+} ThreadRing;
+
+static std::atomic<ThreadRing *> rings[PROFILER_MAX_THREADS];
+static std::atomic<int> ringCount{0};
+static std::atomic<int> droppedSamples{0};
+static thread_local ThreadRing *localRing;
+static thread_local bool ringRegistered;
+
+static std::mutex traceMutex;
+static ProfileSample traceSamples[PROFILER_TRACE_CAPACITY];
+static uint64_t traceWritten;
+
+// 帧统计，GL 线程写入，JNI 线程读取
+static std::mutex statsMutex;
+static float cpuHistory[PROFILER_FRAME_HISTORY];
+static float gpuHistory[PROFILER_FRAME_HISTORY];
+static int cpuCount;
+static int cpuNext;
+static int gpuCount;
+static int gpuNext;
+// 上次 profilerLastFrameTimes 之后得到了新的 GPU 耗时
+static bool gpuFresh;
+static int gpuDisjoint;
+static int gpuDropped;
+
+// GPU 计时，只在 GL 线程访问
+static PFNGLGETQUERYOBJECTUI64VEXTPROC getQueryObjectui64v;
+static bool gpuTimerEnabled;
+static GLuint gpuQueries[PROFILER_GPU_QUERIES];
+static bool gpuIssued[PROFILER_GPU_QUERIES];
+static uint64_t gpuFrameBegin[PROFILER_GPU_QUERIES];
+static unsigned frameIndex;
+static uint64_t frameBeginNs;
+static uint32_t glThreadTid;
+
+uint64_t profilerNowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+}
+
+// 线程第一次记录样本时注册自己的环形缓冲区，线程退出后缓冲区保留，供导出使用
+static ThreadRing *threadRing() {
+    if (!ringRegistered) {
+        ringRegistered = true;
+        int index = ringCount.fetch_add(1, std::memory_order_relaxed);
+        if (index < PROFILER_MAX_THREADS) {
+            ThreadRing *ring = new ThreadRing();
+            ring->tid = (uint32_t) gettid();
+            rings[index].store(ring, std::memory_order_release);
+            localRing = ring;
+        }
+    }
+    return localRing;
+}
+
+void profilerRecord(const char *name, uint64_t beginNs, uint64_t endNs) {
+    ThreadRing *ring = threadRing();
+    if (!ring) {
+        droppedSamples.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    uint32_t head = ring->head.load(std::memory_order_relaxed);
+    uint32_t tail = ring->tail.load(std::memory_order_acquire);
+    if (head - tail >= PROFILER_RING_SIZE) {
+        droppedSamples.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    ProfileSample *sample = &ring->samples[head & (PROFILER_RING_SIZE - 1)];
+    sample->name = name;
+    sample->beginNs = beginNs;
+    sample->endNs = endNs;
+    sample->tid = ring->tid;
+    ring->head.store(head + 1, std::memory_order_release);
+}
+
+// 调用方需要持有 traceMutex
+static void appendTrace(const ProfileSample *sample) {
+    traceSamples[traceWritten % PROFILER_TRACE_CAPACITY] = *sample;
+    traceWritten++;
+}
+
+static void drainRings() {
+    int count = std::min(ringCount.load(std::memory_order_relaxed), PROFILER_MAX_THREADS);
+    int i;
+    for (i = 0; i < count; i++) {
+        ThreadRing *ring = rings[i].load(std::memory_order_acquire);
+        if (!ring) {
+            continue;
+        }
+        uint32_t head = ring->head.load(std::memory_order_acquire);
+        uint32_t tail = ring->tail.load(std::memory_order_relaxed);
+        for (; tail != head; tail++) {
+            appendTrace(&ring->samples[tail & (PROFILER_RING_SIZE - 1)]);
+        }
+        ring->tail.store(tail, std::memory_order_release);
+    }
+}
+
+static void pushHistory(float *history, int *count, int *next, float value) {
+    history[*next] = value;
+    *next = (*next + 1) % PROFILER_FRAME_HISTORY;
+    if (*count < PROFILER_FRAME_HISTORY) {
+        (*count)++;
+    }
+}
+
+void profilerInit() {
+    glThreadTid = (uint32_t) gettid();
+    // 上下文重建后旧的查询对象已经失效
+    memset(gpuIssued, 0, sizeof(gpuIssued));
+    gpuTimerEnabled = false;
+    if (hasGlExtension("GL_EXT_disjoint_timer_query")) {
+        getQueryObjectui64v = (PFNGLGETQUERYOBJECTUI64VEXTPROC) eglGetProcAddress(
+                "glGetQueryObjectui64vEXT");
+        if (getQueryObjectui64v) {
+            glGenQueries(PROFILER_GPU_QUERIES, gpuQueries);
+            gpuTimerEnabled = true;
+        }
+    }
+    ALOGD("GPU timer %s", gpuTimerEnabled ? "enabled" : "not supported");
+}
+
+// 读取一个查询的结果，结果还不可用时返回 false，不等待
+static bool collectGpuQuery(int slot) {
+    GLuint available = GL_FALSE;
+    GLint disjoint = GL_FALSE;
+    GLuint64 elapsed = 0;
+    glGetQueryObjectuiv(gpuQueries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) {
+        return false;
+    }
+    gpuIssued[slot] = false;
+    // 发生 disjoint 时本次查询的结果不可信
+    glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+    if (disjoint) {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        gpuDisjoint++;
+        return true;
+    }
+    getQueryObjectui64v(gpuQueries[slot], GL_QUERY_RESULT, &elapsed);
+    {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        pushHistory(gpuHistory, &gpuCount, &gpuNext, (float) elapsed / 1e6f);
+        gpuFresh = true;
+    }
+    ProfileSample sample = {"gpu frame", gpuFrameBegin[slot], gpuFrameBegin[slot] + elapsed,
+                            GPU_TRACE_TID};
+    std::lock_guard<std::mutex> lock(traceMutex);
+    appendTrace(&sample);
+    return true;
+}
+
+// 从最早的帧开始读取已经完成的查询，查询按提交顺序完成，遇到未完成的就停止；
+// 即将复用的查询仍未完成时丢弃它
+static void collectGpuQueries() {
+    unsigned i;
+    for (i = PROFILER_GPU_QUERIES; i > 0; i--) {
+        if (i > frameIndex) {
+            continue;
+        }
+        int slot = (frameIndex - i) % PROFILER_GPU_QUERIES;
+        if (gpuIssued[slot] && !collectGpuQuery(slot)) {
+            break;
+        }
+    }
+    int slot = frameIndex % PROFILER_GPU_QUERIES;
+    if (gpuIssued[slot]) {
+        gpuIssued[slot] = false;
+        std::lock_guard<std::mutex> lock(statsMutex);
+        gpuDropped++;
+    }
+}
+
+void profilerBeginFrame() {
+    frameBeginNs = profilerNowNs();
+    if (gpuTimerEnabled) {
+        int slot = frameIndex % PROFILER_GPU_QUERIES;
+        collectGpuQueries();
+        glBeginQuery(GL_TIME_ELAPSED_EXT, gpuQueries[slot]);
+        gpuFrameBegin[slot] = frameBeginNs;
+    }
+}
+
+void profilerEndFrame() {
+    uint64_t endNs = profilerNowNs();
+    if (gpuTimerEnabled) {
+        glEndQuery(GL_TIME_ELAPSED_EXT);
+        gpuIssued[frameIndex % PROFILER_GPU_QUERIES] = true;
+    }
+    frameIndex++;
+    profilerRecord("frame", frameBeginNs, endNs);
+    {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        pushHistory(cpuHistory, &cpuCount, &cpuNext, (float) (endNs - frameBeginNs) / 1e6f);
+    }
+    std::lock_guard<std::mutex> lock(traceMutex);
+    drainRings();
+}
+
+// 最近秩法计算分位数
+static void percentiles(const float *history, int count, float *p50, float *p95, float *p99) {
+    float sorted[PROFILER_FRAME_HISTORY];
+    memcpy(sorted, history, sizeof(float) * count);
+    std::sort(sorted, sorted + count);
+    *p50 = sorted[(int) ceilf(0.50f * count) - 1];
+    *p95 = sorted[(int) ceilf(0.95f * count) - 1];
+    *p99 = sorted[(int) ceilf(0.99f * count) - 1];
+}
+
+bool profilerGetFrameStats(ProfileFrameStats *stats) {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    memset(stats, 0, sizeof(ProfileFrameStats));
+    stats->droppedSamples = droppedSamples.load(std::memory_order_relaxed);
+    stats->gpuDisjoint = gpuDisjoint;
+    stats->gpuDropped = gpuDropped;
+    if (cpuCount == 0) {
+        return false;
+    }
+    stats->frames = cpuCount;
+    percentiles(cpuHistory, cpuCount, &stats->cpuP50, &stats->cpuP95, &stats->cpuP99);
+    stats->gpuFrames = gpuCount;
+    if (gpuCount > 0) {
+        percentiles(gpuHistory, gpuCount, &stats->gpuP50, &stats->gpuP95, &stats->gpuP99);
+    }
+    return true;
+}
+
+void profilerLastFrameTimes(float *cpuMs, float *gpuMs) {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    *cpuMs = cpuCount > 0 ? cpuHistory[(cpuNext + PROFILER_FRAME_HISTORY - 1) % PROFILER_FRAME_HISTORY]
+                          : -1.0f;
+    *gpuMs = gpuFresh ? gpuHistory[(gpuNext + PROFILER_FRAME_HISTORY - 1) % PROFILER_FRAME_HISTORY]
+                      : -1.0f;
+    gpuFresh = false;
+}
+
+static void writeThreadName(FILE *file, uint32_t tid, const char *name) {
+    fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,"
+                  "\"args\":{\"name\":\"%s\"}},\n", tid, name);
+}
+
+bool profilerExportTrace(const char *path) {
+    FILE *file = fopen(path, "w");
+    uint64_t first;
+    uint64_t i;
+    if (!file) {
+        ALOGE("Could not open %s", path);
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(traceMutex);
+    drainRings();
+    first = traceWritten > PROFILER_TRACE_CAPACITY ? traceWritten - PROFILER_TRACE_CAPACITY : 0;
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    writeThreadName(file, GPU_TRACE_TID, "GPU");
+    if (glThreadTid) {
+        writeThreadName(file, glThreadTid, "GL");
+    }
+    for (i = first; i < traceWritten; i++) {
+        const ProfileSample *sample = &traceSamples[i % PROFILER_TRACE_CAPACITY];
+        fprintf(file, "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,"
+                      "\"ts\":%.3f,\"dur\":%.3f},\n",
+                sample->name, sample->tid, (double) sample->beginNs / 1e3,
+                (double) (sample->endNs - sample->beginNs) / 1e3);
+    }
+    // JSON 数组最后一项不能带逗号，用进程名元数据事件结尾
+    fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,"
+                  "\"args\":{\"name\":\"glndk\"}}\n]}\n");
+    return fclose(file) == 0;
+}
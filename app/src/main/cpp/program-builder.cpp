@@ -0,0 +1,389 @@
+#include <EGL/egl.h>
+#include <GLES3/gl3.h>
+#include <GLES2/gl2ext.h>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "include/program-builder.h"
+#include "include/program-cache.h"
+
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+typedef enum {
+    STAGE_QUEUED,        // 等待工作线程编译
+    STAGE_COMPILING,     // 已提交给驱动并行编译
+    STAGE_LINKED,        // 工作线程已链接，等待 fence
+    STAGE_READY,
+    STAGE_FAILED,
+} BuildStage;
+
+typedef struct {
+    char *vtxSrc;
+    char *fragSrc;
+    GLuint vtxShader;
+    GLuint fragShader;
+    GLuint program;
+    GLsync fence;
+    bool retrievable;
+    BuildStage stage;
+} BuildEntry;
+
+static ProgramBuildMode buildMode = PROGRAM_BUILD_SYNC;
+static GLuint placeholder;
+static BuildEntry entries[MAX_BUILD_PROGRAMS];
+static int entryCount;
+static int pendingCount;
+
+// 工作线程及其共享上下文，entries 中 stage/program/fence 的读写都在 mutex 保护下进行
+static std::thread worker;
+static std::mutex mutex;
+static std::condition_variable wake;
+static int nextQueued;
+static bool stopping;
+static EGLDisplay workerDisplay = EGL_NO_DISPLAY;
+static EGLContext workerContext = EGL_NO_CONTEXT;
+static EGLSurface workerSurface = EGL_NO_SURFACE;
+
+static char *copyString(const char *src) {
+    size_t len = strlen(src) + 1;
+    char *dst = (char *) malloc(len);
+    if (dst) {
+        memcpy(dst, src, len);
+    }
+    return dst;
+}
+
+static void logInfoLog(GLuint object, bool isShader) {
+    GLint length = 0;
+    if (isShader) {
+        glGetShaderiv(object, GL_INFO_LOG_LENGTH, &length);
+    } else {
+        glGetProgramiv(object, GL_INFO_LOG_LENGTH, &length);
+    }
+    if (length <= 0) {
+        return;
+    }
+    GLchar *infoLog = (GLchar *) malloc(length);
+    if (!infoLog) {
+        return;
+    }
+    if (isShader) {
+        glGetShaderInfoLog(object, length, NULL, infoLog);
+    } else {
+        glGetProgramInfoLog(object, length, NULL, infoLog);
+    }
+    ALOGE("Could not build program:\n%s\n", infoLog);
+    free(infoLog);
+}
+
+static void workerLoop() {
+    eglMakeCurrent(workerDisplay, workerSurface, workerSurface, workerContext);
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        wake.wait(lock, [] { return stopping || nextQueued < entryCount; });
+        if (stopping) {
+            break;
+        }
+        BuildEntry *entry = &entries[nextQueued++];
+        if (entry->stage != STAGE_QUEUED) {
+            // 命中缓存或同步编译的项
+            continue;
+        }
+        lock.unlock();
+        // 工作线程可以直接查询编译/链接状态，阻塞的只是这个线程
+        GLuint program = createProgram(entry->vtxSrc, entry->fragSrc, entry->retrievable);
+        GLsync fence = program ? glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0) : 0;
+        glFlush();
+        lock.lock();
+        entry->program = program;
+        entry->fence = fence;
+        entry->stage = program ? STAGE_LINKED : STAGE_FAILED;
+    }
+    lock.unlock();
+    eglMakeCurrent(workerDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglReleaseThread();
+}
+
+// 用当前上下文的配置创建一个共享上下文，不支持 surfaceless 时使用 1x1 pbuffer
+static bool createWorkerContext() {
+    EGLDisplay display = eglGetCurrentDisplay();
+    EGLContext shared = eglGetCurrentContext();
+    EGLint configId = 0;
+    EGLint numConfigs = 0;
+    EGLConfig config;
+    if (display == EGL_NO_DISPLAY || shared == EGL_NO_CONTEXT ||
+        !eglQueryContext(display, shared, EGL_CONFIG_ID, &configId)) {
+        return false;
+    }
+    const EGLint configAttribs[] = {EGL_CONFIG_ID, configId, EGL_NONE};
+    if (!eglChooseConfig(display, configAttribs, &config, 1, &numConfigs) || numConfigs != 1) {
+        return false;
+    }
+    const EGLint contextAttribs[] = {EGL_CONTEXT_CLIENT_VERSION, 3, EGL_NONE};
+    workerContext = eglCreateContext(display, config, shared, contextAttribs);
+    if (workerContext == EGL_NO_CONTEXT) {
+        return false;
+    }
+    const char *extensions = eglQueryString(display, EGL_EXTENSIONS);
+    if (!extensions || !strstr(extensions, "EGL_KHR_surfaceless_context")) {
+        const EGLint surfaceAttribs[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+        workerSurface = eglCreatePbufferSurface(display, config, surfaceAttribs);
+        if (workerSurface == EGL_NO_SURFACE) {
+            eglDestroyContext(display, workerContext);
+            workerContext = EGL_NO_CONTEXT;
+            return false;
+        }
+    }
+    workerDisplay = display;
+    return true;
+}
+
+static void stopWorker() {
+    if (worker.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_one();
+        worker.join();
+    }
+    if (workerSurface != EGL_NO_SURFACE) {
+        eglDestroySurface(workerDisplay, workerSurface);
+    }
+    if (workerContext != EGL_NO_CONTEXT) {
+        eglDestroyContext(workerDisplay, workerContext);
+    }
+    workerDisplay = EGL_NO_DISPLAY;
+    workerContext = EGL_NO_CONTEXT;
+    workerSurface = EGL_NO_SURFACE;
+    stopping = false;
+}
+
+// deleteObjects 为 false 时只释放内存，用于上下文已经丢失的情况
+static void resetEntries(bool deleteObjects) {
+    int i;
+    for (i = 0; i < entryCount; i++) {
+        BuildEntry *entry = &entries[i];
+        if (deleteObjects) {
+            if (entry->fence) {
+                glDeleteSync(entry->fence);
+            }
+            glDeleteShader(entry->vtxShader);
+            glDeleteShader(entry->fragShader);
+            glDeleteProgram(entry->program);
+        }
+        free(entry->vtxSrc);
+        free(entry->fragSrc);
+    }
+    memset(entries, 0, sizeof(entries));
+    entryCount = 0;
+    nextQueued = 0;
+    pendingCount = 0;
+}
+
+bool programBuilderInit(const char *placeholderVtx, const char *placeholderFrag) {
+    // GL 上下文重建后旧的程序已随上下文释放，只清理线程和内存
+    stopWorker();
+    resetEntries(false);
+    placeholder = createProgramCached(placeholderVtx, placeholderFrag);
+    if (!placeholder) {
+        return false;
+    }
+    if (hasGlExtension("GL_KHR_parallel_shader_compile")) {
+        PFNGLMAXSHADERCOMPILERTHREADSKHRPROC maxShaderCompilerThreads =
+                (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC) eglGetProcAddress(
+                        "glMaxShaderCompilerThreadsKHR");
+        if (maxShaderCompilerThreads) {
+            // 不限制驱动使用的编译线程数
+            maxShaderCompilerThreads(0xFFFFFFFFu);
+        }
+        buildMode = PROGRAM_BUILD_PARALLEL_KHR;
+    } else if (createWorkerContext()) {
+        worker = std::thread(workerLoop);
+        buildMode = PROGRAM_BUILD_WORKER;
+    } else {
+        buildMode = PROGRAM_BUILD_SYNC;
+    }
+    ALOGD("program build mode %d", buildMode);
+    return true;
+}
+
+// 构建完成后源码只在保存缓存时还需要
+static void finishEntry(BuildEntry *entry, bool linked) {
+    if (linked) {
+        entry->stage = STAGE_READY;
+        storeProgramCached(entry->vtxSrc, entry->fragSrc, entry->program);
+    } else {
+        glDeleteProgram(entry->program);
+        entry->program = 0;
+        entry->stage = STAGE_FAILED;
+    }
+    free(entry->vtxSrc);
+    free(entry->fragSrc);
+    entry->vtxSrc = NULL;
+    entry->fragSrc = NULL;
+    pendingCount--;
+}
+
+static void submitParallel(BuildEntry *entry) {
+    const char *vtxSrc = entry->vtxSrc;
+    const char *fragSrc = entry->fragSrc;
+    entry->vtxShader = glCreateShader(GL_VERTEX_SHADER);
+    entry->fragShader = glCreateShader(GL_FRAGMENT_SHADER);
+    entry->program = glCreateProgram();
+    glShaderSource(entry->vtxShader, 1, &vtxSrc, NULL);
+    glShaderSource(entry->fragShader, 1, &fragSrc, NULL);
+    glCompileShader(entry->vtxShader);
+    glCompileShader(entry->fragShader);
+    glAttachShader(entry->program, entry->vtxShader);
+    glAttachShader(entry->program, entry->fragShader);
+    if (entry->retrievable) {
+        glProgramParameteri(entry->program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+    // 链接可以在编译完成前提交，这里不查询任何状态
+    glLinkProgram(entry->program);
+    entry->stage = STAGE_COMPILING;
+}
+
+ProgramHandle programBuilderSubmit(const char *vtxSrc, const char *fragSrc) {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (entryCount >= MAX_BUILD_PROGRAMS) {
+        ALOGE("Too many programs");
+        return -1;
+    }
+    ProgramHandle handle = entryCount;
+    BuildEntry *entry = &entries[handle];
+    memset(entry, 0, sizeof(BuildEntry));
+    entry->program = loadProgramCached(vtxSrc, fragSrc);
+    if (entry->program) {
+        entry->stage = STAGE_READY;
+        entryCount++;
+        return handle;
+    }
+    entry->vtxSrc = copyString(vtxSrc);
+    entry->fragSrc = copyString(fragSrc);
+    if (!entry->vtxSrc || !entry->fragSrc) {
+        free(entry->vtxSrc);
+        free(entry->fragSrc);
+        memset(entry, 0, sizeof(BuildEntry));
+        return -1;
+    }
+    entry->retrievable = isProgramCacheEnabled();
+    entryCount++;
+    switch (buildMode) {
+        case PROGRAM_BUILD_PARALLEL_KHR:
+            submitParallel(entry);
+            pendingCount++;
+            break;
+        case PROGRAM_BUILD_WORKER:
+            entry->stage = STAGE_QUEUED;
+            pendingCount++;
+            lock.unlock();
+            wake.notify_one();
+            break;
+        default:
+            entry->program = createProgram(entry->vtxSrc, entry->fragSrc, entry->retrievable);
+            pendingCount++;
+            finishEntry(entry, entry->program != 0);
+            break;
+    }
+    return handle;
+}
+
+static void pollParallel(BuildEntry *entry) {
+    GLint completed = GL_FALSE;
+    GLint linked = GL_FALSE;
+    glGetProgramiv(entry->program, GL_COMPLETION_STATUS_KHR, &completed);
+    if (!completed) {
+        return;
+    }
+    glGetProgramiv(entry->program, GL_LINK_STATUS, &linked);
+    if (!linked) {
+        GLint compiled = GL_FALSE;
+        glGetShaderiv(entry->vtxShader, GL_COMPILE_STATUS, &compiled);
+        if (!compiled) {
+            logInfoLog(entry->vtxShader, true);
+        }
+        glGetShaderiv(entry->fragShader, GL_COMPILE_STATUS, &compiled);
+        if (!compiled) {
+            logInfoLog(entry->fragShader, true);
+        }
+        logInfoLog(entry->program, false);
+    }
+    glDeleteShader(entry->vtxShader);
+    glDeleteShader(entry->fragShader);
+    entry->vtxShader = 0;
+    entry->fragShader = 0;
+    finishEntry(entry, linked == GL_TRUE);
+}
+
+static void pollWorker(BuildEntry *entry) {
+    GLenum status = glClientWaitSync(entry->fence, 0, 0);
+    if (status == GL_TIMEOUT_EXPIRED) {
+        return;
+    }
+    glDeleteSync(entry->fence);
+    entry->fence = 0;
+    finishEntry(entry, status != GL_WAIT_FAILED);
+}
+
+void programBuilderPoll() {
+    int i;
+    if (pendingCount == 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    for (i = 0; i < entryCount; i++) {
+        BuildEntry *entry = &entries[i];
+        if (entry->stage == STAGE_COMPILING) {
+            pollParallel(entry);
+        } else if (entry->stage == STAGE_LINKED) {
+            pollWorker(entry);
+        } else if (entry->stage == STAGE_FAILED && entry->vtxSrc) {
+            // 工作线程编译失败的项
+            finishEntry(entry, false);
+        }
+    }
+}
+
+ProgramState programBuilderState(ProgramHandle handle) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (handle < 0 || handle >= entryCount) {
+        return PROGRAM_FAILED;
+    }
+    switch (entries[handle].stage) {
+        case STAGE_READY:
+            return PROGRAM_READY;
+        case STAGE_FAILED:
+            return entries[handle].vtxSrc ? PROGRAM_PENDING : PROGRAM_FAILED;
+        default:
+            return PROGRAM_PENDING;
+    }
+}
+
+GLuint programBuilderGet(ProgramHandle handle) {
+    // 工作线程会同时修改其他状态的 stage，读取也要加锁
+    std::lock_guard<std::mutex> lock(mutex);
+    if (handle >= 0 && handle < entryCount && entries[handle].stage == STAGE_READY) {
+        return entries[handle].program;
+    }
+    return placeholder;
+}
+
+int programBuilderPendingCount() {
+    return pendingCount;
+}
+
+ProgramBuildMode programBuilderMode() {
+    return buildMode;
+}
+
+void programBuilderRelease() {
+    stopWorker();
+    resetEntries(true);
+    glDeleteProgram(placeholder);
+    placeholder = 0;
+    buildMode = PROGRAM_BUILD_SYNC;
+}
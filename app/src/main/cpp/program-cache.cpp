@@ -0,0 +1,311 @@
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <atomic>
+#include "include/program-cache.h"
+
+#define CACHE_MAGIC 0x43504c47u   // "GLPC"
+#define CACHE_VERSION 1u
+#define CACHE_SUFFIX ".bin"
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+    uint32_t binaryFormat;
+    uint32_t length;
+} CacheHeader;
+
+typedef struct {
+    char name[32];
+    off_t size;
+    time_t mtime;
+} CacheEntry;
+
+static char cacheDir[PATH_MAX];
+static size_t cacheMaxBytes;
+static bool cacheEnabled = false;
+//drainGlErrors 最多读取的错误数，上下文丢失时 glGetError 可能一直返回错误
+#define MAX_DRAINED_ERRORS 8
+
+// 缓存可能在 GL 线程和着色器编译线程同时使用，统计用原子变量，读取时复制到 ProgramCacheStats
+typedef struct {
+    std::atomic<int> hits;
+    std::atomic<int> misses;
+    std::atomic<int> rejected;
+    std::atomic<int> evictions;
+    std::atomic<size_t> bytes;
+} CacheCounters;
+
+static CacheCounters cacheStats;
+
+uint64_t fnv1a64(uint64_t hash, const void *data, size_t size) {
+    const unsigned char *bytes = (const unsigned char *) data;
+    size_t i;
+    for (i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static uint64_t hashString(uint64_t hash, const char *str) {
+    // 连同结尾的 '\0' 一起计算，避免 "ab"+"c" 与 "a"+"bc" 相同
+    if (!str) {
+        str = "";
+    }
+    return fnv1a64(hash, str, strlen(str) + 1);
+}
+
+static uint64_t programKey(const char *vtxSrc, const char *fragSrc) {
+    uint64_t hash = FNV_OFFSET_BASIS;
+    hash = hashString(hash, vtxSrc);
+    hash = hashString(hash, fragSrc);
+    hash = hashString(hash, (const char *) glGetString(GL_VENDOR));
+    hash = hashString(hash, (const char *) glGetString(GL_RENDERER));
+    hash = hashString(hash, (const char *) glGetString(GL_VERSION));
+    return hash;
+}
+
+static void entryPath(char *path, size_t size, uint64_t key, const char *suffix) {
+    snprintf(path, size, "%s/%016llx%s", cacheDir, (unsigned long long) key, suffix);
+}
+
+static int compareEntryTime(const void *a, const void *b) {
+    time_t ta = ((const CacheEntry *) a)->mtime;
+    time_t tb = ((const CacheEntry *) b)->mtime;
+    return ta < tb ? -1 : (ta > tb ? 1 : 0);
+}
+
+// glProgramBinary 被拒绝时可能产生 GL 错误（如 GL_INVALID_ENUM），
+// 不清除的话会被之后的 checkGlError 报告到无关的调用上
+static void drainGlErrors() {
+    int i;
+    for (i = 0; i < MAX_DRAINED_ERRORS; i++) {
+        GLenum err = glGetError();
+        if (err == GL_NO_ERROR) {
+            break;
+        }
+        ALOGD("glProgramBinary rejected: GL error 0x%04x", err);
+    }
+}
+
+// 统计缓存目录大小，超过上限时从最久未使用的开始删除
+static void evictEntries() {
+    DIR *dir = opendir(cacheDir);
+    CacheEntry *entries = NULL;
+    int count = 0;
+    int capacity = 0;
+    size_t total = 0;
+    struct dirent *ent;
+    char path[PATH_MAX];
+    int i;
+    if (!dir) {
+        return;
+    }
+    while ((ent = readdir(dir)) != NULL) {
+        size_t len = strlen(ent->d_name);
+        struct stat st;
+        if (len <= strlen(CACHE_SUFFIX) || len >= sizeof(entries->name) ||
+            strcmp(ent->d_name + len - strlen(CACHE_SUFFIX), CACHE_SUFFIX) != 0) {
+            continue;
+        }
+        snprintf(path, sizeof(path), "%s/%s", cacheDir, ent->d_name);
+        if (stat(path, &st) != 0) {
+            continue;
+        }
+        if (count == capacity) {
+            capacity = capacity ? capacity * 2 : 16;
+            CacheEntry *grown = (CacheEntry *) realloc(entries, sizeof(CacheEntry) * capacity);
+            if (!grown) {
+                break;
+            }
+            entries = grown;
+        }
+        memcpy(entries[count].name, ent->d_name, len + 1);
+        entries[count].size = st.st_size;
+        entries[count].mtime = st.st_mtime;
+        total += st.st_size;
+        count++;
+    }
+    closedir(dir);
+    if (total > cacheMaxBytes) {
+        qsort(entries, count, sizeof(CacheEntry), compareEntryTime);
+        for (i = 0; i < count && total > cacheMaxBytes; i++) {
+            snprintf(path, sizeof(path), "%s/%s", cacheDir, entries[i].name);
+            if (unlink(path) == 0) {
+                total -= entries[i].size;
+                cacheStats.evictions++;
+            }
+        }
+    }
+    cacheStats.bytes = total;
+    free(entries);
+}
+
+static GLuint loadFromCache(uint64_t key) {
+    char path[PATH_MAX];
+    struct stat st;
+    GLuint program = 0;
+    GLint linked = GL_FALSE;
+    entryPath(path, sizeof(path), key, CACHE_SUFFIX);
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return 0;
+    }
+    if (fstat(fd, &st) != 0 || st.st_size <= (off_t) sizeof(CacheHeader)) {
+        close(fd);
+        unlink(path);
+        return 0;
+    }
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return 0;
+    }
+    const CacheHeader *header = (const CacheHeader *) map;
+    if (header->magic == CACHE_MAGIC && header->version == CACHE_VERSION &&
+        header->key == key && sizeof(CacheHeader) + header->length == (size_t) st.st_size) {
+        program = glCreateProgram();
+        glProgramBinary(program, header->binaryFormat, header + 1, header->length);
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        if (!linked) {
+            drainGlErrors();
+            glDeleteProgram(program);
+            program = 0;
+        }
+    }
+    munmap(map, st.st_size);
+    if (!program) {
+        // 格式不对或驱动已经不接受这份二进制，删掉后重新编译
+        cacheStats.rejected++;
+        unlink(path);
+        return 0;
+    }
+    // 更新 mtime 作为最近使用时间
+    utimensat(AT_FDCWD, path, NULL, 0);
+    return program;
+}
+
+static void storeToCache(uint64_t key, GLuint program) {
+    char path[PATH_MAX];
+    char tmpPath[PATH_MAX];
+    GLint length = 0;
+    GLsizei written = 0;
+    GLenum format = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return;
+    }
+    entryPath(path, sizeof(path), key, CACHE_SUFFIX);
+    entryPath(tmpPath, sizeof(tmpPath), key, ".tmp");
+    int fd = open(tmpPath, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        return;
+    }
+    size_t size = sizeof(CacheHeader) + length;
+    if (ftruncate(fd, size) != 0) {
+        close(fd);
+        unlink(tmpPath);
+        return;
+    }
+    void *map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        close(fd);
+        unlink(tmpPath);
+        return;
+    }
+    // 驱动直接把二进制写进映射的文件，不经过中间缓冲区
+    CacheHeader *header = (CacheHeader *) map;
+    glGetProgramBinary(program, length, &written, &format, header + 1);
+    header->magic = CACHE_MAGIC;
+    header->version = CACHE_VERSION;
+    header->key = key;
+    header->binaryFormat = format;
+    header->length = (uint32_t) written;
+    munmap(map, size);
+    if (written <= 0) {
+        close(fd);
+        unlink(tmpPath);
+        return;
+    }
+    if ((GLint) written != length) {
+        ftruncate(fd, sizeof(CacheHeader) + written);
+    }
+    close(fd);
+    // 先写临时文件再改名，进程中途被杀也不会留下不完整的缓存
+    if (rename(tmpPath, path) != 0) {
+        unlink(tmpPath);
+        return;
+    }
+    evictEntries();
+}
+
+bool programCacheInit(const char *dir, size_t maxBytes) {
+    GLint numFormats = 0;
+    cacheEnabled = false;
+    if (!dir || strlen(dir) >= sizeof(cacheDir)) {
+        return false;
+    }
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+    if (numFormats <= 0) {
+        ALOGD("program binary not supported, cache disabled");
+        return false;
+    }
+    if (mkdir(dir, 0700) != 0 && errno != EEXIST) {
+        ALOGE("Could not create program cache dir %s: %d", dir, errno);
+        return false;
+    }
+    strcpy(cacheDir, dir);
+    cacheMaxBytes = maxBytes;
+    cacheEnabled = true;
+    evictEntries();
+    return true;
+}
+
+bool isProgramCacheEnabled() {
+    return cacheEnabled;
+}
+
+GLuint loadProgramCached(const char *vtxSrc, const char *fragSrc) {
+    GLuint program;
+    if (!cacheEnabled) {
+        return 0;
+    }
+    program = loadFromCache(programKey(vtxSrc, fragSrc));
+    if (program) {
+        cacheStats.hits++;
+    } else {
+        cacheStats.misses++;
+    }
+    return program;
+}
+
+void storeProgramCached(const char *vtxSrc, const char *fragSrc, GLuint program) {
+    if (cacheEnabled && program) {
+        storeToCache(programKey(vtxSrc, fragSrc), program);
+    }
+}
+
+GLuint createProgramCached(const char *vtxSrc, const char *fragSrc) {
+    GLuint program = loadProgramCached(vtxSrc, fragSrc);
+    if (program) {
+        return program;
+    }
+    program = createProgram(vtxSrc, fragSrc, cacheEnabled);
+    storeProgramCached(vtxSrc, fragSrc, program);
+    return program;
+}
+
+void programCacheGetStats(ProgramCacheStats *stats) {
+    stats->hits = cacheStats.hits.load(std::memory_order_relaxed);
+    stats->misses = cacheStats.misses.load(std::memory_order_relaxed);
+    stats->rejected = cacheStats.rejected.load(std::memory_order_relaxed);
+    stats->evictions = cacheStats.evictions.load(std::memory_order_relaxed);
+    stats->bytes = cacheStats.bytes.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,160 @@
+#include "include/render-queue.h"
+
+#define KEY_FIELD_BITS 12
+#define KEY_FIELD_MASK ((1u << KEY_FIELD_BITS) - 1)
+#define KEY_DEPTH_BITS 28
+
+uint64_t makeSortKey(GLuint program, GLuint texture, GLuint vao, float depth) {
+    uint32_t depthBits = 0;
+    if (depth > 0.0f) {
+        // 非负浮点数的位模式与数值同序，取高 28 位
+        memcpy(&depthBits, &depth, sizeof(depthBits));
+        depthBits >>= 32 - KEY_DEPTH_BITS;
+    }
+    return ((uint64_t) (program & KEY_FIELD_MASK) << (KEY_DEPTH_BITS + 2 * KEY_FIELD_BITS)) |
+           ((uint64_t) (texture & KEY_FIELD_MASK) << (KEY_DEPTH_BITS + KEY_FIELD_BITS)) |
+           ((uint64_t) (vao & KEY_FIELD_MASK) << KEY_DEPTH_BITS) |
+           (uint64_t) depthBits;
+}
+
+bool renderQueueInit(RenderQueue *queue, int capacity) {
+    memset(queue, 0, sizeof(RenderQueue));
+    queue->items = (DrawItem *) malloc(sizeof(DrawItem) * capacity);
+    queue->entries = (SortEntry *) malloc(sizeof(SortEntry) * capacity);
+    queue->scratch = (SortEntry *) malloc(sizeof(SortEntry) * capacity);
+    if (!queue->items || !queue->entries || !queue->scratch) {
+        renderQueueRelease(queue);
+        return false;
+    }
+    queue->capacity = capacity;
+    // 0 是合法的绑定（例如不使用纹理），初始状态不能用 0 表示
+    renderQueueResetState(queue);
+    return true;
+}
+
+void renderQueueRelease(RenderQueue *queue) {
+    free(queue->items);
+    free(queue->entries);
+    free(queue->scratch);
+    memset(queue, 0, sizeof(RenderQueue));
+}
+
+bool renderQueueSubmit(RenderQueue *queue, const DrawItem *item) {
+    if (queue->count >= queue->capacity) {
+        return false;
+    }
+    DrawItem *dst = &queue->items[queue->count];
+    *dst = *item;
+    dst->sortKey = makeSortKey(item->program, item->texture, item->vao, item->depth);
+    queue->entries[queue->count].key = dst->sortKey;
+    queue->entries[queue->count].index = (uint32_t) queue->count;
+    queue->count++;
+    return true;
+}
+
+void drawItemFromMesh(DrawItem *item, const MeshBuffer *mesh, GLuint program, GLuint texture,
+                      float depth) {
+    memset(item, 0, sizeof(DrawItem));
+    item->program = program;
+    item->vao = mesh->vao;
+    item->texture = texture;
+    item->depth = depth;
+    item->mode = GL_TRIANGLES;
+    if (mesh->indexCount > 0) {
+        item->count = mesh->indexCount;
+        item->indexType = mesh->indexType;
+    } else {
+        item->count = mesh->vertexCount;
+    }
+    item->instanceCount = 1;
+}
+
+void renderQueueSort(RenderQueue *queue) {
+    SortEntry *src = queue->entries;
+    SortEntry *dst = queue->scratch;
+    int count = queue->count;
+    int pass, i;
+    if (count < 2) {
+        return;
+    }
+    // LSD 基数排序，每趟 8 位；所有键在某一字节上相同时跳过该趟
+    for (pass = 0; pass < 8; pass++) {
+        int shift = pass * 8;
+        int histogram[256] = {0};
+        for (i = 0; i < count; i++) {
+            histogram[(src[i].key >> shift) & 0xff]++;
+        }
+        if (histogram[(src[0].key >> shift) & 0xff] == count) {
+            continue;
+        }
+        int offset = 0;
+        for (i = 0; i < 256; i++) {
+            int n = histogram[i];
+            histogram[i] = offset;
+            offset += n;
+        }
+        for (i = 0; i < count; i++) {
+            dst[histogram[(src[i].key >> shift) & 0xff]++] = src[i];
+        }
+        SortEntry *tmp = src;
+        src = dst;
+        dst = tmp;
+    }
+    queue->entries = src;
+    queue->scratch = dst;
+}
+
+void renderQueueFlush(RenderQueue *queue) {
+    RenderQueueStats *stats = &queue->stats;
+    int i;
+    memset(stats, 0, sizeof(RenderQueueStats));
+    renderQueueSort(queue);
+    for (i = 0; i < queue->count; i++) {
+        const DrawItem *item = &queue->items[queue->entries[i].index];
+        if (item->program != queue->currentProgram) {
+            glUseProgram(item->program);
+            queue->currentProgram = item->program;
+            stats->programBinds++;
+        } else {
+            stats->programBindsSkipped++;
+        }
+        if (item->texture != queue->currentTexture) {
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, item->texture);
+            queue->currentTexture = item->texture;
+            stats->textureBinds++;
+        } else {
+            stats->textureBindsSkipped++;
+        }
+        if (item->vao != queue->currentVao) {
+            glBindVertexArray(item->vao);
+            queue->currentVao = item->vao;
+            stats->vaoBinds++;
+        } else {
+            stats->vaoBindsSkipped++;
+        }
+        if (item->indexType) {
+            if (item->instanceCount > 1) {
+                glDrawElementsInstanced(item->mode, item->count, item->indexType,
+                                        (const void *) 0, item->instanceCount);
+            } else {
+                glDrawElements(item->mode, item->count, item->indexType, (const void *) 0);
+            }
+        } else {
+            if (item->instanceCount > 1) {
+                glDrawArraysInstanced(item->mode, 0, item->count, item->instanceCount);
+            } else {
+                glDrawArrays(item->mode, 0, item->count);
+            }
+        }
+        stats->draws++;
+    }
+    queue->count = 0;
+}
+
+void renderQueueResetState(RenderQueue *queue) {
+    // ~0 不是合法的对象名，保证下一次回放时重新绑定
+    queue->currentProgram = ~0u;
+    queue->currentVao = ~0u;
+    queue->currentTexture = ~0u;
+}
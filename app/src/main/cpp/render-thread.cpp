@@ -0,0 +1,376 @@
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <future>
+#include "include/render-thread.h"
+#include "include/program-builder.h"
+#include "include/texture-streamer.h"
+#include "include/profiler.h"
+
+//渲染队列的容量，一帧的绘制请求超过容量时提前回放
+#define RENDER_QUEUE_CAPACITY 256
+
+RenderThread::RenderThread() {
+    int i;
+    memset(&renderQueue, 0, sizeof(renderQueue));
+    memset(&resolution, 0, sizeof(resolution));
+    scaledFramebufferInit(&scaledTarget, true);
+    for (i = 0; i < MAX_COMMAND_CHANNELS; i++) {
+        channels[i].store(NULL, std::memory_order_relaxed);
+    }
+}
+
+RenderThread::~RenderThread() {
+    int i;
+    stop();
+    for (i = 0; i < MAX_COMMAND_CHANNELS; i++) {
+        delete channels[i].load(std::memory_order_relaxed);
+    }
+}
+
+bool RenderThread::start(ANativeWindow *nativeWindow) {
+    if (thread.joinable()) {
+        return false;
+    }
+    std::promise<bool> created;
+    std::future<bool> result = created.get_future();
+    stopping.store(false);
+    thread = std::thread([this, nativeWindow, &created]() {
+        bool ok = createContext(nativeWindow);
+        created.set_value(ok);
+        if (ok) {
+            run();
+        }
+    });
+    if (!result.get()) {
+        thread.join();
+        return false;
+    }
+    return true;
+}
+
+void RenderThread::stop(void (*cleanup)(void *data), void *data) {
+    if (!thread.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopCleanup = cleanup;
+        stopCleanupData = data;
+        stopping.store(true);
+    }
+    wake.notify_one();
+    thread.join();
+}
+
+void RenderThread::enableAdaptiveResolution(float budgetMs) {
+    ResolutionConfig config;
+    if (thread.joinable()) {
+        return;
+    }
+    resolutionConfigDefault(&config, budgetMs);
+    resolutionControllerInit(&resolution, &config);
+    adaptiveResolution = true;
+    currentScale.store(resolution.scale, std::memory_order_relaxed);
+}
+
+CommandChannel *RenderThread::channel() {
+    std::thread::id self = std::this_thread::get_id();
+    CommandChannel *found;
+    int i;
+    for (i = 0; i < MAX_COMMAND_CHANNELS; i++) {
+        found = channels[i].load(std::memory_order_acquire);
+        if (found && found->owner() == self) {
+            return found;
+        }
+    }
+    // 只有注册新通道时加锁，渲染线程读取通道数组不加锁
+    std::lock_guard<std::mutex> lock(registerMutex);
+    for (i = 0; i < MAX_COMMAND_CHANNELS; i++) {
+        if (!channels[i].load(std::memory_order_relaxed)) {
+            found = new CommandChannel(self);
+            channels[i].store(found, std::memory_order_release);
+            return found;
+        }
+    }
+    ALOGE("Too many producer threads (max %d)", MAX_COMMAND_CHANNELS);
+    return NULL;
+}
+
+bool RenderThread::submit(CommandChannel *channel, CommandBuffer *buffer) {
+    // 先计数再入队，渲染线程看到的已提交数不会少于已执行数
+    submittedBuffers.fetch_add(1);
+    if (!channel->submit(buffer)) {
+        submittedBuffers.fetch_sub(1);
+        return false;
+    }
+    // submittedBuffers 与 sleeping 都是顺序一致的原子操作：
+    // 渲染线程要么在休眠前看到新的计数，要么已经置位 sleeping，此时加锁通知不会丢失
+    if (sleeping.load()) {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        wake.notify_one();
+    }
+    return true;
+}
+
+void RenderThread::run() {
+    for (;;) {
+        if (drainChannels() > 0) {
+            continue;
+        }
+        if (stopping.load()) {
+            break;
+        }
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        sleeping.store(true);
+        wake.wait(lock, [this] {
+            return submittedBuffers.load() != executedBuffers || stopping.load();
+        });
+        sleeping.store(false);
+    }
+    if (stopCleanup) {
+        stopCleanup(stopCleanupData);
+    }
+    destroyContext();
+}
+
+bool RenderThread::createContext(ANativeWindow *nativeWindow) {
+    const EGLint configAttribs[] = {
+            EGL_RENDERABLE_TYPE, EGL_OPENGL_ES3_BIT_KHR,
+            EGL_SURFACE_TYPE, EGL_WINDOW_BIT,
+            EGL_RED_SIZE, 8,
+            EGL_GREEN_SIZE, 8,
+            EGL_BLUE_SIZE, 8,
+            EGL_DEPTH_SIZE, 16,
+            EGL_NONE
+    };
+    const EGLint contextAttribs[] = {EGL_CONTEXT_CLIENT_VERSION, 3, EGL_NONE};
+    EGLConfig config;
+    EGLint numConfigs = 0;
+    EGLint format;
+    display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, NULL, NULL)) {
+        ALOGE("eglInitialize failed: 0x%x", eglGetError());
+        goto fail;
+    }
+    if (!eglChooseConfig(display, configAttribs, &config, 1, &numConfigs) || numConfigs < 1) {
+        ALOGE("No matching EGLConfig");
+        goto fail;
+    }
+    // 窗口缓冲区格式与 EGLConfig 一致
+    eglGetConfigAttrib(display, config, EGL_NATIVE_VISUAL_ID, &format);
+    ANativeWindow_setBuffersGeometry(nativeWindow, 0, 0, format);
+    surface = eglCreateWindowSurface(display, config, nativeWindow, NULL);
+    if (surface == EGL_NO_SURFACE) {
+        ALOGE("eglCreateWindowSurface failed: 0x%x", eglGetError());
+        goto fail;
+    }
+    context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttribs);
+    if (context == EGL_NO_CONTEXT) {
+        ALOGE("eglCreateContext failed: 0x%x", eglGetError());
+        goto fail;
+    }
+    if (!eglMakeCurrent(display, surface, surface, context)) {
+        ALOGE("eglMakeCurrent failed: 0x%x", eglGetError());
+        goto fail;
+    }
+    if (!renderQueueInit(&renderQueue, RENDER_QUEUE_CAPACITY)) {
+        goto fail;
+    }
+    profilerInit();
+    window = nativeWindow;
+    ANativeWindow_acquire(window);
+    return true;
+
+    fail:
+    destroyContext();
+    return false;
+}
+
+void RenderThread::destroyContext() {
+    if (renderQueue.items) {
+        renderQueueRelease(&renderQueue);
+    }
+    if (scaledTarget.fbo) {
+        scaledFramebufferRelease(&scaledTarget);
+    }
+    if (display != EGL_NO_DISPLAY) {
+        eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if (context != EGL_NO_CONTEXT) {
+            eglDestroyContext(display, context);
+        }
+        if (surface != EGL_NO_SURFACE) {
+            eglDestroySurface(display, surface);
+        }
+        // 默认 display 可能还被其他上下文使用，不调用 eglTerminate
+        eglReleaseThread();
+    }
+    if (window) {
+        ANativeWindow_release(window);
+    }
+    display = EGL_NO_DISPLAY;
+    surface = EGL_NO_SURFACE;
+    context = EGL_NO_CONTEXT;
+    window = NULL;
+    inFrame = false;
+    scaledFrame = false;
+    frameStreamCount = 0;
+}
+
+int RenderThread::drainChannels() {
+    int executed = 0;
+    int i;
+    for (i = 0; i < MAX_COMMAND_CHANNELS; i++) {
+        CommandChannel *channel = channels[i].load(std::memory_order_acquire);
+        CommandBuffer *buffer;
+        if (!channel) {
+            continue;
+        }
+        while ((buffer = channel->acquire()) != NULL) {
+            execute(buffer);
+            channel->recycle(buffer);
+            executed++;
+        }
+    }
+    executedBuffers += executed;
+    return executed;
+}
+
+void RenderThread::submitDraw(const DrawItem *item) {
+    if (!renderQueueSubmit(&renderQueue, item)) {
+        // 队列已满，先回放已有的请求
+        renderQueueFlush(&renderQueue);
+        renderQueueSubmit(&renderQueue, item);
+    }
+}
+
+void RenderThread::beginScaledFrame() {
+    EGLint width = 0;
+    EGLint height = 0;
+    eglQuerySurface(display, surface, EGL_WIDTH, &width);
+    eglQuerySurface(display, surface, EGL_HEIGHT, &height);
+    // 分配失败时本帧直接画到窗口
+    scaledFrame = width > 0 && height > 0 &&
+                  scaledFramebufferResize(&scaledTarget, width, height, resolution.scale);
+    if (scaledFrame) {
+        scaledFramebufferBind(&scaledTarget);
+        applyViewport();
+    }
+}
+
+void RenderThread::applyViewport() {
+    if (!scaledFrame) {
+        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    } else if (viewport[2] > 0 && viewport[3] > 0) {
+        scaledFramebufferViewport(&scaledTarget, viewport[0], viewport[1], viewport[2],
+                                  viewport[3]);
+    } else {
+        glViewport(0, 0, scaledTarget.width, scaledTarget.height);
+    }
+}
+
+void RenderThread::execute(const CommandBuffer *buffer) {
+    DrawItem item;
+    int i;
+    for (i = 0; i < buffer->count; i++) {
+        const RenderCommand *command = &buffer->commands[i];
+        // 一帧中第一条绘制相关的命令开始计时，并检查异步编译的程序和流式加载的纹理
+        if (!inFrame && command->type != CMD_CALL && command->type != CMD_VIEWPORT &&
+            command->type != CMD_CLEAR_COLOR) {
+            inFrame = true;
+            profilerBeginFrame();
+            if (adaptiveResolution) {
+                beginScaledFrame();
+            }
+            {
+                PROFILE_SCOPE("programBuilderPoll");
+                programBuilderPoll();
+            }
+            {
+                PROFILE_SCOPE("textureStreamerPoll");
+                textureStreamerPoll();
+                // 上传纹理时改变了纹理绑定
+                renderQueueResetState(&renderQueue);
+            }
+        }
+        switch (command->type) {
+            case CMD_CALL:
+                command->call.fn(command->call.data);
+                // 回调中可能直接修改了绑定状态
+                renderQueueResetState(&renderQueue);
+                break;
+            case CMD_VIEWPORT:
+                viewport[0] = command->viewport.x;
+                viewport[1] = command->viewport.y;
+                viewport[2] = command->viewport.width;
+                viewport[3] = command->viewport.height;
+                // 两帧之间收到时先按窗口设置，下一帧开始时再换算到离屏帧缓冲区
+                applyViewport();
+                break;
+            case CMD_CLEAR_COLOR:
+                glClearColor(command->clearColor.color[0], command->clearColor.color[1],
+                             command->clearColor.color[2], command->clearColor.color[3]);
+                break;
+            case CMD_CLEAR:
+                glClear(command->clear.mask);
+                break;
+            case CMD_DRAW_MESH:
+                drawItemFromMesh(&item, command->draw.mesh,
+                                 programBuilderGet(*command->draw.program),
+                                 command->draw.texture, command->draw.depth);
+                submitDraw(&item);
+                break;
+            case CMD_DRAW_INSTANCES: {
+                const DrawInstancesCommand *draw = &command->instances;
+                // 记不下 fence 的段不能绘制，否则录制线程可能覆盖 GPU 正在读取的数据
+                if (frameStreamCount == MAX_FRAME_STREAMS) {
+                    break;
+                }
+                // 没有可见实例时也登记该段，CMD_PRESENT 照常为它插入 fence
+                frameStreams[frameStreamCount] = draw->stream;
+                frameSegments[frameStreamCount] = draw->segment;
+                frameStreamCount++;
+                if (draw->count <= 0) {
+                    break;
+                }
+                // 上传（非持久映射时）并把实例属性指向该段，修改了 VAO 绑定
+                instanceStreamSubmit(draw->stream, draw->segment, draw->count);
+                renderQueueResetState(&renderQueue);
+                drawItemFromMesh(&item, draw->stream->mesh, programBuilderGet(*draw->program), 0,
+                                 draw->depth);
+                item.instanceCount = draw->count;
+                submitDraw(&item);
+                break;
+            }
+            case CMD_PRESENT: {
+                {
+                    PROFILE_SCOPE("renderQueueFlush");
+                    renderQueueFlush(&renderQueue);
+                }
+                for (int s = 0; s < frameStreamCount; s++) {
+                    instanceStreamEndFrame(frameStreams[s], frameSegments[s]);
+                }
+                frameStreamCount = 0;
+                if (scaledFrame) {
+                    // 放大计入本帧的 GPU 计时
+                    PROFILE_SCOPE("scaledFramebufferBlit");
+                    scaledFramebufferBlit(&scaledTarget);
+                }
+                profilerEndFrame();
+                inFrame = false;
+                if (scaledFrame) {
+                    float cpuMs, gpuMs;
+                    profilerLastFrameTimes(&cpuMs, &gpuMs);
+                    currentScale.store(resolutionControllerUpdate(&resolution, cpuMs, gpuMs),
+                                       std::memory_order_relaxed);
+                    scaledFrame = false;
+                }
+                // 交换缓冲区可能等待垂直同步，只阻塞渲染线程，不影响录制下一帧的线程
+                if (!eglSwapBuffers(display, surface)) {
+                    ALOGE("eglSwapBuffers failed: 0x%x", eglGetError());
+                }
+                presentedFrames.fetch_add(1, std::memory_order_relaxed);
+                break;
+            }
+        }
+    }
+}
@@ -0,0 +1,128 @@
+#include <math.h>
+#include <string.h>
+#include "include/resolution-controller.h"
+
+static float clampf(float value, float low, float high) {
+    return value < low ? low : (value > high ? high : value);
+}
+
+void resolutionConfigDefault(ResolutionConfig *config, float budgetMs) {
+    config->budgetMs = budgetMs;
+    config->minScale = 0.5f;
+    config->maxScale = 1.0f;
+    config->scaleStep = 0.05f;
+    config->lowWater = 0.75f;
+    config->kp = 0.8f;
+    config->ki = 0.2f;
+    config->kd = 0.1f;
+    config->window = 8;
+    config->settleFrames = 3;
+    config->sustainFrames = 24;
+}
+
+void resolutionControllerInit(ResolutionController *controller, const ResolutionConfig *config) {
+    memset(controller, 0, sizeof(ResolutionController));
+    controller->config = *config;
+    if (controller->config.window < 1) {
+        controller->config.window = 1;
+    } else if (controller->config.window > RESOLUTION_WINDOW) {
+        controller->config.window = RESOLUTION_WINDOW;
+    }
+    controller->scale = config->maxScale;
+}
+
+static float quantize(const ResolutionConfig *config, float scale) {
+    if (config->scaleStep > 0.0f) {
+        scale = roundf(scale / config->scaleStep) * config->scaleStep;
+    }
+    return clampf(scale, config->minScale, config->maxScale);
+}
+
+static void resetWindow(ResolutionController *controller) {
+    controller->sampleCount = 0;
+    controller->sampleNext = 0;
+    controller->integral = 0.0f;
+    controller->lastError = 0.0f;
+    controller->overCount = 0;
+}
+
+float resolutionControllerUpdate(ResolutionController *controller, float cpuMs, float gpuMs) {
+    const ResolutionConfig *config = &controller->config;
+    float frameMs = cpuMs;
+    float average = 0.0f;
+    float error, derivative, area, scale;
+    int i;
+    controller->stats.frames++;
+    if (cpuMs > config->budgetMs || gpuMs > config->budgetMs) {
+        controller->stats.overBudget++;
+    }
+    if (gpuMs >= 0.0f) {
+        // 第一次得到 GPU 耗时：窗口中是 CPU 耗时，清空后只用 GPU 耗时
+        if (!controller->gpuTimed) {
+            controller->gpuTimed = true;
+            resetWindow(controller);
+        }
+        frameMs = gpuMs;
+    } else if (controller->gpuTimed) {
+        // 这一帧没有新的 GPU 耗时（结果还没有可用或被丢弃），不用 CPU 耗时代替
+        return controller->scale;
+    }
+    if (controller->settle > 0) {
+        controller->settle--;
+        return controller->scale;
+    }
+    controller->samples[controller->sampleNext] = frameMs;
+    controller->sampleNext = (controller->sampleNext + 1) % config->window;
+    if (controller->sampleCount < config->window) {
+        controller->sampleCount++;
+    }
+    if (controller->sampleCount < config->window) {
+        return controller->scale;
+    }
+    for (i = 0; i < config->window; i++) {
+        average += controller->samples[i];
+    }
+    average /= (float) config->window;
+    controller->stats.averageMs = average;
+
+    if (average > config->budgetMs) {
+        controller->overCount++;
+    } else {
+        controller->overCount = 0;
+    }
+    // 正值表示还有余量
+    error = (config->budgetMs - average) / config->budgetMs;
+    if (average <= config->budgetMs && average >= config->budgetMs * config->lowWater) {
+        controller->integral = 0.0f;
+        controller->lastError = error;
+        return controller->scale;
+    }
+    // 窗口满后每帧评估一次，积分按窗口长度折算；限幅避免长时间饱和（已在 minScale/maxScale）后反应迟钝
+    controller->integral = clampf(controller->integral + error / (float) config->window, -1.0f,
+                                  1.0f);
+    derivative = error - controller->lastError;
+    controller->lastError = error;
+    area = controller->scale * controller->scale *
+           (1.0f + config->kp * error + config->ki * controller->integral + config->kd * derivative);
+    scale = quantize(config, sqrtf(fmaxf(area, 0.0f)));
+    if (scale < controller->scale && controller->overCount < config->sustainFrames) {
+        return controller->scale;
+    }
+    if (scale > controller->scale &&
+        average * scale * scale / (controller->scale * controller->scale) > config->budgetMs) {
+        return controller->scale;
+    }
+    if (scale == controller->scale) {
+        return controller->scale;
+    }
+    if (scale > controller->scale) {
+        controller->stats.increases++;
+    } else {
+        controller->stats.decreases++;
+    }
+    // 窗口中是旧分辨率的耗时，清空后重新收集
+    controller->scale = scale;
+    resetWindow(controller);
+    controller->settle = config->settleFrames;
+    return scale;
+}
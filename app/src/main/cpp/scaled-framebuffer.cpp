@@ -0,0 +1,96 @@
+#include <GLES3/gl3.h>
+#include <math.h>
+#include "include/scaled-framebuffer.h"
+
+void scaledFramebufferInit(ScaledFramebuffer *target, bool depth) {
+    memset(target, 0, sizeof(ScaledFramebuffer));
+    target->hasDepth = depth;
+}
+
+static GLsizei scaledSize(GLsizei size, float scale) {
+    GLsizei result = (GLsizei) lroundf((float) size * scale);
+    return result > 0 ? result : 1;
+}
+
+bool scaledFramebufferResize(ScaledFramebuffer *target, GLsizei surfaceWidth, GLsizei surfaceHeight,
+                             float scale) {
+    GLsizei width = scaledSize(surfaceWidth, scale);
+    GLsizei height = scaledSize(surfaceHeight, scale);
+    GLenum status;
+    if (target->fbo && width == target->width && height == target->height) {
+        target->surfaceWidth = surfaceWidth;
+        target->surfaceHeight = surfaceHeight;
+        target->scale = scale;
+        return true;
+    }
+    if (!target->fbo) {
+        glGenFramebuffers(1, &target->fbo);
+        glGenRenderbuffers(1, &target->color);
+        if (target->hasDepth) {
+            glGenRenderbuffers(1, &target->depth);
+        }
+    }
+    // 渲染缓冲区重新分配存储后需要重新挂接
+    glBindRenderbuffer(GL_RENDERBUFFER, target->color);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    if (target->depth) {
+        glBindRenderbuffer(GL_RENDERBUFFER, target->depth);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT16, width, height);
+    }
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, target->fbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, target->color);
+    if (target->depth) {
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER,
+                                  target->depth);
+    }
+    status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        ALOGE("Scaled framebuffer %dx%d incomplete: 0x%x\n", width, height, status);
+        return false;
+    }
+    target->surfaceWidth = surfaceWidth;
+    target->surfaceHeight = surfaceHeight;
+    target->width = width;
+    target->height = height;
+    target->scale = scale;
+    return true;
+}
+
+void scaledFramebufferBind(const ScaledFramebuffer *target) {
+    glBindFramebuffer(GL_FRAMEBUFFER, target->fbo);
+}
+
+void scaledFramebufferViewport(const ScaledFramebuffer *target, GLint x, GLint y, GLsizei width,
+                               GLsizei height) {
+    // 按实际缩放比例换算，取整后的离屏大小与 scale 可能略有差别
+    float sx = (float) target->width / (float) target->surfaceWidth;
+    float sy = (float) target->height / (float) target->surfaceHeight;
+    glViewport((GLint) lroundf((float) x * sx), (GLint) lroundf((float) y * sy),
+               (GLsizei) lroundf((float) width * sx), (GLsizei) lroundf((float) height * sy));
+}
+
+void scaledFramebufferBlit(const ScaledFramebuffer *target) {
+    static const GLenum attachments[] = {GL_COLOR_ATTACHMENT0, GL_DEPTH_ATTACHMENT};
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, target->fbo);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    glBlitFramebuffer(0, 0, target->width, target->height, 0, 0, target->surfaceWidth,
+                      target->surfaceHeight, GL_COLOR_BUFFER_BIT,
+                      target->width == target->surfaceWidth ? GL_NEAREST : GL_LINEAR);
+    // 下一帧会先清除，离屏内容不需要保留
+    glBindFramebuffer(GL_FRAMEBUFFER, target->fbo);
+    glInvalidateFramebuffer(GL_FRAMEBUFFER, target->depth ? 2 : 1, attachments);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void scaledFramebufferRelease(ScaledFramebuffer *target) {
+    if (target->fbo) {
+        glDeleteFramebuffers(1, &target->fbo);
+        glDeleteRenderbuffers(1, &target->color);
+        if (target->depth) {
+            glDeleteRenderbuffers(1, &target->depth);
+        }
+    }
+    scaledFramebufferInit(target, target->hasDepth);
+}
@@ -0,0 +1,284 @@
+#include <algorithm>
+#include "include/scene-graph.h"
+
+#define SCENE_LOCAL_DIRTY 1
+#define SCENE_UPDATED 2
+
+static Matrix *allocMatrices(int count) {
+    Matrix *ptr = NULL;
+    if (posix_memalign((void **) &ptr, 16, sizeof(Matrix) * (count > 0 ? count : 1)) != 0) {
+        return NULL;
+    }
+    return ptr;
+}
+
+bool sceneGraphInit(SceneGraph *graph, int capacity) {
+    memset(graph, 0, sizeof(SceneGraph));
+    if (capacity <= 0) {
+        return false;
+    }
+    graph->local = allocMatrices(capacity);
+    graph->world = allocMatrices(capacity);
+    graph->parent = (int *) malloc(sizeof(int) * capacity);
+    graph->depth = (int *) malloc(sizeof(int) * capacity);
+    graph->firstChild = (int *) malloc(sizeof(int) * capacity);
+    graph->childCount = (int *) malloc(sizeof(int) * capacity);
+    graph->flags = (uint8_t *) calloc(capacity, 1);
+    graph->slotNode = (SceneNode *) malloc(sizeof(SceneNode) * capacity);
+    graph->nodeSlot = (int *) malloc(sizeof(int) * capacity);
+    graph->dirtyNodes = (SceneNode *) malloc(sizeof(SceneNode) * capacity);
+    graph->queue = (int *) malloc(sizeof(int) * capacity);
+    if (!graph->local || !graph->world || !graph->parent || !graph->depth || !graph->firstChild ||
+        !graph->childCount || !graph->flags || !graph->slotNode || !graph->nodeSlot ||
+        !graph->dirtyNodes || !graph->queue) {
+        sceneGraphRelease(graph);
+        return false;
+    }
+    graph->capacity = capacity;
+    return true;
+}
+
+void sceneGraphRelease(SceneGraph *graph) {
+    free(graph->local);
+    free(graph->world);
+    free(graph->parent);
+    free(graph->depth);
+    free(graph->firstChild);
+    free(graph->childCount);
+    free(graph->flags);
+    free(graph->slotNode);
+    free(graph->nodeSlot);
+    free(graph->dirtyNodes);
+    free(graph->queue);
+    memset(graph, 0, sizeof(SceneGraph));
+}
+
+static void markDirty(SceneGraph *graph, int slot) {
+    if (graph->flags[slot] & SCENE_LOCAL_DIRTY) {
+        return;
+    }
+    graph->flags[slot] |= SCENE_LOCAL_DIRTY;
+    graph->dirtyNodes[graph->dirtyCount++] = graph->slotNode[slot];
+}
+
+SceneNode sceneNodeCreate(SceneGraph *graph, SceneNode parent) {
+    int slot = graph->count;
+    if (slot >= graph->capacity) {
+        ALOGE("Scene graph is full (%d nodes)\n", graph->capacity);
+        return -1;
+    }
+    // 新节点暂时追加在最后，子节点的范围在更新前重新排序时建立
+    graph->count++;
+    graph->orderDirty = true;
+    matrixLoadIdentity(&graph->local[slot]);
+    matrixLoadIdentity(&graph->world[slot]);
+    graph->parent[slot] = parent >= 0 ? graph->nodeSlot[parent] : -1;
+    graph->depth[slot] = parent >= 0 ? graph->depth[graph->nodeSlot[parent]] + 1 : 0;
+    graph->firstChild[slot] = 0;
+    graph->childCount[slot] = 0;
+    graph->flags[slot] = 0;
+    graph->slotNode[slot] = slot;
+    graph->nodeSlot[slot] = slot;
+    markDirty(graph, slot);
+    return slot;
+}
+
+void sceneNodeSetLocal(SceneGraph *graph, SceneNode node, const Matrix *local) {
+    int slot = graph->nodeSlot[node];
+    graph->local[slot] = *local;
+    markDirty(graph, slot);
+}
+
+void sceneNodeSetTransform(SceneGraph *graph, SceneNode node, const float position[3],
+                           const float axis[3], float angle, float scaling) {
+    int slot = graph->nodeSlot[node];
+    Matrix *local = &graph->local[slot];
+    // 变换函数左乘，最后调用的最先作用于顶点
+    matrixLoadIdentity(local);
+    translate(local, position[0], position[1], position[2]);
+    if (angle != 0.0f) {
+        rotate(local, angle, axis[0], axis[1], axis[2]);
+    }
+    scale(local, scaling, scaling, scaling);
+    markDirty(graph, slot);
+}
+
+const Matrix *sceneNodeLocal(const SceneGraph *graph, SceneNode node) {
+    return &graph->local[graph->nodeSlot[node]];
+}
+
+const Matrix *sceneNodeWorld(const SceneGraph *graph, SceneNode node) {
+    return &graph->world[graph->nodeSlot[node]];
+}
+
+// 按广度优先重新排列所有数组，只在创建节点后的第一次更新时执行
+static bool sortBreadthFirst(SceneGraph *graph) {
+    int count = graph->count;
+    int capacity = graph->capacity;
+    Matrix *local = allocMatrices(capacity);
+    Matrix *world = allocMatrices(capacity);
+    int *parent = (int *) malloc(sizeof(int) * capacity);
+    int *depth = (int *) malloc(sizeof(int) * capacity);
+    int *firstChild = (int *) malloc(sizeof(int) * capacity);
+    int *childCount = (int *) malloc(sizeof(int) * capacity);
+    uint8_t *flags = (uint8_t *) calloc(capacity, 1);
+    SceneNode *slotNode = (SceneNode *) malloc(sizeof(SceneNode) * capacity);
+    int *childStart = (int *) calloc(count + 1, sizeof(int));
+    int *children = (int *) malloc(sizeof(int) * capacity);
+    int *newSlot = (int *) malloc(sizeof(int) * capacity);
+    int *order = graph->queue;
+    bool ok = false;
+    int i, k, n;
+    if (!local || !world || !parent || !depth || !firstChild || !childCount || !flags ||
+        !slotNode || !childStart || !children || !newSlot) {
+        ALOGE("Could not reorder scene graph\n");
+        goto done;
+    }
+    // 按父节点分组的子节点列表，同一父节点的子节点保持创建顺序；newSlot 暂时作为写入位置
+    for (i = 0; i < count; i++) {
+        if (graph->parent[i] >= 0) {
+            childStart[graph->parent[i] + 1]++;
+        }
+    }
+    for (i = 0; i < count; i++) {
+        childStart[i + 1] += childStart[i];
+        newSlot[i] = childStart[i];
+    }
+    for (i = 0; i < count; i++) {
+        if (graph->parent[i] >= 0) {
+            children[newSlot[graph->parent[i]]++] = i;
+        }
+    }
+    n = 0;
+    for (i = 0; i < count; i++) {
+        if (graph->parent[i] < 0) {
+            order[n++] = i;
+        }
+    }
+    for (i = 0; i < n; i++) {
+        for (k = childStart[order[i]]; k < childStart[order[i] + 1]; k++) {
+            order[n++] = children[k];
+        }
+    }
+    for (i = 0; i < count; i++) {
+        newSlot[order[i]] = i;
+    }
+    for (i = 0; i < count; i++) {
+        int old = order[i];
+        local[i] = graph->local[old];
+        world[i] = graph->world[old];
+        parent[i] = graph->parent[old] >= 0 ? newSlot[graph->parent[old]] : -1;
+        depth[i] = graph->depth[old];
+        // 子节点在广度优先的顺序中连续，第一个子节点的新位置即范围的起点
+        childCount[i] = childStart[old + 1] - childStart[old];
+        firstChild[i] = childCount[i] > 0 ? newSlot[children[childStart[old]]] : 0;
+        flags[i] = graph->flags[old];
+        slotNode[i] = graph->slotNode[old];
+        graph->nodeSlot[slotNode[i]] = i;
+    }
+    std::swap(local, graph->local);
+    std::swap(world, graph->world);
+    std::swap(parent, graph->parent);
+    std::swap(depth, graph->depth);
+    std::swap(firstChild, graph->firstChild);
+    std::swap(childCount, graph->childCount);
+    std::swap(flags, graph->flags);
+    std::swap(slotNode, graph->slotNode);
+    graph->orderDirty = false;
+    graph->stats.reorders++;
+    ok = true;
+
+done:
+    // 成功时释放的是旧的数组
+    free(local);
+    free(world);
+    free(parent);
+    free(depth);
+    free(firstChild);
+    free(childCount);
+    free(flags);
+    free(slotNode);
+    free(childStart);
+    free(children);
+    free(newSlot);
+    return ok;
+}
+
+// 计算 queue[begin, end) 中节点的世界矩阵，它们的父节点都在之前的层，已经计算完成
+static void updateRange(SceneGraph *graph, int begin, int end) {
+    const int *queue = graph->queue;
+    int i;
+    for (i = begin; i < end; i++) {
+        int slot = queue[i];
+        int p = graph->parent[slot];
+        if (p < 0) {
+            graph->world[slot] = graph->local[slot];
+        } else {
+            matrixMultiply(&graph->world[slot], &graph->local[slot], &graph->world[p]);
+        }
+        graph->flags[slot] |= SCENE_UPDATED;
+    }
+}
+
+int sceneGraphUpdate(SceneGraph *graph, ThreadPool *pool) {
+    int *seeds = graph->dirtyNodes;
+    int *queue = graph->queue;
+    int seedCount = graph->dirtyCount;
+    int next = 0;
+    int begin = 0;
+    int end = 0;
+    int level = 0;
+    int i, k;
+    if (seedCount == 0) {
+        graph->stats.skipped++;
+        graph->stats.lastUpdated = 0;
+        return 0;
+    }
+    if (graph->orderDirty && !sortBreadthFirst(graph)) {
+        return 0;
+    }
+    // 槽的顺序即深度的顺序，排序后按层取出修改过的节点
+    for (i = 0; i < seedCount; i++) {
+        seeds[i] = graph->nodeSlot[seeds[i]];
+    }
+    std::sort(seeds, seeds + seedCount);
+    while (begin < end || next < seedCount) {
+        if (begin == end) {
+            level = graph->depth[seeds[next]];
+        }
+        // queue[begin, end) 为上一层计算过的节点的子节点；父节点计算过的修改节点已经在其中
+        for (; next < seedCount && graph->depth[seeds[next]] == level; next++) {
+            int p = graph->parent[seeds[next]];
+            if (p < 0 || !(graph->flags[p] & SCENE_UPDATED)) {
+                queue[end++] = seeds[next];
+            }
+        }
+        if (pool && end - begin >= SCENE_PARALLEL_GRAIN * 2) {
+            pool->parallelFor(begin, end, SCENE_PARALLEL_GRAIN, [graph](int chunkBegin, int chunkEnd) {
+                updateRange(graph, chunkBegin, chunkEnd);
+            });
+        } else {
+            updateRange(graph, begin, end);
+        }
+        k = end;
+        for (i = begin; i < k; i++) {
+            int slot = queue[i];
+            int child = graph->firstChild[slot];
+            int last = child + graph->childCount[slot];
+            for (; child < last; child++) {
+                queue[end++] = child;
+            }
+        }
+        begin = k;
+        level++;
+    }
+    // 所有修改过的节点都进入过队列
+    for (i = 0; i < end; i++) {
+        graph->flags[queue[i]] = 0;
+    }
+    graph->dirtyCount = 0;
+    graph->stats.updates++;
+    graph->stats.nodesUpdated += end;
+    graph->stats.lastUpdated = end;
+    return end;
+}
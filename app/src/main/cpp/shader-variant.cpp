@@ -0,0 +1,268 @@
+#include <ctype.h>
+#include "include/shader-variant.h"
+#include "include/program-cache.h"
+
+typedef struct {
+    char *vtxSrc;
+    char *fragSrc;
+    int featureCount;
+    char *names[MAX_SHADER_FEATURES];
+    char *values[MAX_SHADER_FEATURES];
+    ShaderFeatures vtxUsed;    // 顶点着色器中出现的特性
+    ShaderFeatures fragUsed;
+} TemplateEntry;
+
+// 查找表的键：高 32 位为模板句柄加 1，低 32 位为去掉未使用特性后的掩码，0 表示空位
+typedef struct {
+    uint64_t key;
+    ProgramHandle program;
+} VariantSlot;
+
+// 已提交的程序，按两个阶段源码的哈希去重
+typedef struct {
+    uint64_t hash;
+    ProgramHandle program;
+} VariantProgram;
+
+static TemplateEntry templates[MAX_SHADER_TEMPLATES];
+static int templateCount;
+static VariantSlot table[SHADER_VARIANT_TABLE_SIZE];
+static int variantCount;
+static VariantProgram programs[MAX_BUILD_PROGRAMS];
+static int programCount;
+static ShaderVariantStats variantStats;
+
+static char *copyString(const char *src) {
+    size_t len = strlen(src) + 1;
+    char *dst = (char *) malloc(len);
+    if (dst) {
+        memcpy(dst, src, len);
+    }
+    return dst;
+}
+
+static bool isIdentifierChar(char c) {
+    return isalnum((unsigned char) c) || c == '_';
+}
+
+// 按完整的标识符查找，避免 COLOR 匹配到 VERTEX_COLOR
+static bool containsIdentifier(const char *src, const char *name) {
+    size_t len = strlen(name);
+    const char *p = src;
+    while ((p = strstr(p, name)) != NULL) {
+        if ((p == src || !isIdentifierChar(p[-1])) && !isIdentifierChar(p[len])) {
+            return true;
+        }
+        p += len;
+    }
+    return false;
+}
+
+static void freeTemplate(TemplateEntry *entry) {
+    int i;
+    free(entry->vtxSrc);
+    free(entry->fragSrc);
+    for (i = 0; i < entry->featureCount; i++) {
+        free(entry->names[i]);
+        free(entry->values[i]);
+    }
+    memset(entry, 0, sizeof(TemplateEntry));
+}
+
+ShaderTemplate shaderTemplateCreate(const char *vtxSrc, const char *fragSrc,
+                                    const ShaderFeature *features, int featureCount) {
+    TemplateEntry *entry;
+    int i;
+    if (templateCount >= MAX_SHADER_TEMPLATES) {
+        ALOGE("Too many shader templates");
+        return -1;
+    }
+    if (featureCount < 0 || featureCount > MAX_SHADER_FEATURES) {
+        ALOGE("Too many shader features: %d\n", featureCount);
+        return -1;
+    }
+    entry = &templates[templateCount];
+    memset(entry, 0, sizeof(TemplateEntry));
+    entry->vtxSrc = copyString(vtxSrc);
+    entry->fragSrc = copyString(fragSrc);
+    if (!entry->vtxSrc || !entry->fragSrc) {
+        goto fail;
+    }
+    for (i = 0; i < featureCount; i++) {
+        entry->featureCount = i + 1;
+        entry->names[i] = copyString(features[i].name);
+        entry->values[i] = features[i].value ? copyString(features[i].value) : NULL;
+        if (!entry->names[i] || (features[i].value && !entry->values[i])) {
+            goto fail;
+        }
+        if (containsIdentifier(vtxSrc, features[i].name)) {
+            entry->vtxUsed |= 1u << i;
+        }
+        if (containsIdentifier(fragSrc, features[i].name)) {
+            entry->fragUsed |= 1u << i;
+        }
+        if (!((entry->vtxUsed | entry->fragUsed) & (1u << i))) {
+            ALOGD("Shader feature %s is not used by its template\n", features[i].name);
+        }
+    }
+    return templateCount++;
+
+fail:
+    freeTemplate(entry);
+    return -1;
+}
+
+// 在 #version 行之后插入 used 中已启用特性的 #define，再用 #line 恢复原来的行号，编译错误仍指向模板中的行
+static char *assembleStage(const TemplateEntry *entry, const char *src, ShaderFeatures features) {
+    const char *body = src;
+    size_t size = strlen(src) + 32;
+    int i;
+    for (i = 0; i < entry->featureCount; i++) {
+        if (features & (1u << i)) {
+            size += strlen("#define  \n") + strlen(entry->names[i]) +
+                    (entry->values[i] ? strlen(entry->values[i]) : 0);
+        }
+    }
+    char *dst = (char *) malloc(size);
+    if (!dst) {
+        return NULL;
+    }
+    char *p = dst;
+    int line = 1;
+    if (strncmp(src, "#version", 8) == 0) {
+        const char *end = strchr(src, '\n');
+        body = end ? end + 1 : src + strlen(src);
+        memcpy(p, src, body - src);
+        p += body - src;
+        if (!end) {
+            *p++ = '\n';
+        }
+        line = 2;
+    }
+    for (i = 0; i < entry->featureCount; i++) {
+        if (features & (1u << i)) {
+            p += sprintf(p, "#define %s%s%s\n", entry->names[i], entry->values[i] ? " " : "",
+                         entry->values[i] ? entry->values[i] : "");
+        }
+    }
+    p += sprintf(p, "#line %d\n", line);
+    strcpy(p, body);
+    return dst;
+}
+
+bool shaderVariantAssemble(ShaderTemplate shaderTemplate, ShaderFeatures features, char **vtxSrc,
+                           char **fragSrc) {
+    if (shaderTemplate < 0 || shaderTemplate >= templateCount) {
+        return false;
+    }
+    const TemplateEntry *entry = &templates[shaderTemplate];
+    *vtxSrc = assembleStage(entry, entry->vtxSrc, features & entry->vtxUsed);
+    *fragSrc = assembleStage(entry, entry->fragSrc, features & entry->fragUsed);
+    if (!*vtxSrc || !*fragSrc) {
+        free(*vtxSrc);
+        free(*fragSrc);
+        *vtxSrc = NULL;
+        *fragSrc = NULL;
+        return false;
+    }
+    return true;
+}
+
+static uint64_t variantKey(ShaderTemplate shaderTemplate, ShaderFeatures features) {
+    const TemplateEntry *entry = &templates[shaderTemplate];
+    features &= entry->vtxUsed | entry->fragUsed;
+    return ((uint64_t) (shaderTemplate + 1) << 32) | features;
+}
+
+// 返回键所在的槽，不存在时返回应插入的空槽
+static VariantSlot *findSlot(uint64_t key) {
+    // Fibonacci 哈希：乘以 2^64 / φ 后取高位
+    uint32_t mask = SHADER_VARIANT_TABLE_SIZE - 1;
+    uint32_t index = (uint32_t) ((key * 0x9e3779b97f4a7c15ULL) >> 32) & mask;
+    while (table[index].key != 0 && table[index].key != key) {
+        index = (index + 1) & mask;
+    }
+    return &table[index];
+}
+
+int shaderVariantPrecompile(const ShaderVariantKey *keys, int count) {
+    int submitted = 0;
+    int i, j;
+    for (i = 0; i < count; i++) {
+        ShaderTemplate shaderTemplate = keys[i].shaderTemplate;
+        char *vtxSrc;
+        char *fragSrc;
+        variantStats.requested++;
+        if (shaderTemplate < 0 || shaderTemplate >= templateCount) {
+            ALOGE("Invalid shader template %d\n", shaderTemplate);
+            return -1;
+        }
+        VariantSlot *slot = findSlot(variantKey(shaderTemplate, keys[i].features));
+        if (slot->key != 0) {
+            variantStats.deduplicated++;
+            continue;
+        }
+        if (variantCount >= SHADER_VARIANT_TABLE_SIZE / 2) {
+            ALOGE("Too many shader variants");
+            return -1;
+        }
+        if (!shaderVariantAssemble(shaderTemplate, keys[i].features, &vtxSrc, &fragSrc)) {
+            return -1;
+        }
+        uint64_t hash = fnv1a64(FNV_OFFSET_BASIS, vtxSrc, strlen(vtxSrc) + 1);
+        hash = fnv1a64(hash, fragSrc, strlen(fragSrc) + 1);
+        ProgramHandle program = -1;
+        for (j = 0; j < programCount; j++) {
+            if (programs[j].hash == hash) {
+                program = programs[j].program;
+                variantStats.deduplicated++;
+                break;
+            }
+        }
+        if (program < 0) {
+            program = programBuilderSubmit(vtxSrc, fragSrc);
+            if (program >= 0) {
+                programs[programCount].hash = hash;
+                programs[programCount].program = program;
+                programCount++;
+                variantStats.compiled++;
+                submitted++;
+            }
+        }
+        free(vtxSrc);
+        free(fragSrc);
+        if (program < 0) {
+            return -1;
+        }
+        slot->key = variantKey(shaderTemplate, keys[i].features);
+        slot->program = program;
+        variantCount++;
+    }
+    return submitted;
+}
+
+ProgramHandle shaderVariantFind(ShaderTemplate shaderTemplate, ShaderFeatures features) {
+    if (shaderTemplate >= 0 && shaderTemplate < templateCount) {
+        const VariantSlot *slot = findSlot(variantKey(shaderTemplate, features));
+        if (slot->key != 0) {
+            return slot->program;
+        }
+    }
+    return -1;
+}
+
+void shaderVariantGetStats(ShaderVariantStats *stats) {
+    *stats = variantStats;
+}
+
+void shaderVariantRelease() {
+    int i;
+    for (i = 0; i < templateCount; i++) {
+        freeTemplate(&templates[i]);
+    }
+    templateCount = 0;
+    memset(table, 0, sizeof(table));
+    variantCount = 0;
+    programCount = 0;
+    memset(&variantStats, 0, sizeof(variantStats));
+}
@@ -0,0 +1,808 @@
+#include <atomic>
+#include <functional>
+#include "include/soft-rasterizer.h"
+#include "include/es-simd.h"
+
+//顶点/三角形设置阶段每个并行任务处理的数量
+#define SOFT_VERTEX_GRAIN 1024
+#define SOFT_TRIANGLE_GRAIN 512
+//屏幕坐标吸附到 1/16 像素，相邻三角形的共享边在两侧得到完全相同的边函数
+#define SOFT_SUBPIXEL 16.0f
+
+struct SoftVertex {
+    float clip[4];
+    float world[3];
+    float color[4];
+};
+
+//裁剪时使用的顶点，裁剪产生的新顶点在裁剪空间中插值
+typedef struct {
+    float clip[4];
+    float color[4];
+} ClipVertex;
+
+struct SoftTriangle {
+    // 边函数 e = a * x + b * y + c，第 i 条边与顶点 i 相对，三角形内 e >= edgeMin
+    float a[3];
+    float b[3];
+    float c[3];
+    float edgeMin[3];      // 左上规则：上边、左边为 0，其余为极小的正数（即要求 e > 0）
+    float invArea;
+    float z[3];
+    float invW[3];
+    float color[3][3];     // Gouraud 的顶点颜色（RGB）
+    uint32_t flatColor;    // flat 为 true 时的颜色
+    uint32_t alpha;        // 已移到最高字节
+    bool flat;
+    int minX;              // 像素包围盒，minX > maxX 表示该位置没有三角形
+    int minY;
+    int maxX;
+    int maxY;
+};
+
+static inline uint32_t packChannel(float value) {
+    value = value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+    return (uint32_t) (value * 255.0f + 0.5f);
+}
+
+static inline uint32_t packColor(float r, float g, float b, float a) {
+    return packChannel(r) | (packChannel(g) << 8) | (packChannel(b) << 16) | (packChannel(a) << 24);
+}
+
+bool softFramebufferInit(SoftFramebuffer *framebuffer, int width, int height) {
+    void *color = NULL;
+    void *depth = NULL;
+    size_t pixels;
+    memset(framebuffer, 0, sizeof(SoftFramebuffer));
+    if (width <= 0 || height <= 0) {
+        return false;
+    }
+    framebuffer->stride = (width + 7) & ~7;
+    pixels = (size_t) framebuffer->stride * height;
+    if (posix_memalign(&color, 32, pixels * sizeof(uint32_t)) != 0) {
+        return false;
+    }
+    if (posix_memalign(&depth, 32, pixels * sizeof(float)) != 0) {
+        free(color);
+        return false;
+    }
+    framebuffer->width = width;
+    framebuffer->height = height;
+    framebuffer->color = (uint32_t *) color;
+    framebuffer->depth = (float *) depth;
+    return true;
+}
+
+void softFramebufferRelease(SoftFramebuffer *framebuffer) {
+    free(framebuffer->color);
+    free(framebuffer->depth);
+    memset(framebuffer, 0, sizeof(SoftFramebuffer));
+}
+
+void softFramebufferClear(SoftFramebuffer *framebuffer, const GLfloat color[4], float depth) {
+    uint32_t packed = packColor(color[0], color[1], color[2], color[3]);
+    size_t pixels = (size_t) framebuffer->stride * framebuffer->height;
+    size_t i;
+    for (i = 0; i < pixels; i++) {
+        framebuffer->color[i] = packed;
+        framebuffer->depth[i] = depth;
+    }
+}
+
+bool softFramebufferWritePpm(const SoftFramebuffer *framebuffer, const char *path) {
+    FILE *file = fopen(path, "wb");
+    unsigned char *row = NULL;
+    bool ok = false;
+    int x, y;
+    if (!file) {
+        ALOGE("Could not open %s for writing\n", path);
+        return false;
+    }
+    row = (unsigned char *) malloc((size_t) framebuffer->width * 3);
+    if (!row) {
+        goto fail;
+    }
+    fprintf(file, "P6\n%d %d\n255\n", framebuffer->width, framebuffer->height);
+    for (y = 0; y < framebuffer->height; y++) {
+        const uint32_t *pixels = framebuffer->color + (size_t) y * framebuffer->stride;
+        for (x = 0; x < framebuffer->width; x++) {
+            row[x * 3 + 0] = (unsigned char) (pixels[x] & 0xFF);
+            row[x * 3 + 1] = (unsigned char) ((pixels[x] >> 8) & 0xFF);
+            row[x * 3 + 2] = (unsigned char) ((pixels[x] >> 16) & 0xFF);
+        }
+        if (fwrite(row, 3, framebuffer->width, file) != (size_t) framebuffer->width) {
+            goto fail;
+        }
+    }
+    ok = true;
+fail:
+    free(row);
+    if (fclose(file) != 0) {
+        ok = false;
+    }
+    return ok;
+}
+
+//PNG 块使用的 CRC-32 查找表，静态局部变量的初始化是线程安全的
+struct Crc32Table {
+    uint32_t entries[256];
+
+    Crc32Table() {
+        for (uint32_t n = 0; n < 256; n++) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            entries[n] = c;
+        }
+    }
+};
+
+static uint32_t crc32Update(uint32_t crc, const unsigned char *data, size_t size) {
+    static const Crc32Table table;
+    size_t i;
+    crc = ~crc;
+    for (i = 0; i < size; i++) {
+        crc = table.entries[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+static void putBigEndian(unsigned char *out, uint32_t value) {
+    out[0] = (unsigned char) (value >> 24);
+    out[1] = (unsigned char) (value >> 16);
+    out[2] = (unsigned char) (value >> 8);
+    out[3] = (unsigned char) value;
+}
+
+//写入一个 PNG 块：长度、类型、数据、类型和数据的 CRC
+static bool writePngChunk(FILE *file, const char *type, const unsigned char *data, size_t size) {
+    unsigned char header[8];
+    unsigned char footer[4];
+    uint32_t crc;
+    putBigEndian(header, (uint32_t) size);
+    memcpy(header + 4, type, 4);
+    crc = crc32Update(0, header + 4, 4);
+    crc = crc32Update(crc, data, size);
+    putBigEndian(footer, crc);
+    return fwrite(header, 1, 8, file) == 8 && fwrite(data, 1, size, file) == size &&
+           fwrite(footer, 1, 4, file) == 4;
+}
+
+bool softFramebufferWritePng(const SoftFramebuffer *framebuffer, const char *path) {
+    static const unsigned char signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    const size_t maxBlock = 65535;
+    size_t rowBytes = (size_t) framebuffer->width * 4 + 1;
+    size_t rawSize = rowBytes * framebuffer->height;
+    size_t numBlocks = (rawSize + maxBlock - 1) / maxBlock;
+    size_t zlibSize = 2 + rawSize + numBlocks * 5 + 4;
+    unsigned char *raw = NULL;
+    unsigned char *zlib = NULL;
+    unsigned char ihdr[13];
+    unsigned char *out;
+    uint32_t adlerA = 1, adlerB = 0;
+    size_t i, offset;
+    bool ok = false;
+    int x, y;
+    FILE *file = fopen(path, "wb");
+    if (!file) {
+        ALOGE("Could not open %s for writing\n", path);
+        return false;
+    }
+    raw = (unsigned char *) malloc(rawSize);
+    zlib = (unsigned char *) malloc(zlibSize);
+    if (!raw || !zlib) {
+        goto fail;
+    }
+    // 每行前面是过滤类型 0（不过滤）
+    for (y = 0; y < framebuffer->height; y++) {
+        const uint32_t *pixels = framebuffer->color + (size_t) y * framebuffer->stride;
+        unsigned char *row = raw + rowBytes * y;
+        row[0] = 0;
+        for (x = 0; x < framebuffer->width; x++) {
+            row[1 + x * 4 + 0] = (unsigned char) (pixels[x] & 0xFF);
+            row[1 + x * 4 + 1] = (unsigned char) ((pixels[x] >> 8) & 0xFF);
+            row[1 + x * 4 + 2] = (unsigned char) ((pixels[x] >> 16) & 0xFF);
+            row[1 + x * 4 + 3] = (unsigned char) (pixels[x] >> 24);
+        }
+    }
+    for (i = 0; i < rawSize; i++) {
+        adlerA = (adlerA + raw[i]) % 65521;
+        adlerB = (adlerB + adlerA) % 65521;
+    }
+    // zlib 头（deflate，32K 窗口），之后是一串不压缩的存储块，最后是 Adler-32
+    out = zlib;
+    *out++ = 0x78;
+    *out++ = 0x01;
+    for (offset = 0; offset < rawSize; offset += maxBlock) {
+        size_t size = rawSize - offset < maxBlock ? rawSize - offset : maxBlock;
+        *out++ = offset + size == rawSize ? 1 : 0;
+        *out++ = (unsigned char) (size & 0xFF);
+        *out++ = (unsigned char) (size >> 8);
+        *out++ = (unsigned char) (~size & 0xFF);
+        *out++ = (unsigned char) ((~size >> 8) & 0xFF);
+        memcpy(out, raw + offset, size);
+        out += size;
+    }
+    putBigEndian(out, (adlerB << 16) | adlerA);
+
+    putBigEndian(ihdr, (uint32_t) framebuffer->width);
+    putBigEndian(ihdr + 4, (uint32_t) framebuffer->height);
+    ihdr[8] = 8;       // 每通道 8 位
+    ihdr[9] = 6;       // RGBA
+    ihdr[10] = 0;
+    ihdr[11] = 0;
+    ihdr[12] = 0;
+    ok = fwrite(signature, 1, 8, file) == 8 &&
+         writePngChunk(file, "IHDR", ihdr, sizeof(ihdr)) &&
+         writePngChunk(file, "IDAT", zlib, zlibSize) &&
+         writePngChunk(file, "IEND", NULL, 0);
+fail:
+    free(raw);
+    free(zlib);
+    if (fclose(file) != 0) {
+        ok = false;
+    }
+    return ok;
+}
+
+bool softFramebufferReadPpm(SoftFramebuffer *framebuffer, const char *path) {
+    FILE *file = fopen(path, "rb");
+    unsigned char *row = NULL;
+    int width, height, maxValue;
+    bool ok = false;
+    int x, y;
+    if (!file) {
+        ALOGE("Could not open %s\n", path);
+        return false;
+    }
+    // 头部之后恰好一个空白字符，然后是像素数据
+    if (fscanf(file, "P6 %d %d %d", &width, &height, &maxValue) != 3 || maxValue != 255 ||
+        fgetc(file) == EOF) {
+        ALOGE("%s is not a binary 8-bit PPM\n", path);
+        goto fail;
+    }
+    softFramebufferRelease(framebuffer);
+    row = (unsigned char *) malloc((size_t) width * 3);
+    if (!row || !softFramebufferInit(framebuffer, width, height)) {
+        goto fail;
+    }
+    for (y = 0; y < height; y++) {
+        uint32_t *pixels = framebuffer->color + (size_t) y * framebuffer->stride;
+        if (fread(row, 3, width, file) != (size_t) width) {
+            ALOGE("%s is truncated\n", path);
+            softFramebufferRelease(framebuffer);
+            goto fail;
+        }
+        for (x = 0; x < width; x++) {
+            pixels[x] = row[x * 3] | (row[x * 3 + 1] << 8) | (row[x * 3 + 2] << 16) | 0xFF000000u;
+        }
+        for (x = 0; x < framebuffer->stride; x++) {
+            framebuffer->depth[(size_t) y * framebuffer->stride + x] = 1.0f;
+        }
+    }
+    ok = true;
+fail:
+    free(row);
+    fclose(file);
+    return ok;
+}
+
+int softFramebufferCompare(const SoftFramebuffer *a, const SoftFramebuffer *b, int tolerance) {
+    int different = 0;
+    int x, y, channel;
+    if (a->width != b->width || a->height != b->height) {
+        return -1;
+    }
+    for (y = 0; y < a->height; y++) {
+        const uint32_t *rowA = a->color + (size_t) y * a->stride;
+        const uint32_t *rowB = b->color + (size_t) y * b->stride;
+        for (x = 0; x < a->width; x++) {
+            for (channel = 0; channel < 3; channel++) {
+                int valueA = (int) ((rowA[x] >> (channel * 8)) & 0xFF);
+                int valueB = (int) ((rowB[x] >> (channel * 8)) & 0xFF);
+                if (abs(valueA - valueB) > tolerance) {
+                    different++;
+                    break;
+                }
+            }
+        }
+    }
+    return different;
+}
+
+void softDrawStateDefault(SoftDrawState *state) {
+    matrixLoadIdentity(&state->model);
+    matrixLoadIdentity(&state->viewProj);
+    state->color[0] = state->color[1] = state->color[2] = state->color[3] = 1.0f;
+    state->lightDir[0] = 0.4f;
+    state->lightDir[1] = 0.8f;
+    state->lightDir[2] = 0.6f;
+    state->ambient = 0.2f;
+    state->shading = SOFT_SHADE_GOURAUD;
+    state->cullBackFaces = true;
+}
+
+bool softRasterizerInit(SoftRasterizer *rasterizer, SoftFramebuffer *target, ThreadPool *pool) {
+    int numTiles;
+    memset(rasterizer, 0, sizeof(SoftRasterizer));
+    rasterizer->target = target;
+    rasterizer->pool = pool;
+    rasterizer->tilesX = (target->width + SOFT_TILE_SIZE - 1) / SOFT_TILE_SIZE;
+    rasterizer->tilesY = (target->height + SOFT_TILE_SIZE - 1) / SOFT_TILE_SIZE;
+    numTiles = rasterizer->tilesX * rasterizer->tilesY;
+    rasterizer->binOffsets = (int *) malloc(sizeof(int) * (numTiles + 1));
+    if (!rasterizer->binOffsets) {
+        return false;
+    }
+    return true;
+}
+
+void softRasterizerRelease(SoftRasterizer *rasterizer) {
+    free(rasterizer->vertices);
+    free(rasterizer->triangles);
+    free(rasterizer->binOffsets);
+    free(rasterizer->binTriangles);
+    memset(rasterizer, 0, sizeof(SoftRasterizer));
+}
+
+//在 pool 上执行 fn，pool 为 NULL 时直接在当前线程执行
+static void runParallel(ThreadPool *pool, int count, int grain,
+                        const std::function<void(int, int)> &fn) {
+    if (pool) {
+        pool->parallelFor(0, count, grain, fn);
+    } else if (count > 0) {
+        fn(0, count);
+    }
+}
+
+static inline float lighting(const SoftDrawState *state, const float lightDir[3], const float n[3]) {
+    float diffuse = n[0] * lightDir[0] + n[1] * lightDir[1] + n[2] * lightDir[2];
+    if (diffuse < 0.0f) {
+        diffuse = 0.0f;
+    }
+    return state->ambient + (1.0f - state->ambient) * diffuse;
+}
+
+static inline void normalize3(float v[3]) {
+    float length = sqrtf(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+    if (length > 0.0f) {
+        v[0] /= length;
+        v[1] /= length;
+        v[2] /= length;
+    }
+}
+
+//裁剪空间中 z >= -w 为近平面内侧，Sutherland-Hodgman 裁剪三角形，返回 0、3 或 4 个顶点
+static int clipNear(const ClipVertex in[3], ClipVertex out[4]) {
+    int count = 0;
+    int i, k;
+    for (i = 0; i < 3; i++) {
+        const ClipVertex *current = &in[i];
+        const ClipVertex *next = &in[(i + 1) % 3];
+        float dCurrent = current->clip[2] + current->clip[3];
+        float dNext = next->clip[2] + next->clip[3];
+        if (dCurrent >= 0.0f) {
+            out[count++] = *current;
+        }
+        if ((dCurrent >= 0.0f) != (dNext >= 0.0f)) {
+            float t = dCurrent / (dCurrent - dNext);
+            ClipVertex *v = &out[count++];
+            for (k = 0; k < 4; k++) {
+                v->clip[k] = current->clip[k] + (next->clip[k] - current->clip[k]) * t;
+                v->color[k] = current->color[k] + (next->color[k] - current->color[k]) * t;
+            }
+        }
+    }
+    return count;
+}
+
+//投影到屏幕并计算边函数，三角形不可见时把 out 标记为空
+static void setupTriangle(const SoftFramebuffer *framebuffer, const ClipVertex *v0,
+                          const ClipVertex *v1, const ClipVertex *v2, bool flat,
+                          uint32_t flatColor, bool cullBackFaces, SoftTriangle *out) {
+    const ClipVertex *in[3] = {v0, v1, v2};
+    float x[3], y[3], z[3], invW[3];
+    float area, minSx, maxSx, minSy, maxSy;
+    int i;
+    out->minX = 1;
+    out->maxX = 0;
+    for (i = 0; i < 3; i++) {
+        float w = in[i]->clip[3];
+        invW[i] = 1.0f / w;
+        x[i] = (in[i]->clip[0] * invW[i] * 0.5f + 0.5f) * (float) framebuffer->width;
+        y[i] = (0.5f - in[i]->clip[1] * invW[i] * 0.5f) * (float) framebuffer->height;
+        x[i] = floorf(x[i] * SOFT_SUBPIXEL + 0.5f) / SOFT_SUBPIXEL;
+        y[i] = floorf(y[i] * SOFT_SUBPIXEL + 0.5f) / SOFT_SUBPIXEL;
+        z[i] = in[i]->clip[2] * invW[i] * 0.5f + 0.5f;
+    }
+    // y 轴向下，NDC 中逆时针的正面在屏幕上为顺时针，面积为负
+    area = (x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0]);
+    if (area == 0.0f || (cullBackFaces && area > 0.0f)) {
+        return;
+    }
+    if (area < 0.0f) {
+        // 统一成面积为正，之后三角形内所有边函数都 >= 0
+        int order[3] = {0, 2, 1};
+        float tx[3], ty[3], tz[3], tw[3];
+        const ClipVertex *tin[3];
+        for (i = 0; i < 3; i++) {
+            tx[i] = x[order[i]];
+            ty[i] = y[order[i]];
+            tz[i] = z[order[i]];
+            tw[i] = invW[order[i]];
+            tin[i] = in[order[i]];
+        }
+        for (i = 0; i < 3; i++) {
+            x[i] = tx[i];
+            y[i] = ty[i];
+            z[i] = tz[i];
+            invW[i] = tw[i];
+            in[i] = tin[i];
+        }
+        area = -area;
+    }
+    minSx = fminf(x[0], fminf(x[1], x[2]));
+    maxSx = fmaxf(x[0], fmaxf(x[1], x[2]));
+    minSy = fminf(y[0], fminf(y[1], y[2]));
+    maxSy = fmaxf(y[0], fmaxf(y[1], y[2]));
+    // 先在浮点中限制到屏幕范围，避免很大的坐标转换为 int 时溢出
+    minSx = fmaxf(minSx, 0.0f);
+    minSy = fmaxf(minSy, 0.0f);
+    maxSx = fminf(maxSx, (float) framebuffer->width);
+    maxSy = fminf(maxSy, (float) framebuffer->height);
+    if (minSx > maxSx || minSy > maxSy) {
+        return;
+    }
+    for (i = 0; i < 3; i++) {
+        // 第 i 条边为顶点 i+1 → i+2
+        int a = (i + 1) % 3;
+        int b = (i + 2) % 3;
+        float dx = x[b] - x[a];
+        float dy = y[b] - y[a];
+        out->a[i] = -dy;
+        out->b[i] = dx;
+        out->c[i] = dy * x[a] - dx * y[a];
+        out->edgeMin[i] = (dy < 0.0f || (dy == 0.0f && dx > 0.0f)) ? 0.0f : 1e-30f;
+        out->z[i] = z[i];
+        out->invW[i] = invW[i];
+        out->color[i][0] = in[i]->color[0];
+        out->color[i][1] = in[i]->color[1];
+        out->color[i][2] = in[i]->color[2];
+    }
+    out->invArea = 1.0f / area;
+    out->flat = flat;
+    out->flatColor = flatColor;
+    out->alpha = packChannel(in[0]->color[3]) << 24;
+    out->minX = (int) minSx;
+    out->minY = (int) minSy;
+    out->maxX = (int) ceilf(maxSx);
+    out->maxY = (int) ceilf(maxSy);
+    if (out->maxX >= framebuffer->width) {
+        out->maxX = framebuffer->width - 1;
+    }
+    if (out->maxY >= framebuffer->height) {
+        out->maxY = framebuffer->height - 1;
+    }
+}
+
+static bool reserveTriangles(SoftRasterizer *rasterizer, int count) {
+    int needed = rasterizer->triangleCount + count;
+    int capacity = rasterizer->triangleCapacity > 0 ? rasterizer->triangleCapacity : 1024;
+    SoftTriangle *triangles;
+    if (needed <= rasterizer->triangleCapacity) {
+        return true;
+    }
+    while (capacity < needed) {
+        capacity *= 2;
+    }
+    triangles = (SoftTriangle *) realloc(rasterizer->triangles, sizeof(SoftTriangle) * capacity);
+    if (!triangles) {
+        return false;
+    }
+    rasterizer->triangles = triangles;
+    rasterizer->triangleCapacity = capacity;
+    return true;
+}
+
+bool softRasterizerDraw(SoftRasterizer *rasterizer, const SoftDrawState *state,
+                        const GLfloat *vertices, const GLfloat *normals, int vertexCount,
+                        const GLuint *indices, int indexCount) {
+    int numTriangles = indexCount / 3;
+    bool gouraud = state->shading == SOFT_SHADE_GOURAUD && normals != NULL;
+    SoftFramebuffer *framebuffer = rasterizer->target;
+    SoftTriangle *triangles;
+    SoftVertex *transformed;
+    float lightDir[3] = {state->lightDir[0], state->lightDir[1], state->lightDir[2]};
+    Matrix model = state->model;
+    Matrix viewProj = state->viewProj;
+    Matrix mvp;
+    if (numTriangles <= 0 || vertexCount <= 0) {
+        return true;
+    }
+    if (vertexCount > rasterizer->vertexCapacity) {
+        SoftVertex *grown = (SoftVertex *) realloc(rasterizer->vertices,
+                                                   sizeof(SoftVertex) * vertexCount);
+        if (!grown) {
+            return false;
+        }
+        rasterizer->vertices = grown;
+        rasterizer->vertexCapacity = vertexCount;
+    }
+    if (!reserveTriangles(rasterizer, numTriangles * 2)) {
+        return false;
+    }
+    normalize3(lightDir);
+    matrixMultiply(&mvp, &model, &viewProj);
+    transformed = rasterizer->vertices;
+    triangles = rasterizer->triangles + rasterizer->triangleCount;
+
+    // 顶点阶段：裁剪空间坐标、世界坐标（flat 计算面法线）、Gouraud 的顶点颜色
+    runParallel(rasterizer->pool, vertexCount, SOFT_VERTEX_GRAIN, [&](int begin, int end) {
+        for (int i = begin; i < end; i++) {
+            const GLfloat *p = vertices + i * 3;
+            SoftVertex *out = &transformed[i];
+            for (int j = 0; j < 4; j++) {
+                out->clip[j] = p[0] * mvp.m[0][j] + p[1] * mvp.m[1][j] + p[2] * mvp.m[2][j] +
+                               mvp.m[3][j];
+            }
+            for (int j = 0; j < 3; j++) {
+                out->world[j] = p[0] * model.m[0][j] + p[1] * model.m[1][j] +
+                                p[2] * model.m[2][j] + model.m[3][j];
+            }
+            if (gouraud) {
+                const GLfloat *n = normals + i * 3;
+                float normal[3];
+                for (int j = 0; j < 3; j++) {
+                    normal[j] = n[0] * model.m[0][j] + n[1] * model.m[1][j] + n[2] * model.m[2][j];
+                }
+                normalize3(normal);
+                float light = lighting(state, lightDir, normal);
+                out->color[0] = state->color[0] * light;
+                out->color[1] = state->color[1] * light;
+                out->color[2] = state->color[2] * light;
+            } else {
+                out->color[0] = state->color[0];
+                out->color[1] = state->color[1];
+                out->color[2] = state->color[2];
+            }
+            out->color[3] = state->color[3];
+        }
+    });
+
+    // 三角形设置：每个输入三角形写入自己的两个位置，近平面裁剪成四边形时两个都用上
+    runParallel(rasterizer->pool, numTriangles, SOFT_TRIANGLE_GRAIN, [&](int begin, int end) {
+        for (int t = begin; t < end; t++) {
+            SoftTriangle *out = &triangles[t * 2];
+            const SoftVertex *v[3];
+            ClipVertex clipIn[3], clipOut[4];
+            uint32_t flatColor = 0;
+            int outcode[3];
+            out[0].minX = out[1].minX = 1;
+            out[0].maxX = out[1].maxX = 0;
+            for (int i = 0; i < 3; i++) {
+                GLuint index = indices[t * 3 + i];
+                if (index >= (GLuint) vertexCount) {
+                    v[0] = NULL;
+                    break;
+                }
+                v[i] = &transformed[index];
+            }
+            if (!v[0]) {
+                continue;
+            }
+            // 三个顶点都在同一个裁剪平面外侧时整个三角形不可见
+            for (int i = 0; i < 3; i++) {
+                const float *c = v[i]->clip;
+                outcode[i] = (c[0] < -c[3]) | ((c[0] > c[3]) << 1) | ((c[1] < -c[3]) << 2) |
+                             ((c[1] > c[3]) << 3) | ((c[2] < -c[3]) << 4) | ((c[2] > c[3]) << 5);
+            }
+            if (outcode[0] & outcode[1] & outcode[2]) {
+                continue;
+            }
+            if (!gouraud) {
+                // 面法线：正面逆时针，(p1 - p0) x (p2 - p0) 指向外侧
+                float e1[3], e2[3], normal[3];
+                for (int j = 0; j < 3; j++) {
+                    e1[j] = v[1]->world[j] - v[0]->world[j];
+                    e2[j] = v[2]->world[j] - v[0]->world[j];
+                }
+                normal[0] = e1[1] * e2[2] - e1[2] * e2[1];
+                normal[1] = e1[2] * e2[0] - e1[0] * e2[2];
+                normal[2] = e1[0] * e2[1] - e1[1] * e2[0];
+                normalize3(normal);
+                float light = lighting(state, lightDir, normal);
+                flatColor = packColor(state->color[0] * light, state->color[1] * light,
+                                      state->color[2] * light, state->color[3]);
+            }
+            for (int i = 0; i < 3; i++) {
+                memcpy(clipIn[i].clip, v[i]->clip, sizeof(clipIn[i].clip));
+                memcpy(clipIn[i].color, v[i]->color, sizeof(clipIn[i].color));
+            }
+            if (!(outcode[0] & 16) && !(outcode[1] & 16) && !(outcode[2] & 16)) {
+                setupTriangle(framebuffer, &clipIn[0], &clipIn[1], &clipIn[2], !gouraud,
+                              flatColor, state->cullBackFaces, &out[0]);
+                continue;
+            }
+            int count = clipNear(clipIn, clipOut);
+            if (count >= 3) {
+                setupTriangle(framebuffer, &clipOut[0], &clipOut[1], &clipOut[2], !gouraud,
+                              flatColor, state->cullBackFaces, &out[0]);
+            }
+            if (count == 4) {
+                setupTriangle(framebuffer, &clipOut[0], &clipOut[2], &clipOut[3], !gouraud,
+                              flatColor, state->cullBackFaces, &out[1]);
+            }
+        }
+    });
+    rasterizer->triangleCount += numTriangles * 2;
+    rasterizer->stats.triangles += numTriangles;
+    return true;
+}
+
+bool softRasterizerDrawMesh(SoftRasterizer *rasterizer, const SoftDrawState *state, const Mesh *mesh) {
+    return softRasterizerDraw(rasterizer, state, mesh->vertices(), mesh->normals(),
+                              mesh->vertexCount(), mesh->indices(), mesh->indexCount());
+}
+
+//把排序后的三角形依次光栅化到一块中，返回写入的像素数
+static long rasterizeTile(const SoftRasterizer *rasterizer, int tile) {
+    SoftFramebuffer *framebuffer = rasterizer->target;
+    int tileX = (tile % rasterizer->tilesX) * SOFT_TILE_SIZE;
+    int tileY = (tile / rasterizer->tilesX) * SOFT_TILE_SIZE;
+    int tileMaxX = tileX + SOFT_TILE_SIZE - 1;
+    int tileMaxY = tileY + SOFT_TILE_SIZE - 1;
+    long fragments = 0;
+    int n;
+    if (tileMaxX >= framebuffer->width) {
+        tileMaxX = framebuffer->width - 1;
+    }
+    if (tileMaxY >= framebuffer->height) {
+        tileMaxY = framebuffer->height - 1;
+    }
+    for (n = rasterizer->binOffsets[tile]; n < rasterizer->binOffsets[tile + 1]; n++) {
+        const SoftTriangle *t = &rasterizer->triangles[rasterizer->binTriangles[n]];
+        int minX = t->minX > tileX ? t->minX : tileX;
+        int maxX = t->maxX < tileMaxX ? t->maxX : tileMaxX;
+        int minY = t->minY > tileY ? t->minY : tileY;
+        int maxY = t->maxY < tileMaxY ? t->maxY : tileMaxY;
+        // 块宽是 SIMD 宽度的倍数，从块内对齐的位置开始，一组像素不会跨到相邻的块；
+        // 最右边的块可能写到 width 和 stride 之间的填充像素，不影响结果
+        int startX = tileX + ((minX - tileX) & ~(ES_SIMD_WIDTH - 1));
+        vfloat a[3], step[3], edgeMin[3];
+        vfloat invArea = vsplat(t->invArea);
+        vfloat z0 = vsplat(t->z[0]);
+        vfloat dz1 = vsplat(t->z[1] - t->z[0]);
+        vfloat dz2 = vsplat(t->z[2] - t->z[0]);
+        vfloat startPx = vadd(vsplat((float) startX + 0.5f), vramp());
+        int x, y, i, k;
+        for (i = 0; i < 3; i++) {
+            a[i] = vsplat(t->a[i]);
+            step[i] = vsplat(t->a[i] * ES_SIMD_WIDTH);
+            edgeMin[i] = vsplat(t->edgeMin[i]);
+        }
+        for (y = minY; y <= maxY; y++) {
+            float py = (float) y + 0.5f;
+            float *depthRow = framebuffer->depth + (size_t) y * framebuffer->stride;
+            uint32_t *colorRow = framebuffer->color + (size_t) y * framebuffer->stride;
+            vfloat e[3];
+            for (i = 0; i < 3; i++) {
+                e[i] = vmadd(a[i], startPx, vsplat(t->b[i] * py + t->c[i]));
+            }
+            for (x = startX; x <= maxX; x += ES_SIMD_WIDTH) {
+                vfloat inside = vand(vand(vge(e[0], edgeMin[0]), vge(e[1], edgeMin[1])),
+                                     vge(e[2], edgeMin[2]));
+                if (vmask(inside)) {
+                    vfloat b1 = vmul(e[1], invArea);
+                    vfloat b2 = vmul(e[2], invArea);
+                    vfloat z = vmadd(dz2, b2, vmadd(dz1, b1, z0));
+                    vfloat depth = vload(depthRow + x);
+                    vfloat pass = vand(inside, vlt(z, depth));
+                    int mask = vmask(pass);
+                    if (mask) {
+                        vstore(depthRow + x, vselect(pass, z, depth));
+                        fragments += __builtin_popcount(mask);
+                        if (t->flat) {
+                            for (k = 0; k < ES_SIMD_WIDTH; k++) {
+                                if (mask & (1 << k)) {
+                                    colorRow[x + k] = t->flatColor;
+                                }
+                            }
+                        } else {
+                            // 透视校正：按 b / w 加权后再除以权重之和
+                            vfloat w0 = vmul(vmul(e[0], invArea), vsplat(t->invW[0]));
+                            vfloat w1 = vmul(b1, vsplat(t->invW[1]));
+                            vfloat w2 = vmul(b2, vsplat(t->invW[2]));
+                            vfloat norm = vrcp(vadd(w0, vadd(w1, w2)));
+                            float channels[3][ES_SIMD_WIDTH];
+                            int c;
+                            for (c = 0; c < 3; c++) {
+                                vfloat value = vmadd(w2, vsplat(t->color[2][c]),
+                                                     vmadd(w1, vsplat(t->color[1][c]),
+                                                           vmul(w0, vsplat(t->color[0][c]))));
+                                value = vmin(vmax(vmul(value, norm), vsplat(0.0f)), vsplat(1.0f));
+                                vstore(channels[c], vmadd(value, vsplat(255.0f), vsplat(0.5f)));
+                            }
+                            for (k = 0; k < ES_SIMD_WIDTH; k++) {
+                                if (mask & (1 << k)) {
+                                    colorRow[x + k] = (uint32_t) channels[0][k] |
+                                                      ((uint32_t) channels[1][k] << 8) |
+                                                      ((uint32_t) channels[2][k] << 16) | t->alpha;
+                                }
+                            }
+                        }
+                    }
+                }
+                for (i = 0; i < 3; i++) {
+                    e[i] = vadd(e[i], step[i]);
+                }
+            }
+        }
+    }
+    return fragments;
+}
+
+void softRasterizerFlush(SoftRasterizer *rasterizer) {
+    int numTiles = rasterizer->tilesX * rasterizer->tilesY;
+    int *offsets = rasterizer->binOffsets;
+    int total = 0;
+    int t, tx, ty, tile;
+    std::atomic<long> fragments{0};
+    if (rasterizer->triangleCount == 0) {
+        return;
+    }
+    // 按块计数排序：先统计每块的三角形数，前缀和得到起始位置，再按提交顺序填入
+    memset(offsets, 0, sizeof(int) * (numTiles + 1));
+    for (t = 0; t < rasterizer->triangleCount; t++) {
+        const SoftTriangle *triangle = &rasterizer->triangles[t];
+        if (triangle->minX > triangle->maxX) {
+            continue;
+        }
+        rasterizer->stats.rasterized++;
+        for (ty = triangle->minY / SOFT_TILE_SIZE; ty <= triangle->maxY / SOFT_TILE_SIZE; ty++) {
+            for (tx = triangle->minX / SOFT_TILE_SIZE; tx <= triangle->maxX / SOFT_TILE_SIZE; tx++) {
+                offsets[ty * rasterizer->tilesX + tx + 1]++;
+                total++;
+            }
+        }
+    }
+    if (total > rasterizer->binCapacity) {
+        int *grown = (int *) realloc(rasterizer->binTriangles, sizeof(int) * total);
+        if (!grown) {
+            ALOGE("Could not allocate %d tile bin entries\n", total);
+            rasterizer->triangleCount = 0;
+            return;
+        }
+        rasterizer->binTriangles = grown;
+        rasterizer->binCapacity = total;
+    }
+    for (tile = 0; tile < numTiles; tile++) {
+        offsets[tile + 1] += offsets[tile];
+    }
+    for (t = 0; t < rasterizer->triangleCount; t++) {
+        const SoftTriangle *triangle = &rasterizer->triangles[t];
+        if (triangle->minX > triangle->maxX) {
+            continue;
+        }
+        for (ty = triangle->minY / SOFT_TILE_SIZE; ty <= triangle->maxY / SOFT_TILE_SIZE; ty++) {
+            for (tx = triangle->minX / SOFT_TILE_SIZE; tx <= triangle->maxX / SOFT_TILE_SIZE; tx++) {
+                // offsets[tile] 作为写指针递增，填完后等于下一块的起始位置，之后整体后移一位还原
+                rasterizer->binTriangles[offsets[ty * rasterizer->tilesX + tx]++] = t;
+            }
+        }
+    }
+    for (tile = numTiles; tile > 0; tile--) {
+        offsets[tile] = offsets[tile - 1];
+    }
+    offsets[0] = 0;
+
+    runParallel(rasterizer->pool, numTiles, 1, [&](int begin, int end) {
+        long count = 0;
+        for (int i = begin; i < end; i++) {
+            count += rasterizeTile(rasterizer, i);
+        }
+        fragments.fetch_add(count, std::memory_order_relaxed);
+    });
+    rasterizer->stats.fragments += fragments.load(std::memory_order_relaxed);
+    rasterizer->triangleCount = 0;
+}
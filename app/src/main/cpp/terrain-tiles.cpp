@@ -0,0 +1,377 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "include/terrain-tiles.h"
+
+// 高度范围表紧跟文件头，块数据从按 64 字节对齐的位置开始
+#define TERRAIN_DATA_ALIGNMENT 64
+
+static size_t alignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+static size_t tileBytesFor(uint32_t tileSize) {
+    return alignUp((size_t) tileSize * tileSize * sizeof(uint16_t), 4);
+}
+
+static size_t dataOffsetFor(uint32_t tileCount) {
+    return alignUp(sizeof(TerrainHeader) + (size_t) tileCount * 2 * sizeof(uint16_t),
+                   TERRAIN_DATA_ALIGNMENT);
+}
+
+bool terrainFileOpen(TerrainFile *file, const char *path) {
+    struct stat info;
+    const unsigned char *base;
+    const TerrainHeader *header;
+    size_t tileCount;
+    int fd;
+    memset(file, 0, sizeof(TerrainFile));
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        ALOGE("Could not open terrain %s\n", path);
+        return false;
+    }
+    if (fstat(fd, &info) != 0 || (size_t) info.st_size < sizeof(TerrainHeader)) {
+        ALOGE("Terrain %s is too small\n", path);
+        close(fd);
+        return false;
+    }
+    file->mappingSize = (size_t) info.st_size;
+    file->mapping = mmap(NULL, file->mappingSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (file->mapping == MAP_FAILED) {
+        file->mapping = NULL;
+        ALOGE("Could not map terrain %s\n", path);
+        return false;
+    }
+    base = (const unsigned char *) file->mapping;
+    header = (const TerrainHeader *) base;
+    if (header->magic != TERRAIN_MAGIC || header->version != TERRAIN_VERSION) {
+        ALOGE("%s is not a terrain file\n", path);
+        goto fail;
+    }
+    if (header->tileSize < 2 || header->tilesX == 0 || header->tilesY == 0) {
+        ALOGE("%s: invalid tile layout\n", path);
+        goto fail;
+    }
+    tileCount = (size_t) header->tilesX * header->tilesY;
+    file->header = *header;
+    file->tileBytes = tileBytesFor(header->tileSize);
+    if (dataOffsetFor((uint32_t) tileCount) + tileCount * file->tileBytes > file->mappingSize) {
+        ALOGE("%s is truncated\n", path);
+        goto fail;
+    }
+    file->ranges = (const uint16_t *) (base + sizeof(TerrainHeader));
+    file->tiles = base + dataOffsetFor((uint32_t) tileCount);
+    // 块按视野随机访问，关闭内核默认的顺序预读，需要时由 terrainFilePrefetch 指定
+    madvise(file->mapping, file->mappingSize, MADV_RANDOM);
+    return true;
+
+fail:
+    terrainFileClose(file);
+    return false;
+}
+
+void terrainFileClose(TerrainFile *file) {
+    if (file->mapping) {
+        munmap(file->mapping, file->mappingSize);
+    }
+    memset(file, 0, sizeof(TerrainFile));
+}
+
+const uint16_t *terrainFileTile(const TerrainFile *file, int tile) {
+    return (const uint16_t *) (file->tiles + (size_t) tile * file->tileBytes);
+}
+
+void terrainFilePrefetch(const TerrainFile *file, int tile) {
+    uintptr_t pageSize = (uintptr_t) sysconf(_SC_PAGESIZE);
+    uintptr_t begin = (uintptr_t) terrainFileTile(file, tile);
+    uintptr_t end = begin + file->tileBytes;
+    // madvise 要求起始地址按页对齐
+    begin &= ~(pageSize - 1);
+    madvise((void *) begin, end - begin, MADV_WILLNEED);
+}
+
+void terrainFileTileBounds(const TerrainFile *file, int tile, float min[3], float max[3]) {
+    const TerrainHeader *header = &file->header;
+    float extent = (float) (header->tileSize - 1) * header->spacing;
+    float low = file->ranges[tile * 2] * header->heightScale + header->heightOffset;
+    float high = file->ranges[tile * 2 + 1] * header->heightScale + header->heightOffset;
+    min[0] = (float) (tile % (int) header->tilesX) * extent;
+    min[1] = (float) (tile / (int) header->tilesX) * extent;
+    min[2] = low < high ? low : high;
+    max[0] = min[0] + extent;
+    max[1] = min[1] + extent;
+    max[2] = low < high ? high : low;
+}
+
+bool terrainFileWrite(const char *path, int tileSize, int tilesX, int tilesY, float spacing,
+                      float heightScale, float heightOffset,
+                      uint16_t (*sample)(int x, int y, void *user), void *user) {
+    TerrainHeader header;
+    uint32_t tileCount = (uint32_t) tilesX * (uint32_t) tilesY;
+    size_t tileBytes = tileBytesFor((uint32_t) tileSize);
+    size_t dataOffset = dataOffsetFor(tileCount);
+    uint16_t *ranges = NULL;
+    uint16_t *tile = NULL;
+    bool ok = false;
+    int tx, ty, x, y;
+    FILE *out;
+    if (tileSize < 2 || tilesX <= 0 || tilesY <= 0) {
+        return false;
+    }
+    out = fopen(path, "wb");
+    if (!out) {
+        ALOGE("Could not open %s for writing\n", path);
+        return false;
+    }
+    ranges = (uint16_t *) malloc(sizeof(uint16_t) * 2 * tileCount);
+    tile = (uint16_t *) calloc(1, tileBytes);
+    if (!ranges || !tile) {
+        goto done;
+    }
+    memset(&header, 0, sizeof(header));
+    header.magic = TERRAIN_MAGIC;
+    header.version = TERRAIN_VERSION;
+    header.tileSize = (uint32_t) tileSize;
+    header.tilesX = (uint32_t) tilesX;
+    header.tilesY = (uint32_t) tilesY;
+    header.spacing = spacing;
+    header.heightScale = heightScale;
+    header.heightOffset = heightOffset;
+    // 高度范围表在写完所有块之后回填
+    if (fwrite(&header, sizeof(header), 1, out) != 1 ||
+        fseek(out, (long) dataOffset, SEEK_SET) != 0) {
+        goto done;
+    }
+    for (ty = 0; ty < tilesY; ty++) {
+        for (tx = 0; tx < tilesX; tx++) {
+            uint16_t low = UINT16_MAX;
+            uint16_t high = 0;
+            for (y = 0; y < tileSize; y++) {
+                for (x = 0; x < tileSize; x++) {
+                    uint16_t h = sample(tx * (tileSize - 1) + x, ty * (tileSize - 1) + y, user);
+                    tile[y * tileSize + x] = h;
+                    low = h < low ? h : low;
+                    high = h > high ? h : high;
+                }
+            }
+            ranges[(ty * tilesX + tx) * 2] = low;
+            ranges[(ty * tilesX + tx) * 2 + 1] = high;
+            if (fwrite(tile, 1, tileBytes, out) != tileBytes) {
+                goto done;
+            }
+        }
+    }
+    ok = fseek(out, (long) sizeof(header), SEEK_SET) == 0 &&
+         fwrite(ranges, sizeof(uint16_t) * 2, tileCount, out) == tileCount;
+
+done:
+    free(ranges);
+    free(tile);
+    if (fclose(out) != 0) {
+        ok = false;
+    }
+    if (!ok) {
+        ALOGE("Could not write terrain %s\n", path);
+    }
+    return ok;
+}
+
+bool terrainCacheInit(TerrainCache *cache, int tilesX, int tilesY, int slotCount) {
+    int tileCount = tilesX * tilesY;
+    int i;
+    memset(cache, 0, sizeof(TerrainCache));
+    if (tilesX <= 0 || tilesY <= 0 || slotCount <= 0) {
+        return false;
+    }
+    cache->tileSlot = (int *) malloc(sizeof(int) * tileCount);
+    cache->tileLoading = (uint8_t *) calloc(tileCount, 1);
+    cache->slotTile = (int *) malloc(sizeof(int) * slotCount);
+    cache->lruPrev = (int *) malloc(sizeof(int) * slotCount);
+    cache->lruNext = (int *) malloc(sizeof(int) * slotCount);
+    cache->freeSlots = (int *) malloc(sizeof(int) * slotCount);
+    if (!cache->tileSlot || !cache->tileLoading || !cache->slotTile || !cache->lruPrev ||
+        !cache->lruNext || !cache->freeSlots) {
+        terrainCacheRelease(cache);
+        return false;
+    }
+    for (i = 0; i < tileCount; i++) {
+        cache->tileSlot[i] = -1;
+    }
+    // 空槽按编号从小到大取出
+    for (i = 0; i < slotCount; i++) {
+        cache->slotTile[i] = -1;
+        cache->freeSlots[i] = slotCount - 1 - i;
+    }
+    cache->freeCount = slotCount;
+    cache->tilesX = tilesX;
+    cache->tilesY = tilesY;
+    cache->slotCount = slotCount;
+    cache->lruHead = -1;
+    cache->lruTail = -1;
+    return true;
+}
+
+void terrainCacheRelease(TerrainCache *cache) {
+    free(cache->tileSlot);
+    free(cache->tileLoading);
+    free(cache->slotTile);
+    free(cache->lruPrev);
+    free(cache->lruNext);
+    free(cache->freeSlots);
+    memset(cache, 0, sizeof(TerrainCache));
+}
+
+static bool rectContains(const int rect[4], int x, int y) {
+    return x >= rect[0] && x < rect[1] && y >= rect[2] && y < rect[3];
+}
+
+// 对 a 中不在 b 中的块逐个调用 fn，只遍历两个矩形的差，不遍历整个矩形
+template<typename Fn>
+static void forEachDifference(const int a[4], const int b[4], Fn fn) {
+    int x, y;
+    for (y = a[2]; y < a[3]; y++) {
+        if (y < b[2] || y >= b[3]) {
+            for (x = a[0]; x < a[1]; x++) {
+                fn(x, y);
+            }
+            continue;
+        }
+        for (x = a[0]; x < a[1] && x < b[0]; x++) {
+            fn(x, y);
+        }
+        for (x = a[0] > b[1] ? a[0] : b[1]; x < a[1]; x++) {
+            fn(x, y);
+        }
+    }
+}
+
+static void lruPushHead(TerrainCache *cache, int slot) {
+    cache->lruPrev[slot] = -1;
+    cache->lruNext[slot] = cache->lruHead;
+    if (cache->lruHead >= 0) {
+        cache->lruPrev[cache->lruHead] = slot;
+    } else {
+        cache->lruTail = slot;
+    }
+    cache->lruHead = slot;
+    cache->lruCount++;
+}
+
+static void lruRemove(TerrainCache *cache, int slot) {
+    int prev = cache->lruPrev[slot];
+    int next = cache->lruNext[slot];
+    if (prev >= 0) {
+        cache->lruNext[prev] = next;
+    } else {
+        cache->lruHead = next;
+    }
+    if (next >= 0) {
+        cache->lruPrev[next] = prev;
+    } else {
+        cache->lruTail = prev;
+    }
+    cache->lruCount--;
+}
+
+int terrainCacheSetView(TerrainCache *cache, int x0, int y0, int x1, int y1, TerrainLoad *loads) {
+    int rect[4] = {x0 > 0 ? x0 : 0, x1 < cache->tilesX ? x1 : cache->tilesX,
+                   y0 > 0 ? y0 : 0, y1 < cache->tilesY ? y1 : cache->tilesY};
+    int *old = cache->view;
+    int needed = 0;
+    int released = 0;
+    int pinned = 0;
+    int loadCount = 0;
+    int tilesX = cache->tilesX;
+    if (rect[0] >= rect[1] || rect[2] >= rect[3]) {
+        rect[0] = rect[1] = rect[2] = rect[3] = 0;
+    }
+    // 先只读地统计槽够不够，不够时不做任何修改：
+    // 进入视野的已加载块从链表中取出（不能被淘汰），离开视野的已加载块进入链表
+    forEachDifference(rect, old, [&](int x, int y) {
+        int tile = y * tilesX + x;
+        needed += cache->tileSlot[tile] < 0;
+        pinned += cache->tileSlot[tile] >= 0 && !cache->tileLoading[tile];
+    });
+    forEachDifference(old, rect, [&](int x, int y) {
+        int tile = y * tilesX + x;
+        released += cache->tileSlot[tile] >= 0 && !cache->tileLoading[tile];
+    });
+    // 离开视野时仍在加载的块占着槽，相机快速移动时可能出现，调用者下一帧重试即可，不输出日志
+    if (needed > cache->freeCount + cache->lruCount + released - pinned) {
+        return -1;
+    }
+
+    forEachDifference(old, rect, [&](int x, int y) {
+        int tile = y * tilesX + x;
+        int slot = cache->tileSlot[tile];
+        // 正在加载的块在 terrainCacheLoaded 中进入链表
+        if (slot >= 0 && !cache->tileLoading[tile]) {
+            lruPushHead(cache, slot);
+        }
+        cache->stats.left++;
+    });
+    // 先处理命中的块，避免它们被同一次更新中缺失的块淘汰
+    forEachDifference(rect, old, [&](int x, int y) {
+        int tile = y * tilesX + x;
+        int slot = cache->tileSlot[tile];
+        cache->stats.entered++;
+        if (slot >= 0) {
+            if (!cache->tileLoading[tile]) {
+                lruRemove(cache, slot);
+            }
+            cache->stats.hits++;
+        }
+    });
+    forEachDifference(rect, old, [&](int x, int y) {
+        int tile = y * tilesX + x;
+        int slot = cache->tileSlot[tile];
+        if (slot >= 0) {
+            return;
+        }
+        if (cache->freeCount > 0) {
+            slot = cache->freeSlots[--cache->freeCount];
+        } else {
+            // 淘汰最久未使用的块
+            slot = cache->lruTail;
+            lruRemove(cache, slot);
+            cache->tileSlot[cache->slotTile[slot]] = -1;
+            cache->stats.evictions++;
+            cache->stats.resident--;
+        }
+        cache->slotTile[slot] = tile;
+        cache->tileSlot[tile] = slot;
+        cache->tileLoading[tile] = 1;
+        cache->stats.loading++;
+        cache->stats.misses++;
+        loads[loadCount].tile = tile;
+        loads[loadCount].slot = slot;
+        loadCount++;
+    });
+    memcpy(cache->view, rect, sizeof(rect));
+    cache->stats.visible = (rect[1] - rect[0]) * (rect[3] - rect[2]);
+    return loadCount;
+}
+
+void terrainCacheLoaded(TerrainCache *cache, int tile) {
+    int slot = cache->tileSlot[tile];
+    if (slot < 0 || !cache->tileLoading[tile]) {
+        return;
+    }
+    cache->tileLoading[tile] = 0;
+    cache->stats.loading--;
+    cache->stats.resident++;
+    if (!terrainCacheInView(cache, tile)) {
+        lruPushHead(cache, slot);
+    }
+}
+
+int terrainCacheSlot(const TerrainCache *cache, int tile) {
+    return cache->tileLoading[tile] ? -1 : cache->tileSlot[tile];
+}
+
+bool terrainCacheInView(const TerrainCache *cache, int tile) {
+    return rectContains(cache->view, tile % cache->tilesX, tile / cache->tilesX);
+}
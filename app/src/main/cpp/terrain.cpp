@@ -0,0 +1,339 @@
+#include <EGL/egl.h>
+#include <GLES3/gl3.h>
+#include <climits>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include "include/terrain.h"
+#include "include/mesh-generator.h"
+
+// 网格顶点 i * size + j 位于 (i, j) / (size - 1)，对应块中第 i 行第 j 列的采样，
+// 所以世界坐标取 terrainGrid.yx；交换后从 +z 方向看三角形为逆时针
+const char TERRAIN_VERTEX_GLSL[] =
+        "layout(location = " STRV(TERRAIN_ATTRIB_GRID) ") in vec3 terrainGrid;\n"
+        "layout(location = " STRV(TERRAIN_ATTRIB_HEIGHT) ") in float terrainHeight;\n"
+        "uniform vec4 terrainTile;\n"         // 块原点 xy，块的边长
+        "uniform vec2 terrainHeightScale;\n"  // 高度 = 采样 * x + y
+        "vec3 terrainPosition() {\n"
+        "    return vec3(terrainTile.xy + terrainGrid.yx * terrainTile.z,\n"
+        "                terrainHeight * terrainHeightScale.x + terrainHeightScale.y);\n"
+        "}\n";
+
+static bool initialized;
+// 创建 GL 对象时的上下文，重新初始化时据此判断旧的对象是否还需要删除
+static EGLContext context;
+static TerrainFile file;
+static TerrainCache cache;
+static int viewRadius;
+static int viewTileX;
+static int viewTileY;
+static TerrainLoad *loads;         // terrainCacheSetView 的输出，容量为视野的面积
+static float tileExtent;
+static GLuint gridVbo;
+static GLuint indexVbo;
+static GLuint heightVbo;           // 每个槽 file.tileBytes 字节
+static GLuint *vaos;               // 每个槽一个
+static GLenum indexType;
+static GLsizei indexCount;
+static GLuint lastProgram;
+static GLint tileLocation;
+static GLint heightScaleLocation;
+static TerrainStats stats;
+
+// I/O 线程；staging 中每个槽的区域只在该槽的块加载期间由 I/O 线程写入，上传之前槽不会被重新分配
+static unsigned char *staging;
+static std::thread worker;
+static std::mutex mutex;
+static std::condition_variable wake;
+static std::deque<TerrainLoad> jobs;
+static std::deque<TerrainLoad> done;
+static bool stopping;
+
+static void workerLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        wake.wait(lock, [] { return stopping || !jobs.empty(); });
+        if (stopping) {
+            break;
+        }
+        TerrainLoad load = jobs.front();
+        jobs.pop_front();
+        int next = jobs.empty() ? -1 : jobs.front().tile;
+        lock.unlock();
+        // 拷贝当前块时内核同时读入下一个块
+        if (next >= 0) {
+            terrainFilePrefetch(&file, next);
+        }
+        memcpy(staging + (size_t) load.slot * file.tileBytes, terrainFileTile(&file, load.tile),
+               file.tileBytes);
+        lock.lock();
+        done.push_back(load);
+    }
+}
+
+static void stopWorker() {
+    if (worker.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_one();
+        worker.join();
+    }
+    jobs.clear();
+    done.clear();
+    stopping = false;
+}
+
+// deleteObjects 为 false 时只释放内存，用于上下文已经丢失的情况
+static void resetState(bool deleteObjects) {
+    if (deleteObjects) {
+        if (vaos) {
+            glDeleteVertexArrays(cache.slotCount, vaos);
+        }
+        glDeleteBuffers(1, &gridVbo);
+        glDeleteBuffers(1, &indexVbo);
+        glDeleteBuffers(1, &heightVbo);
+    }
+    free(vaos);
+    free(loads);
+    free(staging);
+    terrainCacheRelease(&cache);
+    terrainFileClose(&file);
+    memset(&stats, 0, sizeof(stats));
+    vaos = NULL;
+    loads = NULL;
+    staging = NULL;
+    gridVbo = 0;
+    indexVbo = 0;
+    heightVbo = 0;
+    lastProgram = 0;
+    viewTileX = INT_MIN;
+    viewTileY = INT_MIN;
+    initialized = false;
+}
+
+//共用的网格顶点和索引，顶点不超过 65536 个时使用 16 位索引
+static bool createGrid(int tileSize) {
+    GridGenerator grid;
+    GLfloat *vertices = NULL;
+    GLuint *indices = NULL;
+    int vertexCount = squareGridVertexCount(tileSize);
+    int i;
+    bool ok = false;
+    if (!gridGeneratorInit(&grid, tileSize)) {
+        return false;
+    }
+    indexCount = squareGridIndexCount(tileSize);
+    vertices = (GLfloat *) malloc(sizeof(GLfloat) * 3 * vertexCount);
+    indices = (GLuint *) malloc(sizeof(GLuint) * indexCount);
+    if (!vertices || !indices) {
+        goto done;
+    }
+    gridGeneratorVertices(&grid, 0, tileSize, vertices);
+    gridGeneratorIndices(&grid, 0, tileSize - 1, indices);
+    glGenBuffers(1, &gridVbo);
+    glBindBuffer(GL_ARRAY_BUFFER, gridVbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * 3 * vertexCount, vertices, GL_STATIC_DRAW);
+    glGenBuffers(1, &indexVbo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexVbo);
+    if (vertexCount <= 65536) {
+        // 原地压缩为 16 位，写入位置总在读取位置之前
+        GLushort *shortIndices = (GLushort *) indices;
+        for (i = 0; i < indexCount; i++) {
+            shortIndices[i] = (GLushort) indices[i];
+        }
+        indexType = GL_UNSIGNED_SHORT;
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLushort) * indexCount, shortIndices,
+                     GL_STATIC_DRAW);
+    } else {
+        indexType = GL_UNSIGNED_INT;
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * indexCount, indices,
+                     GL_STATIC_DRAW);
+    }
+    ok = true;
+
+done:
+    free(vertices);
+    free(indices);
+    gridGeneratorRelease(&grid);
+    return ok;
+}
+
+bool terrainInit(const char *path, int radius, int cacheTiles) {
+    int side = 2 * radius + 1;
+    int slotCount = side * side + (cacheTiles > 0 ? cacheTiles : 0);
+    int slot;
+    // 仍在同一个上下文中时删除旧的对象；上下文重建后旧的对象已随上下文释放，只清理线程和内存
+    stopWorker();
+    resetState(initialized && eglGetCurrentContext() == context);
+    context = eglGetCurrentContext();
+    if (radius < 0 || !terrainFileOpen(&file, path)) {
+        return false;
+    }
+    if (!terrainCacheInit(&cache, (int) file.header.tilesX, (int) file.header.tilesY, slotCount)) {
+        terrainFileClose(&file);
+        return false;
+    }
+    loads = (TerrainLoad *) malloc(sizeof(TerrainLoad) * side * side);
+    vaos = (GLuint *) calloc((size_t) slotCount, sizeof(GLuint));
+    staging = (unsigned char *) malloc(file.tileBytes * slotCount);
+    if (!loads || !vaos || !staging) {
+        resetState(false);
+        return false;
+    }
+    glBindVertexArray(0);
+    if (!createGrid((int) file.header.tileSize)) {
+        resetState(true);
+        return false;
+    }
+    glGenBuffers(1, &heightVbo);
+    glBindBuffer(GL_ARRAY_BUFFER, heightVbo);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr) (file.tileBytes * slotCount), NULL,
+                 GL_DYNAMIC_DRAW);
+    glGenVertexArrays(slotCount, vaos);
+    for (slot = 0; slot < slotCount; slot++) {
+        glBindVertexArray(vaos[slot]);
+        glBindBuffer(GL_ARRAY_BUFFER, gridVbo);
+        glVertexAttribPointer(TERRAIN_ATTRIB_GRID, 3, GL_FLOAT, GL_FALSE, 0, (const void *) 0);
+        glEnableVertexAttribArray(TERRAIN_ATTRIB_GRID);
+        glBindBuffer(GL_ARRAY_BUFFER, heightVbo);
+        glVertexAttribPointer(TERRAIN_ATTRIB_HEIGHT, 1, GL_UNSIGNED_SHORT, GL_FALSE, 0,
+                              (const void *) (file.tileBytes * slot));
+        glEnableVertexAttribArray(TERRAIN_ATTRIB_HEIGHT);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexVbo);
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    if (checkGlError("terrainInit")) {
+        resetState(true);
+        return false;
+    }
+    viewRadius = radius;
+    tileExtent = (float) (file.header.tileSize - 1) * file.header.spacing;
+    worker = std::thread(workerLoop);
+    initialized = true;
+    return true;
+}
+
+bool terrainSetView(float x, float y) {
+    int tileX, tileY, count, i;
+    if (!initialized) {
+        return false;
+    }
+    tileX = (int) floorf(x / tileExtent);
+    tileY = (int) floorf(y / tileExtent);
+    if (tileX == viewTileX && tileY == viewTileY) {
+        return true;
+    }
+    count = terrainCacheSetView(&cache, tileX - viewRadius, tileY - viewRadius,
+                                tileX + viewRadius + 1, tileY + viewRadius + 1, loads);
+    if (count < 0) {
+        return false;
+    }
+    viewTileX = tileX;
+    viewTileY = tileY;
+    if (count > 0) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (i = 0; i < count; i++) {
+                jobs.push_back(loads[i]);
+            }
+        }
+        wake.notify_one();
+        stats.pendingLoads += count;
+    }
+    return true;
+}
+
+void terrainUpdate(int maxUploads) {
+    int i;
+    if (!initialized || stats.pendingLoads == 0) {
+        return;
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, heightVbo);
+    for (i = 0; i < maxUploads; i++) {
+        TerrainLoad load;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (done.empty()) {
+                break;
+            }
+            load = done.front();
+            done.pop_front();
+        }
+        glBufferSubData(GL_ARRAY_BUFFER, (GLintptr) (file.tileBytes * load.slot),
+                        (GLsizeiptr) file.tileBytes, staging + file.tileBytes * load.slot);
+        terrainCacheLoaded(&cache, load.tile);
+        stats.pendingLoads--;
+        stats.tilesUploaded++;
+        stats.bytesUploaded += (long) file.tileBytes;
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+int terrainDraw(GLuint program, const Frustum *frustum) {
+    const int *view = cache.view;
+    int x, y;
+    stats.tilesDrawn = 0;
+    stats.tilesCulled = 0;
+    if (!initialized) {
+        return 0;
+    }
+    if (program != lastProgram) {
+        tileLocation = glGetUniformLocation(program, "terrainTile");
+        heightScaleLocation = glGetUniformLocation(program, "terrainHeightScale");
+        lastProgram = program;
+    }
+    glUniform2f(heightScaleLocation, file.header.heightScale, file.header.heightOffset);
+    for (y = view[2]; y < view[3]; y++) {
+        for (x = view[0]; x < view[1]; x++) {
+            int tile = y * cache.tilesX + x;
+            int slot = terrainCacheSlot(&cache, tile);
+            if (slot < 0) {
+                continue;
+            }
+            if (frustum) {
+                float min[3], max[3], center[3];
+                terrainFileTileBounds(&file, tile, min, max);
+                center[0] = (min[0] + max[0]) * 0.5f;
+                center[1] = (min[1] + max[1]) * 0.5f;
+                center[2] = (min[2] + max[2]) * 0.5f;
+                if (!frustumContainsSphere(frustum, center, sqrtf(
+                        (max[0] - center[0]) * (max[0] - center[0]) +
+                        (max[1] - center[1]) * (max[1] - center[1]) +
+                        (max[2] - center[2]) * (max[2] - center[2])))) {
+                    stats.tilesCulled++;
+                    continue;
+                }
+            }
+            glUniform4f(tileLocation, (float) x * tileExtent, (float) y * tileExtent, tileExtent,
+                        0.0f);
+            glBindVertexArray(vaos[slot]);
+            glDrawElements(GL_TRIANGLES, indexCount, indexType, (const void *) 0);
+            stats.tilesDrawn++;
+        }
+    }
+    glBindVertexArray(0);
+    return stats.tilesDrawn;
+}
+
+void terrainExtent(float *width, float *height) {
+    *width = (float) file.header.tilesX * tileExtent;
+    *height = (float) file.header.tilesY * tileExtent;
+}
+
+const TerrainStats *terrainStats() {
+    stats.cache = cache.stats;
+    return &stats;
+}
+
+void terrainRelease() {
+    stopWorker();
+    if (initialized) {
+        resetState(true);
+    }
+}
@@ -0,0 +1,191 @@
+#include <stdint.h>
+#include <atomic>
+#include <set>
+#include <thread>
+#include "command-buffer.h"
+#include "test-util.h"
+
+// 命令缓冲与无锁队列：容量取整、满/空时的返回值；生产者和消费者线程同时推入、取出几十万个缓冲区时
+// 顺序不变、不丢失；CommandChannel 的缓冲区经 recycle 循环复用，数量不超过上限，framesInFlight 不为负。
+
+#define QUEUE_ITEMS 300000
+#define CHANNEL_BUFFERS 200000
+//每隔几个缓冲区结束一帧
+#define BUFFERS_PER_FRAME 3
+
+//队列只传递指针，不访问缓冲区，用序号代替
+static CommandBuffer *sequenceBuffer(unsigned i) {
+    return (CommandBuffer *) (uintptr_t) (i + 1);
+}
+
+static void testQueueCapacity() {
+    // 5 向上取整为 8
+    SpscQueue queue(5);
+    CommandBuffer buffers[9];
+    EXPECT_TRUE(queue.pop() == NULL);
+    for (int i = 0; i < 8; i++) {
+        EXPECT_TRUE(queue.push(&buffers[i]));
+    }
+    EXPECT_TRUE(!queue.push(&buffers[8]));
+    EXPECT_TRUE(queue.pop() == &buffers[0]);
+    // 取出一个后又能放入一个
+    EXPECT_TRUE(queue.push(&buffers[8]));
+    EXPECT_TRUE(!queue.push(&buffers[0]));
+    for (int i = 1; i <= 8; i++) {
+        EXPECT_TRUE(queue.pop() == &buffers[i]);
+    }
+    EXPECT_TRUE(queue.pop() == NULL);
+    // 索引多次回绕后仍然先进先出
+    for (unsigned round = 0; round < 1000; round++) {
+        for (unsigned i = 0; i < 3; i++) {
+            EXPECT_TRUE(queue.push(sequenceBuffer(round * 3 + i)));
+        }
+        for (unsigned i = 0; i < 3; i++) {
+            EXPECT_TRUE(queue.pop() == sequenceBuffer(round * 3 + i));
+        }
+    }
+    EXPECT_TRUE(queue.pop() == NULL);
+}
+
+static void testQueueThreads() {
+    SpscQueue queue(8);
+    long fullCount = 0, emptyCount = 0, outOfOrder = 0;
+    std::thread producer([&]() {
+        for (unsigned i = 0; i < QUEUE_ITEMS; i++) {
+            while (!queue.push(sequenceBuffer(i))) {
+                fullCount++;
+                std::this_thread::yield();
+            }
+        }
+    });
+    for (unsigned expected = 0; expected < QUEUE_ITEMS;) {
+        CommandBuffer *buffer = queue.pop();
+        if (!buffer) {
+            emptyCount++;
+            std::this_thread::yield();
+            continue;
+        }
+        outOfOrder += buffer != sequenceBuffer(expected);
+        expected++;
+    }
+    producer.join();
+    EXPECT_EQ(0, outOfOrder);
+    EXPECT_TRUE(queue.pop() == NULL);
+    printf("queue: %ld full, %ld empty\n", fullCount, emptyCount);
+}
+
+// 生产者在每个缓冲区里记录序号，消费者检查顺序、内容，并在执行完后归还
+static void testChannelThreads() {
+    CommandChannel *channel = NULL;
+    std::atomic<bool> ready{false};
+    std::atomic<long> producerNegative{0};
+    std::atomic<long> producerOverflow{0};
+    std::thread producer([&]() {
+        CommandChannel own(std::this_thread::get_id());
+        channel = &own;
+        ready.store(true, std::memory_order_release);
+        long negative = 0, overflow = 0;
+        for (int i = 0; i < CHANNEL_BUFFERS; i++) {
+            CommandBuffer *buffer;
+            // 所有缓冲区都在渲染线程一侧时等待归还
+            while (!(buffer = own.begin())) {
+                std::this_thread::yield();
+            }
+            commandViewport(buffer, i, i % BUFFERS_PER_FRAME, 1, 1);
+            commandClear(buffer, GL_COLOR_BUFFER_BIT);
+            if (i % BUFFERS_PER_FRAME == BUFFERS_PER_FRAME - 1) {
+                commandPresent(buffer);
+            }
+            while (!own.submit(buffer)) {
+                std::this_thread::yield();
+            }
+            int inFlight = own.framesInFlight();
+            negative += inFlight < 0;
+            overflow += inFlight > CHANNEL_MAX_BUFFERS;
+        }
+        producerNegative.store(negative);
+        producerOverflow.store(overflow);
+        // 消费者不再访问通道（把 ready 清除）之后才析构
+        while (ready.load(std::memory_order_acquire)) {
+            std::this_thread::yield();
+        }
+    });
+    while (!ready.load(std::memory_order_acquire)) {
+        std::this_thread::yield();
+    }
+
+    std::set<CommandBuffer *> distinct;
+    long outOfOrder = 0, badContent = 0, negative = 0;
+    for (int expected = 0; expected < CHANNEL_BUFFERS;) {
+        CommandBuffer *buffer = channel->acquire();
+        if (!buffer) {
+            std::this_thread::yield();
+            continue;
+        }
+        bool endsFrame = expected % BUFFERS_PER_FRAME == BUFFERS_PER_FRAME - 1;
+        outOfOrder += buffer->count < 1 || buffer->commands[0].type != CMD_VIEWPORT ||
+                      buffer->commands[0].viewport.x != expected;
+        badContent += buffer->count != (endsFrame ? 3 : 2) || buffer->endsFrame != endsFrame ||
+                      buffer->commands[1].type != CMD_CLEAR;
+        distinct.insert(buffer);
+        negative += channel->framesInFlight() < 0;
+        channel->recycle(buffer);
+        negative += channel->framesInFlight() < 0;
+        expected++;
+    }
+    EXPECT_EQ(0, channel->framesInFlight());
+    EXPECT_TRUE(channel->acquire() == NULL);
+    ready.store(false, std::memory_order_release);
+    producer.join();
+
+    EXPECT_EQ(0, outOfOrder);
+    EXPECT_EQ(0, badContent);
+    EXPECT_EQ(0, negative);
+    EXPECT_EQ(0, producerNegative.load());
+    EXPECT_EQ(0, producerOverflow.load());
+    // 缓冲区循环复用，没有超过通道的上限
+    EXPECT_TRUE(!distinct.empty() && distinct.size() <= CHANNEL_MAX_BUFFERS);
+}
+
+// 缓冲区全部提交、没有归还时 begin 返回 NULL；归还一个后又能取到，且是同一个
+static void testChannelRecycle() {
+    CommandChannel channel(std::this_thread::get_id());
+    CommandBuffer *buffers[CHANNEL_MAX_BUFFERS];
+    for (int i = 0; i < CHANNEL_MAX_BUFFERS; i++) {
+        buffers[i] = channel.begin();
+        EXPECT_TRUE(buffers[i] != NULL);
+        commandPresent(buffers[i]);
+        EXPECT_TRUE(channel.submit(buffers[i]));
+        EXPECT_EQ(i + 1, channel.framesInFlight());
+    }
+    EXPECT_TRUE(channel.begin() == NULL);
+
+    CommandBuffer *first = channel.acquire();
+    EXPECT_TRUE(first == buffers[0]);
+    channel.recycle(first);
+    EXPECT_EQ(CHANNEL_MAX_BUFFERS - 1, channel.framesInFlight());
+    CommandBuffer *reused = channel.begin();
+    EXPECT_TRUE(reused == first);
+    // 复用的缓冲区已经清空
+    EXPECT_EQ(0, reused->count);
+    EXPECT_TRUE(!reused->endsFrame);
+    EXPECT_TRUE(channel.begin() == NULL);
+
+    // 不结束一帧的缓冲区不计入 framesInFlight
+    commandClear(reused, GL_COLOR_BUFFER_BIT);
+    EXPECT_TRUE(channel.submit(reused));
+    EXPECT_EQ(CHANNEL_MAX_BUFFERS - 1, channel.framesInFlight());
+    CommandBuffer *buffer;
+    while ((buffer = channel.acquire()) != NULL) {
+        channel.recycle(buffer);
+    }
+    EXPECT_EQ(0, channel.framesInFlight());
+}
+
+int main() {
+    RUN_TEST(testQueueCapacity);
+    RUN_TEST(testQueueThreads);
+    RUN_TEST(testChannelThreads);
+    RUN_TEST(testChannelRecycle);
+    return TEST_RESULT();
+}
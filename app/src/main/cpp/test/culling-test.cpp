@@ -0,0 +1,262 @@
+#include <random>
+#include <vector>
+#include "es-util.h"
+#include "culling.h"
+#include "test-util.h"
+
+// SIMD 路径的乘加顺序与标量不同，离平面距离小于这个值的物体两种结果都接受
+#define BOUNDARY_EPSILON 1e-3
+//不是 SIMD 宽度的整数倍，覆盖尾部的标量处理
+#define OBJECT_COUNT 10007
+#define SCENE_SIZE 400.0f
+
+static void sceneFrustum(Frustum *frustum) {
+    Matrix view, projection, viewProjection;
+    matrixLoadIdentity(&view);
+    translate(&view, 0.0f, -10.0f, 0.0f);
+    rotate(&view, 20.0f, 0.0f, 1.0f, 0.0f);
+    matrixLoadIdentity(&projection);
+    perspective(&projection, 60.0f, 16.0f / 9.0f, 0.1f, 150.0f);
+    matrixMultiply(&viewProjection, &view, &projection);
+    frustumFromMatrix(frustum, &viewProjection);
+}
+
+// 包围球到视锥内侧的最小距离（负数在外侧），双精度计算
+static double sphereMargin(const Frustum *frustum, const float center[3], float radius) {
+    double margin = INFINITY;
+    for (int p = 0; p < 6; p++) {
+        const float *plane = frustum->planes[p];
+        double dist = (double) plane[0] * center[0] + (double) plane[1] * center[1] +
+                      (double) plane[2] * center[2] + plane[3] + radius;
+        margin = dist < margin ? dist : margin;
+    }
+    return margin;
+}
+
+static double boxMargin(const Frustum *frustum, const float min[3], const float max[3]) {
+    double margin = INFINITY;
+    for (int p = 0; p < 6; p++) {
+        const float *plane = frustum->planes[p];
+        double dist = plane[3];
+        for (int k = 0; k < 3; k++) {
+            dist += (double) plane[k] * (plane[k] >= 0.0f ? max[k] : min[k]);
+        }
+        margin = dist < margin ? dist : margin;
+    }
+    return margin;
+}
+
+typedef struct {
+    std::vector<float> center;
+    std::vector<float> radius;
+} Scene;
+
+static void randomScene(Scene *scene, CullSpheres *spheres, CullAabbs *boxes, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> position(-0.5f * SCENE_SIZE, 0.5f * SCENE_SIZE);
+    std::uniform_real_distribution<float> size(0.2f, 6.0f);
+    scene->center.resize(OBJECT_COUNT * 3);
+    scene->radius.resize(OBJECT_COUNT);
+    cullSpheresInit(spheres, OBJECT_COUNT);
+    cullAabbsInit(boxes, OBJECT_COUNT);
+    for (int i = 0; i < OBJECT_COUNT; i++) {
+        float *c = &scene->center[i * 3];
+        c[0] = position(rng);
+        c[1] = position(rng) * 0.1f;
+        c[2] = position(rng);
+        scene->radius[i] = size(rng);
+        float min[3] = {c[0] - scene->radius[i], c[1] - scene->radius[i], c[2] - scene->radius[i]};
+        float max[3] = {c[0] + scene->radius[i], c[1] + scene->radius[i], c[2] + scene->radius[i]};
+        cullSpheresSet(spheres, i, c, scene->radius[i]);
+        cullAabbsSet(boxes, i, min, max);
+    }
+}
+
+static void boxOf(const CullAabbs *boxes, int i, float min[3], float max[3]) {
+    min[0] = boxes->minX[i];
+    min[1] = boxes->minY[i];
+    min[2] = boxes->minZ[i];
+    max[0] = boxes->maxX[i];
+    max[1] = boxes->maxY[i];
+    max[2] = boxes->maxZ[i];
+}
+
+// 与包围盒参照结果比较，返回不一致的物体数；visibleCount 必须等于 visible 中 1 的个数
+static int countBoxMismatches(const Frustum *frustum, const CullAabbs *boxes,
+                              const uint8_t *visible, int visibleCount) {
+    int mismatches = 0;
+    int ones = 0;
+    for (int i = 0; i < boxes->count; i++) {
+        float min[3], max[3];
+        boxOf(boxes, i, min, max);
+        double margin = boxMargin(frustum, min, max);
+        ones += visible[i];
+        if (fabs(margin) > BOUNDARY_EPSILON && visible[i] != (margin >= 0.0)) {
+            mismatches++;
+        }
+    }
+    EXPECT_EQ(ones, visibleCount);
+    return mismatches;
+}
+
+static void testSpheresMatchScalar() {
+    Frustum frustum;
+    Scene scene;
+    CullSpheres spheres;
+    CullAabbs boxes;
+    ThreadPool pool(4);
+    std::vector<uint8_t> expected(OBJECT_COUNT), visible(OBJECT_COUNT);
+    sceneFrustum(&frustum);
+    randomScene(&scene, &spheres, &boxes, 1234);
+    int expectedCount = 0;
+    for (int i = 0; i < OBJECT_COUNT; i++) {
+        expected[i] = frustumContainsSphere(&frustum, &scene.center[i * 3], scene.radius[i]);
+        expectedCount += expected[i];
+    }
+    // 场景需要同时包含可见和被剔除的物体
+    EXPECT_TRUE(expectedCount > 100 && expectedCount < OBJECT_COUNT - 100);
+
+    ThreadPool *pools[] = {NULL, &pool};
+    for (ThreadPool *p : pools) {
+        CullStats stats = {};
+        std::fill(visible.begin(), visible.end(), 2);
+        int count = cullSpheresParallel(&frustum, &spheres, visible.data(), p, &stats);
+        int mismatches = 0;
+        int ones = 0;
+        for (int i = 0; i < OBJECT_COUNT; i++) {
+            double margin = sphereMargin(&frustum, &scene.center[i * 3], scene.radius[i]);
+            ones += visible[i];
+            if (visible[i] != expected[i] && fabs(margin) > BOUNDARY_EPSILON) {
+                mismatches++;
+            }
+        }
+        EXPECT_EQ(0, mismatches);
+        EXPECT_EQ(ones, count);
+        EXPECT_EQ(count, stats.visible);
+        EXPECT_EQ(OBJECT_COUNT - count, stats.culled);
+    }
+
+    // 起点不对齐的子范围，范围外的结果不被改写
+    std::fill(visible.begin(), visible.end(), 2);
+    cullSpheres(&frustum, &spheres, 3, 3 + 2 * 8 + 5, visible.data());
+    EXPECT_EQ(2, visible[2]);
+    EXPECT_EQ(2, visible[3 + 2 * 8 + 5]);
+    for (int i = 3; i < 3 + 2 * 8 + 5; i++) {
+        double margin = sphereMargin(&frustum, &scene.center[i * 3], scene.radius[i]);
+        EXPECT_TRUE(visible[i] == expected[i] || fabs(margin) <= BOUNDARY_EPSILON);
+    }
+    cullSpheresRelease(&spheres);
+    cullAabbsRelease(&boxes);
+}
+
+static void testAabbsMatchReference() {
+    Frustum frustum;
+    Scene scene;
+    CullSpheres spheres;
+    CullAabbs boxes;
+    ThreadPool pool(4);
+    std::vector<uint8_t> visible(OBJECT_COUNT);
+    sceneFrustum(&frustum);
+    randomScene(&scene, &spheres, &boxes, 99);
+    int serial = cullAabbsParallel(&frustum, &boxes, visible.data(), NULL, NULL);
+    EXPECT_EQ(0, countBoxMismatches(&frustum, &boxes, visible.data(), serial));
+    int parallel = cullAabbsParallel(&frustum, &boxes, visible.data(), &pool, NULL);
+    EXPECT_EQ(0, countBoxMismatches(&frustum, &boxes, visible.data(), parallel));
+    EXPECT_EQ(serial, parallel);
+    // 包围盒包含包围球，球可见时盒子一定可见
+    for (int i = 0; i < OBJECT_COUNT; i++) {
+        if (sphereMargin(&frustum, &scene.center[i * 3], scene.radius[i]) > BOUNDARY_EPSILON) {
+            EXPECT_EQ(1, visible[i]);
+        }
+    }
+    cullSpheresRelease(&spheres);
+    cullAabbsRelease(&boxes);
+}
+
+static void checkBvh(Bvh *bvh, const Frustum *frustum, const CullAabbs *boxes, ThreadPool *pool) {
+    std::vector<uint8_t> visible(boxes->count, 2);
+    CullStats stats = {};
+    int count = bvhCull(bvh, frustum, visible.data(), pool, &stats);
+    EXPECT_EQ(0, countBoxMismatches(frustum, boxes, visible.data(), count));
+    EXPECT_EQ(count, stats.visible);
+    EXPECT_EQ(boxes->count - count, stats.culled);
+    // 整棵子树在视锥内外时不逐个测试
+    EXPECT_TRUE(stats.objectsTested < boxes->count);
+}
+
+static void testBvhMatchesReference() {
+    Frustum frustum;
+    Scene scene;
+    CullSpheres spheres;
+    CullAabbs boxes;
+    Bvh bvh;
+    ThreadPool pool(4);
+    sceneFrustum(&frustum);
+    randomScene(&scene, &spheres, &boxes, 7);
+    EXPECT_TRUE(bvhBuild(&bvh, &boxes));
+    checkBvh(&bvh, &frustum, &boxes, NULL);
+    checkBvh(&bvh, &frustum, &boxes, &pool);
+    bvhRelease(&bvh);
+    cullSpheresRelease(&spheres);
+    cullAabbsRelease(&boxes);
+}
+
+// 物体移动后用 bvhUpdateObject 或 bvhSetObject + bvhRefit 更新，结果与重新逐个测试一致
+static void testBvhAfterUpdateAndRefit() {
+    Frustum frustum;
+    Scene scene;
+    CullSpheres spheres;
+    CullAabbs boxes;
+    Bvh bvh;
+    ThreadPool pool(4);
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> offset(-60.0f, 60.0f);
+    sceneFrustum(&frustum);
+    randomScene(&scene, &spheres, &boxes, 2024);
+    EXPECT_TRUE(bvhBuild(&bvh, &boxes));
+
+    // 少量物体大范围移动，逐个更新
+    for (int i = 0; i < OBJECT_COUNT; i += 37) {
+        float min[3], max[3];
+        float dx = offset(rng), dz = offset(rng);
+        boxOf(&boxes, i, min, max);
+        min[0] += dx;
+        max[0] += dx;
+        min[2] += dz;
+        max[2] += dz;
+        cullAabbsSet(&boxes, i, min, max);
+        bvhUpdateObject(&bvh, i, min, max);
+    }
+    checkBvh(&bvh, &frustum, &boxes, NULL);
+    checkBvh(&bvh, &frustum, &boxes, &pool);
+
+    // 大部分物体移动，整体 refit
+    for (int i = 0; i < OBJECT_COUNT; i++) {
+        if (i % 5 == 0) {
+            continue;
+        }
+        float min[3], max[3];
+        float dx = offset(rng) * 0.1f, dy = offset(rng) * 0.1f;
+        boxOf(&boxes, i, min, max);
+        min[0] += dx;
+        max[0] += dx;
+        min[1] += dy;
+        max[1] += dy;
+        cullAabbsSet(&boxes, i, min, max);
+        bvhSetObject(&bvh, i, min, max);
+    }
+    bvhRefit(&bvh);
+    checkBvh(&bvh, &frustum, &boxes, NULL);
+    checkBvh(&bvh, &frustum, &boxes, &pool);
+    bvhRelease(&bvh);
+    cullSpheresRelease(&spheres);
+    cullAabbsRelease(&boxes);
+}
+
+int main() {
+    RUN_TEST(testSpheresMatchScalar);
+    RUN_TEST(testAabbsMatchReference);
+    RUN_TEST(testBvhMatchesReference);
+    RUN_TEST(testBvhAfterUpdateAndRefit);
+    return TEST_RESULT();
+}
@@ -0,0 +1,147 @@
+#include "es-util.h"
+#include "gl-buffer.h"
+#include "gl-stub.h"
+#include "test-util.h"
+
+static void testRingSubAllocate() {
+    GLsizeiptr offset = -1;
+    EXPECT_TRUE(ringSubAllocate(0, 64, 256, 1024, &offset));
+    EXPECT_EQ(0, offset);
+    EXPECT_TRUE(ringSubAllocate(64, 64, 256, 1024, &offset));
+    EXPECT_EQ(256, offset);
+    EXPECT_TRUE(ringSubAllocate(256, 768, 256, 1024, &offset));
+    EXPECT_EQ(256, offset);
+    // 对齐后放不下
+    EXPECT_TRUE(!ringSubAllocate(257, 513, 256, 1024, &offset));
+    EXPECT_TRUE(!ringSubAllocate(0, -1, 256, 1024, &offset));
+    EXPECT_TRUE(ringSubAllocate(3, 4, 1, 8, &offset));
+    EXPECT_EQ(3, offset);
+}
+
+static void testCreateMeshBuffer() {
+    const GLfloat vertices[] = {0, 0, 0, 1, 0, 0, 0, 1, 0};
+    const GLfloat texCoords[] = {0, 0, 1, 0, 0, 1};
+    const GLuint indices[] = {0, 1, 2};
+    MeshBuffer mesh;
+    GLsizeiptr size = 0;
+    glStubReset();
+    EXPECT_TRUE(createMeshBuffer(&mesh, 3, vertices, NULL, texCoords, 3, indices));
+    EXPECT_TRUE(mesh.vao != 0);
+    EXPECT_TRUE(mesh.vbo[VERTEX_ATTRIB_POSITION] != 0);
+    EXPECT_EQ(0, mesh.vbo[VERTEX_ATTRIB_NORMAL]);
+    EXPECT_TRUE(mesh.vbo[VERTEX_ATTRIB_TEXCOORD] != 0);
+    EXPECT_TRUE(mesh.ibo != 0);
+    EXPECT_EQ(3, mesh.indexCount);
+    EXPECT_EQ(GL_UNSIGNED_INT, mesh.indexType);
+    // 数据上传到各自的缓冲区
+    unsigned char *data = glStubBufferData(mesh.vbo[VERTEX_ATTRIB_TEXCOORD], &size);
+    EXPECT_EQ(sizeof(texCoords), size);
+    EXPECT_TRUE(data && memcmp(data, texCoords, sizeof(texCoords)) == 0);
+    data = glStubBufferData(mesh.ibo, &size);
+    EXPECT_EQ(sizeof(indices), size);
+    EXPECT_TRUE(data && memcmp(data, indices, sizeof(indices)) == 0);
+    EXPECT_EQ(2, glStubCount("glVertexAttribPointer"));
+    // 最后解绑 VAO，IBO 的绑定保留在 VAO 中
+    EXPECT_EQ(0, glStubLast("glBindVertexArray")->args[0]);
+
+    glStubReset();
+    drawMeshBuffer(&mesh);
+    EXPECT_EQ(1, glStubCount("glDrawElements"));
+    EXPECT_EQ(3, glStubLast("glDrawElements")->args[1]);
+    mesh.indexCount = 0;
+    drawMeshBuffer(&mesh);
+    EXPECT_EQ(1, glStubCount("glDrawArrays"));
+
+    deleteMeshBuffer(&mesh);
+    EXPECT_EQ(1, glStubCount("glDeleteVertexArrays"));
+    EXPECT_EQ(0, mesh.vao);
+}
+
+static void testCreateMeshBufferReportsGlError() {
+    const GLfloat vertices[] = {0, 0, 0};
+    MeshBuffer mesh;
+    glStubReset();
+    glStubPushError(GL_OUT_OF_MEMORY);
+    EXPECT_TRUE(!createMeshBuffer(&mesh, 1, vertices, NULL, NULL, 0, NULL));
+    deleteMeshBuffer(&mesh);
+}
+
+static void testFencedUniformRing() {
+    UniformRing ring;
+    GLintptr offsets[UNIFORM_RING_SEGMENTS];
+    const float value[4] = {1.0f, 2.0f, 3.0f, 4.0f};
+    GLsizeiptr size = 0;
+    glStubReset();
+    EXPECT_TRUE(uniformRingInit(&ring, 100, UNIFORM_RING_FENCED));
+    // 区段大小按对齐要求向上取整
+    EXPECT_EQ(256, ring.segmentSize);
+    EXPECT_EQ(256 * UNIFORM_RING_SEGMENTS, glStubLast("glBufferData")->args[1]);
+    for (int frame = 0; frame < UNIFORM_RING_SEGMENTS; frame++) {
+        EXPECT_TRUE(uniformRingBeginFrame(&ring));
+        EXPECT_EQ(frame, ring.segment);
+        offsets[frame] = uniformRingPush(&ring, value, sizeof(value));
+        EXPECT_EQ(256 * frame, offsets[frame]);
+        // 第二次写入对齐到下一个 256 字节，超出区段
+        EXPECT_EQ(-1, uniformRingPush(&ring, value, sizeof(value)));
+        uniformRingEndFrame(&ring);
+        EXPECT_TRUE(ring.mapped == NULL);
+    }
+    EXPECT_EQ(UNIFORM_RING_SEGMENTS, glStubCount("glFenceSync"));
+    EXPECT_EQ(0, glStubCount("glClientWaitSync"));
+    unsigned char *data = glStubBufferData(ring.buffer, &size);
+    EXPECT_EQ(256 * UNIFORM_RING_SEGMENTS, size);
+    for (int frame = 0; frame < UNIFORM_RING_SEGMENTS; frame++) {
+        EXPECT_TRUE(data && memcmp(data + offsets[frame], value, sizeof(value)) == 0);
+    }
+
+    // 回到第一个区段时等待它的 fence，fence 超时两次后完成
+    glStubSetFenceTimeouts(2);
+    EXPECT_TRUE(uniformRingBeginFrame(&ring));
+    EXPECT_EQ(0, ring.segment);
+    EXPECT_EQ(0, ring.waitCount);
+    EXPECT_EQ(1, glStubCount("glClientWaitSync"));
+    EXPECT_EQ(1, glStubCount("glDeleteSync"));
+    uniformRingEndFrame(&ring);
+    EXPECT_TRUE(uniformRingBeginFrame(&ring));
+    uniformRingEndFrame(&ring);
+    EXPECT_TRUE(uniformRingBeginFrame(&ring));
+    uniformRingEndFrame(&ring);
+    // 新的 fence 需要等待
+    int waits = glStubCount("glClientWaitSync");
+    EXPECT_TRUE(uniformRingBeginFrame(&ring));
+    EXPECT_EQ(1, ring.waitCount);
+    EXPECT_EQ(waits + 3, glStubCount("glClientWaitSync"));
+    uniformRingEndFrame(&ring);
+
+    uniformRingRelease(&ring);
+    EXPECT_EQ(0, ring.buffer);
+}
+
+static void testOrphanUniformRing() {
+    UniformRing ring;
+    const float value[4] = {5.0f, 6.0f, 7.0f, 8.0f};
+    glStubReset();
+    EXPECT_TRUE(uniformRingInit(&ring, 512, UNIFORM_RING_ORPHAN));
+    for (int frame = 0; frame < 4; frame++) {
+        EXPECT_TRUE(uniformRingBeginFrame(&ring));
+        EXPECT_EQ(0, uniformRingPush(&ring, value, sizeof(value)));
+        EXPECT_EQ(256, uniformRingPush(&ring, value, sizeof(value)));
+        uniformRingBind(&ring, 1, 256, sizeof(value));
+        uniformRingEndFrame(&ring);
+    }
+    // 每帧重新分配存储，不使用 fence
+    EXPECT_EQ(1 + 4, glStubCount("glBufferData"));
+    EXPECT_EQ(0, glStubCount("glFenceSync"));
+    EXPECT_EQ(4, glStubCount("glUnmapBuffer"));
+    EXPECT_EQ(256, glStubLast("glBindBufferRange")->args[2]);
+    uniformRingRelease(&ring);
+}
+
+int main() {
+    RUN_TEST(testRingSubAllocate);
+    RUN_TEST(testCreateMeshBuffer);
+    RUN_TEST(testCreateMeshBufferReportsGlError);
+    RUN_TEST(testFencedUniformRing);
+    RUN_TEST(testOrphanUniformRing);
+    return TEST_RESULT();
+}
@@ -0,0 +1,506 @@
+#include <map>
+#include <string>
+#include <vector>
+#include "gl-stub.h"
+
+static std::vector<GlCall> calls;
+static std::vector<GLenum> errors;
+static std::map<GLuint, std::vector<unsigned char>> buffers;
+static std::map<GLenum, GLuint> boundBuffers;
+static std::map<GLenum, GLuint> boundTextures;
+static std::map<std::pair<GLuint, int>, std::vector<unsigned char>> textures;
+static std::map<long long, int> fenceTimeouts;
+static std::map<GLuint, std::pair<std::string, std::string>> programSources;
+static GLuint nextName = 1;
+static long long nextFence = 1;
+static int timeoutsPerFence = 0;
+// 第一个上下文，glStubSetContext 模拟上下文重建
+#define GL_STUB_CONTEXT ((EGLContext) 1)
+static EGLContext currentContext = GL_STUB_CONTEXT;
+
+static void record(const char *name, long long a0 = 0, long long a1 = 0, long long a2 = 0,
+                   long long a3 = 0) {
+    GlCall call = {name, {a0, a1, a2, a3}};
+    calls.push_back(call);
+}
+
+void glStubReset() {
+    calls.clear();
+    errors.clear();
+    buffers.clear();
+    boundBuffers.clear();
+    boundTextures.clear();
+    textures.clear();
+    fenceTimeouts.clear();
+    programSources.clear();
+    nextName = 1;
+    nextFence = 1;
+    timeoutsPerFence = 0;
+    currentContext = GL_STUB_CONTEXT;
+}
+
+int glStubCallCount() {
+    return (int) calls.size();
+}
+
+const GlCall *glStubCall(int index) {
+    return index >= 0 && index < (int) calls.size() ? &calls[index] : NULL;
+}
+
+int glStubCount(const char *name) {
+    int count = 0;
+    for (const GlCall &call : calls) {
+        if (strcmp(call.name, name) == 0) {
+            count++;
+        }
+    }
+    return count;
+}
+
+const GlCall *glStubLast(const char *name) {
+    for (size_t i = calls.size(); i > 0; i--) {
+        if (strcmp(calls[i - 1].name, name) == 0) {
+            return &calls[i - 1];
+        }
+    }
+    return NULL;
+}
+
+void glStubPushError(GLenum error) {
+    errors.push_back(error);
+}
+
+void glStubSetFenceTimeouts(int timeouts) {
+    timeoutsPerFence = timeouts;
+}
+
+unsigned char *glStubBufferData(GLuint buffer, GLsizeiptr *size) {
+    auto found = buffers.find(buffer);
+    if (found == buffers.end() || found->second.empty()) {
+        return NULL;
+    }
+    if (size) {
+        *size = (GLsizeiptr) found->second.size();
+    }
+    return found->second.data();
+}
+
+unsigned char *glStubTextureData(GLuint texture, int level, size_t *size) {
+    auto found = textures.find(std::make_pair(texture, level));
+    if (found == textures.end() || found->second.empty()) {
+        return NULL;
+    }
+    if (size) {
+        *size = found->second.size();
+    }
+    return found->second.data();
+}
+
+void glStubSetContext(EGLContext context) {
+    currentContext = context;
+}
+
+const char *glStubProgramSource(GLuint program, GLenum shaderType) {
+    auto found = programSources.find(program);
+    if (found == programSources.end()) {
+        return NULL;
+    }
+    return shaderType == GL_VERTEX_SHADER ? found->second.first.c_str()
+                                          : found->second.second.c_str();
+}
+
+EGLContext eglGetCurrentContext() {
+    return currentContext;
+}
+
+// 没有当前的 display，program-builder 不创建工作线程的共享上下文
+EGLDisplay eglGetCurrentDisplay() {
+    return EGL_NO_DISPLAY;
+}
+
+EGLBoolean eglQueryContext(EGLDisplay display, EGLContext context, EGLint attribute,
+                           EGLint *value) {
+    return EGL_FALSE;
+}
+
+EGLBoolean eglChooseConfig(EGLDisplay display, const EGLint *attribs, EGLConfig *configs,
+                           EGLint size, EGLint *numConfigs) {
+    *numConfigs = 0;
+    return EGL_FALSE;
+}
+
+EGLContext eglCreateContext(EGLDisplay display, EGLConfig config, EGLContext shared,
+                            const EGLint *attribs) {
+    return EGL_NO_CONTEXT;
+}
+
+EGLSurface eglCreatePbufferSurface(EGLDisplay display, EGLConfig config, const EGLint *attribs) {
+    return EGL_NO_SURFACE;
+}
+
+EGLBoolean eglDestroyContext(EGLDisplay display, EGLContext context) {
+    return EGL_FALSE;
+}
+
+EGLBoolean eglDestroySurface(EGLDisplay display, EGLSurface surface) {
+    return EGL_FALSE;
+}
+
+EGLBoolean eglMakeCurrent(EGLDisplay display, EGLSurface draw, EGLSurface read,
+                          EGLContext context) {
+    return EGL_FALSE;
+}
+
+EGLBoolean eglReleaseThread() {
+    return EGL_TRUE;
+}
+
+const char *eglQueryString(EGLDisplay display, EGLint name) {
+    return NULL;
+}
+
+__eglMustCastToProperFunctionPointerType eglGetProcAddress(const char *name) {
+    return NULL;
+}
+
+bool checkGlError(const char *funcName) {
+    GLenum err = glGetError();
+    if (err != GL_NO_ERROR) {
+        ALOGE("GL error after %s(): 0x%08x\n", funcName, err);
+        return true;
+    }
+    return false;
+}
+
+bool hasGlExtension(const char *name) {
+    record("hasGlExtension");
+    return false;
+}
+
+GLuint createProgram(const char *vtxSrc, const char *fragSrc, bool binaryRetrievable) {
+    GLuint program = nextName++;
+    programSources[program] = std::make_pair(std::string(vtxSrc), std::string(fragSrc));
+    record("createProgram", program, binaryRetrievable);
+    return program;
+}
+
+static void genNames(const char *name, GLsizei n, GLuint *names) {
+    for (GLsizei i = 0; i < n; i++) {
+        names[i] = nextName++;
+    }
+    record(name, n, n > 0 ? names[0] : 0);
+}
+
+GL_APICALL GLenum GL_APIENTRY glGetError() {
+    GLenum error = GL_NO_ERROR;
+    if (!errors.empty()) {
+        error = errors.front();
+        errors.erase(errors.begin());
+    }
+    record("glGetError", error);
+    return error;
+}
+
+GL_APICALL void GL_APIENTRY glGetIntegerv(GLenum pname, GLint *data) {
+    record("glGetIntegerv", pname);
+    *data = pname == GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT ? 256 : 0;
+}
+
+GL_APICALL void GL_APIENTRY glGenBuffers(GLsizei n, GLuint *names) {
+    genNames("glGenBuffers", n, names);
+}
+
+GL_APICALL void GL_APIENTRY glGenVertexArrays(GLsizei n, GLuint *names) {
+    genNames("glGenVertexArrays", n, names);
+}
+
+GL_APICALL void GL_APIENTRY glDeleteBuffers(GLsizei n, const GLuint *names) {
+    for (GLsizei i = 0; i < n; i++) {
+        buffers.erase(names[i]);
+    }
+    record("glDeleteBuffers", n, n > 0 ? names[0] : 0);
+}
+
+GL_APICALL void GL_APIENTRY glDeleteVertexArrays(GLsizei n, const GLuint *names) {
+    record("glDeleteVertexArrays", n, n > 0 ? names[0] : 0);
+}
+
+GL_APICALL void GL_APIENTRY glBindBuffer(GLenum target, GLuint buffer) {
+    boundBuffers[target] = buffer;
+    record("glBindBuffer", target, buffer);
+}
+
+GL_APICALL void GL_APIENTRY glBindBufferRange(GLenum target, GLuint index, GLuint buffer,
+                                              GLintptr offset, GLsizeiptr size) {
+    record("glBindBufferRange", index, buffer, offset, size);
+}
+
+GL_APICALL void GL_APIENTRY glBufferData(GLenum target, GLsizeiptr size, const void *data,
+                                         GLenum usage) {
+    std::vector<unsigned char> &storage = buffers[boundBuffers[target]];
+    storage.assign((size_t) size, 0);
+    if (data) {
+        memcpy(storage.data(), data, (size_t) size);
+    }
+    record("glBufferData", target, size, data != NULL, usage);
+}
+
+GL_APICALL void GL_APIENTRY glBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size,
+                                            const void *data) {
+    std::vector<unsigned char> &storage = buffers[boundBuffers[target]];
+    if (offset >= 0 && size > 0 && (size_t) (offset + size) <= storage.size()) {
+        memcpy(storage.data() + offset, data, (size_t) size);
+    }
+    record("glBufferSubData", target, offset, size);
+}
+
+GL_APICALL void *GL_APIENTRY glMapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length,
+                                              GLbitfield access) {
+    std::vector<unsigned char> &storage = buffers[boundBuffers[target]];
+    record("glMapBufferRange", target, offset, length, access);
+    if (offset < 0 || length <= 0 || (size_t) (offset + length) > storage.size()) {
+        return NULL;
+    }
+    return storage.data() + offset;
+}
+
+GL_APICALL GLboolean GL_APIENTRY glUnmapBuffer(GLenum target) {
+    record("glUnmapBuffer", target);
+    return GL_TRUE;
+}
+
+GL_APICALL void GL_APIENTRY glBindVertexArray(GLuint array) {
+    record("glBindVertexArray", array);
+}
+
+GL_APICALL void GL_APIENTRY glVertexAttribPointer(GLuint index, GLint size, GLenum type,
+                                                  GLboolean normalized, GLsizei stride,
+                                                  const void *pointer) {
+    record("glVertexAttribPointer", index, size, type, stride);
+}
+
+GL_APICALL void GL_APIENTRY glEnableVertexAttribArray(GLuint index) {
+    record("glEnableVertexAttribArray", index);
+}
+
+GL_APICALL void GL_APIENTRY glUseProgram(GLuint program) {
+    record("glUseProgram", program);
+}
+
+GL_APICALL GLint GL_APIENTRY glGetUniformLocation(GLuint program, const GLchar *name) {
+    record("glGetUniformLocation", program);
+    return 0;
+}
+
+GL_APICALL void GL_APIENTRY glUniform2f(GLint location, GLfloat v0, GLfloat v1) {
+    record("glUniform2f", location);
+}
+
+GL_APICALL void GL_APIENTRY glUniform4f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2,
+                                        GLfloat v3) {
+    // 地形绘制时为块的原点和边长，记录整数部分
+    record("glUniform4f", location, (long long) v0, (long long) v1, (long long) v2);
+}
+
+GL_APICALL void GL_APIENTRY glActiveTexture(GLenum texture) {
+    record("glActiveTexture", texture);
+}
+
+GL_APICALL void GL_APIENTRY glGenTextures(GLsizei n, GLuint *names) {
+    genNames("glGenTextures", n, names);
+}
+
+GL_APICALL void GL_APIENTRY glDeleteTextures(GLsizei n, const GLuint *names) {
+    for (GLsizei i = 0; i < n; i++) {
+        for (auto it = textures.begin(); it != textures.end();) {
+            it = it->first.first == names[i] ? textures.erase(it) : std::next(it);
+        }
+    }
+    record("glDeleteTextures", n, n > 0 ? names[0] : 0);
+}
+
+GL_APICALL void GL_APIENTRY glBindTexture(GLenum target, GLuint texture) {
+    boundTextures[target] = texture;
+    record("glBindTexture", target, texture);
+}
+
+GL_APICALL void GL_APIENTRY glTexParameteri(GLenum target, GLenum pname, GLint param) {
+    record("glTexParameteri", target, pname, param);
+}
+
+GL_APICALL void GL_APIENTRY glTexImage2D(GLenum target, GLint level, GLint internalFormat,
+                                         GLsizei width, GLsizei height, GLint border,
+                                         GLenum format, GLenum type, const void *pixels) {
+    record("glTexImage2D", level, internalFormat, width, height);
+}
+
+GL_APICALL void GL_APIENTRY glTexStorage2D(GLenum target, GLsizei levels, GLenum internalFormat,
+                                           GLsizei width, GLsizei height) {
+    record("glTexStorage2D", levels, internalFormat, width, height);
+}
+
+//从绑定的 PIXEL_UNPACK 缓冲区读取 size 字节，追加到当前纹理第 level 级的数据之后
+static void appendUnpackData(GLint level, const void *offset, size_t size) {
+    auto found = buffers.find(boundBuffers[GL_PIXEL_UNPACK_BUFFER]);
+    size_t begin = (size_t) (intptr_t) offset;
+    if (found == buffers.end() || begin + size > found->second.size()) {
+        return;
+    }
+    std::vector<unsigned char> &data = textures[std::make_pair(boundTextures[GL_TEXTURE_2D], level)];
+    data.insert(data.end(), found->second.begin() + begin, found->second.begin() + begin + size);
+}
+
+GL_APICALL void GL_APIENTRY glTexSubImage2D(GLenum target, GLint level, GLint x, GLint y,
+                                            GLsizei width, GLsizei height, GLenum format,
+                                            GLenum type, const void *pixels) {
+    if (format == GL_RGBA && type == GL_UNSIGNED_BYTE) {
+        appendUnpackData(level, pixels, (size_t) width * height * 4);
+    }
+    record("glTexSubImage2D", level, y, width, height);
+}
+
+GL_APICALL void GL_APIENTRY glCompressedTexSubImage2D(GLenum target, GLint level, GLint x, GLint y,
+                                                      GLsizei width, GLsizei height, GLenum format,
+                                                      GLsizei imageSize, const void *data) {
+    appendUnpackData(level, data, (size_t) imageSize);
+    record("glCompressedTexSubImage2D", level, y, height, imageSize);
+}
+
+GL_APICALL void GL_APIENTRY glDrawArrays(GLenum mode, GLint first, GLsizei count) {
+    record("glDrawArrays", mode, first, count);
+}
+
+GL_APICALL void GL_APIENTRY glDrawArraysInstanced(GLenum mode, GLint first, GLsizei count,
+                                                  GLsizei instanceCount) {
+    record("glDrawArraysInstanced", mode, first, count, instanceCount);
+}
+
+GL_APICALL void GL_APIENTRY glDrawElements(GLenum mode, GLsizei count, GLenum type,
+                                           const void *indices) {
+    record("glDrawElements", mode, count, type);
+}
+
+GL_APICALL void GL_APIENTRY glDrawElementsInstanced(GLenum mode, GLsizei count, GLenum type,
+                                                    const void *indices, GLsizei instanceCount) {
+    record("glDrawElementsInstanced", mode, count, type, instanceCount);
+}
+
+GL_APICALL GLsync GL_APIENTRY glFenceSync(GLenum condition, GLbitfield flags) {
+    long long fence = nextFence++;
+    fenceTimeouts[fence] = timeoutsPerFence;
+    record("glFenceSync", fence);
+    return (GLsync) (intptr_t) fence;
+}
+
+GL_APICALL GLenum GL_APIENTRY glClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout) {
+    long long fence = (long long) (intptr_t) sync;
+    GLenum result = GL_CONDITION_SATISFIED;
+    if (fenceTimeouts[fence] > 0) {
+        fenceTimeouts[fence]--;
+        result = GL_TIMEOUT_EXPIRED;
+    }
+    record("glClientWaitSync", fence, (long long) timeout, result);
+    return result;
+}
+
+GL_APICALL void GL_APIENTRY glDeleteSync(GLsync sync) {
+    fenceTimeouts.erase((long long) (intptr_t) sync);
+    record("glDeleteSync", (long long) (intptr_t) sync);
+}
+
+GL_APICALL void GL_APIENTRY glFlush() {
+    record("glFlush");
+}
+
+GL_APICALL const GLubyte *GL_APIENTRY glGetString(GLenum name) {
+    record("glGetString", name);
+    return (const GLubyte *) "";
+}
+
+// 以下供 program-builder、program-cache 链接；同步构建和不使用缓存时只会调用 glDeleteShader/glDeleteProgram
+GL_APICALL GLuint GL_APIENTRY glCreateShader(GLenum type) {
+    GLuint shader = nextName++;
+    record("glCreateShader", type, shader);
+    return shader;
+}
+
+GL_APICALL void GL_APIENTRY glDeleteShader(GLuint shader) {
+    record("glDeleteShader", shader);
+}
+
+GL_APICALL void GL_APIENTRY glShaderSource(GLuint shader, GLsizei count,
+                                           const GLchar *const *string, const GLint *length) {
+    record("glShaderSource", shader, count);
+}
+
+GL_APICALL void GL_APIENTRY glCompileShader(GLuint shader) {
+    record("glCompileShader", shader);
+}
+
+GL_APICALL void GL_APIENTRY glGetShaderiv(GLuint shader, GLenum pname, GLint *params) {
+    record("glGetShaderiv", shader, pname);
+    *params = pname == GL_COMPILE_STATUS ? GL_TRUE : 0;
+}
+
+GL_APICALL void GL_APIENTRY glGetShaderInfoLog(GLuint shader, GLsizei bufSize, GLsizei *length,
+                                               GLchar *infoLog) {
+    record("glGetShaderInfoLog", shader);
+    if (length) {
+        *length = 0;
+    }
+    if (bufSize > 0) {
+        infoLog[0] = '\0';
+    }
+}
+
+GL_APICALL GLuint GL_APIENTRY glCreateProgram() {
+    GLuint program = nextName++;
+    record("glCreateProgram", program);
+    return program;
+}
+
+GL_APICALL void GL_APIENTRY glDeleteProgram(GLuint program) {
+    programSources.erase(program);
+    record("glDeleteProgram", program);
+}
+
+GL_APICALL void GL_APIENTRY glAttachShader(GLuint program, GLuint shader) {
+    record("glAttachShader", program, shader);
+}
+
+GL_APICALL void GL_APIENTRY glProgramParameteri(GLuint program, GLenum pname, GLint value) {
+    record("glProgramParameteri", program, pname, value);
+}
+
+GL_APICALL void GL_APIENTRY glLinkProgram(GLuint program) {
+    record("glLinkProgram", program);
+}
+
+GL_APICALL void GL_APIENTRY glGetProgramiv(GLuint program, GLenum pname, GLint *params) {
+    record("glGetProgramiv", program, pname);
+    *params = pname == GL_LINK_STATUS ? GL_TRUE : 0;
+}
+
+GL_APICALL void GL_APIENTRY glGetProgramInfoLog(GLuint program, GLsizei bufSize, GLsizei *length,
+                                                GLchar *infoLog) {
+    record("glGetProgramInfoLog", program);
+    if (length) {
+        *length = 0;
+    }
+    if (bufSize > 0) {
+        infoLog[0] = '\0';
+    }
+}
+
+GL_APICALL void GL_APIENTRY glGetProgramBinary(GLuint program, GLsizei bufSize, GLsizei *length,
+                                               GLenum *binaryFormat, void *binary) {
+    record("glGetProgramBinary", program, bufSize);
+    if (length) {
+        *length = 0;
+    }
+}
+
+GL_APICALL void GL_APIENTRY glProgramBinary(GLuint program, GLenum binaryFormat,
+                                            const void *binary, GLsizei length) {
+    record("glProgramBinary", program, binaryFormat, length);
+}
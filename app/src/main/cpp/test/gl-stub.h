@@ -0,0 +1,45 @@
+#ifndef GLES_GL_STUB_H
+#define GLES_GL_STUB_H
+
+#include <EGL/egl.h>
+#include "es-util.h"
+
+// 主机测试用的 GL 桩：不需要 GL 上下文，按调用顺序记录各 GL 函数及其整数参数。
+// 对象名从 1 开始递增分配；glBufferData 为缓冲区分配内存，glMapBufferRange 返回其中的地址，
+// 测试可以检查写入的数据；从 PIXEL_UNPACK 缓冲区上传的纹理数据按级别依次拼接保存；
+// fence 可以设置先超时若干次。
+// 主机构建的 es-util.cpp 不含 GL 部分，checkGlError、hasGlExtension（总是返回 false）、
+// createProgram（不编译，保存源码后分配程序名）也由这里实现；
+// eglGetCurrentContext 返回 glStubSetContext 设置的上下文，eglGetCurrentDisplay 返回 EGL_NO_DISPLAY，
+// 所以 programBuilderInit 选择同步构建。
+
+#define GL_STUB_MAX_ARGS 4
+
+typedef struct {
+    const char *name;                   // 函数名，例如 "glBindBuffer"
+    long long args[GL_STUB_MAX_ARGS];   // 整数参数，指针参数不记录
+} GlCall;
+
+//清空调用记录、对象、缓冲区内容、待返回的错误和 fence 设置，恢复第一个上下文
+void glStubReset();
+int glStubCallCount();
+const GlCall *glStubCall(int index);
+//name 被调用的次数
+int glStubCount(const char *name);
+//最后一次调用 name 的记录，没有时返回 NULL
+const GlCall *glStubLast(const char *name);
+//之后的 glGetError 依次返回 error
+void glStubPushError(GLenum error);
+//之后创建的 fence 在前 timeouts 次 glClientWaitSync 时返回 GL_TIMEOUT_EXPIRED
+void glStubSetFenceTimeouts(int timeouts);
+//缓冲区对象的存储，没有分配时返回 NULL
+unsigned char *glStubBufferData(GLuint buffer, GLsizeiptr *size);
+//按上传顺序拼接的 texture 第 level 级的数据（glTexSubImage2D 只支持 RGBA/UNSIGNED_BYTE），
+//没有上传过时返回 NULL
+unsigned char *glStubTextureData(GLuint texture, int level, size_t *size);
+//之后 eglGetCurrentContext 返回 context，模拟上下文丢失后重建
+void glStubSetContext(EGLContext context);
+//createProgram 创建 program 时的源码，shaderType 为 GL_VERTEX_SHADER 或 GL_FRAGMENT_SHADER，没有时返回 NULL
+const char *glStubProgramSource(GLuint program, GLenum shaderType);
+
+#endif
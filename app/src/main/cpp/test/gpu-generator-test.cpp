@@ -0,0 +1,422 @@
+#include <EGL/egl.h>
+#include <GLES3/gl31.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "es-util.h"
+#include "gpu-generator.h"
+#include "mesh-generator.h"
+#include "mesh-optimizer.h"
+#include "test-util.h"
+
+// 在 Mesa（llvmpipe）的无窗口 EGL 上下文中运行 GPU 生成，以 CPU 实现为参考：
+// 1. 读回两种后端生成的球体、网格和实例数据，与关闭优化时的 createSphereInto/createSquareGridInto
+//    及不剔除的 recordInstances 逐项比较，索引必须完全相同；
+// 2. 把 GPU 生成的网格和实例真正用于绘制，与上传 CPU 结果（包括打开优化后重排的网格）的绘制结果比较。
+// 没有可用的 EGL/GLES 3.0 时返回 77，ctest 记为跳过。
+
+#define TEST_SKIPPED 77
+#define SPHERE_SLICES 40
+#define SPHERE_RADIUS 1.5f
+#define GRID_SIZE 33
+#define OBJECT_COUNT 300
+//浮点结果允许的误差：GPU 的 sin/cos 与 CPU 的系数表计算方式不同
+#define FLOAT_TOLERANCE 1e-5f
+#define IMAGE_SIZE 96
+//与软件光栅化器的金标准图像相同：每个通道最多相差 2，最多 8 个像素不同
+#define PIXEL_TOLERANCE 2
+#define MAX_DIFFERENT_PIXELS 8
+
+static const char MESH_VERTEX_SHADER[] =
+        "#version 300 es\n"
+        "layout(location = 0) in vec4 vPosition;\n"
+        "layout(location = 1) in vec3 vNormal;\n"
+        "layout(location = 2) in vec2 vTexCoord;\n"
+        "uniform mat4 mvp;\n"
+        "out vec4 vColor;\n"
+        "void main(){\n"
+        "gl_Position = mvp * vPosition;\n"
+        "vColor = vec4(vTexCoord, vNormal.z * 0.5 + 0.5, 1.0) + vec4(vPosition.xy, 0.0, 0.0);\n"
+        "}\n";
+static const char INSTANCED_VERTEX_HEADER[] =
+        "#version 300 es\n"
+        "layout(location = 0) in vec4 vPosition;\n";
+static const char INSTANCED_VERTEX_BODY[] =
+        "out vec4 vColor;\n"
+        "void main(){\n"
+        "gl_Position = instanceMatrix * vPosition;\n"
+        "vColor = instanceColor;\n"
+        "}\n";
+static const char FRAGMENT_SHADER[] =
+        "#version 300 es\n"
+        "precision mediump float;\n"
+        "in vec4 vColor;\n"
+        "out vec4 fragColor;\n"
+        "void main(){\n"
+        "fragColor = vColor;\n"
+        "}\n";
+
+typedef struct {
+    EGLDisplay display;
+    EGLContext context;
+    GLuint framebuffer;
+    GLuint renderbuffers[2];
+    GLuint meshProgram;
+    GLuint instancedProgram;
+} TestContext;
+
+static TestContext ctx;
+
+static bool createContext() {
+    static const EGLint configAttribs[] = {
+            EGL_RENDERABLE_TYPE, EGL_OPENGL_ES3_BIT,
+            // 默认要求窗口表面，无窗口的平台只有 pbuffer 配置
+            EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+            EGL_NONE
+    };
+    // 优先 GLES 3.1，这样也能测试计算着色器后端
+    static const EGLint versions[][2] = {{3, 1}, {3, 0}};
+    EGLConfig config;
+    EGLint numConfigs = 0;
+    size_t i;
+    ctx.display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (ctx.display == EGL_NO_DISPLAY || !eglInitialize(ctx.display, NULL, NULL) ||
+        !eglBindAPI(EGL_OPENGL_ES_API) ||
+        !eglChooseConfig(ctx.display, configAttribs, &config, 1, &numConfigs) || numConfigs < 1) {
+        return false;
+    }
+    for (i = 0; i < sizeof(versions) / sizeof(versions[0]); i++) {
+        const EGLint contextAttribs[] = {
+                EGL_CONTEXT_MAJOR_VERSION, versions[i][0],
+                EGL_CONTEXT_MINOR_VERSION, versions[i][1],
+                EGL_NONE
+        };
+        ctx.context = eglCreateContext(ctx.display, config, EGL_NO_CONTEXT, contextAttribs);
+        if (ctx.context != EGL_NO_CONTEXT) {
+            break;
+        }
+    }
+    // 不创建表面，绘制到自己的 FBO
+    return ctx.context != EGL_NO_CONTEXT &&
+           eglMakeCurrent(ctx.display, EGL_NO_SURFACE, EGL_NO_SURFACE, ctx.context);
+}
+
+static bool createTargets() {
+    char vertexShader[1024];
+    glGenFramebuffers(1, &ctx.framebuffer);
+    glGenRenderbuffers(2, ctx.renderbuffers);
+    glBindRenderbuffer(GL_RENDERBUFFER, ctx.renderbuffers[0]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, IMAGE_SIZE, IMAGE_SIZE);
+    glBindRenderbuffer(GL_RENDERBUFFER, ctx.renderbuffers[1]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, IMAGE_SIZE, IMAGE_SIZE);
+    glBindFramebuffer(GL_FRAMEBUFFER, ctx.framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER,
+                              ctx.renderbuffers[0]);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER,
+                              ctx.renderbuffers[1]);
+    glViewport(0, 0, IMAGE_SIZE, IMAGE_SIZE);
+    snprintf(vertexShader, sizeof(vertexShader), "%s%s%s", INSTANCED_VERTEX_HEADER,
+             INSTANCE_ATTRIBS_GLSL, INSTANCED_VERTEX_BODY);
+    ctx.meshProgram = createProgram(MESH_VERTEX_SHADER, FRAGMENT_SHADER);
+    ctx.instancedProgram = createProgram(vertexShader, FRAGMENT_SHADER);
+    return glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE &&
+           ctx.meshProgram && ctx.instancedProgram;
+}
+
+static void destroyContext() {
+    glDeleteProgram(ctx.meshProgram);
+    glDeleteProgram(ctx.instancedProgram);
+    glDeleteRenderbuffers(2, ctx.renderbuffers);
+    glDeleteFramebuffers(1, &ctx.framebuffer);
+    eglMakeCurrent(ctx.display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroyContext(ctx.display, ctx.context);
+    eglTerminate(ctx.display);
+}
+
+//读回 buffer 中 offset 开始的 size 字节；先拷贝到临时缓冲区，实例流的缓冲区可能已被持久映射
+static bool readBack(GLuint buffer, GLintptr offset, GLsizeiptr size, void *dst) {
+    GLuint copy;
+    glGenBuffers(1, &copy);
+    glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, copy);
+    glBufferData(GL_COPY_WRITE_BUFFER, size, NULL, GL_STREAM_READ);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, offset, 0, size);
+    void *src = glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, size, GL_MAP_READ_BIT);
+    if (src) {
+        memcpy(dst, src, (size_t) size);
+        glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    glDeleteBuffers(1, &copy);
+    return src != NULL;
+}
+
+static float maxDifference(const GLfloat *a, const GLfloat *b, size_t n) {
+    float diff = 0.0f;
+    size_t i;
+    for (i = 0; i < n; i++) {
+        float d = fabsf(a[i] - b[i]);
+        diff = d > diff ? d : diff;
+    }
+    return diff;
+}
+
+static void beginImage(bool cullFace) {
+    glBindFramebuffer(GL_FRAMEBUFFER, ctx.framebuffer);
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glEnable(GL_DEPTH_TEST);
+    if (cullFace) {
+        glEnable(GL_CULL_FACE);
+    }
+}
+
+static std::vector<unsigned char> readImage() {
+    std::vector<unsigned char> pixels(IMAGE_SIZE * IMAGE_SIZE * 4);
+    glReadPixels(0, 0, IMAGE_SIZE, IMAGE_SIZE, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_CULL_FACE);
+    return pixels;
+}
+
+static void drawMesh(const MeshBuffer *mesh, const Matrix *mvp, bool cullFace) {
+    beginImage(cullFace);
+    glUseProgram(ctx.meshProgram);
+    glUniformMatrix4fv(glGetUniformLocation(ctx.meshProgram, "mvp"), 1, GL_FALSE, &mvp->m[0][0]);
+    drawMeshBuffer(mesh);
+    glUseProgram(0);
+}
+
+static int differentPixels(const std::vector<unsigned char> &a,
+                           const std::vector<unsigned char> &b) {
+    int count = 0;
+    for (size_t i = 0; i < a.size(); i += 4) {
+        for (size_t c = 0; c < 4; c++) {
+            if (abs((int) a[i + c] - (int) b[i + c]) > PIXEL_TOLERANCE) {
+                count++;
+                break;
+            }
+        }
+    }
+    return count;
+}
+
+//不是背景色的像素数，确认物体确实画在了图像中
+static int coveredPixels(const std::vector<unsigned char> &image) {
+    int count = 0;
+    for (size_t i = 0; i < image.size(); i += 4) {
+        count += image[i] != 0 || image[i + 1] != 0 || image[i + 2] != 0;
+    }
+    return count;
+}
+
+static void meshTransform(Matrix *mvp, float distance, float angle) {
+    Matrix proj;
+    matrixLoadIdentity(mvp);
+    translate(mvp, 0.0f, 0.0f, -distance);
+    rotate(mvp, angle, 1.0f, 1.0f, 0.0f);
+    matrixLoadIdentity(&proj);
+    perspective(&proj, 60.0f, 1.0f, 0.1f, 100.0f);
+    matrixMultiply(mvp, mvp, &proj);
+}
+
+static void testSphere() {
+    int numVertices = sphereVertexCount(SPHERE_SLICES);
+    int numIndices = sphereIndexCount(SPHERE_SLICES);
+    std::vector<GLfloat> expected((size_t) numVertices * 8);
+    std::vector<GLfloat> actual((size_t) numVertices * 8);
+    std::vector<GLuint> expectedIndices((size_t) numIndices);
+    std::vector<GLuint> actualIndices((size_t) numIndices);
+    GLfloat *positions = expected.data();
+    GLfloat *normals = positions + numVertices * 3;
+    GLfloat *texCoords = normals + numVertices * 3;
+    MeshBuffer gpuMesh, cpuMesh, optimizedMesh;
+    Matrix mvp;
+    memset(&gpuMesh, 0, sizeof(MeshBuffer));
+    memset(&cpuMesh, 0, sizeof(MeshBuffer));
+    memset(&optimizedMesh, 0, sizeof(MeshBuffer));
+
+    EXPECT_EQ(numIndices, createSphereInto(SPHERE_SLICES, SPHERE_RADIUS, positions, normals,
+                                           texCoords, expectedIndices.data(), NULL, false));
+    EXPECT_TRUE(gpuCreateSphereMesh(&gpuMesh, SPHERE_SLICES, SPHERE_RADIUS));
+    EXPECT_EQ(numVertices, gpuMesh.vertexCount);
+    EXPECT_EQ(numIndices, gpuMesh.indexCount);
+    EXPECT_TRUE(readBack(gpuMesh.vbo[VERTEX_ATTRIB_POSITION], 0,
+                         sizeof(GLfloat) * 3 * numVertices, actual.data()));
+    EXPECT_TRUE(readBack(gpuMesh.vbo[VERTEX_ATTRIB_NORMAL], 0,
+                         sizeof(GLfloat) * 3 * numVertices, actual.data() + numVertices * 3));
+    EXPECT_TRUE(readBack(gpuMesh.vbo[VERTEX_ATTRIB_TEXCOORD], 0,
+                         sizeof(GLfloat) * 2 * numVertices, actual.data() + numVertices * 6));
+    EXPECT_TRUE(readBack(gpuMesh.ibo, 0, sizeof(GLuint) * numIndices, actualIndices.data()));
+    EXPECT_NEAR(0.0, maxDifference(expected.data(), actual.data(), expected.size()),
+                FLOAT_TOLERANCE);
+    EXPECT_TRUE(expectedIndices == actualIndices);
+
+    // 上传 CPU 结果后绘制，GPU 生成的网格应得到相同的图像
+    EXPECT_TRUE(createMeshBuffer(&cpuMesh, numVertices, positions, normals, texCoords, numIndices,
+                                 expectedIndices.data()));
+    meshTransform(&mvp, 4.0f, 30.0f);
+    drawMesh(&cpuMesh, &mvp, true);
+    std::vector<unsigned char> cpuImage = readImage();
+    drawMesh(&gpuMesh, &mvp, true);
+    std::vector<unsigned char> gpuImage = readImage();
+    EXPECT_TRUE(coveredPixels(cpuImage) > IMAGE_SIZE * IMAGE_SIZE / 4);
+    EXPECT_TRUE(differentPixels(cpuImage, gpuImage) <= MAX_DIFFERENT_PIXELS);
+
+    // 打开优化后 CPU 的索引和顶点顺序不同，但画出的是同一个球体
+    EXPECT_EQ(numIndices, createSphereInto(SPHERE_SLICES, SPHERE_RADIUS, positions, normals,
+                                           texCoords, expectedIndices.data(), NULL, true));
+    EXPECT_TRUE(expectedIndices != actualIndices);
+    EXPECT_TRUE(createMeshBuffer(&optimizedMesh, numVertices, positions, normals, texCoords,
+                                 numIndices, expectedIndices.data()));
+    drawMesh(&optimizedMesh, &mvp, true);
+    EXPECT_TRUE(differentPixels(readImage(), gpuImage) <= MAX_DIFFERENT_PIXELS);
+    EXPECT_TRUE(!checkGlError("testSphere"));
+
+    deleteMeshBuffer(&gpuMesh);
+    deleteMeshBuffer(&cpuMesh);
+    deleteMeshBuffer(&optimizedMesh);
+}
+
+static void testSquareGrid() {
+    int numVertices = squareGridVertexCount(GRID_SIZE);
+    int numIndices = squareGridIndexCount(GRID_SIZE);
+    std::vector<GLfloat> expected((size_t) numVertices * 3);
+    std::vector<GLfloat> actual((size_t) numVertices * 3);
+    std::vector<GLuint> expectedIndices((size_t) numIndices);
+    std::vector<GLuint> actualIndices((size_t) numIndices);
+    MeshBuffer gpuMesh, cpuMesh;
+    Matrix mvp;
+    memset(&gpuMesh, 0, sizeof(MeshBuffer));
+    memset(&cpuMesh, 0, sizeof(MeshBuffer));
+
+    EXPECT_EQ(numIndices, createSquareGridInto(GRID_SIZE, expected.data(), expectedIndices.data(),
+                                               NULL, false));
+    EXPECT_TRUE(gpuCreateSquareGridMesh(&gpuMesh, GRID_SIZE));
+    EXPECT_TRUE(readBack(gpuMesh.vbo[VERTEX_ATTRIB_POSITION], 0,
+                         sizeof(GLfloat) * 3 * numVertices, actual.data()));
+    EXPECT_TRUE(readBack(gpuMesh.ibo, 0, sizeof(GLuint) * numIndices, actualIndices.data()));
+    EXPECT_NEAR(0.0, maxDifference(expected.data(), actual.data(), expected.size()),
+                FLOAT_TOLERANCE);
+    EXPECT_TRUE(expectedIndices == actualIndices);
+
+    EXPECT_TRUE(createMeshBuffer(&cpuMesh, numVertices, expected.data(), NULL, NULL, numIndices,
+                                 expectedIndices.data()));
+    // 网格在 [0, 1] 范围内，两面都可能朝向相机，不剔除
+    meshTransform(&mvp, 1.5f, 20.0f);
+    drawMesh(&cpuMesh, &mvp, false);
+    std::vector<unsigned char> cpuImage = readImage();
+    drawMesh(&gpuMesh, &mvp, false);
+    std::vector<unsigned char> gpuImage = readImage();
+    EXPECT_TRUE(coveredPixels(cpuImage) > 0);
+    EXPECT_TRUE(differentPixels(cpuImage, gpuImage) <= MAX_DIFFERENT_PIXELS);
+    EXPECT_TRUE(!checkGlError("testSquareGrid"));
+
+    deleteMeshBuffer(&gpuMesh);
+    deleteMeshBuffer(&cpuMesh);
+}
+
+//位置、旋转轴、角度和缩放各不相同，包括角度为 0 的物体，都在相机前方
+static void fillObjects(RecordObject *objects, int count) {
+    for (int i = 0; i < count; i++) {
+        RecordObject *object = &objects[i];
+        object->position[0] = (float) (i % 17) - 8.0f;
+        object->position[1] = (float) (i % 5) - 2.0f;
+        object->position[2] = -8.0f - (float) (i % 11);
+        object->axis[0] = (float) (i % 3);
+        object->axis[1] = 1.0f;
+        object->axis[2] = (float) (i % 7) * 0.25f;
+        object->angle = (i % 10 == 0) ? 0.0f : (float) ((i * 37) % 360);
+        object->scale = 0.2f + (float) (i % 4) * 0.1f;
+        object->radius = 1.0f;
+        object->color[0] = (float) i / count;
+        object->color[1] = 1.0f - object->color[0];
+        object->color[2] = 0.5f;
+        object->color[3] = 1.0f;
+    }
+}
+
+//以第 segment 段的实例绘制，upload 为 false 时该段已由 GPU 写入
+static void drawInstances(InstanceStream *stream, int segment, bool upload) {
+    const MeshBuffer *mesh = stream->mesh;
+    beginImage(true);
+    instanceStreamSubmit(stream, segment, upload ? OBJECT_COUNT : 0);
+    glUseProgram(ctx.instancedProgram);
+    glBindVertexArray(mesh->vao);
+    glDrawElementsInstanced(GL_TRIANGLES, mesh->indexCount, mesh->indexType, (const void *) 0,
+                            OBJECT_COUNT);
+    glBindVertexArray(0);
+    glUseProgram(0);
+}
+
+static void testInstances() {
+    std::vector<RecordObject> objects(OBJECT_COUNT);
+    std::vector<InstanceData> expected(OBJECT_COUNT);
+    std::vector<InstanceData> actual(OBJECT_COUNT);
+    InstanceRecorder recorder;
+    InstanceStream stream;
+    MeshBuffer mesh;
+    Matrix viewProj;
+    // GPU 写入第 1 段，CPU 的参考结果写入第 0 段
+    GLintptr gpuOffset = (GLintptr) sizeof(InstanceData) * OBJECT_COUNT;
+    memset(&mesh, 0, sizeof(MeshBuffer));
+    fillObjects(objects.data(), OBJECT_COUNT);
+    matrixLoadIdentity(&viewProj);
+    perspective(&viewProj, 60.0f, 1.0f, 0.1f, 100.0f);
+    EXPECT_TRUE(instanceRecorderInit(&recorder, OBJECT_COUNT));
+    EXPECT_EQ(OBJECT_COUNT, recordInstances(&recorder, objects.data(), OBJECT_COUNT, &viewProj,
+                                            NULL, expected.data(), OBJECT_COUNT, NULL));
+    instanceRecorderRelease(&recorder);
+
+    // 与应用中相同：实例流的一段由 GPU 写入，以 count 为 0 提交，只设置实例属性
+    EXPECT_TRUE(gpuCreateSphereMesh(&mesh, 12, 1.0f));
+    EXPECT_TRUE(instanceStreamInit(&stream, &mesh, OBJECT_COUNT));
+    EXPECT_TRUE(gpuRecordInstances(stream.buffer, gpuOffset, objects.data(), OBJECT_COUNT,
+                                   &viewProj));
+    EXPECT_TRUE(readBack(stream.buffer, gpuOffset, sizeof(InstanceData) * OBJECT_COUNT,
+                         actual.data()));
+    EXPECT_NEAR(0.0, maxDifference((const GLfloat *) expected.data(),
+                                   (const GLfloat *) actual.data(),
+                                   sizeof(InstanceData) / sizeof(GLfloat) * OBJECT_COUNT),
+                FLOAT_TOLERANCE);
+
+    memcpy(instanceStreamSegment(&stream, 0), expected.data(), sizeof(InstanceData) * OBJECT_COUNT);
+    drawInstances(&stream, 0, true);
+    std::vector<unsigned char> cpuImage = readImage();
+    drawInstances(&stream, 1, false);
+    std::vector<unsigned char> gpuImage = readImage();
+    EXPECT_TRUE(coveredPixels(cpuImage) > IMAGE_SIZE * IMAGE_SIZE / 8);
+    EXPECT_TRUE(differentPixels(cpuImage, gpuImage) <= MAX_DIFFERENT_PIXELS);
+    EXPECT_TRUE(!checkGlError("testInstances"));
+
+    instanceStreamRelease(&stream);
+    deleteMeshBuffer(&mesh);
+}
+
+static void runBackend(bool allowCompute, GpuGeneratorBackend expected) {
+    EXPECT_TRUE(gpuGeneratorInit(allowCompute));
+    EXPECT_EQ(expected, gpuGeneratorBackend());
+    printf("backend %d\n", gpuGeneratorBackend());
+    RUN_TEST(testSphere);
+    RUN_TEST(testSquareGrid);
+    RUN_TEST(testInstances);
+    gpuGeneratorRelease();
+}
+
+int main() {
+    if (!createContext()) {
+        fprintf(stderr, "no EGL context, skipping\n");
+        return TEST_SKIPPED;
+    }
+    EXPECT_TRUE(createTargets());
+    GLint major = 0, minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    if (major > 3 || (major == 3 && minor >= 1)) {
+        runBackend(true, GPU_GENERATOR_COMPUTE);
+    }
+    runBackend(false, GPU_GENERATOR_TRANSFORM_FEEDBACK);
+    destroyContext();
+    return TEST_RESULT();
+}
@@ -0,0 +1,177 @@
+#include <math.h>
+#include <vector>
+#include "es-util.h"
+#include "culling.h"
+#include "instance-recorder.h"
+#include "thread-pool.h"
+#include "test-util.h"
+
+// 并行录制实例数据：与逐个剔除、逐个计算 MVP 的串行参考实现比较输出的顺序和内容。
+// 可见与不可见的物体交替出现，连续的区间跨过块边界，还有整块都不可见的块和不满一块的尾部；
+// 分别在当前线程、1 个和多个线程的线程池中执行，以及输出容量不足时的截断。
+
+//不是 RECORD_CHUNK 的整数倍
+#define OBJECT_COUNT (RECORD_CHUNK * 9 + 77)
+//可见性的周期与块大小互质，不可见的区间落在块中间，也跨过块边界
+#define VISIBLE_PERIOD 97
+#define HIDDEN_RUN 40
+//这一块中的物体全部不可见
+#define HIDDEN_CHUNK 4
+//批量乘法可能使用 SIMD，乘加顺序与 matrixMultiply 不同
+#define MATRIX_TOLERANCE 1e-4
+
+static void sceneViewProj(Matrix *viewProj) {
+    Matrix view, projection;
+    matrixLoadIdentity(&view);
+    translate(&view, 0.0f, -2.0f, -5.0f);
+    rotate(&view, 10.0f, 0.0f, 1.0f, 0.0f);
+    matrixLoadIdentity(&projection);
+    perspective(&projection, 60.0f, 16.0f / 9.0f, 0.1f, 500.0f);
+    matrixMultiply(viewProj, &view, &projection);
+}
+
+static std::vector<RecordObject> sceneObjects() {
+    std::vector<RecordObject> objects(OBJECT_COUNT);
+    for (int i = 0; i < OBJECT_COUNT; i++) {
+        RecordObject *object = &objects[i];
+        bool hidden = i % VISIBLE_PERIOD < HIDDEN_RUN || i / RECORD_CHUNK == HIDDEN_CHUNK;
+        float t = (float) i / (float) OBJECT_COUNT;
+        object->position[0] = hidden ? 1000.0f + (float) i : sinf((float) i) * 5.0f;
+        object->position[1] = cosf((float) i * 0.7f) * 3.0f;
+        object->position[2] = -20.0f - 150.0f * t;
+        object->axis[0] = 0.0f;
+        object->axis[1] = 0.6f;
+        object->axis[2] = 0.8f;
+        // 一部分不旋转，覆盖 angle == 0 的分支；一部分缩放为负
+        object->angle = i % 5 == 0 ? 0.0f : (float) (i % 360);
+        object->scale = i % 11 == 0 ? -1.5f : 0.5f + (float) (i % 4) * 0.25f;
+        object->radius = 1.0f;
+        object->color[0] = (float) i;
+        object->color[1] = t;
+        object->color[2] = 1.0f - t;
+        object->color[3] = 1.0f;
+    }
+    // 半径为 0 的物体不剔除，即使位于视锥外（整块不可见的那一块除外）
+    for (int i = 3; i < OBJECT_COUNT; i += VISIBLE_PERIOD * 3) {
+        if (i / RECORD_CHUNK != HIDDEN_CHUNK) {
+            objects[i].radius = 0.0f;
+        }
+    }
+    return objects;
+}
+
+// 串行参考实现：逐个剔除，可见的按原顺序计算 MVP 后追加到输出
+static std::vector<InstanceData> referenceInstances(const std::vector<RecordObject> &objects,
+                                                    const Matrix *viewProj,
+                                                    const Frustum *frustum) {
+    std::vector<InstanceData> result;
+    Matrix viewProjCopy = *viewProj;
+    for (const RecordObject &object : objects) {
+        if (frustum && object.radius > 0.0f &&
+            !frustumContainsSphere(frustum, object.position, object.radius * fabsf(object.scale))) {
+            continue;
+        }
+        Matrix model;
+        InstanceData instance;
+        matrixLoadIdentity(&model);
+        translate(&model, object.position[0], object.position[1], object.position[2]);
+        if (object.angle != 0.0f) {
+            rotate(&model, object.angle, object.axis[0], object.axis[1], object.axis[2]);
+        }
+        scale(&model, object.scale, object.scale, object.scale);
+        matrixMultiply(&instance.transform, &model, &viewProjCopy);
+        memcpy(instance.color, object.color, sizeof(GLfloat) * 4);
+        result.push_back(instance);
+    }
+    return result;
+}
+
+// 比较前 n 个实例，返回内容不同的实例数
+static int countMismatches(const InstanceData *actual, const std::vector<InstanceData> &expected,
+                           int n) {
+    int mismatches = 0;
+    for (int i = 0; i < n; i++) {
+        bool same = memcmp(actual[i].color, expected[i].color, sizeof(GLfloat) * 4) == 0;
+        for (int r = 0; r < 4; r++) {
+            for (int c = 0; c < 4; c++) {
+                same &= fabsf(actual[i].transform.m[r][c] - expected[i].transform.m[r][c]) <=
+                        MATRIX_TOLERANCE * (1.0f + fabsf(expected[i].transform.m[r][c]));
+            }
+        }
+        mismatches += !same;
+    }
+    return mismatches;
+}
+
+static void checkRecord(ThreadPool *pool) {
+    std::vector<RecordObject> objects = sceneObjects();
+    Matrix viewProj;
+    Frustum frustum;
+    InstanceRecorder recorder;
+    sceneViewProj(&viewProj);
+    frustumFromMatrix(&frustum, &viewProj);
+    EXPECT_TRUE(instanceRecorderInit(&recorder, OBJECT_COUNT));
+    std::vector<InstanceData> out(OBJECT_COUNT);
+
+    std::vector<InstanceData> expected = referenceInstances(objects, &viewProj, &frustum);
+    // 剔除确实跨块生效：既有可见的也有不可见的，整块不可见的那一块没有输出
+    EXPECT_TRUE(expected.size() > OBJECT_COUNT / 4 && expected.size() < OBJECT_COUNT * 3 / 4);
+    int count = recordInstances(&recorder, objects.data(), OBJECT_COUNT, &viewProj, &frustum,
+                                out.data(), OBJECT_COUNT, pool);
+    EXPECT_EQ(expected.size(), count);
+    EXPECT_EQ(0, countMismatches(out.data(), expected, count));
+    EXPECT_EQ(recorder.chunkOffsets[HIDDEN_CHUNK], recorder.chunkOffsets[HIDDEN_CHUNK + 1]);
+
+    // 不剔除时按原顺序输出全部物体
+    std::vector<InstanceData> all = referenceInstances(objects, &viewProj, NULL);
+    count = recordInstances(&recorder, objects.data(), OBJECT_COUNT, &viewProj, NULL, out.data(),
+                            OBJECT_COUNT, pool);
+    EXPECT_EQ(OBJECT_COUNT, count);
+    EXPECT_EQ(0, countMismatches(out.data(), all, count));
+
+    // 输出容量不足时得到参考结果的前缀，不写出界
+    const int limits[] = {1, RECORD_CHUNK - 1, RECORD_CHUNK + 3, (int) expected.size() - 1};
+    for (int limit : limits) {
+        std::vector<InstanceData> truncated(limit + 1);
+        memset(&truncated[limit], 0xab, sizeof(InstanceData));
+        InstanceData guard = truncated[limit];
+        count = recordInstances(&recorder, objects.data(), OBJECT_COUNT, &viewProj, &frustum,
+                                truncated.data(), limit, pool);
+        EXPECT_EQ(limit, count);
+        EXPECT_EQ(0, countMismatches(truncated.data(), expected, count));
+        EXPECT_TRUE(memcmp(&truncated[limit], &guard, sizeof(InstanceData)) == 0);
+    }
+
+    // 物体数超过 recorder 的容量时只处理前 capacity 个
+    InstanceRecorder small;
+    EXPECT_TRUE(instanceRecorderInit(&small, RECORD_CHUNK * 2 + 5));
+    std::vector<RecordObject> prefix(objects.begin(), objects.begin() + small.capacity);
+    std::vector<InstanceData> prefixExpected = referenceInstances(prefix, &viewProj, &frustum);
+    count = recordInstances(&small, objects.data(), OBJECT_COUNT, &viewProj, &frustum, out.data(),
+                            OBJECT_COUNT, pool);
+    EXPECT_EQ(prefixExpected.size(), count);
+    EXPECT_EQ(0, countMismatches(out.data(), prefixExpected, count));
+    instanceRecorderRelease(&small);
+    instanceRecorderRelease(&recorder);
+}
+
+static void testSerial() {
+    checkRecord(NULL);
+}
+
+static void testSingleThreadPool() {
+    ThreadPool pool(1);
+    checkRecord(&pool);
+}
+
+static void testThreadPool() {
+    ThreadPool pool(4);
+    checkRecord(&pool);
+}
+
+int main() {
+    RUN_TEST(testSerial);
+    RUN_TEST(testSingleThreadPool);
+    RUN_TEST(testThreadPool);
+    return TEST_RESULT();
+}
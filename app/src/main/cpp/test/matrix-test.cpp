@@ -0,0 +1,130 @@
+#include <random>
+#include <vector>
+#include "es-util.h"
+#include "test-util.h"
+
+// NEON/SSE 版本与标量版本（matrixMultiplyScalar）的结果必须逐位相同
+
+static void randomMatrix(std::mt19937 *rng, Matrix *m) {
+    // 数量级相差很大时，加法顺序不同或使用 FMA 都会改变舍入结果
+    std::uniform_real_distribution<float> mantissa(-1.0f, 1.0f);
+    std::uniform_int_distribution<int> exponent(-20, 20);
+    for (int i = 0; i < 4; i++) {
+        for (int j = 0; j < 4; j++) {
+            m->m[i][j] = ldexpf(mantissa(*rng), exponent(*rng));
+        }
+    }
+}
+
+static void expectBitExact(const Matrix *expected, const Matrix *actual) {
+    EXPECT_TRUE(memcmp(expected->m, actual->m, sizeof(Matrix)) == 0);
+}
+
+static void testMatchesScalar() {
+    std::mt19937 rng(1);
+    Matrix a, b, expected, result;
+    for (int n = 0; n < 1000; n++) {
+        randomMatrix(&rng, &a);
+        randomMatrix(&rng, &b);
+        matrixMultiplyScalar(&expected, &a, &b);
+        matrixMultiply(&result, &a, &b);
+        expectBitExact(&expected, &result);
+    }
+}
+
+static void testResultMayAliasSource() {
+    std::mt19937 rng(2);
+    Matrix a, b, expected, result;
+    randomMatrix(&rng, &a);
+    randomMatrix(&rng, &b);
+    matrixMultiplyScalar(&expected, &a, &b);
+    result = a;
+    matrixMultiply(&result, &result, &b);
+    expectBitExact(&expected, &result);
+    result = b;
+    matrixMultiply(&result, &a, &result);
+    expectBitExact(&expected, &result);
+    matrixMultiplyScalar(&expected, &a, &a);
+    result = a;
+    matrixMultiply(&result, &result, &result);
+    expectBitExact(&expected, &result);
+}
+
+static void testMultiplyNMatchesScalar() {
+    const int count = 37;
+    std::mt19937 rng(3);
+    std::vector<Matrix> a(count), b(count), result(count);
+    Matrix expected;
+    for (int i = 0; i < count; i++) {
+        randomMatrix(&rng, &a[i]);
+        randomMatrix(&rng, &b[i]);
+    }
+    matrixMultiplyN(result.data(), a.data(), b.data(), count);
+    for (int i = 0; i < count; i++) {
+        matrixMultiplyScalar(&expected, &a[i], &b[i]);
+        expectBitExact(&expected, &result[i]);
+    }
+}
+
+static void testBatchWithStrideMatchesScalar() {
+    const int count = 19;
+    // 结果之间留出 16 字节，检查步长并且不覆盖间隔
+    const size_t stride = sizeof(Matrix) + 16;
+    std::mt19937 rng(4);
+    std::vector<Matrix> a(count);
+    std::vector<Matrix> storage(count * 2);
+    unsigned char *bytes = (unsigned char *) storage.data();
+    Matrix b, expected;
+    randomMatrix(&rng, &b);
+    for (int i = 0; i < count; i++) {
+        randomMatrix(&rng, &a[i]);
+    }
+    memset(bytes, 0xcd, sizeof(Matrix) * storage.size());
+    matrixMultiplyBatch((Matrix *) bytes, stride, a.data(), &b, count);
+    for (int i = 0; i < count; i++) {
+        matrixMultiplyScalar(&expected, &a[i], &b);
+        expectBitExact(&expected, (const Matrix *) (bytes + i * stride));
+        for (size_t k = sizeof(Matrix); k < stride; k++) {
+            EXPECT_EQ(0xcd, bytes[i * stride + k]);
+        }
+    }
+}
+
+// 融合的 modelViewProjection 与依次调用各变换函数再相乘的结果一致（只允许舍入误差）
+static void testModelViewProjectionMatchesChain() {
+    const GLfloat eye[3] = {0.0f, 2.0f, 5.0f};
+    const GLfloat target[3] = {0.0f, 0.0f, 0.0f};
+    const GLfloat up[3] = {0.0f, 1.0f, 0.0f};
+    const GLfloat translation[3] = {1.0f, 0.5f, -2.0f};
+    const GLfloat axis[3] = {0.3f, 1.0f, 0.2f};
+    const GLfloat scaling[3] = {1.5f, 0.5f, 2.0f};
+    Matrix model, view, projection, modelView, expected, result;
+    for (float angle = 0.0f; angle < 360.0f; angle += 37.0f) {
+        matrixLoadIdentity(&model);
+        translate(&model, translation[0], translation[1], translation[2]);
+        rotate(&model, angle, axis[0], axis[1], axis[2]);
+        scale(&model, scaling[0], scaling[1], scaling[2]);
+        matrixLookAt(&view, eye[0], eye[1], eye[2], target[0], target[1], target[2], up[0], up[1],
+                     up[2]);
+        matrixLoadIdentity(&projection);
+        perspective(&projection, 60.0f, 16.0f / 9.0f, 0.1f, 100.0f);
+        matrixMultiply(&modelView, &model, &view);
+        matrixMultiply(&expected, &modelView, &projection);
+        modelViewProjection(&result, eye, target, up, 60.0f, 16.0f / 9.0f, 0.1f, 100.0f,
+                            translation, angle, axis, scaling);
+        for (int i = 0; i < 4; i++) {
+            for (int j = 0; j < 4; j++) {
+                EXPECT_NEAR(expected.m[i][j], result.m[i][j], 1e-5f * (1.0f + fabsf(expected.m[i][j])));
+            }
+        }
+    }
+}
+
+int main() {
+    RUN_TEST(testMatchesScalar);
+    RUN_TEST(testResultMayAliasSource);
+    RUN_TEST(testMultiplyNMatchesScalar);
+    RUN_TEST(testBatchWithStrideMatchesScalar);
+    RUN_TEST(testModelViewProjectionMatchesChain);
+    return TEST_RESULT();
+}
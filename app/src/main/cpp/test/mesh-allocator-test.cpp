@@ -0,0 +1,145 @@
+#include <vector>
+#include "es-util.h"
+#include "mesh-allocator.h"
+#include "mesh-generator.h"
+#include "mesh-optimizer.h"
+#include "test-util.h"
+
+static void testArenaCountersAfterReset() {
+    LinearArena arena(4096);
+    void *a = arena.allocate(100);
+    void *b = arena.allocate(200);
+    EXPECT_TRUE(a && b);
+    EXPECT_EQ(0, (size_t) b % MESH_ALLOC_ALIGNMENT);
+    // 使用量包含对齐填充，与 used() 一致
+    EXPECT_EQ(arena.used(), arena.stats().bytesInUse);
+    arena.deallocate(a, 100);
+    EXPECT_EQ(1, arena.stats().frees);
+    EXPECT_EQ(arena.used(), arena.stats().bytesInUse);
+
+    arena.reset();
+    EXPECT_EQ(0, arena.stats().bytesInUse);
+    // reset 之后释放之前的分配不能使计数下溢
+    arena.deallocate(b, 200);
+    EXPECT_EQ(0, arena.stats().bytesInUse);
+    EXPECT_EQ(2, arena.stats().frees);
+    EXPECT_EQ(112 + 200, arena.stats().peakBytes);
+}
+
+static void testArenaRewind() {
+    LinearArena arena(4096);
+    EXPECT_TRUE(arena.allocate(64) != NULL);
+    size_t mark = arena.marker();
+    EXPECT_TRUE(arena.allocate(1000) != NULL);
+    EXPECT_TRUE(arena.allocate(10) != NULL);
+    EXPECT_EQ(arena.used(), arena.stats().bytesInUse);
+    arena.rewind(mark);
+    EXPECT_EQ(64, arena.used());
+    EXPECT_EQ(64, arena.stats().bytesInUse);
+    // 回收后的空间可以再次分配
+    EXPECT_TRUE(arena.allocate(4000) != NULL);
+    EXPECT_TRUE(arena.allocate(64) == NULL);
+    EXPECT_EQ(1, arena.stats().failures);
+    EXPECT_EQ(arena.used(), arena.stats().bytesInUse);
+}
+
+static void testPoolReuse() {
+    PoolAllocator pool;
+    void *a = pool.allocate(1000);
+    pool.deallocate(a, 1000);
+    void *b = pool.allocate(900);
+    // 同一大小等级，复用空闲块
+    EXPECT_TRUE(a == b);
+    EXPECT_EQ(1, pool.stats().systemAllocations);
+    EXPECT_EQ(900, pool.stats().bytesInUse);
+    pool.deallocate(b, 900);
+    EXPECT_EQ(0, pool.stats().bytesInUse);
+}
+
+// 网格分配器中只有网格本身：系数表和优化用的临时缓冲区不经过它
+static void testGeneratorUsesMeshAllocator() {
+    PoolAllocator pool;
+    Mesh sphere(&pool);
+    Mesh grid(&pool);
+    MeshAllocator *defaults = defaultMeshAllocator();
+    size_t defaultAllocations = defaults->stats().allocations;
+
+    EXPECT_TRUE(createSphereMesh(&sphere, 32, 1.0f, NULL, false));
+    EXPECT_TRUE(createSquareGridMesh(&grid, 33, NULL, false));
+    EXPECT_EQ(2, pool.stats().allocations);
+    EXPECT_EQ(0, pool.stats().frees);
+
+    EXPECT_TRUE(createSphereMesh(&sphere, 32, 1.0f, NULL, true));
+    // 替换原来的球体：一次分配、一次释放
+    EXPECT_EQ(3, pool.stats().allocations);
+    EXPECT_EQ(1, pool.stats().frees);
+    EXPECT_EQ(defaultAllocations, defaults->stats().allocations);
+
+    // 空闲链表中已有同样大小的块，重复生成不再向系统申请内存
+    size_t systemAllocations = pool.stats().systemAllocations;
+    for (int i = 0; i < 4; i++) {
+        EXPECT_TRUE(createSphereMesh(&sphere, 32, 1.0f));
+        EXPECT_TRUE(createSquareGridMesh(&grid, 33));
+    }
+    EXPECT_EQ(systemAllocations, pool.stats().systemAllocations);
+    sphere.release();
+    grid.release();
+    EXPECT_EQ(0, pool.stats().bytesInUse);
+}
+
+// arena 中只留下网格本身，reset 后全部回收
+static void testGeneratorWithArena() {
+    LinearArena arena(1024 * 1024);
+    {
+        Mesh mesh(&arena);
+        EXPECT_TRUE(createSphereMesh(&mesh, 48, 1.0f));
+        EXPECT_EQ(mesh.byteSize(), arena.used());
+        EXPECT_EQ(arena.used(), arena.stats().bytesInUse);
+        arena.reset();
+    }
+    EXPECT_EQ(0, arena.stats().bytesInUse);
+}
+
+// 容量刚好放下 meshCount 个网格的 arena：开不开优化都能生成这么多个，再多一个时失败且网格为空
+static void testTightArena() {
+    const int numSlices = 64;
+    const int meshCount = 4;
+    size_t meshBytes;
+    {
+        Mesh probe;
+        EXPECT_TRUE(createSphereMesh(&probe, numSlices, 1.0f, NULL, false));
+        meshBytes = (probe.byteSize() + MESH_ALLOC_ALIGNMENT - 1) &
+                    ~(size_t) (MESH_ALLOC_ALIGNMENT - 1);
+    }
+    const bool options[] = {false, true};
+    for (bool optimize : options) {
+        LinearArena arena(meshBytes * meshCount);
+        std::vector<Mesh> meshes;
+        for (int i = 0; i < meshCount; i++) {
+            meshes.emplace_back(&arena);
+            EXPECT_TRUE(createSphereMesh(&meshes.back(), numSlices, 1.0f, NULL, optimize));
+        }
+        EXPECT_EQ(meshBytes * meshCount, arena.used());
+        EXPECT_EQ(0, arena.stats().failures);
+        Mesh extra(&arena);
+        EXPECT_TRUE(!createSphereMesh(&extra, numSlices, 1.0f, NULL, optimize));
+        EXPECT_TRUE(extra.vertices() == NULL && extra.indices() == NULL);
+        EXPECT_EQ(0, extra.indexCount());
+    }
+    // 非法尺寸同样返回 false，原有数据被释放
+    Mesh mesh;
+    EXPECT_TRUE(createSquareGridMesh(&mesh, 8));
+    EXPECT_TRUE(!createSquareGridMesh(&mesh, 1));
+    EXPECT_TRUE(mesh.vertices() == NULL);
+    EXPECT_TRUE(!createSphereMesh(&mesh, 1, 1.0f));
+}
+
+int main() {
+    RUN_TEST(testArenaCountersAfterReset);
+    RUN_TEST(testArenaRewind);
+    RUN_TEST(testPoolReuse);
+    RUN_TEST(testGeneratorUsesMeshAllocator);
+    RUN_TEST(testGeneratorWithArena);
+    RUN_TEST(testTightArena);
+    return TEST_RESULT();
+}
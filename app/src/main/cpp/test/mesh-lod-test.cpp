@@ -0,0 +1,244 @@
+#include <float.h>
+#include <math.h>
+#include <vector>
+#include "es-util.h"
+#include "mesh-generator.h"
+#include "mesh-lod.h"
+#include "test-util.h"
+
+// LOD 链与级别选择：各级分段数逐级减半，缓存按参数去重；
+// 物体越远级别越粗，混合系数在 [0, 1] 内，只在每级区间末尾的过渡带内指向下一级；参数非法时不生成。
+
+#define VIEWPORT_HEIGHT 1080.0f
+#define FOVY 60.0f
+//距离采样数
+#define DISTANCE_STEPS 2000
+
+static void testProjection(Matrix *projection) {
+    matrixLoadIdentity(projection);
+    perspective(projection, FOVY, 16.0f / 9.0f, 0.1f, 10000.0f);
+}
+
+static void placeAt(Matrix *modelView, float distance) {
+    matrixLoadIdentity(modelView);
+    translate(modelView, 0.0f, 0.0f, -distance);
+}
+
+static void testChainLevels() {
+    LodCache cache;
+    LodKey sphereKey = {LOD_SHAPE_SPHERE, 64, MAX_LOD_LEVELS, 2.0f};
+    const LodChain *sphere = cache.acquire(sphereKey);
+    EXPECT_TRUE(sphere != NULL);
+    // 64, 32, 16, 8, 4：低于 4 个分段的级别不生成
+    EXPECT_EQ(5, sphere->levelCount);
+    for (int i = 0; i < sphere->levelCount; i++) {
+        EXPECT_EQ(64 >> i, sphere->resolution[i]);
+        EXPECT_EQ(sphereVertexCount(64 >> i), sphere->levels[i].vertexCount());
+        EXPECT_EQ(sphereIndexCount(64 >> i), sphere->levels[i].indexCount());
+    }
+    EXPECT_NEAR(2.0, sphere->boundingRadius, 0.0);
+
+    // 网格按分段数减半，size = (segments >> i) + 1：33, 17, 9, 5, 3, 2
+    LodKey gridKey = {LOD_SHAPE_GRID, 33, MAX_LOD_LEVELS, 0.0f};
+    const LodChain *grid = cache.acquire(gridKey);
+    EXPECT_TRUE(grid != NULL);
+    EXPECT_EQ(6, grid->levelCount);
+    for (int i = 0; i < grid->levelCount; i++) {
+        int size = (32 >> i) + 1;
+        EXPECT_EQ(size, grid->resolution[i]);
+        EXPECT_EQ(squareGridVertexCount(size), grid->levels[i].vertexCount());
+        EXPECT_EQ(squareGridIndexCount(size), grid->levels[i].indexCount());
+    }
+    EXPECT_NEAR(1.0 / 32.0, grid->baseEdgeLength, 1e-7);
+
+    // maxLevels 限制级别数
+    LodKey limited = {LOD_SHAPE_GRID, 33, 2, 0.0f};
+    const LodChain *twoLevels = cache.acquire(limited);
+    EXPECT_TRUE(twoLevels != NULL);
+    EXPECT_EQ(2, twoLevels->levelCount);
+    EXPECT_TRUE(twoLevels->levels[2].vertices() == NULL);
+}
+
+static void testInvalidKeys() {
+    LodCache cache;
+    const LodKey invalid[] = {
+            {LOD_SHAPE_SPHERE, 64, 0, 1.0f},
+            {LOD_SHAPE_SPHERE, 64, -1, 1.0f},
+            {LOD_SHAPE_SPHERE, 3, MAX_LOD_LEVELS, 1.0f},
+            {LOD_SHAPE_SPHERE, 64, MAX_LOD_LEVELS, 0.0f},
+            {LOD_SHAPE_GRID, 33, 0, 0.0f},
+            {LOD_SHAPE_GRID, 1, MAX_LOD_LEVELS, 0.0f},
+            {LOD_SHAPE_GRID, 0, MAX_LOD_LEVELS, 0.0f},
+    };
+    for (const LodKey &key : invalid) {
+        EXPECT_TRUE(cache.acquire(key) == NULL);
+    }
+    // 失败的查找计入 misses，但不进入缓存，也不占用内存
+    EXPECT_EQ(0, cache.stats().hits);
+    EXPECT_EQ((int) (sizeof(invalid) / sizeof(invalid[0])), cache.stats().misses);
+    EXPECT_EQ(0, cache.stats().bytes);
+    // 最小的合法参数
+    LodKey smallest = {LOD_SHAPE_GRID, 2, 1, 0.0f};
+    const LodChain *chain = cache.acquire(smallest);
+    EXPECT_TRUE(chain != NULL && chain->levelCount == 1);
+}
+
+static void testCacheDedup() {
+    LodCache cache;
+    LodKey key = {LOD_SHAPE_SPHERE, 32, 4, 1.0f};
+    const LodChain *first = cache.acquire(key);
+    EXPECT_TRUE(first != NULL);
+    size_t bytes = cache.stats().bytes;
+    size_t expectedBytes = 0;
+    for (int i = 0; i < first->levelCount; i++) {
+        expectedBytes += first->levels[i].byteSize();
+    }
+    EXPECT_EQ(expectedBytes, bytes);
+
+    EXPECT_TRUE(cache.acquire(key) == first);
+    EXPECT_EQ(1, cache.stats().hits);
+    EXPECT_EQ(1, cache.stats().misses);
+    EXPECT_EQ(bytes, cache.stats().bytes);
+
+    // 半径、级别数不同时是另一条链
+    LodKey otherRadius = key;
+    otherRadius.radius = 2.0f;
+    LodKey otherLevels = key;
+    otherLevels.maxLevels = 2;
+    EXPECT_TRUE(cache.acquire(otherRadius) != first);
+    EXPECT_TRUE(cache.acquire(otherLevels) != first);
+    EXPECT_EQ(3, cache.stats().misses);
+
+    // 网格忽略半径
+    LodKey grid = {LOD_SHAPE_GRID, 17, 4, 0.0f};
+    LodKey gridWithRadius = {LOD_SHAPE_GRID, 17, 4, 5.0f};
+    const LodChain *gridChain = cache.acquire(grid);
+    EXPECT_TRUE(cache.acquire(gridWithRadius) == gridChain);
+    EXPECT_EQ(2, cache.stats().hits);
+    EXPECT_EQ(4, cache.stats().misses);
+
+    cache.clear();
+    EXPECT_EQ(0, cache.stats().bytes);
+    EXPECT_TRUE(cache.acquire(key) != NULL);
+    EXPECT_EQ(5, cache.stats().misses);
+}
+
+// 由距离直接算出连续的 lod 值，与 lodSelect 的选择对照
+static float expectedLod(const LodChain *chain, const Matrix *projection, const LodParams *params,
+                         float distance) {
+    float pixelsPerUnit = projection->m[1][1] * 0.5f * params->viewportHeight / distance;
+    return log2f(params->targetEdgePixels / (chain->baseEdgeLength * pixelsPerUnit));
+}
+
+static void checkSelectionSweep(const LodChain *chain, const LodParams *params) {
+    Matrix projection, modelView;
+    int lastLevel = chain->levelCount - 1;
+    int previousLevel = 0;
+    float previousRadius = FLT_MAX;
+    float start = 1.0f - params->blendRange;
+    int blended = 0, sampled = 0;
+    testProjection(&projection);
+    for (int i = 0; i < DISTANCE_STEPS; i++) {
+        // 从包围球附近到很远处按指数分布采样
+        float distance = chain->boundingRadius * 1.5f * powf(1.005f, (float) i);
+        LodSelection selection;
+        placeAt(&modelView, distance);
+        lodSelect(chain, &modelView, &projection, params, &selection);
+
+        EXPECT_TRUE(selection.level >= 0 && selection.level <= lastLevel);
+        EXPECT_TRUE(selection.level >= previousLevel);
+        EXPECT_TRUE(selection.projectedRadius <= previousRadius);
+        EXPECT_TRUE(selection.blend >= 0.0f && selection.blend <= 1.0f);
+        EXPECT_TRUE(selection.nextLevel == selection.level ||
+                    selection.nextLevel == selection.level + 1);
+        EXPECT_TRUE(selection.nextLevel <= lastLevel);
+        if (selection.nextLevel == selection.level) {
+            EXPECT_EQ(0, selection.blend);
+        } else {
+            blended++;
+        }
+        previousLevel = selection.level;
+        previousRadius = selection.projectedRadius;
+
+        // 离级别边界或过渡带边界太近的采样受舍入影响，不做精确比较
+        float lod = expectedLod(chain, &projection, params, distance);
+        float fraction = lod - floorf(lod);
+        if (fabsf(fraction - start) < 1e-3f || fraction < 1e-3f || fraction > 1.0f - 1e-3f) {
+            continue;
+        }
+        sampled++;
+        if (lod <= 0.0f) {
+            EXPECT_EQ(0, selection.level);
+            EXPECT_EQ(0, selection.nextLevel);
+        } else if (lod >= (float) lastLevel) {
+            EXPECT_EQ(lastLevel, selection.level);
+            EXPECT_EQ(lastLevel, selection.nextLevel);
+        } else {
+            EXPECT_EQ((int) lod, selection.level);
+            bool inBand = params->blendRange > 0.0f && fraction > start;
+            EXPECT_EQ(inBand ? selection.level + 1 : selection.level, selection.nextLevel);
+            if (inBand) {
+                EXPECT_NEAR((fraction - start) / params->blendRange, selection.blend, 1e-3);
+            }
+        }
+    }
+    // 采样覆盖了从第 0 级到最后一级的全部区间
+    EXPECT_EQ(lastLevel, previousLevel);
+    EXPECT_TRUE(sampled > DISTANCE_STEPS / 2);
+    EXPECT_TRUE(params->blendRange > 0.0f ? blended > 0 : blended == 0);
+}
+
+static void testSelectionMonotonic() {
+    LodCache cache;
+    LodKey sphereKey = {LOD_SHAPE_SPHERE, 128, MAX_LOD_LEVELS, 1.0f};
+    LodKey gridKey = {LOD_SHAPE_GRID, 65, MAX_LOD_LEVELS, 0.0f};
+    const LodChain *chains[] = {cache.acquire(sphereKey), cache.acquire(gridKey)};
+    const float blendRanges[] = {0.0f, 0.2f, 0.5f, 1.0f};
+    for (const LodChain *chain : chains) {
+        EXPECT_TRUE(chain != NULL);
+        for (float blendRange : blendRanges) {
+            LodParams params = {VIEWPORT_HEIGHT, 8.0f, blendRange};
+            checkSelectionSweep(chain, &params);
+        }
+    }
+}
+
+// 包围球与相机相交时用最精细的级别；批量选择统计的顶点数与逐个选择一致
+static void testSelectionEdgeCases() {
+    LodCache cache;
+    LodKey key = {LOD_SHAPE_SPHERE, 64, MAX_LOD_LEVELS, 1.0f};
+    const LodChain *chain = cache.acquire(key);
+    LodParams params = {VIEWPORT_HEIGHT, 8.0f, 0.25f};
+    Matrix projection, modelView;
+    LodSelection selection;
+    testProjection(&projection);
+    placeAt(&modelView, 0.5f);
+    lodSelect(chain, &modelView, &projection, &params, &selection);
+    EXPECT_EQ(0, selection.level);
+    EXPECT_EQ(0, selection.nextLevel);
+    EXPECT_TRUE(selection.projectedRadius == FLT_MAX);
+
+    const int n = 64;
+    std::vector<Matrix> modelViews(n);
+    std::vector<LodSelection> selections(n);
+    long expectedVertices = 0;
+    for (int i = 0; i < n; i++) {
+        placeAt(&modelViews[i], 2.0f * powf(1.1f, (float) i));
+        lodSelect(chain, &modelViews[i], &projection, &params, &selection);
+        expectedVertices += chain->levels[selection.level].vertexCount();
+        if (selection.nextLevel != selection.level) {
+            expectedVertices += chain->levels[selection.nextLevel].vertexCount();
+        }
+    }
+    EXPECT_EQ(expectedVertices, lodSelectBatch(chain, modelViews.data(), n, &projection, &params,
+                                               selections.data()));
+}
+
+int main() {
+    RUN_TEST(testChainLevels);
+    RUN_TEST(testInvalidKeys);
+    RUN_TEST(testCacheDedup);
+    RUN_TEST(testSelectionMonotonic);
+    RUN_TEST(testSelectionEdgeCases);
+    return TEST_RESULT();
+}
@@ -0,0 +1,223 @@
+#include <algorithm>
+#include <array>
+#include <thread>
+#include <vector>
+#include "es-util.h"
+#include "mesh-generator.h"
+#include "mesh-optimizer.h"
+#include "test-util.h"
+
+typedef std::array<GLuint, 3> Triangle;
+
+// 旋转到最小编号在前，保持绕序，排序后可以比较两组三角形是否相同
+static std::vector<Triangle> canonicalTriangles(const GLuint *indices, int numIndices,
+                                                const GLuint *remap) {
+    std::vector<Triangle> tris;
+    for (int i = 0; i < numIndices; i += 3) {
+        Triangle t = {indices[i], indices[i + 1], indices[i + 2]};
+        if (remap) {
+            t = {remap[t[0]], remap[t[1]], remap[t[2]]};
+        }
+        while (t[0] > t[1] || t[0] > t[2]) {
+            t = {t[1], t[2], t[0]};
+        }
+        tris.push_back(t);
+    }
+    std::sort(tris.begin(), tris.end());
+    return tris;
+}
+
+static void checkOptimizeMesh(const std::vector<GLuint> &original, int numVertices) {
+    std::vector<GLuint> indices = original;
+    std::vector<GLuint> remap(numVertices);
+    MeshOptimizeStats stats;
+    int numIndices = (int) indices.size();
+    optimizeMesh(indices.data(), numIndices, numVertices, remap.data(), &stats);
+
+    EXPECT_TRUE(stats.after.acmr < stats.before.acmr);
+    EXPECT_TRUE(stats.after.acmr < 0.8f);
+    for (int i = 0; i < numIndices; i++) {
+        EXPECT_TRUE(indices[i] < (GLuint) numVertices);
+    }
+    // remap 是 [0, numVertices) 的一个排列
+    std::vector<GLuint> sorted = remap;
+    std::sort(sorted.begin(), sorted.end());
+    for (int i = 0; i < numVertices; i++) {
+        EXPECT_EQ(i, sorted[i]);
+    }
+    // 原三角形换成新编号后与重排后的三角形集合相同
+    EXPECT_TRUE(canonicalTriangles(original.data(), numIndices, remap.data()) ==
+                canonicalTriangles(indices.data(), numIndices, NULL));
+}
+
+static void testOptimizeSphere() {
+    const int numSlices = 64;
+    std::vector<GLuint> indices(sphereIndexCount(numSlices));
+    createSphereInto(numSlices, 1.0f, NULL, NULL, NULL, indices.data(), NULL, false);
+    checkOptimizeMesh(indices, sphereVertexCount(numSlices));
+}
+
+static void testOptimizeGrid() {
+    const int size = 65;
+    std::vector<GLuint> indices(squareGridIndexCount(size));
+    createSquareGridInto(size, NULL, indices.data(), NULL, false);
+    checkOptimizeMesh(indices, squareGridVertexCount(size));
+}
+
+// 按顶点位置比较两组三角形，与顶点编号无关
+static std::vector<std::array<float, 9>> trianglePositions(const GLfloat *vertices,
+                                                           const GLuint *indices, int numIndices) {
+    std::vector<std::array<float, 9>> result;
+    for (int i = 0; i < numIndices; i += 3) {
+        std::array<float, 9> t;
+        int first = 0;
+        // 从位置最小的顶点开始，保持绕序
+        for (int k = 1; k < 3; k++) {
+            if (std::lexicographical_compare(vertices + indices[i + k] * 3,
+                                             vertices + indices[i + k] * 3 + 3,
+                                             vertices + indices[i + first] * 3,
+                                             vertices + indices[i + first] * 3 + 3)) {
+                first = k;
+            }
+        }
+        for (int k = 0; k < 3; k++) {
+            memcpy(&t[k * 3], vertices + indices[i + (first + k) % 3] * 3, sizeof(float) * 3);
+        }
+        result.push_back(t);
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+// 开启优化后生成器输出同一组三角形，只是顺序和顶点编号不同；线程池不影响结果
+static void testGeneratedMeshIsReordered() {
+    const int numSlices = 48;
+    int numVertices = sphereVertexCount(numSlices);
+    int numIndices = sphereIndexCount(numSlices);
+    std::vector<GLfloat> plainVertices(numVertices * 3), optimizedVertices(numVertices * 3);
+    std::vector<GLfloat> pooledVertices(numVertices * 3), normals(numVertices * 3);
+    std::vector<GLfloat> texCoords(numVertices * 2);
+    std::vector<GLuint> plainIndices(numIndices), optimizedIndices(numIndices);
+    std::vector<GLuint> pooledIndices(numIndices);
+    VertexCacheStats plainStats, optimizedStats;
+    ThreadPool pool(4);
+
+    createSphereInto(numSlices, 1.0f, plainVertices.data(), NULL, NULL, plainIndices.data(), NULL,
+                     false);
+    createSphereInto(numSlices, 1.0f, optimizedVertices.data(), normals.data(), texCoords.data(),
+                     optimizedIndices.data(), NULL, true);
+    createSphereInto(numSlices, 1.0f, pooledVertices.data(), NULL, NULL, pooledIndices.data(),
+                     &pool, true);
+
+    EXPECT_TRUE(plainIndices != optimizedIndices);
+    EXPECT_TRUE(optimizedIndices == pooledIndices);
+    EXPECT_TRUE(optimizedVertices == pooledVertices);
+    EXPECT_TRUE(trianglePositions(plainVertices.data(), plainIndices.data(), numIndices) ==
+                trianglePositions(optimizedVertices.data(), optimizedIndices.data(), numIndices));
+    // 球面上的顶点，法线与位置方向相同（半径为 1）
+    for (int i = 0; i < numVertices * 3; i++) {
+        EXPECT_NEAR(optimizedVertices[i], normals[i], 1e-6);
+    }
+    analyzeVertexCache(plainIndices.data(), numIndices, numVertices, VERTEX_CACHE_SIZE,
+                       &plainStats);
+    analyzeVertexCache(optimizedIndices.data(), numIndices, numVertices, VERTEX_CACHE_SIZE,
+                       &optimizedStats);
+    EXPECT_TRUE(optimizedStats.acmr < plainStats.acmr);
+}
+
+// 尺寸非法时返回 0，输出指针置为 NULL，不返回未初始化的缓冲区
+static void testInvalidSizes() {
+    GLfloat *vertices = (GLfloat *) 1, *normals = (GLfloat *) 1, *texCoords = (GLfloat *) 1;
+    GLuint *indices = (GLuint *) 1;
+    EXPECT_EQ(0, createSquareGrid(1, &vertices, &indices));
+    EXPECT_TRUE(vertices == NULL && indices == NULL);
+    EXPECT_EQ(0, createSphere(0, 1.0f, &vertices, &normals, &texCoords, &indices));
+    EXPECT_TRUE(vertices == NULL && normals == NULL && texCoords == NULL && indices == NULL);
+    EXPECT_EQ(0, createSquareGridInto(1, NULL, NULL, NULL, true));
+    EXPECT_EQ(0, createSphereInto(0, 1.0f, NULL, NULL, NULL, NULL, NULL, true));
+
+    EXPECT_EQ(squareGridIndexCount(2), createSquareGrid(2, &vertices, &indices));
+    EXPECT_TRUE(vertices != NULL && indices != NULL);
+    free(vertices);
+    free(indices);
+    EXPECT_EQ(sphereIndexCount(8), createSphere(8, 1.0f, &vertices, NULL, NULL, &indices));
+    EXPECT_TRUE(vertices != NULL && indices != NULL);
+    free(vertices);
+    free(indices);
+}
+
+// 分配内存的生成函数默认优化，并通过 stats 报告优化前后的 ACMR/ATVR；关闭时 stats 清零
+static void testGeneratorStats() {
+    GLfloat *vertices = NULL;
+    GLuint *indices = NULL;
+    MeshOptimizeStats stats;
+    VertexCacheStats check;
+    const int numSlices = 32;
+    const int size = 33;
+
+    int numIndices = createSphere(numSlices, 1.0f, &vertices, NULL, NULL, &indices, true, &stats);
+    EXPECT_TRUE(stats.after.acmr < stats.before.acmr);
+    EXPECT_TRUE(stats.after.atvr < stats.before.atvr);
+    analyzeVertexCache(indices, numIndices, sphereVertexCount(numSlices), VERTEX_CACHE_SIZE,
+                       &check);
+    EXPECT_NEAR(stats.after.acmr, check.acmr, 1e-6);
+    free(vertices);
+    free(indices);
+
+    MeshOptimizeStats plain;
+    GLuint *plainIndices = NULL;
+    numIndices = createSphere(numSlices, 1.0f, NULL, NULL, NULL, &plainIndices, false, &plain);
+    EXPECT_EQ(0, plain.before.acmr);
+    EXPECT_EQ(0, plain.after.acmr);
+    analyzeVertexCache(plainIndices, numIndices, sphereVertexCount(numSlices), VERTEX_CACHE_SIZE,
+                       &check);
+    EXPECT_NEAR(stats.before.acmr, check.acmr, 1e-6);
+    free(plainIndices);
+
+    numIndices = createSquareGrid(size, &vertices, &indices, true, &stats);
+    EXPECT_TRUE(stats.after.acmr < stats.before.acmr);
+    analyzeVertexCache(indices, numIndices, squareGridVertexCount(size), VERTEX_CACHE_SIZE,
+                       &check);
+    EXPECT_NEAR(stats.after.acmr, check.acmr, 1e-6);
+    free(vertices);
+    free(indices);
+}
+
+// 选项是调用参数而不是全局状态：两个线程同时用不同选项生成，结果与单独生成时相同
+static void testConcurrentOptions() {
+    const int numSlices = 40;
+    const int rounds = 16;
+    int numIndices = sphereIndexCount(numSlices);
+    std::vector<GLuint> plainExpected(numIndices), optimizedExpected(numIndices);
+    createSphereInto(numSlices, 1.0f, NULL, NULL, NULL, plainExpected.data(), NULL, false);
+    createSphereInto(numSlices, 1.0f, NULL, NULL, NULL, optimizedExpected.data(), NULL, true);
+    int plainMismatches = 0, optimizedMismatches = 0;
+    std::thread plainThread([&]() {
+        std::vector<GLuint> indices(numIndices);
+        for (int i = 0; i < rounds; i++) {
+            createSphereInto(numSlices, 1.0f, NULL, NULL, NULL, indices.data(), NULL, false);
+            plainMismatches += indices != plainExpected;
+        }
+    });
+    std::thread optimizedThread([&]() {
+        std::vector<GLuint> indices(numIndices);
+        for (int i = 0; i < rounds; i++) {
+            createSphereInto(numSlices, 1.0f, NULL, NULL, NULL, indices.data(), NULL, true);
+            optimizedMismatches += indices != optimizedExpected;
+        }
+    });
+    plainThread.join();
+    optimizedThread.join();
+    EXPECT_EQ(0, plainMismatches);
+    EXPECT_EQ(0, optimizedMismatches);
+}
+
+int main() {
+    RUN_TEST(testOptimizeSphere);
+    RUN_TEST(testOptimizeGrid);
+    RUN_TEST(testGeneratedMeshIsReordered);
+    RUN_TEST(testInvalidSizes);
+    RUN_TEST(testGeneratorStats);
+    RUN_TEST(testConcurrentOptions);
+    return TEST_RESULT();
+}
@@ -0,0 +1,157 @@
+#include "es-util.h"
+#include "gl-stub.h"
+#include "render-queue.h"
+#include "test-util.h"
+
+static DrawItem makeItem(GLuint program, GLuint texture, GLuint vao, float depth, GLsizei count) {
+    DrawItem item;
+    memset(&item, 0, sizeof(DrawItem));
+    item.program = program;
+    item.texture = texture;
+    item.vao = vao;
+    item.depth = depth;
+    item.mode = GL_TRIANGLES;
+    item.count = count;
+    item.instanceCount = 1;
+    return item;
+}
+
+static void testSortKeyOrder() {
+    // program 优先，其次纹理、VAO，最后深度
+    EXPECT_TRUE(makeSortKey(1, 9, 9, 100.0f) < makeSortKey(2, 0, 0, 0.0f));
+    EXPECT_TRUE(makeSortKey(1, 1, 9, 100.0f) < makeSortKey(1, 2, 0, 0.0f));
+    EXPECT_TRUE(makeSortKey(1, 1, 1, 100.0f) < makeSortKey(1, 1, 2, 0.0f));
+    EXPECT_TRUE(makeSortKey(1, 1, 1, 0.5f) < makeSortKey(1, 1, 1, 2.0f));
+    // 负深度按 0 处理
+    EXPECT_EQ(makeSortKey(1, 1, 1, 0.0f), makeSortKey(1, 1, 1, -3.0f));
+}
+
+static void testSortIsStable() {
+    RenderQueue queue;
+    const GLuint programs[] = {3, 1, 2, 1, 3, 1};
+    EXPECT_TRUE(renderQueueInit(&queue, 8));
+    for (int i = 0; i < 6; i++) {
+        DrawItem item = makeItem(programs[i], 0, 1, 1.0f, i + 1);
+        EXPECT_TRUE(renderQueueSubmit(&queue, &item));
+    }
+    renderQueueSort(&queue);
+    // 键相同的请求保持提交顺序
+    const int expected[] = {1, 3, 5, 2, 0, 4};
+    for (int i = 0; i < 6; i++) {
+        EXPECT_EQ(expected[i], queue.entries[i].index);
+    }
+    renderQueueRelease(&queue);
+}
+
+static void testFlushSkipsRedundantBinds() {
+    RenderQueue queue;
+    glStubReset();
+    EXPECT_TRUE(renderQueueInit(&queue, 8));
+    DrawItem items[] = {
+            makeItem(2, 5, 7, 3.0f, 30),
+            makeItem(1, 5, 7, 2.0f, 20),
+            makeItem(2, 5, 7, 1.0f, 10),
+            makeItem(1, 5, 8, 1.0f, 40),
+    };
+    for (const DrawItem &item : items) {
+        EXPECT_TRUE(renderQueueSubmit(&queue, &item));
+    }
+    renderQueueFlush(&queue);
+    EXPECT_EQ(4, queue.stats.draws);
+    EXPECT_EQ(2, queue.stats.programBinds);
+    EXPECT_EQ(2, queue.stats.programBindsSkipped);
+    EXPECT_EQ(1, queue.stats.textureBinds);
+    EXPECT_EQ(3, queue.stats.textureBindsSkipped);
+    EXPECT_EQ(3, queue.stats.vaoBinds);
+    EXPECT_EQ(2, glStubCount("glUseProgram"));
+    EXPECT_EQ(1, glStubCount("glBindTexture"));
+    EXPECT_EQ(3, glStubCount("glBindVertexArray"));
+    EXPECT_EQ(0, queue.count);
+    // 回放顺序：program 1 的 VAO 7、VAO 8，然后 program 2 按深度从近到远
+    const long long counts[] = {20, 40, 10, 30};
+    int draw = 0;
+    for (int i = 0; i < glStubCallCount(); i++) {
+        const GlCall *call = glStubCall(i);
+        if (strcmp(call->name, "glDrawArrays") == 0) {
+            EXPECT_EQ(counts[draw], call->args[2]);
+            draw++;
+        }
+    }
+    EXPECT_EQ(4, draw);
+
+    // 状态在两次回放之间保留
+    glStubReset();
+    EXPECT_TRUE(renderQueueSubmit(&queue, &items[2]));
+    renderQueueFlush(&queue);
+    EXPECT_EQ(0, glStubCount("glUseProgram"));
+    EXPECT_EQ(0, glStubCount("glBindTexture"));
+
+    // 外部改动状态后必须重新绑定
+    renderQueueResetState(&queue);
+    EXPECT_TRUE(renderQueueSubmit(&queue, &items[2]));
+    renderQueueFlush(&queue);
+    EXPECT_EQ(1, glStubCount("glUseProgram"));
+    EXPECT_EQ(1, glStubCount("glBindTexture"));
+    EXPECT_EQ(1, glStubCount("glBindVertexArray"));
+    renderQueueRelease(&queue);
+}
+
+// 初始化后第一次绑定 0（不使用纹理）不能被当作重复绑定跳过
+static void testFirstBindOfZeroIsNotSkipped() {
+    RenderQueue queue;
+    glStubReset();
+    EXPECT_TRUE(renderQueueInit(&queue, 4));
+    DrawItem item = makeItem(0, 0, 0, 1.0f, 3);
+    EXPECT_TRUE(renderQueueSubmit(&queue, &item));
+    renderQueueFlush(&queue);
+    EXPECT_EQ(1, glStubCount("glUseProgram"));
+    EXPECT_EQ(1, glStubCount("glBindTexture"));
+    EXPECT_EQ(0, glStubLast("glBindTexture")->args[1]);
+    EXPECT_EQ(1, glStubCount("glBindVertexArray"));
+    renderQueueRelease(&queue);
+}
+
+static void testDrawCalls() {
+    RenderQueue queue;
+    MeshBuffer mesh;
+    DrawItem item;
+    glStubReset();
+    EXPECT_TRUE(renderQueueInit(&queue, 4));
+    memset(&mesh, 0, sizeof(MeshBuffer));
+    mesh.vao = 3;
+    mesh.vertexCount = 12;
+    mesh.indexCount = 36;
+    mesh.indexType = GL_UNSIGNED_SHORT;
+    drawItemFromMesh(&item, &mesh, 1, 0, 1.0f);
+    EXPECT_TRUE(renderQueueSubmit(&queue, &item));
+    item.instanceCount = 5;
+    EXPECT_TRUE(renderQueueSubmit(&queue, &item));
+    mesh.indexCount = 0;
+    drawItemFromMesh(&item, &mesh, 1, 0, 2.0f);
+    EXPECT_TRUE(renderQueueSubmit(&queue, &item));
+    item.instanceCount = 4;
+    EXPECT_TRUE(renderQueueSubmit(&queue, &item));
+    // 队列已满
+    EXPECT_TRUE(!renderQueueSubmit(&queue, &item));
+    renderQueueFlush(&queue);
+
+    EXPECT_EQ(1, glStubCount("glDrawElements"));
+    EXPECT_EQ(36, glStubLast("glDrawElements")->args[1]);
+    EXPECT_EQ(GL_UNSIGNED_SHORT, glStubLast("glDrawElements")->args[2]);
+    EXPECT_EQ(1, glStubCount("glDrawElementsInstanced"));
+    EXPECT_EQ(5, glStubLast("glDrawElementsInstanced")->args[3]);
+    EXPECT_EQ(1, glStubCount("glDrawArrays"));
+    EXPECT_EQ(12, glStubLast("glDrawArrays")->args[2]);
+    EXPECT_EQ(1, glStubCount("glDrawArraysInstanced"));
+    EXPECT_EQ(4, glStubLast("glDrawArraysInstanced")->args[3]);
+    renderQueueRelease(&queue);
+}
+
+int main() {
+    RUN_TEST(testSortKeyOrder);
+    RUN_TEST(testSortIsStable);
+    RUN_TEST(testFlushSkipsRedundantBinds);
+    RUN_TEST(testFirstBindOfZeroIsNotSkipped);
+    RUN_TEST(testDrawCalls);
+    return TEST_RESULT();
+}
@@ -0,0 +1,165 @@
+#include "resolution-controller.h"
+#include "test-util.h"
+#include "../benchmark/resolution-trace.h"
+
+// 用基准测试的帧时间序列回放动态分辨率控制：scale 不超出范围，稳定负载下不振荡，
+// 降频时超出预算的帧足够少，短暂的尖峰不改变 scale；以及 GPU 耗时晚到、缺失时不用 CPU 耗时代替。
+
+//GPU 耗时晚到时，每 4 帧有一帧没有结果（查询被丢弃）
+#define GPU_DROP_PERIOD 4
+#define GPU_LAG_MAX 8
+//不报告 GPU 耗时，只用 CPU 耗时
+#define CPU_ONLY (-1)
+
+typedef struct {
+    long overBudget;        // GPU 耗时超过预算的帧数
+    int changes;            // scale 改变的次数
+    int lastChange;         // 最后一次改变所在的帧，没有改变时为 -1
+    float minScale;
+    float maxScale;
+    float finalScale;
+} TraceResult;
+
+//constantLoad > 0 时代替 trace 的负载；gpuLag 为 GPU 耗时晚到的帧数，CPU_ONLY 时只提供 CPU 耗时
+static TraceResult replay(const ResolutionConfig *config, int trace, float constantLoad,
+                          int gpuLag, float cpuMs) {
+    ResolutionController controller;
+    TraceResult result = {0, 0, -1, config->maxScale, config->maxScale, config->maxScale};
+    float inFlight[GPU_LAG_MAX];
+    uint32_t seed = 12345;
+    float scale = config->maxScale;
+    resolutionControllerInit(&controller, config);
+    for (int i = 0; i < TRACE_FRAMES; i++) {
+        float load = constantLoad > 0.0f ? constantLoad : traceLoad(trace, i);
+        float gpuMs = traceGpuMs(load, scale, &seed);
+        float cpu = cpuMs + traceNoise(&seed);
+        float reported = gpuMs;
+        if (gpuMs > config->budgetMs) {
+            result.overBudget++;
+        }
+        if (gpuLag == CPU_ONLY) {
+            reported = -1.0f;
+        } else if (gpuLag > 0) {
+            inFlight[i % GPU_LAG_MAX] = gpuMs;
+            reported = i >= gpuLag && i % GPU_DROP_PERIOD != GPU_DROP_PERIOD - 1
+                       ? inFlight[(i - gpuLag) % GPU_LAG_MAX] : -1.0f;
+        }
+        float next = resolutionControllerUpdate(&controller, cpu, reported);
+        if (next != scale) {
+            result.changes++;
+            result.lastChange = i;
+        }
+        scale = next;
+        result.minScale = scale < result.minScale ? scale : result.minScale;
+        result.maxScale = scale > result.maxScale ? scale : result.maxScale;
+    }
+    result.finalScale = scale;
+    return result;
+}
+
+static void testScaleStaysInRange() {
+    static const float loads[] = {0.0f, 0.2f, 1.4f, 3.0f, 8.0f};
+    ResolutionConfig config;
+    resolutionConfigDefault(&config, TRACE_BUDGET_MS);
+    // 另一组范围和步长：0.55 不是步长的整数倍
+    ResolutionConfig narrow = config;
+    narrow.minScale = 0.55f;
+    narrow.maxScale = 0.9f;
+    narrow.scaleStep = 0.1f;
+    const ResolutionConfig *configs[] = {&config, &narrow};
+    for (const ResolutionConfig *c : configs) {
+        for (int trace = TRACE_STEADY; trace <= TRACE_SPIKE; trace++) {
+            for (float load : loads) {
+                TraceResult result = replay(c, trace, load, 0, 4.0f);
+                EXPECT_TRUE(result.minScale >= c->minScale && result.maxScale <= c->maxScale);
+            }
+        }
+        // 负载很高时停在 minScale，很低时保持 maxScale
+        EXPECT_EQ(c->minScale, replay(c, TRACE_STEADY, 8.0f, 0, 4.0f).finalScale);
+        EXPECT_EQ(0, replay(c, TRACE_STEADY, 0.2f, 0, 4.0f).changes);
+    }
+}
+
+static void testSteadyLoadDoesNotOscillate() {
+    ResolutionConfig config;
+    resolutionConfigDefault(&config, TRACE_BUDGET_MS);
+    // 低于预算的稳定负载：一次都不调整
+    EXPECT_EQ(0, replay(&config, TRACE_STEADY, 0.0f, 0, 4.0f).changes);
+    EXPECT_EQ(0, replay(&config, TRACE_STEADY, 0.0f, 2, 4.0f).changes);
+    // 超过预算的稳定负载：收敛后不再调整，也不会来回调整
+    TraceResult heavy = replay(&config, TRACE_STEADY, 1.4f, 0, 4.0f);
+    EXPECT_TRUE(heavy.finalScale < 1.0f);
+    EXPECT_TRUE(heavy.changes <= 2);
+    EXPECT_TRUE(heavy.lastChange < TRACE_FRAMES / 10);
+    TraceResult lagged = replay(&config, TRACE_STEADY, 1.4f, 2, 4.0f);
+    EXPECT_TRUE(lagged.changes <= 2);
+    EXPECT_TRUE(lagged.lastChange < TRACE_FRAMES / 10);
+}
+
+static void testThrottleRamp() {
+    ResolutionConfig config;
+    resolutionConfigDefault(&config, TRACE_BUDGET_MS);
+    ResolutionConfig fixed = config;
+    fixed.minScale = fixed.maxScale;
+    TraceResult adaptive = replay(&config, TRACE_THROTTLE, 0.0f, 0, 4.0f);
+    TraceResult reference = replay(&fixed, TRACE_THROTTLE, 0.0f, 0, 4.0f);
+    printf("throttle: over budget %.3f (fixed %.3f), %d changes\n",
+           (double) adaptive.overBudget / TRACE_FRAMES,
+           (double) reference.overBudget / TRACE_FRAMES, adaptive.changes);
+    EXPECT_TRUE(adaptive.overBudget < TRACE_FRAMES / 10);
+    EXPECT_TRUE(adaptive.overBudget * 4 < reference.overBudget);
+    EXPECT_TRUE(adaptive.minScale < 1.0f);
+    // 负载恢复后回到原分辨率
+    EXPECT_EQ(config.maxScale, adaptive.finalScale);
+    TraceResult lagged = replay(&config, TRACE_THROTTLE, 0.0f, 2, 4.0f);
+    EXPECT_TRUE(lagged.overBudget < TRACE_FRAMES / 10);
+    EXPECT_EQ(config.maxScale, lagged.finalScale);
+}
+
+static void testIsolatedSpikes() {
+    ResolutionConfig config;
+    resolutionConfigDefault(&config, TRACE_BUDGET_MS);
+    // 每 120 帧有 10 帧负载翻倍：平均值短暂超过预算，不降低分辨率
+    EXPECT_EQ(0, replay(&config, TRACE_SPIKE, 0.0f, 0, 4.0f).changes);
+    EXPECT_EQ(0, replay(&config, TRACE_SPIKE, 0.0f, 2, 4.0f).changes);
+    // 同样的尖峰持续不断时仍然会降低
+    ResolutionController controller;
+    resolutionControllerInit(&controller, &config);
+    for (int i = 0; i < config.window + config.sustainFrames; i++) {
+        resolutionControllerUpdate(&controller, 4.0f, 2.0f * TRACE_BUDGET_MS);
+    }
+    EXPECT_EQ(1, controller.stats.decreases);
+}
+
+static void testGpuTimingFallback() {
+    ResolutionConfig config;
+    resolutionConfigDefault(&config, TRACE_BUDGET_MS);
+    // 得到 GPU 耗时之后，没有新结果的帧不用 CPU 耗时代替：CPU 远超预算也不降低分辨率
+    EXPECT_EQ(0, replay(&config, TRACE_STEADY, 0.0f, 2, 30.0f).changes);
+    EXPECT_EQ(0, replay(&config, TRACE_STEADY, 0.0f, 3, 30.0f).changes);
+    // 在第一个 GPU 耗时之前的 CPU 耗时被清空，不影响之后的控制
+    ResolutionController controller;
+    resolutionControllerInit(&controller, &config);
+    for (int i = 0; i < config.window - 1; i++) {
+        resolutionControllerUpdate(&controller, 30.0f, -1.0f);
+    }
+    for (int i = 0; i < config.window + config.sustainFrames; i++) {
+        resolutionControllerUpdate(&controller, 30.0f, 11.0f);
+    }
+    EXPECT_EQ(0, controller.stats.decreases);
+    EXPECT_NEAR(11.0, controller.stats.averageMs, 1e-4);
+    // 没有 GPU 计时时用 CPU 耗时控制
+    EXPECT_EQ(0, replay(&config, TRACE_STEADY, 0.0f, CPU_ONLY, 11.0f).changes);
+    TraceResult cpuBound = replay(&config, TRACE_STEADY, 0.0f, CPU_ONLY, 20.0f);
+    EXPECT_TRUE(cpuBound.changes > 0);
+    EXPECT_EQ(config.minScale, cpuBound.finalScale);
+}
+
+int main() {
+    RUN_TEST(testScaleStaysInRange);
+    RUN_TEST(testSteadyLoadDoesNotOscillate);
+    RUN_TEST(testThrottleRamp);
+    RUN_TEST(testIsolatedSpikes);
+    RUN_TEST(testGpuTimingFallback);
+    return TEST_RESULT();
+}
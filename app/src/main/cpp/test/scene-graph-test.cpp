@@ -0,0 +1,332 @@
+#include <vector>
+#include "es-util.h"
+#include "scene-graph.h"
+#include "thread-pool.h"
+#include "test-util.h"
+
+// 变换层次：世界矩阵与按句柄逐个用 matrixMultiply 串联局部矩阵的参考结果一致；
+// 只重新计算修改过的节点及其子树；更新后再创建节点触发重新排序，之前的句柄仍然指向原来的节点；
+// 某一层需要计算的节点超过 SCENE_PARALLEL_GRAIN * 2 时用 ThreadPool 并行，结果与当前线程执行相同。
+
+#define NODE_COUNT 1500
+//宽树的每层节点数，第 2、3 层超过并行的阈值
+#define WIDE_LEVEL1 4
+#define WIDE_LEVEL2 (SCENE_PARALLEL_GRAIN / 2)
+#define WIDE_LEVEL3 2
+
+// 与 SceneGraph 并行维护的参考：按句柄保存父节点和局部矩阵
+typedef struct {
+    std::vector<SceneNode> parent;
+    std::vector<Matrix> local;
+} ReferenceScene;
+
+static uint32_t nextRandom(uint32_t *seed) {
+    *seed = *seed * 1664525u + 1013904223u;
+    return *seed >> 8;
+}
+
+static SceneNode addNode(SceneGraph *graph, ReferenceScene *ref, SceneNode parent) {
+    SceneNode node = sceneNodeCreate(graph, parent);
+    EXPECT_EQ((int) ref->parent.size(), node);
+    Matrix identity;
+    matrixLoadIdentity(&identity);
+    ref->parent.push_back(parent);
+    ref->local.push_back(identity);
+    return node;
+}
+
+// 由 i 和 variant 决定的变换，同时设置到图和参考中
+static void setNodeTransform(SceneGraph *graph, ReferenceScene *ref, SceneNode node, int variant) {
+    int i = node + variant * 7;
+    const float position[3] = {(float) (i % 7) - 3.0f, (float) (i % 5) * 0.5f,
+                               (float) (i % 3) - 1.0f};
+    const float axis[3] = {0.0f, 0.6f, 0.8f};
+    // 一部分不旋转，覆盖 angle == 0 的分支
+    float angle = i % 4 == 0 ? 0.0f : (float) (i * 37 % 360);
+    float scaling = 0.9f + (float) (i % 3) * 0.05f;
+    Matrix *local = &ref->local[node];
+    matrixLoadIdentity(local);
+    translate(local, position[0], position[1], position[2]);
+    if (angle != 0.0f) {
+        rotate(local, angle, axis[0], axis[1], axis[2]);
+    }
+    scale(local, scaling, scaling, scaling);
+    sceneNodeSetTransform(graph, node, position, axis, angle, scaling);
+}
+
+// 父节点的句柄总小于子节点，按句柄顺序即可串联
+static std::vector<Matrix> referenceWorld(ReferenceScene *ref) {
+    std::vector<Matrix> world(ref->parent.size());
+    for (size_t i = 0; i < world.size(); i++) {
+        SceneNode p = ref->parent[i];
+        if (p < 0) {
+            world[i] = ref->local[i];
+        } else {
+            matrixMultiply(&world[i], &ref->local[i], &world[p]);
+        }
+    }
+    return world;
+}
+
+static int subtreeSize(const ReferenceScene *ref, SceneNode node) {
+    int size = 1;
+    for (size_t i = node + 1; i < ref->parent.size(); i++) {
+        if (ref->parent[i] == node) {
+            size += subtreeSize(ref, (SceneNode) i);
+        }
+    }
+    return size;
+}
+
+static bool inSubtree(const ReferenceScene *ref, SceneNode node, SceneNode root) {
+    for (; node >= 0; node = ref->parent[node]) {
+        if (node == root) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// 与参考结果不同的节点数；两边的乘法顺序相同，结果应完全相同
+static int countMismatches(const SceneGraph *graph, ReferenceScene *ref) {
+    std::vector<Matrix> expected = referenceWorld(ref);
+    int mismatches = 0;
+    for (size_t i = 0; i < expected.size(); i++) {
+        mismatches += memcmp(sceneNodeWorld(graph, (SceneNode) i), &expected[i], sizeof(Matrix)) != 0;
+        mismatches += memcmp(sceneNodeLocal(graph, (SceneNode) i), &ref->local[i], sizeof(Matrix)) != 0;
+    }
+    return mismatches;
+}
+
+// 几个根节点，每个节点的父节点从之前创建的节点中随机选择，创建顺序与广度优先顺序不同
+static void buildRandomScene(SceneGraph *graph, ReferenceScene *ref, int count) {
+    uint32_t seed = 2024;
+    for (int i = 0; i < count; i++) {
+        SceneNode parent = i < 3 ? -1 : (SceneNode) (nextRandom(&seed) % i);
+        SceneNode node = addNode(graph, ref, parent);
+        setNodeTransform(graph, ref, node, 0);
+    }
+}
+
+static void testWorldMatchesReference() {
+    SceneGraph graph;
+    ReferenceScene ref;
+    EXPECT_TRUE(sceneGraphInit(&graph, NODE_COUNT + 64));
+    buildRandomScene(&graph, &ref, NODE_COUNT);
+    // 再加一条很深的链
+    SceneNode chain = 0;
+    for (int i = 0; i < 64; i++) {
+        chain = addNode(&graph, &ref, chain);
+        setNodeTransform(&graph, &ref, chain, 1);
+    }
+    EXPECT_EQ(NODE_COUNT + 64, sceneGraphUpdate(&graph, NULL));
+    EXPECT_EQ(1, graph.stats.reorders);
+    EXPECT_EQ(0, countMismatches(&graph, &ref));
+    // 广度优先：父节点的槽总在子节点之前，深度不减
+    for (int i = 1; i < graph.count; i++) {
+        EXPECT_TRUE(graph.parent[i] < i);
+        EXPECT_TRUE(graph.depth[i] >= graph.depth[i - 1]);
+    }
+    sceneGraphRelease(&graph);
+}
+
+static void testOnlyDirtySubtrees() {
+    SceneGraph graph;
+    ReferenceScene ref;
+    EXPECT_TRUE(sceneGraphInit(&graph, NODE_COUNT));
+    buildRandomScene(&graph, &ref, NODE_COUNT);
+    sceneGraphUpdate(&graph, NULL);
+
+    // 没有修改时直接返回
+    EXPECT_EQ(0, sceneGraphUpdate(&graph, NULL));
+    EXPECT_EQ(1, graph.stats.skipped);
+    EXPECT_EQ(0, graph.stats.lastUpdated);
+
+    // 叶子节点只计算自己
+    SceneNode leaf = NODE_COUNT - 1;
+    EXPECT_EQ(1, subtreeSize(&ref, leaf));
+    setNodeTransform(&graph, &ref, leaf, 1);
+    EXPECT_EQ(1, sceneGraphUpdate(&graph, NULL));
+    EXPECT_EQ(1, graph.stats.lastUpdated);
+    EXPECT_EQ(0, countMismatches(&graph, &ref));
+
+    // 找一个子树不小也不是整棵树的节点
+    SceneNode inner = -1;
+    for (SceneNode node = 3; node < NODE_COUNT && inner < 0; node++) {
+        int size = subtreeSize(&ref, node);
+        if (size > 20 && size < NODE_COUNT / 4) {
+            inner = node;
+        }
+    }
+    EXPECT_TRUE(inner >= 0);
+    int innerSize = subtreeSize(&ref, inner);
+    setNodeTransform(&graph, &ref, inner, 2);
+    EXPECT_EQ(innerSize, sceneGraphUpdate(&graph, NULL));
+    EXPECT_EQ(0, countMismatches(&graph, &ref));
+
+    // 同一节点修改两次、子树中的节点也修改：每个节点只计算一次
+    SceneNode descendant = -1;
+    for (SceneNode node = inner + 1; node < NODE_COUNT && descendant < 0; node++) {
+        if (ref.parent[node] == inner) {
+            descendant = node;
+        }
+    }
+    setNodeTransform(&graph, &ref, inner, 3);
+    setNodeTransform(&graph, &ref, descendant, 3);
+    setNodeTransform(&graph, &ref, inner, 4);
+    EXPECT_EQ(innerSize, sceneGraphUpdate(&graph, NULL));
+    EXPECT_EQ(0, countMismatches(&graph, &ref));
+
+    // 互不相交的两棵子树：个数相加
+    setNodeTransform(&graph, &ref, inner, 5);
+    setNodeTransform(&graph, &ref, leaf, 5);
+    EXPECT_EQ(innerSize + 1, sceneGraphUpdate(&graph, NULL));
+    EXPECT_EQ(0, countMismatches(&graph, &ref));
+
+    // sceneNodeSetLocal 同样只标记该节点
+    Matrix local;
+    matrixLoadIdentity(&local);
+    translate(&local, 1.0f, 2.0f, 3.0f);
+    ref.local[descendant] = local;
+    sceneNodeSetLocal(&graph, descendant, &local);
+    EXPECT_EQ(subtreeSize(&ref, descendant), sceneGraphUpdate(&graph, NULL));
+    EXPECT_EQ(0, countMismatches(&graph, &ref));
+
+    // 根节点：整棵树
+    setNodeTransform(&graph, &ref, 0, 6);
+    EXPECT_EQ(subtreeSize(&ref, 0), sceneGraphUpdate(&graph, NULL));
+    EXPECT_EQ(0, countMismatches(&graph, &ref));
+    EXPECT_EQ(1, graph.stats.reorders);
+    EXPECT_EQ(1, graph.stats.skipped);
+    sceneGraphRelease(&graph);
+}
+
+static void testHandlesAfterReorder() {
+    SceneGraph graph;
+    ReferenceScene ref;
+    EXPECT_TRUE(sceneGraphInit(&graph, NODE_COUNT + 40));
+    buildRandomScene(&graph, &ref, NODE_COUNT);
+    sceneGraphUpdate(&graph, NULL);
+    std::vector<int> slotsBefore(NODE_COUNT);
+    for (int i = 0; i < NODE_COUNT; i++) {
+        slotsBefore[i] = graph.nodeSlot[i];
+    }
+
+    // 在已排序的节点下面挂新的子节点，以及新的根节点，顺序与广度优先不同
+    uint32_t seed = 7;
+    std::vector<SceneNode> added;
+    for (int i = 0; i < 30; i++) {
+        SceneNode parent = i % 10 == 9 ? -1 : (SceneNode) (nextRandom(&seed) % ref.parent.size());
+        SceneNode node = addNode(&graph, &ref, parent);
+        added.push_back(node);
+        // 更新之前，新节点的世界矩阵为单位矩阵
+        EXPECT_TRUE(memcmp(sceneNodeWorld(&graph, node), &ref.local[node], sizeof(Matrix)) == 0);
+        if (i % 2 == 0) {
+            setNodeTransform(&graph, &ref, node, 1);
+        }
+    }
+    // 新节点挂在旧节点下：只有新节点需要计算（旧的父节点没有修改）
+    EXPECT_EQ((int) added.size(), sceneGraphUpdate(&graph, NULL));
+    EXPECT_EQ(2, graph.stats.reorders);
+    EXPECT_EQ(0, countMismatches(&graph, &ref));
+    int moved = 0;
+    for (int i = 0; i < NODE_COUNT; i++) {
+        moved += graph.nodeSlot[i] != slotsBefore[i];
+        EXPECT_EQ(i, graph.slotNode[graph.nodeSlot[i]]);
+    }
+    // 新的根节点排在旧节点的子节点之前，确实有节点换了槽
+    EXPECT_TRUE(moved > 0);
+
+    // 创建节点后、重新排序之前修改的旧节点也在排序后更新
+    SceneNode old = ref.parent[added[0]] >= 0 ? ref.parent[added[0]] : 0;
+    SceneNode newChild = addNode(&graph, &ref, added[1]);
+    setNodeTransform(&graph, &ref, old, 2);
+    int expected = subtreeSize(&ref, old) + (inSubtree(&ref, newChild, old) ? 0 : 1);
+    EXPECT_EQ(expected, sceneGraphUpdate(&graph, NULL));
+    EXPECT_EQ(3, graph.stats.reorders);
+    EXPECT_EQ(0, countMismatches(&graph, &ref));
+
+    // 容量已满
+    while ((int) ref.parent.size() < graph.capacity) {
+        addNode(&graph, &ref, 0);
+    }
+    EXPECT_EQ(-1, sceneNodeCreate(&graph, 0));
+    sceneGraphUpdate(&graph, NULL);
+    EXPECT_EQ(0, countMismatches(&graph, &ref));
+    sceneGraphRelease(&graph);
+}
+
+// 1 个根，WIDE_LEVEL1 个子节点，各有 WIDE_LEVEL2 个子节点，再各有 WIDE_LEVEL3 个
+static void buildWideScene(SceneGraph *graph, ReferenceScene *ref) {
+    SceneNode root = addNode(graph, ref, -1);
+    setNodeTransform(graph, ref, root, 0);
+    for (int i = 0; i < WIDE_LEVEL1; i++) {
+        SceneNode a = addNode(graph, ref, root);
+        setNodeTransform(graph, ref, a, 0);
+        for (int j = 0; j < WIDE_LEVEL2; j++) {
+            SceneNode b = addNode(graph, ref, a);
+            setNodeTransform(graph, ref, b, 0);
+            for (int k = 0; k < WIDE_LEVEL3; k++) {
+                SceneNode c = addNode(graph, ref, b);
+                setNodeTransform(graph, ref, c, 0);
+            }
+        }
+    }
+}
+
+static int countWorldDifferences(const SceneGraph *a, const SceneGraph *b, int count) {
+    int differences = 0;
+    for (SceneNode node = 0; node < count; node++) {
+        differences += memcmp(sceneNodeWorld(a, node), sceneNodeWorld(b, node), sizeof(Matrix)) != 0;
+    }
+    return differences;
+}
+
+static void testThreadPoolMatchesSerial() {
+    const int count = 1 + WIDE_LEVEL1 * (1 + WIDE_LEVEL2 * (1 + WIDE_LEVEL3));
+    // 并行的层确实超过阈值
+    EXPECT_TRUE(WIDE_LEVEL1 * WIDE_LEVEL2 >= SCENE_PARALLEL_GRAIN * 2);
+    ThreadPool pool(4);
+    SceneGraph serial, parallel;
+    ReferenceScene serialRef, parallelRef;
+    EXPECT_TRUE(sceneGraphInit(&serial, count));
+    EXPECT_TRUE(sceneGraphInit(&parallel, count));
+    buildWideScene(&serial, &serialRef);
+    buildWideScene(&parallel, &parallelRef);
+    EXPECT_EQ(count, sceneGraphUpdate(&serial, NULL));
+    EXPECT_EQ(count, sceneGraphUpdate(&parallel, &pool));
+    EXPECT_EQ(0, countWorldDifferences(&serial, &parallel, count));
+    EXPECT_EQ(0, countMismatches(&parallel, &parallelRef));
+
+    // 只修改第 2 层的一半：这一层不到阈值，在当前线程计算，下一层的子节点超过阈值
+    for (SceneNode node = 0; node < count; node++) {
+        if (serialRef.parent[node] > 0 && serialRef.parent[serialRef.parent[node]] == 0 &&
+            node % 2 == 0) {
+            setNodeTransform(&serial, &serialRef, node, 1);
+            setNodeTransform(&parallel, &parallelRef, node, 1);
+        }
+    }
+    int updated = sceneGraphUpdate(&serial, NULL);
+    EXPECT_EQ(updated, sceneGraphUpdate(&parallel, &pool));
+    EXPECT_TRUE(updated >= SCENE_PARALLEL_GRAIN * 2);
+    EXPECT_EQ(0, countWorldDifferences(&serial, &parallel, count));
+    EXPECT_EQ(0, countMismatches(&parallel, &parallelRef));
+
+    // 修改根节点：全部重新计算
+    setNodeTransform(&serial, &serialRef, 0, 2);
+    setNodeTransform(&parallel, &parallelRef, 0, 2);
+    EXPECT_EQ(count, sceneGraphUpdate(&serial, NULL));
+    EXPECT_EQ(count, sceneGraphUpdate(&parallel, &pool));
+    EXPECT_EQ(0, countWorldDifferences(&serial, &parallel, count));
+    EXPECT_EQ(0, countMismatches(&parallel, &parallelRef));
+    sceneGraphRelease(&serial);
+    sceneGraphRelease(&parallel);
+}
+
+int main() {
+    RUN_TEST(testWorldMatchesReference);
+    RUN_TEST(testOnlyDirtySubtrees);
+    RUN_TEST(testHandlesAfterReorder);
+    RUN_TEST(testThreadPoolMatchesSerial);
+    return TEST_RESULT();
+}
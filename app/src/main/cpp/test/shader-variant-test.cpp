@@ -0,0 +1,250 @@
+#include <string>
+#include "es-util.h"
+#include "gl-stub.h"
+#include "program-builder.h"
+#include "shader-variant.h"
+#include "test-util.h"
+
+// 着色器变体：#define 插入在 #version 行之后（没有时在开头），并用 #line 恢复行号；
+// 特性按完整标识符匹配，COLOR 不匹配 VERTEX_COLOR，只注入用到它的阶段；
+// 两个阶段都没用到的特性不产生新的组合；源码相同的组合只提交一次。
+// gl-stub 中没有 EGL display，programBuilderInit 选择同步构建，createProgram 记录提交的源码。
+
+#define VTX_BODY \
+    "in vec4 aPosition;\n" \
+    "void main() {\n" \
+    "#ifdef SKINNED\n" \
+    "    gl_Position = aPosition * 2.0;\n" \
+    "#else\n" \
+    "    gl_Position = aPosition;\n" \
+    "#endif\n" \
+    "}\n"
+#define FRAG_BODY \
+    "precision mediump float;\n" \
+    "out vec4 fragColor;\n" \
+    "void main() {\n" \
+    "#ifdef FOG\n" \
+    "    fragColor = TINT * 0.5;\n" \
+    "#else\n" \
+    "    fragColor = TINT;\n" \
+    "#endif\n" \
+    "}\n"
+#define VERSION_LINE "#version 300 es\n"
+
+#define TINT_VALUE "vec4(1.0, 0.5, 0.0, 1.0)"
+
+//与 FEATURES 中的顺序一致
+#define SKINNED (1u << 0)
+#define FOG (1u << 1)
+#define TINT (1u << 2)
+#define UNUSED (1u << 3)
+
+static const ShaderFeature FEATURES[] = {
+        {"SKINNED", NULL},
+        {"FOG", NULL},
+        {"TINT", TINT_VALUE},
+        {"UNUSED", NULL},
+};
+#define FEATURE_COUNT ((int) (sizeof(FEATURES) / sizeof(FEATURES[0])))
+
+static void setUp() {
+    glStubReset();
+    EXPECT_TRUE(programBuilderInit(VERSION_LINE VTX_BODY, VERSION_LINE FRAG_BODY));
+    EXPECT_EQ(PROGRAM_BUILD_SYNC, programBuilderMode());
+}
+
+static void tearDown() {
+    shaderVariantRelease();
+    programBuilderRelease();
+}
+
+static bool assembleEquals(ShaderTemplate shaderTemplate, ShaderFeatures features,
+                           const char *expectedVtx, const char *expectedFrag) {
+    char *vtxSrc = NULL;
+    char *fragSrc = NULL;
+    if (!shaderVariantAssemble(shaderTemplate, features, &vtxSrc, &fragSrc)) {
+        return false;
+    }
+    bool same = strcmp(vtxSrc, expectedVtx) == 0 && strcmp(fragSrc, expectedFrag) == 0;
+    if (!same) {
+        fprintf(stderr, "assembled:\n%s\n---\n%s\n", vtxSrc, fragSrc);
+    }
+    free(vtxSrc);
+    free(fragSrc);
+    return same;
+}
+
+static void testAssembleWithVersion() {
+    setUp();
+    ShaderTemplate shaderTemplate = shaderTemplateCreate(VERSION_LINE VTX_BODY,
+                                                         VERSION_LINE FRAG_BODY, FEATURES,
+                                                         FEATURE_COUNT);
+    EXPECT_EQ(0, shaderTemplate);
+    // 各特性只注入到用到它的阶段，顺序与特性定义一致
+    EXPECT_TRUE(assembleEquals(shaderTemplate, SKINNED | FOG | TINT | UNUSED,
+                               VERSION_LINE "#define SKINNED\n#line 2\n" VTX_BODY,
+                               VERSION_LINE "#define FOG\n#define TINT " TINT_VALUE "\n#line 2\n"
+                               FRAG_BODY));
+    EXPECT_TRUE(assembleEquals(shaderTemplate, 0, VERSION_LINE "#line 2\n" VTX_BODY,
+                               VERSION_LINE "#line 2\n" FRAG_BODY));
+
+    // 只有 #version 一行且没有换行时补上换行
+    ShaderTemplate versionOnly = shaderTemplateCreate("#version 300 es", "#version 300 es FOG",
+                                                      FEATURES, FEATURE_COUNT);
+    EXPECT_TRUE(assembleEquals(versionOnly, FOG, "#version 300 es\n#line 2\n",
+                               "#version 300 es FOG\n#define FOG\n#line 2\n"));
+    tearDown();
+}
+
+static void testAssembleWithoutVersion() {
+    setUp();
+    ShaderTemplate shaderTemplate = shaderTemplateCreate(VTX_BODY, FRAG_BODY, FEATURES,
+                                                         FEATURE_COUNT);
+    EXPECT_TRUE(shaderTemplate >= 0);
+    // 没有 #version 时 #define 放在开头，#line 1 让后面的行号从模板第 1 行开始
+    EXPECT_TRUE(assembleEquals(shaderTemplate, SKINNED | TINT,
+                               "#define SKINNED\n#line 1\n" VTX_BODY,
+                               "#define TINT " TINT_VALUE "\n#line 1\n" FRAG_BODY));
+    EXPECT_TRUE(assembleEquals(shaderTemplate, 0, "#line 1\n" VTX_BODY, "#line 1\n" FRAG_BODY));
+    // 不在开头的 #version 不当作版本行
+    ShaderTemplate indented = shaderTemplateCreate(" #version 300 es\n", "\n#version 300 es\n",
+                                                   FEATURES, FEATURE_COUNT);
+    EXPECT_TRUE(assembleEquals(indented, 0, "#line 1\n #version 300 es\n",
+                               "#line 1\n\n#version 300 es\n"));
+    // 模板句柄非法
+    char *vtxSrc = NULL;
+    char *fragSrc = NULL;
+    EXPECT_TRUE(!shaderVariantAssemble(-1, 0, &vtxSrc, &fragSrc));
+    EXPECT_TRUE(!shaderVariantAssemble(MAX_SHADER_TEMPLATES, 0, &vtxSrc, &fragSrc));
+    tearDown();
+}
+
+// 顶点着色器中只有 VERTEX_COLOR、COLORS、aCOLOR，片元着色器中有完整的 COLOR
+static void testWholeIdentifierMatch() {
+    setUp();
+    const char *vtx = VERSION_LINE
+            "in vec4 VERTEX_COLOR;\n"
+            "out vec4 COLORS;\n"
+            "void main() { COLORS = VERTEX_COLOR; gl_Position = vec4(aCOLOR); }\n";
+    const char *frag = VERSION_LINE
+            "precision mediump float;\n"
+            "in vec4 COLORS;\n"
+            "out vec4 fragColor;\n"
+            "void main() {\n"
+            "#ifdef COLOR\n"
+            "    fragColor = COLORS;\n"
+            "#endif\n"
+            "}\n";
+    const char *vertexOnly = VERSION_LINE "void main() { gl_Position = VERTEX_COLOR; }\n";
+    const ShaderFeature color = {"COLOR", NULL};
+    ShaderTemplate shaderTemplate = shaderTemplateCreate(vtx, frag, &color, 1);
+    ShaderTemplate unmatched = shaderTemplateCreate(vertexOnly, vertexOnly, &color, 1);
+    EXPECT_TRUE(shaderTemplate >= 0 && unmatched >= 0);
+
+    std::string vtxBody(vtx + strlen(VERSION_LINE));
+    std::string fragBody(frag + strlen(VERSION_LINE));
+    EXPECT_TRUE(assembleEquals(shaderTemplate, 1, (VERSION_LINE "#line 2\n" + vtxBody).c_str(),
+                               (VERSION_LINE "#define COLOR\n#line 2\n" + fragBody).c_str()));
+
+    // 两个阶段都只有 VERTEX_COLOR：COLOR 不注入，也不产生新的组合
+    std::string unmatchedSrc = std::string(VERSION_LINE "#line 2\n") +
+                               (vertexOnly + strlen(VERSION_LINE));
+    EXPECT_TRUE(assembleEquals(unmatched, 1, unmatchedSrc.c_str(), unmatchedSrc.c_str()));
+    const ShaderVariantKey keys[] = {{unmatched, 0}, {unmatched, 1}};
+    EXPECT_EQ(1, shaderVariantPrecompile(keys, 2));
+    EXPECT_EQ(shaderVariantFind(unmatched, 0), shaderVariantFind(unmatched, 1));
+    tearDown();
+}
+
+// 没有用到的特性在生成键时被去掉：与不带该特性的组合是同一个变体
+static void testUnusedFeaturesCollapse() {
+    setUp();
+    ShaderTemplate shaderTemplate = shaderTemplateCreate(VERSION_LINE VTX_BODY,
+                                                         VERSION_LINE FRAG_BODY, FEATURES,
+                                                         FEATURE_COUNT);
+    // 高于 featureCount 的位同样忽略
+    const ShaderVariantKey keys[] = {
+            {shaderTemplate, TINT},
+            {shaderTemplate, TINT | UNUSED},
+            {shaderTemplate, TINT | (1u << 31)},
+            {shaderTemplate, TINT | FOG},
+            {shaderTemplate, TINT | FOG | UNUSED},
+    };
+    EXPECT_EQ(2, shaderVariantPrecompile(keys, 5));
+    ShaderVariantStats stats;
+    shaderVariantGetStats(&stats);
+    EXPECT_EQ(5, stats.requested);
+    EXPECT_EQ(2, stats.compiled);
+    EXPECT_EQ(3, stats.deduplicated);
+
+    ProgramHandle tint = shaderVariantFind(shaderTemplate, TINT);
+    ProgramHandle fog = shaderVariantFind(shaderTemplate, TINT | FOG);
+    EXPECT_TRUE(tint >= 0 && fog >= 0 && tint != fog);
+    EXPECT_EQ(tint, shaderVariantFind(shaderTemplate, TINT | UNUSED));
+    EXPECT_EQ(fog, shaderVariantFind(shaderTemplate, TINT | FOG | UNUSED));
+    // 没有预编译的组合和非法的模板
+    EXPECT_EQ(-1, shaderVariantFind(shaderTemplate, SKINNED | TINT));
+    EXPECT_EQ(-1, shaderVariantFind(shaderTemplate + 1, TINT));
+    EXPECT_EQ(-1, shaderVariantFind(-1, TINT));
+
+    // 再次预编译已有的组合不提交
+    EXPECT_EQ(0, shaderVariantPrecompile(keys, 5));
+    shaderVariantGetStats(&stats);
+    EXPECT_EQ(10, stats.requested);
+    EXPECT_EQ(2, stats.compiled);
+    EXPECT_EQ(8, stats.deduplicated);
+    const ShaderVariantKey invalid = {shaderTemplate + 1, 0};
+    EXPECT_EQ(-1, shaderVariantPrecompile(&invalid, 1));
+    tearDown();
+}
+
+// 两个模板的源码相同：键不同但生成的源码相同，只提交一次，两个键得到同一个程序
+static void testIdenticalSourcesSubmittedOnce() {
+    setUp();
+    // 占位程序
+    EXPECT_EQ(1, glStubCount("createProgram"));
+    ShaderTemplate first = shaderTemplateCreate(VERSION_LINE VTX_BODY, VERSION_LINE FRAG_BODY,
+                                                FEATURES, FEATURE_COUNT);
+    ShaderTemplate second = shaderTemplateCreate(VERSION_LINE VTX_BODY, VERSION_LINE FRAG_BODY,
+                                                 FEATURES, FEATURE_COUNT);
+    const ShaderVariantKey keys[] = {
+            {first, SKINNED | TINT},
+            {second, SKINNED | TINT},
+            {second, SKINNED | TINT | UNUSED},
+            {first, TINT},
+            {second, TINT},
+    };
+    EXPECT_EQ(2, shaderVariantPrecompile(keys, 5));
+    EXPECT_EQ(3, glStubCount("createProgram"));
+    ShaderVariantStats stats;
+    shaderVariantGetStats(&stats);
+    EXPECT_EQ(5, stats.requested);
+    EXPECT_EQ(2, stats.compiled);
+    EXPECT_EQ(3, stats.deduplicated);
+
+    ProgramHandle skinned = shaderVariantFind(first, SKINNED | TINT);
+    ProgramHandle plain = shaderVariantFind(first, TINT);
+    EXPECT_TRUE(skinned >= 0 && plain >= 0 && skinned != plain);
+    EXPECT_EQ(skinned, shaderVariantFind(second, SKINNED | TINT));
+    EXPECT_EQ(plain, shaderVariantFind(second, TINT));
+
+    // 提交给 createProgram 的是组装后的源码
+    EXPECT_EQ(PROGRAM_READY, programBuilderState(skinned));
+    GLuint program = programBuilderGet(skinned);
+    const char *vtxSrc = glStubProgramSource(program, GL_VERTEX_SHADER);
+    const char *fragSrc = glStubProgramSource(program, GL_FRAGMENT_SHADER);
+    EXPECT_TRUE(vtxSrc && fragSrc);
+    if (vtxSrc && fragSrc) {
+        EXPECT_TRUE(assembleEquals(first, SKINNED | TINT, vtxSrc, fragSrc));
+    }
+    tearDown();
+}
+
+int main() {
+    RUN_TEST(testAssembleWithVersion);
+    RUN_TEST(testAssembleWithoutVersion);
+    RUN_TEST(testWholeIdentifierMatch);
+    RUN_TEST(testUnusedFeaturesCollapse);
+    RUN_TEST(testIdenticalSourcesSubmittedOnce);
+    return TEST_RESULT();
+}
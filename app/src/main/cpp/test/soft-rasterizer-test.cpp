@@ -0,0 +1,407 @@
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+#include "es-util.h"
+#include "mesh-generator.h"
+#include "soft-rasterizer.h"
+#include "test-util.h"
+
+// 软件光栅化的基准图像测试：golden/ 下的 PPM 由本程序生成并提交，
+// 渲染结果变化是预期的时候用 `soft-rasterizer-test --update-golden`（工作目录为 test/）重新生成。
+
+#define GOLDEN_WIDTH 160
+#define GOLDEN_HEIGHT 120
+//不同编译器/指令集下插值的舍入可能略有差异，允许的通道误差及不一致的像素数
+#define GOLDEN_TOLERANCE 2
+#define GOLDEN_MAX_DIFFERENT 8
+//宽度不是 8 的倍数，高度跨越多个块
+#define FAN_WIDTH 203
+#define FAN_HEIGHT 141
+
+static bool updateGolden = false;
+
+static const GLfloat CLEAR_COLOR[4] = {0.1f, 0.1f, 0.1f, 1.0f};
+static const GLfloat BLACK[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+
+static void perspectiveCamera(Matrix *viewProj, float eyeY, float centerZ, int width, int height) {
+    Matrix view, projection;
+    matrixLookAt(&view, 0.0f, eyeY, 0.0f, 0.0f, eyeY, centerZ, 0.0f, 1.0f, 0.0f);
+    matrixLoadIdentity(&projection);
+    perspective(&projection, 60.0f, (float) width / height, 0.1f, 100.0f);
+    matrixMultiply(viewProj, &view, &projection);
+}
+
+//球体（Gouraud）与立方体（flat）互相穿插，检验深度测试、插值和背面剔除
+static void drawScene(SoftFramebuffer *framebuffer, ThreadPool *pool) {
+    SoftRasterizer rasterizer;
+    SoftDrawState state;
+    Mesh sphere, cube;
+    createSphereMesh(&sphere, 24, 1.0f);
+    createCubeMesh(&cube, 0.8f);
+    softFramebufferClear(framebuffer, CLEAR_COLOR, 1.0f);
+    softRasterizerInit(&rasterizer, framebuffer, pool);
+    softDrawStateDefault(&state);
+    perspectiveCamera(&state.viewProj, 0.0f, -1.0f, framebuffer->width, framebuffer->height);
+
+    translate(&state.model, -0.4f, 0.0f, -4.0f);
+    state.color[1] = 0.6f;
+    state.color[2] = 0.3f;
+    softRasterizerDrawMesh(&rasterizer, &state, &sphere);
+
+    matrixLoadIdentity(&state.model);
+    translate(&state.model, 0.6f, 0.2f, -3.6f);
+    rotate(&state.model, 35.0f, 0.3f, 1.0f, 0.2f);
+    state.color[0] = 0.3f;
+    state.color[1] = 0.5f;
+    state.color[2] = 1.0f;
+    state.shading = SOFT_SHADE_FLAT;
+    softRasterizerDrawMesh(&rasterizer, &state, &cube);
+    softRasterizerFlush(&rasterizer);
+    softRasterizerRelease(&rasterizer);
+}
+
+//从眼睛下方延伸到身后的地面，只有经过近平面裁剪才能正确绘制；远端接近远平面，地平线在屏幕正中。
+//第一个三角形一个顶点在身后，裁剪成四边形（两个三角形），第二个两个顶点在身后，裁剪后仍是一个三角形
+static const GLfloat GROUND[] = {
+        0.0f, 0.0f, 10.0f,
+        -200.0f, 0.0f, -90.0f,
+        200.0f, 0.0f, -90.0f,
+        -200.0f, 0.0f, 10.0f,
+        200.0f, 0.0f, 10.0f,
+        0.0f, 0.0f, -90.0f,
+};
+static const GLuint GROUND_INDICES[] = {0, 1, 2, 3, 4, 5};
+
+static void drawGround(SoftRasterizer *rasterizer, SoftFramebuffer *framebuffer) {
+    SoftDrawState state;
+    softDrawStateDefault(&state);
+    perspectiveCamera(&state.viewProj, 1.0f, -1.0f, framebuffer->width, framebuffer->height);
+    state.ambient = 1.0f;
+    state.shading = SOFT_SHADE_FLAT;
+    state.cullBackFaces = false;
+    state.color[0] = 0.0f;
+    state.color[2] = 0.0f;
+    softRasterizerDraw(rasterizer, &state, GROUND, NULL, 6, GROUND_INDICES, 6);
+}
+
+static void drawNearClipScene(SoftFramebuffer *framebuffer) {
+    SoftRasterizer rasterizer;
+    SoftDrawState state;
+    Mesh cube;
+    createCubeMesh(&cube, 1.0f);
+    softFramebufferClear(framebuffer, CLEAR_COLOR, 1.0f);
+    softRasterizerInit(&rasterizer, framebuffer, NULL);
+    drawGround(&rasterizer, framebuffer);
+    // 立方体一半在近平面之后
+    softDrawStateDefault(&state);
+    perspectiveCamera(&state.viewProj, 1.0f, -1.0f, framebuffer->width, framebuffer->height);
+    state.cullBackFaces = false;
+    translate(&state.model, 0.6f, 0.7f, -0.8f);
+    rotate(&state.model, 20.0f, 0.0f, 1.0f, 0.0f);
+    softRasterizerDrawMesh(&rasterizer, &state, &cube);
+    softRasterizerFlush(&rasterizer);
+    softRasterizerRelease(&rasterizer);
+}
+
+static void expectGolden(const SoftFramebuffer *actual, const char *name) {
+    char path[256];
+    SoftFramebuffer golden;
+    snprintf(path, sizeof(path), "golden/%s.ppm", name);
+    if (updateGolden) {
+        EXPECT_TRUE(softFramebufferWritePpm(actual, path));
+        return;
+    }
+    memset(&golden, 0, sizeof(golden));
+    EXPECT_TRUE(softFramebufferReadPpm(&golden, path));
+    int different = softFramebufferCompare(actual, &golden, GOLDEN_TOLERANCE);
+    if (different < 0 || different > GOLDEN_MAX_DIFFERENT) {
+        fprintf(stderr, "%s: %d pixels differ from the golden image\n", name, different);
+    }
+    EXPECT_TRUE(different >= 0 && different <= GOLDEN_MAX_DIFFERENT);
+    softFramebufferRelease(&golden);
+}
+
+static void testSceneGolden() {
+    SoftFramebuffer framebuffer;
+    EXPECT_TRUE(softFramebufferInit(&framebuffer, GOLDEN_WIDTH, GOLDEN_HEIGHT));
+    drawScene(&framebuffer, NULL);
+    expectGolden(&framebuffer, "soft-scene");
+    softFramebufferRelease(&framebuffer);
+}
+
+//每块只由一个线程按提交顺序光栅化，任意线程数的结果都应逐位相同
+static void testThreadCountInvariance() {
+    const int threadCounts[] = {1, 2, 3, 8};
+    SoftFramebuffer serial, parallel;
+    softFramebufferInit(&serial, GOLDEN_WIDTH * 2, GOLDEN_HEIGHT * 2);
+    softFramebufferInit(&parallel, GOLDEN_WIDTH * 2, GOLDEN_HEIGHT * 2);
+    drawScene(&serial, NULL);
+    for (int threads : threadCounts) {
+        ThreadPool pool(threads);
+        drawScene(&parallel, &pool);
+        EXPECT_EQ(0, softFramebufferCompare(&serial, &parallel, 0));
+        EXPECT_TRUE(memcmp(serial.depth, parallel.depth,
+                           sizeof(float) * serial.stride * serial.height) == 0);
+    }
+    softFramebufferRelease(&serial);
+    softFramebufferRelease(&parallel);
+}
+
+//扇形的每个三角形单独光栅化，累计每个像素被覆盖的次数
+static void rasterizeFan(ThreadPool *pool, float centerX, float centerY, float radius, int slices,
+                         std::vector<int> &hits) {
+    const GLfloat white[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+    SoftFramebuffer framebuffer;
+    SoftRasterizer rasterizer;
+    SoftDrawState state;
+    GLfloat vertices[9];
+    const GLuint indices[3] = {0, 1, 2};
+    softFramebufferInit(&framebuffer, FAN_WIDTH, FAN_HEIGHT);
+    softRasterizerInit(&rasterizer, &framebuffer, pool);
+    softDrawStateDefault(&state);
+    memcpy(state.color, white, sizeof(white));
+    state.ambient = 1.0f;
+    state.shading = SOFT_SHADE_FLAT;
+    hits.assign(FAN_WIDTH * FAN_HEIGHT, 0);
+    for (int i = 0; i < slices; i++) {
+        // 角度不均匀，边的斜率各不相同；最后一片回到第 0 个顶点，扇形闭合
+        int next = (i + 1) % slices;
+        float a0 = 2.0f * PI * ((float) i + 0.3f * sinf((float) i)) / slices;
+        float a1 = 2.0f * PI * ((float) next + 0.3f * sinf((float) next)) / slices;
+        vertices[0] = centerX;
+        vertices[1] = centerY;
+        vertices[3] = centerX + radius * cosf(a0);
+        vertices[4] = centerY + radius * sinf(a0);
+        vertices[6] = centerX + radius * cosf(a1);
+        vertices[7] = centerY + radius * sinf(a1);
+        vertices[2] = vertices[5] = vertices[8] = 0.0f;
+        softFramebufferClear(&framebuffer, BLACK, 1.0f);
+        softRasterizerDraw(&rasterizer, &state, vertices, NULL, 3, indices, 3);
+        softRasterizerFlush(&rasterizer);
+        for (int y = 0; y < FAN_HEIGHT; y++) {
+            for (int x = 0; x < FAN_WIDTH; x++) {
+                if ((framebuffer.color[y * framebuffer.stride + x] & 0xFFFFFF) != 0) {
+                    hits[y * FAN_WIDTH + x]++;
+                }
+            }
+        }
+    }
+    softRasterizerRelease(&rasterizer);
+    softFramebufferRelease(&framebuffer);
+}
+
+//覆盖整个屏幕的扇形：共享边按左上规则只属于一个三角形，每个像素恰好被覆盖一次
+static void testFanCoversScreenOnce() {
+    std::vector<int> hits;
+    ThreadPool pool(4);
+    ThreadPool *pools[] = {NULL, &pool};
+    for (ThreadPool *p : pools) {
+        rasterizeFan(p, 0.137f, -0.071f, 3.0f, 13, hits);
+        int wrong = 0;
+        for (int h : hits) {
+            wrong += h != 1;
+        }
+        EXPECT_EQ(0, wrong);
+    }
+}
+
+//屏幕内的细长扇形：没有像素被覆盖两次，内切圆内的像素都被覆盖
+static void testFanSharedEdges() {
+    const float centerX = 0.05f;
+    const float centerY = 0.02f;
+    const float radius = 0.7f;
+    const int slices = 64;
+    std::vector<int> hits;
+    rasterizeFan(NULL, centerX, centerY, radius, slices, hits);
+    // 角度不均匀时最宽的一片约为 2π/slices * 1.3，内切半径留出 2 个像素的余量
+    float inner = radius * cosf(1.3f * PI / slices) - 4.0f / FAN_HEIGHT;
+    int doubles = 0;
+    int gaps = 0;
+    for (int y = 0; y < FAN_HEIGHT; y++) {
+        for (int x = 0; x < FAN_WIDTH; x++) {
+            int h = hits[y * FAN_WIDTH + x];
+            float ndcX = ((float) x + 0.5f) / FAN_WIDTH * 2.0f - 1.0f;
+            float ndcY = 1.0f - ((float) y + 0.5f) / FAN_HEIGHT * 2.0f;
+            float dx = ndcX - centerX;
+            float dy = ndcY - centerY;
+            doubles += h > 1;
+            gaps += h == 0 && dx * dx + dy * dy < inner * inner;
+        }
+    }
+    EXPECT_EQ(0, doubles);
+    EXPECT_EQ(0, gaps);
+}
+
+//地面裁剪后共 3 个三角形，画面下半部分全是地面，上半部分没有
+static void testNearPlaneClipping() {
+    SoftFramebuffer framebuffer;
+    SoftRasterizer rasterizer;
+    const uint32_t green = 0xFF00FF00u;
+    softFramebufferInit(&framebuffer, GOLDEN_WIDTH, GOLDEN_HEIGHT);
+    softFramebufferClear(&framebuffer, BLACK, 1.0f);
+    softRasterizerInit(&rasterizer, &framebuffer, NULL);
+    drawGround(&rasterizer, &framebuffer);
+    softRasterizerFlush(&rasterizer);
+    EXPECT_EQ(2, rasterizer.stats.triangles);
+    EXPECT_EQ(3, rasterizer.stats.rasterized);
+    // 视线水平，地平线附近的两行不检查
+    int wrong = 0;
+    for (int y = 0; y < GOLDEN_HEIGHT; y++) {
+        for (int x = 0; x < GOLDEN_WIDTH; x++) {
+            uint32_t pixel = framebuffer.color[y * framebuffer.stride + x];
+            if (y < GOLDEN_HEIGHT / 2 - 1) {
+                wrong += pixel != 0xFF000000u;
+            } else if (y > GOLDEN_HEIGHT / 2 + 1) {
+                wrong += pixel != green;
+            }
+        }
+    }
+    EXPECT_EQ(0, wrong);
+    softRasterizerRelease(&rasterizer);
+
+    drawNearClipScene(&framebuffer);
+    expectGolden(&framebuffer, "soft-near-clip");
+    softFramebufferRelease(&framebuffer);
+}
+
+static uint32_t readBigEndian(const unsigned char *data) {
+    return ((uint32_t) data[0] << 24) | ((uint32_t) data[1] << 16) | ((uint32_t) data[2] << 8) |
+           data[3];
+}
+
+//逐位计算的 CRC-32，与实现中的查表法独立
+static uint32_t referenceCrc32(const unsigned char *data, size_t size) {
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; i++) {
+        crc ^= data[i];
+        for (int k = 0; k < 8; k++) {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+//按 PNG/zlib 规范检查文件结构、CRC、存储块和 Adler-32，并与帧缓冲区逐像素比较
+static bool validatePng(const unsigned char *file, size_t size, const SoftFramebuffer *expected) {
+    static const unsigned char signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    std::vector<unsigned char> idat, raw;
+    size_t offset = 8;
+    bool sawHeader = false, sawEnd = false;
+    if (size < 8 || memcmp(file, signature, 8) != 0) {
+        return false;
+    }
+    while (offset + 12 <= size && !sawEnd) {
+        uint32_t length = readBigEndian(file + offset);
+        const unsigned char *type = file + offset + 4;
+        const unsigned char *data = type + 4;
+        if (offset + 12 + length > size ||
+            referenceCrc32(type, length + 4) != readBigEndian(data + length)) {
+            return false;
+        }
+        if (memcmp(type, "IHDR", 4) == 0) {
+            // 宽、高、8 位、RGBA、deflate、标准过滤、不隔行
+            if (sawHeader || length != 13 || readBigEndian(data) != (uint32_t) expected->width ||
+                readBigEndian(data + 4) != (uint32_t) expected->height || data[8] != 8 ||
+                data[9] != 6 || data[10] != 0 || data[11] != 0 || data[12] != 0) {
+                return false;
+            }
+            sawHeader = true;
+        } else if (memcmp(type, "IDAT", 4) == 0) {
+            idat.insert(idat.end(), data, data + length);
+        } else if (memcmp(type, "IEND", 4) == 0) {
+            sawEnd = length == 0;
+        }
+        offset += 12 + length;
+    }
+    if (!sawHeader || !sawEnd || offset != size || idat.size() < 6) {
+        return false;
+    }
+    // zlib 头：方法 8，FCHECK 使头部是 31 的倍数，没有预设字典
+    if ((idat[0] & 0x0F) != 8 || ((idat[0] << 8) | idat[1]) % 31 != 0 || (idat[1] & 0x20)) {
+        return false;
+    }
+    size_t pos = 2;
+    bool last = false;
+    while (!last) {
+        // 写入端只产生存储块（BTYPE 00），每块从字节边界开始
+        if (pos + 5 > idat.size() || (idat[pos] & 0x06) != 0) {
+            return false;
+        }
+        last = idat[pos] & 1;
+        size_t length = idat[pos + 1] | (idat[pos + 2] << 8);
+        size_t inverse = idat[pos + 3] | (idat[pos + 4] << 8);
+        if ((length ^ 0xFFFF) != inverse || pos + 5 + length > idat.size()) {
+            return false;
+        }
+        raw.insert(raw.end(), idat.begin() + pos + 5, idat.begin() + pos + 5 + length);
+        pos += 5 + length;
+    }
+    uint32_t a = 1, b = 0;
+    for (unsigned char value : raw) {
+        a = (a + value) % 65521;
+        b = (b + a) % 65521;
+    }
+    if (pos + 4 != idat.size() || readBigEndian(&idat[pos]) != ((b << 16) | a)) {
+        return false;
+    }
+    size_t rowBytes = (size_t) expected->width * 4 + 1;
+    if (raw.size() != rowBytes * expected->height) {
+        return false;
+    }
+    for (int y = 0; y < expected->height; y++) {
+        const unsigned char *row = &raw[rowBytes * y];
+        if (row[0] != 0) {
+            return false;
+        }
+        for (int x = 0; x < expected->width; x++) {
+            uint32_t pixel = expected->color[(size_t) y * expected->stride + x];
+            for (int channel = 0; channel < 4; channel++) {
+                if (row[1 + x * 4 + channel] != ((pixel >> (channel * 8)) & 0xFF)) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+static void testPngIsValid() {
+    char path[] = "/tmp/soft-rasterizer-test-XXXXXX";
+    SoftFramebuffer framebuffer;
+    int fd = mkstemp(path);
+    EXPECT_TRUE(fd >= 0);
+    if (fd < 0) {
+        return;
+    }
+    close(fd);
+    // 超过一个存储块（65535 字节）的大小，检验分块
+    softFramebufferInit(&framebuffer, GOLDEN_WIDTH * 2 + 3, GOLDEN_HEIGHT * 2);
+    drawScene(&framebuffer, NULL);
+    framebuffer.color[0] = 0x80402010u;
+    EXPECT_TRUE(softFramebufferWritePng(&framebuffer, path));
+    FILE *file = fopen(path, "rb");
+    std::vector<unsigned char> data;
+    if (file) {
+        unsigned char buffer[4096];
+        size_t n;
+        while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+            data.insert(data.end(), buffer, buffer + n);
+        }
+        fclose(file);
+    }
+    EXPECT_TRUE(validatePng(data.data(), data.size(), &framebuffer));
+    unlink(path);
+    softFramebufferRelease(&framebuffer);
+}
+
+int main(int argc, char **argv) {
+    updateGolden = argc > 1 && strcmp(argv[1], "--update-golden") == 0;
+    RUN_TEST(testSceneGolden);
+    RUN_TEST(testThreadCountInvariance);
+    RUN_TEST(testFanCoversScreenOnce);
+    RUN_TEST(testFanSharedEdges);
+    RUN_TEST(testNearPlaneClipping);
+    RUN_TEST(testPngIsValid);
+    return TEST_RESULT();
+}
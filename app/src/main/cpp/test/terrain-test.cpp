@@ -0,0 +1,392 @@
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+#include "es-util.h"
+#include "gl-stub.h"
+#include "terrain.h"
+#include "terrain-tiles.h"
+#include "test-util.h"
+
+// 用 terrainFileWrite 生成地形文件，检查文件格式、地形缓存（命中、缺失、淘汰、只处理视野矩形的差、
+// 槽不够时返回 -1、块在加载中离开视野），以及 terrain.cpp 经 gl-stub 加载和上传的数据。
+
+#define TILE_SIZE 9
+#define MAP_TILES 8
+//I/O 线程异步拷贝，轮询之间短暂休眠，最多等待约 5 秒
+#define MAX_POLLS 25000
+
+static uint16_t testSample(int x, int y, void *user) {
+    return (uint16_t) (x * 31 + y * 17 + (x * y) % 7);
+}
+
+static bool writeTestTerrain(char *path, int tilesX, int tilesY) {
+    strcpy(path, "/tmp/terrain-test-XXXXXX");
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        return false;
+    }
+    close(fd);
+    return terrainFileWrite(path, TILE_SIZE, tilesX, tilesY, 2.0f, 0.5f, -10.0f, testSample,
+                            NULL);
+}
+
+static int tileAt(const TerrainCache *cache, int x, int y) {
+    return y * cache->tilesX + x;
+}
+
+//按 terrainCacheSetView 的顺序完成所有加载
+static void finishLoads(TerrainCache *cache, const TerrainLoad *loads, int count) {
+    for (int i = 0; i < count; i++) {
+        terrainCacheLoaded(cache, loads[i].tile);
+    }
+}
+
+static void testFileLayout() {
+    char path[64];
+    TerrainFile file;
+    EXPECT_TRUE(writeTestTerrain(path, 4, 3));
+    EXPECT_TRUE(terrainFileOpen(&file, path));
+    EXPECT_EQ(TILE_SIZE, file.header.tileSize);
+    EXPECT_EQ(4, file.header.tilesX);
+    EXPECT_EQ(3, file.header.tilesY);
+    bool samplesMatch = true;
+    bool boundsMatch = true;
+    for (int tile = 0; tile < 12; tile++) {
+        const uint16_t *samples = terrainFileTile(&file, tile);
+        int originX = (tile % 4) * (TILE_SIZE - 1);
+        int originY = (tile / 4) * (TILE_SIZE - 1);
+        uint16_t low = UINT16_MAX, high = 0;
+        for (int y = 0; y < TILE_SIZE; y++) {
+            for (int x = 0; x < TILE_SIZE; x++) {
+                uint16_t h = testSample(originX + x, originY + y, NULL);
+                samplesMatch &= samples[y * TILE_SIZE + x] == h;
+                low = h < low ? h : low;
+                high = h > high ? h : high;
+            }
+        }
+        float min[3], max[3];
+        terrainFileTileBounds(&file, tile, min, max);
+        boundsMatch &= min[0] == (tile % 4) * 16.0f && max[0] == min[0] + 16.0f &&
+                       min[1] == (tile / 4) * 16.0f && max[1] == min[1] + 16.0f &&
+                       min[2] == low * 0.5f - 10.0f && max[2] == high * 0.5f - 10.0f;
+    }
+    EXPECT_TRUE(samplesMatch);
+    EXPECT_TRUE(boundsMatch);
+    // 相邻的块共享边上的采样
+    EXPECT_EQ(terrainFileTile(&file, 0)[TILE_SIZE - 1], terrainFileTile(&file, 1)[0]);
+    EXPECT_EQ(terrainFileTile(&file, 0)[(TILE_SIZE - 1) * TILE_SIZE],
+              terrainFileTile(&file, 4)[0]);
+    terrainFileClose(&file);
+
+    // 截断的文件和不存在的文件都打不开
+    EXPECT_EQ(0, truncate(path, 200));
+    EXPECT_TRUE(!terrainFileOpen(&file, path));
+    EXPECT_TRUE(file.mapping == NULL);
+    unlink(path);
+    EXPECT_TRUE(!terrainFileOpen(&file, path));
+}
+
+static void testHitsMissesEvictions() {
+    TerrainCache cache;
+    TerrainLoad loads[9];
+    // 3x3 的视野，另外缓存 3 个离开视野的块
+    EXPECT_TRUE(terrainCacheInit(&cache, MAP_TILES, MAP_TILES, 12));
+    int count = terrainCacheSetView(&cache, 0, 0, 3, 3, loads);
+    EXPECT_EQ(9, count);
+    // 空槽按编号从小到大分配，加载完成前不能使用
+    EXPECT_EQ(0, loads[0].slot);
+    EXPECT_EQ(8, loads[8].slot);
+    EXPECT_EQ(-1, terrainCacheSlot(&cache, loads[0].tile));
+    EXPECT_EQ(9, cache.stats.loading);
+    finishLoads(&cache, loads, count);
+    EXPECT_EQ(0, terrainCacheSlot(&cache, loads[0].tile));
+    EXPECT_EQ(9, cache.stats.resident);
+    EXPECT_EQ(0, cache.stats.loading);
+
+    // 右移一列：第 0 列离开视野但留在缓存中，新的一列用剩下的空槽
+    count = terrainCacheSetView(&cache, 1, 0, 4, 3, loads);
+    EXPECT_EQ(3, count);
+    EXPECT_EQ(9, loads[0].slot);
+    finishLoads(&cache, loads, count);
+    EXPECT_EQ(0, cache.stats.evictions);
+    EXPECT_EQ(3, cache.lruCount);
+    EXPECT_TRUE(!terrainCacheInView(&cache, tileAt(&cache, 0, 0)));
+    EXPECT_TRUE(terrainCacheSlot(&cache, tileAt(&cache, 0, 0)) >= 0);
+
+    // 再右移：没有空槽，淘汰最早离开视野的第 0 列，第 1 列留下
+    int column0Slot = terrainCacheSlot(&cache, tileAt(&cache, 0, 1));
+    count = terrainCacheSetView(&cache, 2, 0, 5, 3, loads);
+    EXPECT_EQ(3, count);
+    EXPECT_EQ(3, cache.stats.evictions);
+    bool reusedColumn0 = false;
+    for (int i = 0; i < count; i++) {
+        reusedColumn0 |= loads[i].slot == column0Slot;
+    }
+    EXPECT_TRUE(reusedColumn0);
+    finishLoads(&cache, loads, count);
+    for (int y = 0; y < 3; y++) {
+        EXPECT_EQ(-1, terrainCacheSlot(&cache, tileAt(&cache, 0, y)));
+        EXPECT_TRUE(terrainCacheSlot(&cache, tileAt(&cache, 1, y)) >= 0);
+    }
+
+    // 左移回来：第 1 列命中，不需要加载
+    count = terrainCacheSetView(&cache, 1, 0, 4, 3, loads);
+    EXPECT_EQ(0, count);
+    EXPECT_EQ(3, cache.stats.hits);
+    // 再左移：第 0 列已被淘汰，这次淘汰刚离开视野的第 4 列（链表中只有它们）
+    count = terrainCacheSetView(&cache, 0, 0, 3, 3, loads);
+    EXPECT_EQ(3, count);
+    EXPECT_EQ(6, cache.stats.evictions);
+    finishLoads(&cache, loads, count);
+    for (int y = 0; y < 3; y++) {
+        EXPECT_EQ(-1, terrainCacheSlot(&cache, tileAt(&cache, 4, y)));
+        EXPECT_TRUE(terrainCacheSlot(&cache, tileAt(&cache, 3, y)) >= 0);
+    }
+    EXPECT_EQ(3, cache.stats.hits);
+    EXPECT_EQ(18, cache.stats.misses);
+    EXPECT_EQ(12, cache.stats.resident);
+    EXPECT_EQ(9, cache.stats.visible);
+    terrainCacheRelease(&cache);
+}
+
+//检查缓存的不变量：视野中的块都占着槽，槽和块一一对应，链表中正好是不在视野中的已加载块
+static bool cacheConsistent(const TerrainCache *cache, const int rect[4]) {
+    int tileCount = cache->tilesX * cache->tilesY;
+    int occupied = 0;
+    int outsideLoaded = 0;
+    for (int tile = 0; tile < tileCount; tile++) {
+        int x = tile % cache->tilesX;
+        int y = tile / cache->tilesX;
+        bool inside = x >= rect[0] && x < rect[1] && y >= rect[2] && y < rect[3];
+        int slot = cache->tileSlot[tile];
+        if (terrainCacheInView(cache, tile) != inside || (inside && slot < 0)) {
+            return false;
+        }
+        if (slot >= 0) {
+            if (cache->slotTile[slot] != tile) {
+                return false;
+            }
+            occupied++;
+            outsideLoaded += !inside && !cache->tileLoading[tile];
+        }
+    }
+    int linked = 0;
+    for (int slot = cache->lruHead; slot >= 0; slot = cache->lruNext[slot]) {
+        int tile = cache->slotTile[slot];
+        int x = tile % cache->tilesX;
+        int y = tile / cache->tilesX;
+        if (linked++ > cache->slotCount || cache->tileLoading[tile] ||
+            (x >= rect[0] && x < rect[1] && y >= rect[2] && y < rect[3])) {
+            return false;
+        }
+    }
+    return linked == cache->lruCount && linked == outsideLoaded &&
+           occupied + cache->freeCount == cache->slotCount;
+}
+
+static void testIncrementalViewWalk() {
+    TerrainCache cache;
+    TerrainLoad loads[25];
+    const int radius = 2;
+    const int size = 24;
+    EXPECT_TRUE(terrainCacheInit(&cache, size, size, 25 + 10));
+    std::vector<bool> wasCached((size_t) size * size);
+    int rect[4] = {0, 0, 0, 0};
+    int cx = 5, cy = 5;
+    unsigned seed = 12345;
+    bool consistent = true;
+    bool diffOnly = true;
+    bool loadsMatch = true;
+    for (int step = 0; step < 400; step++) {
+        // 大部分时候移动一块（包括对角），偶尔跳到别处，视野可能被地图边缘裁剪
+        seed = seed * 1103515245u + 12345u;
+        int move = (int) (seed >> 16) % 10;
+        if (move == 0) {
+            cx = (int) (seed >> 8) % (size + 4) - 2;
+            cy = (int) (seed >> 20) % (size + 4) - 2;
+        } else {
+            cx += move % 3 - 1;
+            cy += (move / 3) % 3 - 1;
+            cx = cx < -2 ? -2 : (cx > size + 1 ? size + 1 : cx);
+            cy = cy < -2 ? -2 : (cy > size + 1 ? size + 1 : cy);
+        }
+        int next[4] = {cx - radius, cx + radius + 1, cy - radius, cy + radius + 1};
+        next[0] = next[0] < 0 ? 0 : next[0];
+        next[1] = next[1] > size ? size : next[1];
+        next[2] = next[2] < 0 ? 0 : next[2];
+        next[3] = next[3] > size ? size : next[3];
+        if (next[0] >= next[1] || next[2] >= next[3]) {
+            next[0] = next[1] = next[2] = next[3] = 0;
+        }
+        // 暴力计算两个矩形的差
+        int entered = 0, left = 0, expectedLoads = 0;
+        for (int tile = 0; tile < size * size; tile++) {
+            int x = tile % size, y = tile / size;
+            bool inOld = x >= rect[0] && x < rect[1] && y >= rect[2] && y < rect[3];
+            bool inNew = x >= next[0] && x < next[1] && y >= next[2] && y < next[3];
+            wasCached[tile] = cache.tileSlot[tile] >= 0;
+            entered += inNew && !inOld;
+            left += inOld && !inNew;
+            expectedLoads += inNew && !inOld && !wasCached[tile];
+        }
+        long enteredBefore = cache.stats.entered;
+        long leftBefore = cache.stats.left;
+        int count = terrainCacheSetView(&cache, cx - radius, cy - radius, cx + radius + 1,
+                                        cy + radius + 1, loads);
+        diffOnly &= cache.stats.entered - enteredBefore == entered &&
+                    cache.stats.left - leftBefore == left;
+        loadsMatch &= count == expectedLoads;
+        for (int i = 0; i < count; i++) {
+            int x = loads[i].tile % size, y = loads[i].tile / size;
+            loadsMatch &= !wasCached[loads[i].tile] && x >= next[0] && x < next[1] &&
+                          y >= next[2] && y < next[3];
+        }
+        memcpy(rect, next, sizeof(rect));
+        finishLoads(&cache, loads, count);
+        consistent &= cacheConsistent(&cache, rect);
+    }
+    EXPECT_TRUE(consistent);
+    EXPECT_TRUE(diffOnly);
+    EXPECT_TRUE(loadsMatch);
+    EXPECT_TRUE(cache.stats.hits > 0);
+    EXPECT_TRUE(cache.stats.evictions > 0);
+    terrainCacheRelease(&cache);
+}
+
+static void testOutOfSlots() {
+    TerrainCache cache;
+    TerrainLoad loads[9];
+    // 槽数正好是视野面积，没有多余的缓存
+    EXPECT_TRUE(terrainCacheInit(&cache, MAP_TILES, MAP_TILES, 9));
+    int count = terrainCacheSetView(&cache, 0, 0, 3, 3, loads);
+    EXPECT_EQ(9, count);
+    // 旧视野的块都还在加载，占着所有槽：返回 -1，视野和统计不变
+    TerrainCacheStats before = cache.stats;
+    EXPECT_EQ(-1, terrainCacheSetView(&cache, 3, 0, 6, 3, loads));
+    EXPECT_TRUE(memcmp(&before, &cache.stats, sizeof(before)) == 0);
+    EXPECT_TRUE(terrainCacheInView(&cache, tileAt(&cache, 0, 0)));
+    EXPECT_TRUE(!terrainCacheInView(&cache, tileAt(&cache, 3, 0)));
+    int rect[4] = {0, 3, 0, 3};
+    EXPECT_TRUE(cacheConsistent(&cache, rect));
+
+    // 部分重叠时同样不够：加载中的块离开视野后不能被淘汰
+    EXPECT_EQ(-1, terrainCacheSetView(&cache, 1, 0, 4, 3, loads));
+    // 加载完成后重试成功，淘汰整个旧视野
+    finishLoads(&cache, loads, count);
+    count = terrainCacheSetView(&cache, 3, 0, 6, 3, loads);
+    EXPECT_EQ(9, count);
+    EXPECT_EQ(9, cache.stats.evictions);
+    int next[4] = {3, 6, 0, 3};
+    EXPECT_TRUE(cacheConsistent(&cache, next));
+    terrainCacheRelease(&cache);
+}
+
+static void testLeavesViewWhileLoading() {
+    TerrainCache cache;
+    TerrainLoad loads[9];
+    TerrainLoad first[9];
+    EXPECT_TRUE(terrainCacheInit(&cache, MAP_TILES, MAP_TILES, 12));
+    int firstCount = terrainCacheSetView(&cache, 0, 0, 3, 3, first);
+    EXPECT_EQ(9, firstCount);
+    // 第 0 列还在加载就离开视野：仍占着槽，不进入链表
+    int count = terrainCacheSetView(&cache, 1, 0, 4, 3, loads);
+    EXPECT_EQ(3, count);
+    EXPECT_EQ(0, cache.lruCount);
+    EXPECT_EQ(12, cache.stats.loading);
+    int tile = tileAt(&cache, 0, 1);
+    EXPECT_EQ(-1, terrainCacheSlot(&cache, tile));
+    // 加载完成时已不在视野中，进入链表，之后可以命中或被淘汰
+    terrainCacheLoaded(&cache, tile);
+    EXPECT_EQ(1, cache.lruCount);
+    EXPECT_TRUE(terrainCacheSlot(&cache, tile) >= 0);
+    int rect[4] = {1, 4, 0, 3};
+    EXPECT_TRUE(cacheConsistent(&cache, rect));
+
+    // 第 0 列还在加载的块又回到视野：算作命中，不重复加载；加载完成时在视野中，不进入链表
+    long hitsBefore = cache.stats.hits;
+    count = terrainCacheSetView(&cache, 0, 0, 3, 3, loads);
+    EXPECT_EQ(0, count);
+    EXPECT_EQ(hitsBefore + 3, cache.stats.hits);
+    EXPECT_EQ(0, cache.lruCount);
+    terrainCacheLoaded(&cache, tileAt(&cache, 0, 0));
+    EXPECT_EQ(0, cache.lruCount);
+    // 重复通知同一个块没有影响
+    terrainCacheLoaded(&cache, tileAt(&cache, 0, 0));
+    EXPECT_EQ(10, cache.stats.loading);
+    EXPECT_EQ(2, cache.stats.resident);
+    rect[0] = 0;
+    rect[1] = 3;
+    EXPECT_TRUE(cacheConsistent(&cache, rect));
+    terrainCacheRelease(&cache);
+}
+
+static bool pollUntilLoaded() {
+    for (int i = 0; i < MAX_POLLS && terrainStats()->pendingLoads > 0; i++) {
+        terrainUpdate(4);
+        usleep(200);
+    }
+    return terrainStats()->pendingLoads == 0;
+}
+
+static void testStreamingAndReinit() {
+    char path[64];
+    TerrainFile file;
+    EXPECT_TRUE(writeTestTerrain(path, MAP_TILES, MAP_TILES));
+    EXPECT_TRUE(terrainFileOpen(&file, path));
+    glStubReset();
+    EXPECT_TRUE(terrainInit(path, 1, 3));
+    GLuint heightVbo = (GLuint) glStubLast("glGenBuffers")->args[1];
+    // 相机在 (2, 2) 块，视野 3x3
+    EXPECT_TRUE(terrainSetView(2.5f * 16.0f, 2.5f * 16.0f));
+    EXPECT_EQ(9, terrainStats()->pendingLoads);
+    EXPECT_TRUE(pollUntilLoaded());
+    EXPECT_EQ(9, terrainStats()->tilesUploaded);
+
+    // 用到的 9 个槽中正好是视野中 9 个块的高度，各出现一次
+    GLsizeiptr size = 0;
+    unsigned char *heights = glStubBufferData(heightVbo, &size);
+    EXPECT_EQ((GLsizeiptr) file.tileBytes * 12, size);
+    std::vector<bool> found(MAP_TILES * MAP_TILES);
+    int matched = 0;
+    for (int slot = 0; slot < 9 && heights; slot++) {
+        for (int y = 1; y <= 3; y++) {
+            for (int x = 1; x <= 3; x++) {
+                int tile = y * MAP_TILES + x;
+                if (!found[tile] && memcmp(heights + file.tileBytes * slot,
+                                           terrainFileTile(&file, tile), file.tileBytes) == 0) {
+                    found[tile] = true;
+                    matched++;
+                }
+            }
+        }
+    }
+    EXPECT_EQ(9, matched);
+    EXPECT_EQ(9, terrainDraw(1, NULL));
+    EXPECT_EQ(9, glStubCount("glDrawElements"));
+
+    // 在同一个上下文中重新初始化：先删除旧的缓冲区和 VAO
+    EXPECT_TRUE(terrainInit(path, 1, 3));
+    EXPECT_EQ(3, glStubCount("glDeleteBuffers"));
+    EXPECT_EQ(1, glStubCount("glDeleteVertexArrays"));
+    // 上下文重建后旧的对象已随上下文释放，不再删除
+    glStubSetContext((EGLContext) 2);
+    EXPECT_TRUE(terrainInit(path, 1, 3));
+    EXPECT_EQ(3, glStubCount("glDeleteBuffers"));
+    EXPECT_EQ(1, glStubCount("glDeleteVertexArrays"));
+    terrainRelease();
+    EXPECT_EQ(6, glStubCount("glDeleteBuffers"));
+    EXPECT_EQ(2, glStubCount("glDeleteVertexArrays"));
+    terrainFileClose(&file);
+    unlink(path);
+}
+
+int main() {
+    RUN_TEST(testFileLayout);
+    RUN_TEST(testHitsMissesEvictions);
+    RUN_TEST(testIncrementalViewWalk);
+    RUN_TEST(testOutOfSlots);
+    RUN_TEST(testLeavesViewWhileLoading);
+    RUN_TEST(testStreamingAndReinit);
+    return TEST_RESULT();
+}
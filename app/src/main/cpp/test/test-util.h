@@ -0,0 +1,51 @@
+#ifndef GLES_TEST_UTIL_H
+#define GLES_TEST_UTIL_H
+
+#include <math.h>
+#include <stdio.h>
+
+// 主机单元测试使用的最小断言：失败时打印位置并计数，不中止，
+// main 中用 RUN_TEST 依次运行各测试函数，最后返回 TEST_RESULT()。
+
+static int testFailures = 0;
+
+#define EXPECT_TRUE(cond)                                                           \
+    do {                                                                            \
+        if (!(cond)) {                                                              \
+            fprintf(stderr, "%s:%d: expected %s\n", __FILE__, __LINE__, #cond);     \
+            testFailures++;                                                         \
+        }                                                                           \
+    } while (0)
+
+#define EXPECT_EQ(expected, actual)                                                 \
+    do {                                                                            \
+        long long expectedValue_ = (long long) (expected);                          \
+        long long actualValue_ = (long long) (actual);                              \
+        if (expectedValue_ != actualValue_) {                                       \
+            fprintf(stderr, "%s:%d: %s == %s, expected %lld, got %lld\n", __FILE__, \
+                    __LINE__, #expected, #actual, expectedValue_, actualValue_);    \
+            testFailures++;                                                         \
+        }                                                                           \
+    } while (0)
+
+#define EXPECT_NEAR(expected, actual, tolerance)                                    \
+    do {                                                                            \
+        double expectedValue_ = (double) (expected);                                \
+        double actualValue_ = (double) (actual);                                    \
+        if (!(fabs(expectedValue_ - actualValue_) <= (tolerance))) {                \
+            fprintf(stderr, "%s:%d: %s ~ %s, expected %g, got %g\n", __FILE__,      \
+                    __LINE__, #expected, #actual, expectedValue_, actualValue_);    \
+            testFailures++;                                                         \
+        }                                                                           \
+    } while (0)
+
+#define RUN_TEST(fn)                                                                \
+    do {                                                                            \
+        int failuresBefore_ = testFailures;                                         \
+        fn();                                                                       \
+        printf("%s %s\n", testFailures == failuresBefore_ ? "[  OK  ]" : "[ FAIL ]", #fn); \
+    } while (0)
+
+#define TEST_RESULT() (testFailures == 0 ? 0 : 1)
+
+#endif
@@ -0,0 +1,217 @@
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+#include "es-util.h"
+#include "gl-stub.h"
+#include "texture-container.h"
+#include "texture-streamer.h"
+#include "test-util.h"
+
+// 用 textureContainerWrite 生成 KTX2 文件，经 textureStreamerLoad 加载到 gl-stub，
+// 检查级别从粗到细上传、分片、PBO 环的回收，以及上传到各级别的数据与文件一致。
+
+#define VK_FORMAT_R8G8B8A8_UNORM 37
+#define VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK 147
+#define VK_FORMAT_ASTC_4x4_UNORM_BLOCK 157
+//64 像素宽的 RGBA8 一行 256 字节，每个 PBO 放 4 行，最大的级别分成多片
+#define TEST_PBO_SIZE 1024
+//I/O 线程异步拷贝，轮询之间短暂休眠，最多等待约 5 秒
+#define MAX_POLLS 25000
+
+typedef struct {
+    char path[64];
+    int levelCount;
+    std::vector<unsigned char> levels[TEXTURE_MAX_LEVELS];
+} TestTexture;
+
+static int levelCountFor(int width, int height) {
+    int size = width > height ? width : height;
+    int count = 1;
+    while (size > 1) {
+        size >>= 1;
+        count++;
+    }
+    return count;
+}
+
+//每个字节由级别和位置决定，数据错位或级别混淆都能发现
+static bool writeTestTexture(TestTexture *texture, uint32_t vkFormat, int width, int height) {
+    TextureFormat format;
+    const void *levelData[TEXTURE_MAX_LEVELS];
+    strcpy(texture->path, "/tmp/texture-streamer-test-XXXXXX");
+    int fd = mkstemp(texture->path);
+    if (fd < 0 || !textureFormatFromVk(vkFormat, &format)) {
+        return false;
+    }
+    close(fd);
+    texture->levelCount = levelCountFor(width, height);
+    for (int level = 0; level < texture->levelCount; level++) {
+        size_t size = textureLevelSize(&format, width, height, level);
+        texture->levels[level].resize(size);
+        for (size_t i = 0; i < size; i++) {
+            texture->levels[level][i] = (unsigned char) (i * 7 + level * 31 + (i >> 8));
+        }
+        levelData[level] = texture->levels[level].data();
+    }
+    return textureContainerWrite(texture->path, vkFormat, width, height, texture->levelCount,
+                                 levelData);
+}
+
+static void removeTestTexture(TestTexture *texture) {
+    unlink(texture->path);
+}
+
+static bool pollUntilDone() {
+    for (int i = 0; i < MAX_POLLS && textureStreamerPendingCount() > 0; i++) {
+        textureStreamerPoll();
+        usleep(200);
+    }
+    return textureStreamerPendingCount() == 0;
+}
+
+static bool levelMatches(GLuint name, const TestTexture *texture, int level) {
+    size_t size = 0;
+    unsigned char *data = glStubTextureData(name, level, &size);
+    return data && size == texture->levels[level].size() &&
+           memcmp(data, texture->levels[level].data(), size) == 0;
+}
+
+static void testStreamsCoarsestLevelsFirst() {
+    TestTexture rgba, etc2;
+    EXPECT_TRUE(writeTestTexture(&rgba, VK_FORMAT_R8G8B8A8_UNORM, 64, 48));
+    EXPECT_TRUE(writeTestTexture(&etc2, VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK, 32, 32));
+    glStubReset();
+    // 每个 fence 第一次查询时还没有触发，PBO 要等到下一次轮询才能回收
+    glStubSetFenceTimeouts(1);
+    EXPECT_TRUE(textureStreamerInit(TEST_PBO_SIZE));
+    GLuint placeholder = (GLuint) glStubLast("glGenTextures")->args[1];
+    TextureHandle first = textureStreamerLoad(rgba.path);
+    TextureHandle second = textureStreamerLoad(etc2.path);
+    EXPECT_EQ(0, first);
+    EXPECT_EQ(1, second);
+    EXPECT_EQ(2, textureStreamerPendingCount());
+    EXPECT_EQ(TEXTURE_PENDING, textureStreamerState(first));
+    EXPECT_EQ(placeholder, textureStreamerGet(first));
+    EXPECT_EQ(-1, textureStreamerResidentLevel(first));
+
+    // 已上传的最精细级别只会变细，第一个级别可用后不再返回占位纹理
+    int resident[2] = {-1, -1};
+    bool monotonic = true;
+    bool sawPartial = false;
+    for (int i = 0; i < MAX_POLLS && textureStreamerPendingCount() > 0; i++) {
+        textureStreamerPoll();
+        for (int t = 0; t < 2; t++) {
+            int level = textureStreamerResidentLevel(t);
+            if (resident[t] >= 0 && (level < 0 || level > resident[t])) {
+                monotonic = false;
+            }
+            if (level >= 0 && textureStreamerGet(t) == placeholder) {
+                monotonic = false;
+            }
+            sawPartial |= textureStreamerState(t) == TEXTURE_PARTIAL;
+            resident[t] = level;
+        }
+        usleep(200);
+    }
+    EXPECT_EQ(0, textureStreamerPendingCount());
+    EXPECT_TRUE(monotonic);
+    EXPECT_TRUE(sawPartial);
+    EXPECT_EQ(TEXTURE_COMPLETE, textureStreamerState(first));
+    EXPECT_EQ(TEXTURE_COMPLETE, textureStreamerState(second));
+    EXPECT_EQ(0, textureStreamerResidentLevel(first));
+    EXPECT_EQ(0, textureStreamerResidentLevel(second));
+
+    GLuint rgbaName = textureStreamerGet(first);
+    GLuint etc2Name = textureStreamerGet(second);
+    EXPECT_TRUE(rgbaName != placeholder && etc2Name != placeholder && rgbaName != etc2Name);
+    for (int level = 0; level < rgba.levelCount; level++) {
+        EXPECT_TRUE(levelMatches(rgbaName, &rgba, level));
+    }
+    for (int level = 0; level < etc2.levelCount; level++) {
+        EXPECT_TRUE(levelMatches(etc2Name, &etc2, level));
+    }
+
+    // 同一纹理的片段从最小的级别开始上传；64x48 的最大级别 12 个块行 * 256 字节，分成 3 片
+    int lastLevel[2] = {TEXTURE_MAX_LEVELS, TEXTURE_MAX_LEVELS};
+    int level0Chunks = 0;
+    bool ordered = true;
+    for (int i = 0; i < glStubCallCount(); i++) {
+        const GlCall *call = glStubCall(i);
+        int t = strcmp(call->name, "glTexSubImage2D") == 0 ? 0
+              : strcmp(call->name, "glCompressedTexSubImage2D") == 0 ? 1 : -1;
+        if (t < 0) {
+            continue;
+        }
+        ordered &= call->args[0] <= lastLevel[t];
+        lastLevel[t] = (int) call->args[0];
+        level0Chunks += t == 0 && call->args[0] == 0;
+    }
+    EXPECT_TRUE(ordered);
+    EXPECT_EQ(64 * 48 * 4 / TEST_PBO_SIZE, level0Chunks);
+    const TextureStreamStats *stats = textureStreamerStats();
+    EXPECT_EQ(rgba.levelCount + etc2.levelCount, stats->levelsCompleted);
+    EXPECT_TRUE(stats->fenceWaits > 0);
+    // 完成后 BASE_LEVEL 降到 0
+    const GlCall *base = glStubLast("glTexParameteri");
+    EXPECT_TRUE(base && base->args[1] == GL_TEXTURE_BASE_LEVEL && base->args[2] == 0);
+
+    textureStreamerRelease();
+    EXPECT_EQ(TEXTURE_PBO_COUNT, glStubCount("glDeleteBuffers"));
+    // 两个纹理和占位纹理
+    EXPECT_EQ(3, glStubCount("glDeleteTextures"));
+    removeTestTexture(&rgba);
+    removeTestTexture(&etc2);
+}
+
+static void testRejectedTextures() {
+    TestTexture astc, wide;
+    EXPECT_TRUE(writeTestTexture(&astc, VK_FORMAT_ASTC_4x4_UNORM_BLOCK, 16, 16));
+    // 一行 2048 字节，放不进一个 PBO
+    EXPECT_TRUE(writeTestTexture(&wide, VK_FORMAT_R8G8B8A8_UNORM, 512, 4));
+    glStubReset();
+    EXPECT_TRUE(textureStreamerInit(TEST_PBO_SIZE));
+    GLuint placeholder = textureStreamerGet(-1);
+    TextureHandle missing = textureStreamerLoad("/nonexistent/texture.ktx2");
+    // gl-stub 没有任何扩展，ASTC 不可用
+    TextureHandle unsupported = textureStreamerLoad(astc.path);
+    TextureHandle tooWide = textureStreamerLoad(wide.path);
+    EXPECT_TRUE(pollUntilDone());
+    EXPECT_EQ(TEXTURE_FAILED, textureStreamerState(missing));
+    EXPECT_EQ(TEXTURE_FAILED, textureStreamerState(unsupported));
+    EXPECT_EQ(TEXTURE_FAILED, textureStreamerState(tooWide));
+    EXPECT_EQ(placeholder, textureStreamerGet(missing));
+    EXPECT_EQ(placeholder, textureStreamerGet(unsupported));
+    EXPECT_EQ(placeholder, textureStreamerGet(tooWide));
+    EXPECT_EQ(0, glStubCount("glTexStorage2D"));
+    EXPECT_EQ(0, glStubCount("glMapBufferRange"));
+    textureStreamerRelease();
+    EXPECT_EQ(-1, textureStreamerLoad(astc.path));
+    removeTestTexture(&astc);
+    removeTestTexture(&wide);
+}
+
+static void testReinitDeletesOnlyLiveObjects() {
+    glStubReset();
+    EXPECT_TRUE(textureStreamerInit(TEST_PBO_SIZE));
+    EXPECT_EQ(0, glStubCount("glDeleteBuffers"));
+    // 在同一个上下文中重新初始化：删除之前的 PBO 和占位纹理
+    EXPECT_TRUE(textureStreamerInit(TEST_PBO_SIZE));
+    EXPECT_EQ(TEXTURE_PBO_COUNT, glStubCount("glDeleteBuffers"));
+    EXPECT_EQ(1, glStubCount("glDeleteTextures"));
+    // 上下文重建后旧的对象已随上下文释放，不再删除
+    glStubSetContext((EGLContext) 2);
+    EXPECT_TRUE(textureStreamerInit(TEST_PBO_SIZE));
+    EXPECT_EQ(TEXTURE_PBO_COUNT, glStubCount("glDeleteBuffers"));
+    EXPECT_EQ(1, glStubCount("glDeleteTextures"));
+    textureStreamerRelease();
+    EXPECT_EQ(TEXTURE_PBO_COUNT * 2, glStubCount("glDeleteBuffers"));
+    EXPECT_EQ(2, glStubCount("glDeleteTextures"));
+}
+
+int main() {
+    RUN_TEST(testStreamsCoarsestLevelsFirst);
+    RUN_TEST(testRejectedTextures);
+    RUN_TEST(testReinitDeletesOnlyLiveObjects);
+    return TEST_RESULT();
+}
@@ -0,0 +1,419 @@
+#include <stdlib.h>
+#include <string.h>
+#include <array>
+#include <vector>
+#include "es-util.h"
+#include "gl-stub.h"
+#include "mesh-generator.h"
+#include "vertex-format.h"
+#include "test-util.h"
+
+// 量化函数的取值与舍入、各格式组合的步长和偏移，以及交错生成的立方体/球体与浮点版本一致。
+
+static float halfToFloat(GLushort half) {
+    int exponent = (half >> 10) & 0x1f;
+    int mantissa = half & 0x3ff;
+    float value;
+    if (exponent == 0) {
+        value = ldexpf((float) mantissa, -24);
+    } else if (exponent == 31) {
+        value = mantissa ? NAN : INFINITY;
+    } else {
+        value = ldexpf((float) (mantissa | 0x400), exponent - 25);
+    }
+    return half & 0x8000 ? -value : value;
+}
+
+// 与 OCT_DECODE_GLSL 相同
+static void octDecode(const GLfloat e[2], GLfloat n[3]) {
+    n[0] = e[0];
+    n[1] = e[1];
+    n[2] = 1.0f - fabsf(e[0]) - fabsf(e[1]);
+    float t = n[2] < 0.0f ? -n[2] : 0.0f;
+    n[0] += n[0] >= 0.0f ? -t : t;
+    n[1] += n[1] >= 0.0f ? -t : t;
+    float length = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+    n[0] /= length;
+    n[1] /= length;
+    n[2] /= length;
+}
+
+static float snorm10ToFloat(GLuint bits) {
+    int value = (int) (bits & 0x3ff);
+    if (value & 0x200) {
+        value -= 0x400;
+    }
+    float result = (float) value / 511.0f;
+    return result < -1.0f ? -1.0f : result;
+}
+
+// 球面上分布的单位向量，包括坐标轴方向
+static std::vector<std::array<GLfloat, 3>> unitVectors() {
+    std::vector<std::array<GLfloat, 3>> result = {
+            {1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1}};
+    for (int i = 0; i < 16; i++) {
+        for (int j = 0; j < 32; j++) {
+            float theta = (float) PI * ((float) i + 0.5f) / 16.0f;
+            float phi = 2.0f * (float) PI * (float) j / 32.0f;
+            result.push_back({sinf(theta) * cosf(phi), cosf(theta), sinf(theta) * sinf(phi)});
+        }
+    }
+    return result;
+}
+
+static void testFloatToHalf() {
+    EXPECT_EQ(0x0000, floatToHalf(0.0f));
+    EXPECT_EQ(0x8000, floatToHalf(-0.0f));
+    EXPECT_EQ(0x3c00, floatToHalf(1.0f));
+    EXPECT_EQ(0xc000, floatToHalf(-2.0f));
+    EXPECT_EQ(0x3555, floatToHalf(1.0f / 3.0f));
+    EXPECT_EQ(0x7bff, floatToHalf(65504.0f));
+    // 超出范围为 inf，NaN 保持为 NaN
+    EXPECT_EQ(0x7c00, floatToHalf(65520.0f));
+    EXPECT_EQ(0xfc00, floatToHalf(-1e10f));
+    EXPECT_EQ(0x7c00, floatToHalf(INFINITY));
+    EXPECT_EQ(0x7e00, floatToHalf(NAN) & 0x7e00);
+    // 非规格化数：最小值 2^-24，一半时向偶数舍入
+    EXPECT_EQ(0x0001, floatToHalf(ldexpf(1.0f, -24)));
+    EXPECT_EQ(0x0000, floatToHalf(ldexpf(1.0f, -25)));
+    EXPECT_EQ(0x0002, floatToHalf(ldexpf(3.0f, -25)));
+    EXPECT_EQ(0x0400, floatToHalf(ldexpf(1.0f, -14)));
+    // 规格化数的就近舍入：1 + 2^-11 正好在 1 与 1 + 2^-10 中间，舍入到偶数
+    EXPECT_EQ(0x3c00, floatToHalf(1.0f + ldexpf(1.0f, -11)));
+    EXPECT_EQ(0x3c02, floatToHalf(1.0f + ldexpf(3.0f, -11)));
+    EXPECT_EQ(0x3c01, floatToHalf(1.0f + ldexpf(1.0f, -11) + ldexpf(1.0f, -20)));
+    // 尾数进位到指数
+    EXPECT_EQ(0x4000, floatToHalf(2.0f - ldexpf(1.0f, -12)));
+    // 规格化范围内相对误差不超过 2^-11
+    bool accurate = true;
+    for (float v = ldexpf(1.0f, -14); v < 65504.0f; v *= 1.0137f) {
+        float roundTrip = halfToFloat(floatToHalf(v));
+        accurate &= fabsf(roundTrip - v) <= v * ldexpf(1.0f, -11);
+        accurate &= halfToFloat(floatToHalf(-v)) == -roundTrip;
+    }
+    EXPECT_TRUE(accurate);
+}
+
+static void testOctEncode() {
+    float maxError = 0.0f;
+    bool inRange = true;
+    for (const auto &n : unitVectors()) {
+        GLfloat e[2], decoded[3];
+        octEncode(n.data(), e);
+        inRange &= fabsf(e[0]) <= 1.0f && fabsf(e[1]) <= 1.0f;
+        octDecode(e, decoded);
+        for (int k = 0; k < 3; k++) {
+            maxError = fmaxf(maxError, fabsf(decoded[k] - n[k]));
+        }
+    }
+    EXPECT_TRUE(inRange);
+    EXPECT_TRUE(maxError < 1e-5f);
+    GLfloat zero[3] = {0.0f, 0.0f, 0.0f}, e[2] = {1.0f, 1.0f};
+    octEncode(zero, e);
+    EXPECT_TRUE(e[0] == 0.0f && e[1] == 0.0f);
+}
+
+static void testLayouts() {
+    const int positionBytes[] = {12, 8};
+    const int normalBytes[] = {0, 12, 4, 4};
+    const int texCoordBytes[] = {0, 8, 4};
+    const GLenum normalTypes[] = {0, GL_FLOAT, GL_SHORT, GL_INT_2_10_10_10_REV};
+    const GLenum texCoordTypes[] = {0, GL_FLOAT, GL_UNSIGNED_SHORT};
+    for (int p = POSITION_FLOAT; p <= POSITION_HALF; p++) {
+        for (int n = NORMAL_NONE; n <= NORMAL_INT_2_10_10_10; n++) {
+            for (int t = TEXCOORD_NONE; t <= TEXCOORD_UNORM16; t++) {
+                VertexFormat format = {(PositionFormat) p, (NormalFormat) n, (TexCoordFormat) t};
+                VertexLayout layout;
+                vertexLayoutInit(&layout, &format, 100, 300);
+                EXPECT_EQ(positionBytes[p] + normalBytes[n] + texCoordBytes[t], layout.stride);
+                EXPECT_EQ(1 + (n != NORMAL_NONE) + (t != TEXCOORD_NONE), layout.numAttribs);
+                // 属性依次紧密排列，位置在最前，4 字节对齐
+                GLuint offset = 0;
+                for (int i = 0; i < layout.numAttribs; i++) {
+                    const VertexAttrib *attrib = &layout.attribs[i];
+                    EXPECT_EQ(offset, attrib->offset);
+                    EXPECT_EQ(0, attrib->offset % 4);
+                    if (attrib->location == VERTEX_ATTRIB_POSITION) {
+                        EXPECT_EQ(0, i);
+                        EXPECT_EQ(p == POSITION_HALF ? GL_HALF_FLOAT : GL_FLOAT, attrib->type);
+                        offset += positionBytes[p];
+                    } else if (attrib->location == VERTEX_ATTRIB_NORMAL) {
+                        EXPECT_EQ(normalTypes[n], attrib->type);
+                        EXPECT_EQ(n != NORMAL_FLOAT, attrib->normalized);
+                        offset += normalBytes[n];
+                    } else {
+                        EXPECT_EQ(VERTEX_ATTRIB_TEXCOORD, attrib->location);
+                        EXPECT_EQ(texCoordTypes[t], attrib->type);
+                        EXPECT_EQ(t == TEXCOORD_UNORM16, attrib->normalized);
+                        offset += texCoordBytes[t];
+                    }
+                }
+                EXPECT_EQ(layout.stride, (GLsizei) offset);
+            }
+        }
+    }
+    // 65536 个顶点以内使用 16 位索引
+    VertexFormat format = {POSITION_FLOAT, NORMAL_NONE, TEXCOORD_NONE};
+    VertexLayout layout;
+    vertexLayoutInit(&layout, &format, 65536, 6);
+    EXPECT_EQ(GL_UNSIGNED_SHORT, layout.indexType);
+    EXPECT_EQ(2, layout.indexSize);
+    vertexLayoutInit(&layout, &format, 65537, 6);
+    EXPECT_EQ(GL_UNSIGNED_INT, layout.indexType);
+    EXPECT_EQ(4, layout.indexSize);
+}
+
+// 按 layout 依次设置各属性
+static void testApplyVertexLayout() {
+    VertexFormat format = {POSITION_HALF, NORMAL_OCT16, TEXCOORD_UNORM16};
+    VertexLayout layout;
+    vertexLayoutInit(&layout, &format, 10, 30);
+    glStubReset();
+    applyVertexLayout(&layout, NULL);
+    EXPECT_EQ(3, glStubCount("glVertexAttribPointer"));
+    EXPECT_EQ(3, glStubCount("glEnableVertexAttribArray"));
+    const GLenum types[] = {GL_HALF_FLOAT, GL_SHORT, GL_UNSIGNED_SHORT};
+    const int sizes[] = {4, 2, 2};
+    for (int i = 0; i < 3; i++) {
+        const GlCall *call = glStubCall(i * 2);
+        EXPECT_TRUE(strcmp(call->name, "glVertexAttribPointer") == 0);
+        EXPECT_EQ(i, call->args[0]);
+        EXPECT_EQ(sizes[i], call->args[1]);
+        EXPECT_EQ(types[i], call->args[2]);
+        EXPECT_EQ(16, call->args[3]);
+    }
+}
+
+// 逐个格式打包后按 layout 读回，与原值比较
+static void testPackRoundTrip() {
+    std::vector<std::array<GLfloat, 3>> normals = unitVectors();
+    int count = (int) normals.size();
+    std::vector<GLfloat> positions(count * 3), texCoords(count * 2);
+    std::vector<GLuint> remap(count);
+    for (int i = 0; i < count; i++) {
+        positions[i * 3] = (float) i * 0.37f - 50.0f;
+        positions[i * 3 + 1] = 1.0f / (float) (i + 1);
+        positions[i * 3 + 2] = -(float) i;
+        // 包括 [0, 1] 以外的值，UNORM16 截断
+        texCoords[i * 2] = (float) i / (float) (count - 1) * 1.2f - 0.1f;
+        texCoords[i * 2 + 1] = 1.0f - (float) i / (float) (count - 1);
+        remap[i] = (GLuint) (count - 1 - i);
+    }
+    for (int p = POSITION_FLOAT; p <= POSITION_HALF; p++) {
+        for (int n = NORMAL_FLOAT; n <= NORMAL_INT_2_10_10_10; n++) {
+            for (int t = TEXCOORD_FLOAT; t <= TEXCOORD_UNORM16; t++) {
+                VertexFormat format = {(PositionFormat) p, (NormalFormat) n, (TexCoordFormat) t};
+                VertexLayout layout;
+                vertexLayoutInit(&layout, &format, count, 0);
+                std::vector<GLubyte> packed((size_t) count * layout.stride, 0xcd);
+                // 分两次打包，第二次从 first 开始，都按 remap 写到倒序的位置
+                int half = count / 2;
+                packVertices(&layout, &format, 0, half, positions.data(), normals[0].data(),
+                             texCoords.data(), remap.data(), packed.data());
+                packVertices(&layout, &format, half, count - half, positions.data() + half * 3,
+                             normals[half].data(), texCoords.data() + half * 2, remap.data(),
+                             packed.data());
+                float positionError = 0.0f, normalError = 0.0f, texCoordError = 0.0f;
+                for (int i = 0; i < count; i++) {
+                    const GLubyte *v = packed.data() + (size_t) remap[i] * layout.stride;
+                    const VertexAttrib *attribs = layout.attribs;
+                    const GLubyte *pos = v + attribs[0].offset;
+                    const GLubyte *nor = v + attribs[1].offset;
+                    const GLubyte *tex = v + attribs[2].offset;
+                    for (int k = 0; k < 3; k++) {
+                        float value;
+                        if (p == POSITION_HALF) {
+                            GLushort h;
+                            memcpy(&h, pos + k * 2, 2);
+                            value = halfToFloat(h);
+                        } else {
+                            memcpy(&value, pos + k * 4, 4);
+                        }
+                        float expected = positions[i * 3 + k];
+                        positionError = fmaxf(positionError, fabsf(value - expected) /
+                                                             fmaxf(fabsf(expected), 1e-3f));
+                    }
+                    if (p == POSITION_HALF) {
+                        GLushort w;
+                        memcpy(&w, pos + 6, 2);
+                        EXPECT_EQ(0x3c00, w);
+                    }
+                    GLfloat decoded[3];
+                    if (n == NORMAL_FLOAT) {
+                        memcpy(decoded, nor, sizeof(decoded));
+                    } else if (n == NORMAL_OCT16) {
+                        GLshort s[2];
+                        memcpy(s, nor, sizeof(s));
+                        GLfloat e[2] = {fmaxf(s[0] / 32767.0f, -1.0f),
+                                        fmaxf(s[1] / 32767.0f, -1.0f)};
+                        octDecode(e, decoded);
+                    } else {
+                        GLuint bits;
+                        memcpy(&bits, nor, sizeof(bits));
+                        EXPECT_EQ(0, bits >> 30);
+                        for (int k = 0; k < 3; k++) {
+                            decoded[k] = snorm10ToFloat(bits >> (k * 10));
+                        }
+                    }
+                    for (int k = 0; k < 3; k++) {
+                        normalError = fmaxf(normalError, fabsf(decoded[k] - normals[i][k]));
+                    }
+                    for (int k = 0; k < 2; k++) {
+                        float value, expected = texCoords[i * 2 + k];
+                        if (t == TEXCOORD_UNORM16) {
+                            GLushort u;
+                            memcpy(&u, tex + k * 2, 2);
+                            value = u / 65535.0f;
+                            expected = fminf(fmaxf(expected, 0.0f), 1.0f);
+                        } else {
+                            memcpy(&value, tex + k * 4, 4);
+                        }
+                        texCoordError = fmaxf(texCoordError, fabsf(value - expected));
+                    }
+                }
+                EXPECT_TRUE(positionError <= (p == POSITION_HALF ? ldexpf(1.0f, -11) : 0.0f));
+                EXPECT_TRUE(normalError <= (n == NORMAL_FLOAT ? 0.0f
+                                          : n == NORMAL_OCT16 ? 1e-4f : 1.0f / 511.0f));
+                EXPECT_TRUE(texCoordError <= (t == TEXCOORD_FLOAT ? 0.0f : 0.5f / 65535.0f));
+            }
+        }
+    }
+    // 索引：16 位时截断为 GLushort，从 first 开始写
+    const GLuint indices[] = {0, 1, 65535, 7};
+    VertexFormat format = {POSITION_FLOAT, NORMAL_NONE, TEXCOORD_NONE};
+    VertexLayout layout;
+    GLushort shorts[6] = {9, 9, 9, 9, 9, 9};
+    GLuint ints[6] = {9, 9, 9, 9, 9, 9};
+    vertexLayoutInit(&layout, &format, 65536, 6);
+    packIndices(&layout, 2, 4, indices, shorts);
+    EXPECT_TRUE(shorts[1] == 9 && shorts[2] == 0 && shorts[3] == 1 && shorts[4] == 65535 &&
+                shorts[5] == 7);
+    vertexLayoutInit(&layout, &format, 100000, 6);
+    packIndices(&layout, 2, 4, indices, ints);
+    EXPECT_TRUE(ints[1] == 9 && ints[2] == 0 && ints[4] == 65535 && ints[5] == 7);
+}
+
+// 按顶点逐位比较交错格式（POSITION_FLOAT/NORMAL_FLOAT/TEXCOORD_FLOAT）与分开的数组
+static bool sameAsStreams(const void *vertices, const void *packedIndices,
+                          const VertexLayout *layout, const GLfloat *positions,
+                          const GLfloat *normals, const GLfloat *texCoords, const GLuint *indices) {
+    bool same = true;
+    for (int i = 0; i < layout->numVertices; i++) {
+        const GLfloat *v = (const GLfloat *) ((const GLubyte *) vertices + i * layout->stride);
+        same &= memcmp(v, &positions[i * 3], 12) == 0 && memcmp(v + 3, &normals[i * 3], 12) == 0 &&
+                memcmp(v + 6, &texCoords[i * 2], 8) == 0;
+    }
+    for (int i = 0; i < layout->numIndices; i++) {
+        same &= ((const GLushort *) packedIndices)[i] == indices[i];
+    }
+    return same;
+}
+
+// 浮点格式的交错球体与 createSphereInto 的结果逐位相同（优化与否都一样）；
+// 纹理坐标在 [0, 1] 内，UNORM16 不丢失 V
+static void testSphereInterleaved() {
+    const int numSlices = 24;
+    int numVertices = sphereVertexCount(numSlices);
+    int numIndices = sphereIndexCount(numSlices);
+    std::vector<GLfloat> positions(numVertices * 3), normals(numVertices * 3);
+    std::vector<GLfloat> texCoords(numVertices * 2);
+    std::vector<GLuint> indices(numIndices);
+    EXPECT_EQ(numIndices, createSphereInto(numSlices, 2.0f, positions.data(), normals.data(),
+                                           texCoords.data(), indices.data(), NULL, false));
+    // 每行 V 相同，从北极的 1 递减到南极的 0
+    for (int i = 0; i < numVertices; i++) {
+        int row = i / (numSlices + 1);
+        EXPECT_NEAR(1.0 - (double) row / (numSlices / 2), texCoords[i * 2 + 1], 1e-6);
+    }
+
+    VertexFormat floats = {POSITION_FLOAT, NORMAL_FLOAT, TEXCOORD_FLOAT};
+    VertexLayout layout;
+    void *vertices = NULL, *packedIndices = NULL;
+    EXPECT_EQ(numIndices, createSphereInterleaved(numSlices, 2.0f, &floats, &vertices,
+                                                  &packedIndices, &layout, false));
+    EXPECT_EQ(32, layout.stride);
+    EXPECT_EQ(GL_UNSIGNED_SHORT, layout.indexType);
+    EXPECT_TRUE(sameAsStreams(vertices, packedIndices, &layout, positions.data(), normals.data(),
+                              texCoords.data(), indices.data()));
+    free(vertices);
+    free(packedIndices);
+
+    VertexFormat compact = {POSITION_HALF, NORMAL_OCT16, TEXCOORD_UNORM16};
+    EXPECT_EQ(numIndices, createSphereInterleaved(numSlices, 2.0f, &compact, &vertices, NULL,
+                                                  &layout, false));
+    EXPECT_EQ(16, layout.stride);
+    float texCoordError = 0.0f;
+    for (int i = 0; i < numVertices; i++) {
+        const GLushort *t = (const GLushort *) ((const GLubyte *) vertices + i * layout.stride +
+                                                layout.attribs[2].offset);
+        texCoordError = fmaxf(texCoordError, fabsf(t[0] / 65535.0f - texCoords[i * 2]));
+        texCoordError = fmaxf(texCoordError, fabsf(t[1] / 65535.0f - texCoords[i * 2 + 1]));
+    }
+    EXPECT_TRUE(texCoordError <= 0.5f / 65535.0f);
+    free(vertices);
+
+    // 默认开启优化，顶点直接写到优化后的位置，stats 与 createSphereInto 报告的相同
+    MeshOptimizeStats stats, expectedStats;
+    EXPECT_EQ(numIndices, createSphereInto(numSlices, 2.0f, positions.data(), normals.data(),
+                                           texCoords.data(), indices.data(), NULL, true,
+                                           &expectedStats));
+    EXPECT_EQ(numIndices, createSphereInterleaved(numSlices, 2.0f, &floats, &vertices,
+                                                  &packedIndices, &layout, true, &stats));
+    EXPECT_TRUE(sameAsStreams(vertices, packedIndices, &layout, positions.data(), normals.data(),
+                              texCoords.data(), indices.data()));
+    EXPECT_TRUE(stats.after.acmr < stats.before.acmr);
+    EXPECT_TRUE(memcmp(&stats, &expectedStats, sizeof(MeshOptimizeStats)) == 0);
+    free(vertices);
+    free(packedIndices);
+
+    vertices = packedIndices = (void *) 1;
+    EXPECT_EQ(0, createSphereInterleaved(1, 1.0f, &floats, &vertices, &packedIndices, &layout));
+    EXPECT_TRUE(vertices == NULL && packedIndices == NULL);
+}
+
+static void testCubeInterleaved() {
+    GLfloat *positions, *normals, *texCoords;
+    GLuint *indices;
+    EXPECT_EQ(CUBE_INDEX_COUNT, createCube(3.0f, &positions, &normals, &texCoords, &indices));
+    VertexFormat format = {POSITION_HALF, NORMAL_INT_2_10_10_10, TEXCOORD_FLOAT};
+    VertexLayout layout;
+    void *vertices, *packedIndices;
+    EXPECT_EQ(CUBE_INDEX_COUNT, createCubeInterleaved(3.0f, &format, &vertices, &packedIndices,
+                                                      &layout));
+    EXPECT_EQ(CUBE_VERTEX_COUNT, layout.numVertices);
+    EXPECT_EQ(20, layout.stride);
+    bool same = true;
+    for (int i = 0; i < CUBE_VERTEX_COUNT; i++) {
+        const GLubyte *v = (const GLubyte *) vertices + i * layout.stride;
+        GLushort half[3];
+        GLuint bits;
+        memcpy(half, v, sizeof(half));
+        memcpy(&bits, v + 8, sizeof(bits));
+        for (int k = 0; k < 3; k++) {
+            same &= halfToFloat(half[k]) == positions[i * 3 + k];
+            same &= snorm10ToFloat(bits >> (k * 10)) == normals[i * 3 + k];
+        }
+        same &= memcmp(v + 12, &texCoords[i * 2], 8) == 0;
+    }
+    for (int i = 0; i < CUBE_INDEX_COUNT; i++) {
+        same &= ((const GLushort *) packedIndices)[i] == indices[i];
+    }
+    EXPECT_TRUE(same);
+    free(vertices);
+    free(packedIndices);
+    free(positions);
+    free(normals);
+    free(texCoords);
+    free(indices);
+}
+
+int main() {
+    RUN_TEST(testFloatToHalf);
+    RUN_TEST(testOctEncode);
+    RUN_TEST(testLayouts);
+    RUN_TEST(testApplyVertexLayout);
+    RUN_TEST(testPackRoundTrip);
+    RUN_TEST(testSphereInterleaved);
+    RUN_TEST(testCubeInterleaved);
+    return TEST_RESULT();
+}
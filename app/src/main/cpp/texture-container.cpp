@@ -0,0 +1,268 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "include/texture-container.h"
+
+// ASTC 格式在 GLES2/gl2ext.h 中（GL_KHR_texture_compression_astc_ldr），主机构建只包含 gl3.h
+#ifndef GL_COMPRESSED_RGBA_ASTC_4x4_KHR
+#define GL_COMPRESSED_RGBA_ASTC_4x4_KHR 0x93B0
+#endif
+#ifndef GL_COMPRESSED_SRGB8_ALPHA8_ASTC_4x4_KHR
+#define GL_COMPRESSED_SRGB8_ALPHA8_ASTC_4x4_KHR 0x93D0
+#endif
+
+//文件头：12 字节标识、9 个 uint32、4 个 uint32 + 2 个 uint64 的索引，之后是每级 3 个 uint64
+#define KTX2_HEADER_SIZE 80
+#define KTX2_LEVEL_ENTRY_SIZE 24
+
+static const unsigned char ktx2Identifier[12] = {
+        0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'
+};
+
+//VkFormat 编号，VK_FORMAT_ASTC_4x4_UNORM_BLOCK 之后依次为 14 种块大小的 UNORM/SRGB
+#define VK_FORMAT_R8G8B8A8_UNORM 37
+#define VK_FORMAT_R8G8B8A8_SRGB 43
+#define VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK 147
+#define VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK 148
+#define VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK 151
+#define VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK 152
+#define VK_FORMAT_ASTC_4x4_UNORM_BLOCK 157
+#define ASTC_BLOCK_SIZES 14
+
+static const uint8_t astcBlockSizes[ASTC_BLOCK_SIZES][2] = {
+        {4, 4}, {5, 4}, {5, 5}, {6, 5}, {6, 6}, {8, 5}, {8, 6},
+        {8, 8}, {10, 5}, {10, 6}, {10, 8}, {10, 10}, {12, 10}, {12, 12},
+};
+
+static uint32_t readU32(const unsigned char *p) {
+    return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) |
+           ((uint32_t) p[3] << 24);
+}
+
+static uint64_t readU64(const unsigned char *p) {
+    return (uint64_t) readU32(p) | ((uint64_t) readU32(p + 4) << 32);
+}
+
+static void writeU32(unsigned char *p, uint32_t value) {
+    p[0] = (unsigned char) value;
+    p[1] = (unsigned char) (value >> 8);
+    p[2] = (unsigned char) (value >> 16);
+    p[3] = (unsigned char) (value >> 24);
+}
+
+static void writeU64(unsigned char *p, uint64_t value) {
+    writeU32(p, (uint32_t) value);
+    writeU32(p + 4, (uint32_t) (value >> 32));
+}
+
+bool textureFormatFromVk(uint32_t vkFormat, TextureFormat *format) {
+    memset(format, 0, sizeof(TextureFormat));
+    format->vkFormat = vkFormat;
+    format->blockWidth = 4;
+    format->blockHeight = 4;
+    format->compressed = true;
+    switch (vkFormat) {
+        case VK_FORMAT_R8G8B8A8_UNORM:
+        case VK_FORMAT_R8G8B8A8_SRGB:
+            format->internalFormat = vkFormat == VK_FORMAT_R8G8B8A8_UNORM ? GL_RGBA8 : GL_SRGB8_ALPHA8;
+            format->format = GL_RGBA;
+            format->type = GL_UNSIGNED_BYTE;
+            format->blockWidth = 1;
+            format->blockHeight = 1;
+            format->blockBytes = 4;
+            format->compressed = false;
+            return true;
+        case VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK:
+            format->internalFormat = GL_COMPRESSED_RGB8_ETC2;
+            format->blockBytes = 8;
+            return true;
+        case VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK:
+            format->internalFormat = GL_COMPRESSED_SRGB8_ETC2;
+            format->blockBytes = 8;
+            return true;
+        case VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK:
+            format->internalFormat = GL_COMPRESSED_RGBA8_ETC2_EAC;
+            format->blockBytes = 16;
+            return true;
+        case VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK:
+            format->internalFormat = GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC;
+            format->blockBytes = 16;
+            return true;
+        default:
+            break;
+    }
+    if (vkFormat >= VK_FORMAT_ASTC_4x4_UNORM_BLOCK &&
+        vkFormat < VK_FORMAT_ASTC_4x4_UNORM_BLOCK + ASTC_BLOCK_SIZES * 2) {
+        int index = (int) (vkFormat - VK_FORMAT_ASTC_4x4_UNORM_BLOCK);
+        bool srgb = index % 2 == 1;
+        index /= 2;
+        format->internalFormat = (srgb ? GL_COMPRESSED_SRGB8_ALPHA8_ASTC_4x4_KHR
+                                       : GL_COMPRESSED_RGBA_ASTC_4x4_KHR) + index;
+        format->blockWidth = astcBlockSizes[index][0];
+        format->blockHeight = astcBlockSizes[index][1];
+        format->blockBytes = 16;
+        format->astc = true;
+        return true;
+    }
+    return false;
+}
+
+size_t textureLevelSize(const TextureFormat *format, int width, int height, int level) {
+    int w = width >> level > 0 ? width >> level : 1;
+    int h = height >> level > 0 ? height >> level : 1;
+    size_t blocksX = (size_t) (w + format->blockWidth - 1) / format->blockWidth;
+    size_t blocksY = (size_t) (h + format->blockHeight - 1) / format->blockHeight;
+    return blocksX * blocksY * format->blockBytes;
+}
+
+bool textureContainerOpen(TextureContainer *container, const char *path) {
+    struct stat info;
+    const unsigned char *base;
+    uint32_t levelCount;
+    int fd, level;
+    memset(container, 0, sizeof(TextureContainer));
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        ALOGE("Could not open texture %s\n", path);
+        return false;
+    }
+    if (fstat(fd, &info) != 0 || info.st_size < KTX2_HEADER_SIZE) {
+        ALOGE("Texture %s is too small\n", path);
+        close(fd);
+        return false;
+    }
+    container->mappingSize = (size_t) info.st_size;
+    container->mapping = mmap(NULL, container->mappingSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    // 映射建立后文件描述符就不再需要
+    close(fd);
+    if (container->mapping == MAP_FAILED) {
+        container->mapping = NULL;
+        ALOGE("Could not map texture %s\n", path);
+        return false;
+    }
+    base = (const unsigned char *) container->mapping;
+    if (memcmp(base, ktx2Identifier, sizeof(ktx2Identifier)) != 0) {
+        ALOGE("%s is not a KTX2 file\n", path);
+        goto fail;
+    }
+    if (!textureFormatFromVk(readU32(base + 12), &container->format)) {
+        ALOGE("%s: unsupported vkFormat %u\n", path, readU32(base + 12));
+        goto fail;
+    }
+    container->width = (int) readU32(base + 20);
+    container->height = (int) readU32(base + 24);
+    levelCount = readU32(base + 40);
+    // pixelDepth、layerCount 为 0，faceCount 为 1，levelCount 为 0 表示只有一级
+    if (readU32(base + 28) != 0 || readU32(base + 32) > 1 || readU32(base + 36) != 1 ||
+        readU32(base + 44) != 0 || container->width <= 0 || container->height <= 0) {
+        ALOGE("%s: only plain 2D textures without supercompression are supported\n", path);
+        goto fail;
+    }
+    container->levelCount = levelCount > 0 ? (int) levelCount : 1;
+    if (container->levelCount > TEXTURE_MAX_LEVELS ||
+        KTX2_HEADER_SIZE + (size_t) container->levelCount * KTX2_LEVEL_ENTRY_SIZE >
+        container->mappingSize) {
+        ALOGE("%s: bad level count %d\n", path, container->levelCount);
+        goto fail;
+    }
+    for (level = 0; level < container->levelCount; level++) {
+        const unsigned char *entry = base + KTX2_HEADER_SIZE + level * KTX2_LEVEL_ENTRY_SIZE;
+        uint64_t offset = readU64(entry);
+        uint64_t length = readU64(entry + 8);
+        TextureLevel *dst = &container->levels[level];
+        const TextureFormat *format = &container->format;
+        dst->width = container->width >> level > 0 ? container->width >> level : 1;
+        dst->height = container->height >> level > 0 ? container->height >> level : 1;
+        dst->rowBytes = (size_t) (dst->width + format->blockWidth - 1) / format->blockWidth *
+                        format->blockBytes;
+        dst->blockRows = (dst->height + format->blockHeight - 1) / format->blockHeight;
+        if (length != textureLevelSize(format, container->width, container->height, level) ||
+            offset > container->mappingSize || length > container->mappingSize - offset) {
+            ALOGE("%s: level %d is truncated or has the wrong size\n", path, level);
+            goto fail;
+        }
+        dst->data = base + offset;
+        dst->size = (size_t) length;
+    }
+    return true;
+fail:
+    textureContainerClose(container);
+    return false;
+}
+
+void textureContainerClose(TextureContainer *container) {
+    if (container->mapping) {
+        munmap(container->mapping, container->mappingSize);
+    }
+    memset(container, 0, sizeof(TextureContainer));
+}
+
+void textureContainerPrefetch(const TextureContainer *container, int level, size_t offset,
+                              size_t size) {
+    const TextureLevel *src = &container->levels[level];
+    uintptr_t pageSize = (uintptr_t) sysconf(_SC_PAGESIZE);
+    uintptr_t begin, end;
+    if (offset >= src->size) {
+        return;
+    }
+    if (size > src->size - offset) {
+        size = src->size - offset;
+    }
+    // madvise 要求起始地址按页对齐
+    begin = (uintptr_t) (src->data + offset) & ~(pageSize - 1);
+    end = (uintptr_t) (src->data + offset + size);
+    madvise((void *) begin, end - begin, MADV_WILLNEED);
+}
+
+bool textureContainerWrite(const char *path, uint32_t vkFormat, int width, int height,
+                           int levelCount, const void *const *levelData) {
+    TextureFormat format;
+    unsigned char header[KTX2_HEADER_SIZE + TEXTURE_MAX_LEVELS * KTX2_LEVEL_ENTRY_SIZE];
+    size_t headerSize = KTX2_HEADER_SIZE + (size_t) levelCount * KTX2_LEVEL_ENTRY_SIZE;
+    size_t offsets[TEXTURE_MAX_LEVELS];
+    size_t offset;
+    bool ok = true;
+    int level;
+    FILE *file;
+    if (!textureFormatFromVk(vkFormat, &format) || levelCount <= 0 ||
+        levelCount > TEXTURE_MAX_LEVELS) {
+        return false;
+    }
+    // 与 KTX2 的要求相同，最小的级别放在最前面，每级起点按 16 字节对齐
+    offset = (headerSize + 15) & ~(size_t) 15;
+    for (level = levelCount - 1; level >= 0; level--) {
+        offsets[level] = offset;
+        offset += (textureLevelSize(&format, width, height, level) + 15) & ~(size_t) 15;
+    }
+    memset(header, 0, sizeof(header));
+    memcpy(header, ktx2Identifier, sizeof(ktx2Identifier));
+    writeU32(header + 12, vkFormat);
+    writeU32(header + 16, 1);          // typeSize，压缩格式和 8 位分量都为 1
+    writeU32(header + 20, (uint32_t) width);
+    writeU32(header + 24, (uint32_t) height);
+    writeU32(header + 36, 1);
+    writeU32(header + 40, (uint32_t) levelCount);
+    for (level = 0; level < levelCount; level++) {
+        unsigned char *entry = header + KTX2_HEADER_SIZE + level * KTX2_LEVEL_ENTRY_SIZE;
+        size_t size = textureLevelSize(&format, width, height, level);
+        writeU64(entry, offsets[level]);
+        writeU64(entry + 8, size);
+        writeU64(entry + 16, size);
+    }
+    file = fopen(path, "wb");
+    if (!file) {
+        ALOGE("Could not open %s for writing\n", path);
+        return false;
+    }
+    ok = fwrite(header, 1, headerSize, file) == headerSize;
+    for (level = levelCount - 1; ok && level >= 0; level--) {
+        size_t size = textureLevelSize(&format, width, height, level);
+        ok = fseek(file, (long) offsets[level], SEEK_SET) == 0 &&
+             fwrite(levelData[level], 1, size, file) == size;
+    }
+    if (fclose(file) != 0) {
+        ok = false;
+    }
+    return ok;
+}
@@ -0,0 +1,501 @@
+#include <EGL/egl.h>
+#include <GLES3/gl3.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include "include/texture-streamer.h"
+
+typedef enum {
+    STREAM_OPENING,      // 等待 I/O 线程映射文件
+    STREAM_OPENED,       // 已解析，等待 GL 线程分配存储
+    STREAM_OPEN_FAILED,  // I/O 线程打开失败，等待 GL 线程处理
+    STREAM_UPLOADING,
+    STREAM_COMPLETE,
+    STREAM_FAILED,
+} StreamStage;
+
+typedef struct {
+    char *path;
+    TextureContainer container;
+    GLuint texture;
+    int levelCount;      // 分配存储后有效，上传完成后容器被关闭
+    int nextLevel;       // 下一个片段所在的级别，小于 0 表示已全部分配
+    int nextRow;         // 下一个片段在该级别中的起始块行
+    int residentLevel;   // 已上传的最精细级别
+    StreamStage stage;
+} StreamTexture;
+
+typedef enum {
+    SLOT_FREE,
+    SLOT_COPYING,        // 已映射，I/O 线程正在拷贝
+    SLOT_FILLED,         // 拷贝完成，等待 GL 线程上传
+    SLOT_IN_FLIGHT,      // 已上传，等待 fence
+} SlotStage;
+
+typedef struct {
+    GLuint buffer;
+    void *mapped;
+    GLsync fence;
+    int texture;
+    int level;
+    int rowBegin;
+    int rowCount;
+    size_t offset;       // 片段在级别数据中的偏移
+    size_t size;
+    SlotStage stage;
+} PboSlot;
+
+typedef struct {
+    bool open;           // true 为打开 textures[index]，false 为拷贝 slots[index]
+    int index;
+} IoJob;
+
+static bool initialized;
+// 创建 GL 对象时的上下文，重新初始化时据此判断旧的对象是否还需要删除
+static EGLContext context;
+static GLuint placeholder;
+static GLsizeiptr slotSize;
+static StreamTexture textures[MAX_STREAM_TEXTURES];
+static int textureCount;
+static int pendingCount;
+// PBO 按环的顺序分配和上传，片段的上传顺序与分配顺序相同，级别总是在更粗的级别之后完成
+static PboSlot slots[TEXTURE_PBO_COUNT];
+static int nextAssign;
+static int nextUpload;
+static TextureStreamStats stats;
+
+// I/O 线程；textures 的 stage/container 与 slots 的 stage 都在 mutex 保护下修改
+static std::thread worker;
+static std::mutex mutex;
+static std::condition_variable wake;
+static std::deque<IoJob> jobs;
+static bool stopping;
+
+static char *copyString(const char *src) {
+    size_t len = strlen(src) + 1;
+    char *dst = (char *) malloc(len);
+    if (dst) {
+        memcpy(dst, src, len);
+    }
+    return dst;
+}
+
+static void workerLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        wake.wait(lock, [] { return stopping || !jobs.empty(); });
+        if (stopping) {
+            break;
+        }
+        IoJob job = jobs.front();
+        jobs.pop_front();
+        if (job.open) {
+            StreamTexture *texture = &textures[job.index];
+            const char *path = texture->path;
+            TextureContainer container;
+            lock.unlock();
+            bool opened = textureContainerOpen(&container, path);
+            lock.lock();
+            texture->container = container;
+            texture->stage = opened ? STREAM_OPENED : STREAM_OPEN_FAILED;
+            continue;
+        }
+        // 打开之后容器不再改变，拷贝时不需要持有锁
+        PboSlot *slot = &slots[job.index];
+        const TextureContainer *container = &textures[slot->texture].container;
+        const unsigned char *src = container->levels[slot->level].data + slot->offset;
+        void *dst = slot->mapped;
+        size_t size = slot->size;
+        int level = slot->level;
+        size_t offset = slot->offset;
+        lock.unlock();
+        memcpy(dst, src, size);
+        // 下一个片段通常紧跟在后面，提前让内核读入
+        textureContainerPrefetch(container, level, offset + size, size);
+        lock.lock();
+        slot->stage = SLOT_FILLED;
+    }
+}
+
+static void stopWorker() {
+    if (worker.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_one();
+        worker.join();
+    }
+    jobs.clear();
+    stopping = false;
+}
+
+// deleteObjects 为 false 时只释放内存，用于上下文已经丢失的情况
+static void resetState(bool deleteObjects) {
+    int i;
+    for (i = 0; i < TEXTURE_PBO_COUNT; i++) {
+        PboSlot *slot = &slots[i];
+        if (deleteObjects) {
+            if (slot->mapped) {
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot->buffer);
+                glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            }
+            if (slot->fence) {
+                glDeleteSync(slot->fence);
+            }
+            glDeleteBuffers(1, &slot->buffer);
+        }
+    }
+    for (i = 0; i < textureCount; i++) {
+        StreamTexture *texture = &textures[i];
+        if (deleteObjects && texture->texture) {
+            glDeleteTextures(1, &texture->texture);
+        }
+        textureContainerClose(&texture->container);
+        free(texture->path);
+    }
+    if (deleteObjects) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        glDeleteTextures(1, &placeholder);
+    }
+    memset(slots, 0, sizeof(slots));
+    memset(textures, 0, sizeof(textures));
+    memset(&stats, 0, sizeof(stats));
+    textureCount = 0;
+    pendingCount = 0;
+    nextAssign = 0;
+    nextUpload = 0;
+    placeholder = 0;
+    initialized = false;
+}
+
+bool textureStreamerInit(GLsizeiptr pboSize) {
+    static const GLubyte white[4] = {255, 255, 255, 255};
+    int i;
+    // 仍在同一个上下文中时删除旧的对象；上下文重建后旧的对象已随上下文释放，只清理线程和内存
+    stopWorker();
+    resetState(initialized && eglGetCurrentContext() == context);
+    context = eglGetCurrentContext();
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glGenTextures(1, &placeholder);
+    glBindTexture(GL_TEXTURE_2D, placeholder);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, white);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    for (i = 0; i < TEXTURE_PBO_COUNT; i++) {
+        glGenBuffers(1, &slots[i].buffer);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slots[i].buffer);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, pboSize, NULL, GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    if (checkGlError("textureStreamerInit")) {
+        resetState(true);
+        return false;
+    }
+    slotSize = pboSize;
+    worker = std::thread(workerLoop);
+    initialized = true;
+    return true;
+}
+
+TextureHandle textureStreamerLoad(const char *path) {
+    if (!initialized) {
+        return -1;
+    }
+    if (textureCount >= MAX_STREAM_TEXTURES) {
+        ALOGE("Too many textures");
+        return -1;
+    }
+    char *copy = copyString(path);
+    if (!copy) {
+        return -1;
+    }
+    TextureHandle handle = textureCount;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        StreamTexture *texture = &textures[handle];
+        memset(texture, 0, sizeof(StreamTexture));
+        texture->path = copy;
+        texture->stage = STREAM_OPENING;
+        textureCount++;
+        jobs.push_back(IoJob{true, handle});
+    }
+    pendingCount++;
+    wake.notify_one();
+    return handle;
+}
+
+static void failTexture(StreamTexture *texture) {
+    if (texture->texture) {
+        glDeleteTextures(1, &texture->texture);
+        texture->texture = 0;
+    }
+    textureContainerClose(&texture->container);
+    pendingCount--;
+    std::lock_guard<std::mutex> lock(mutex);
+    texture->stage = STREAM_FAILED;
+}
+
+// 文件已解析：分配全部级别的存储，从最小的级别开始上传
+static void allocateStorage(StreamTexture *texture) {
+    const TextureContainer *container = &texture->container;
+    if (container->format.astc && !hasGlExtension("GL_KHR_texture_compression_astc_ldr")) {
+        ALOGE("%s: ASTC is not supported by this device\n", texture->path);
+        failTexture(texture);
+        return;
+    }
+    if (container->levels[0].rowBytes > (size_t) slotSize) {
+        ALOGE("%s: a row of blocks (%zu bytes) does not fit in a PBO\n", texture->path,
+              container->levels[0].rowBytes);
+        failTexture(texture);
+        return;
+    }
+    glGenTextures(1, &texture->texture);
+    glBindTexture(GL_TEXTURE_2D, texture->texture);
+    glTexStorage2D(GL_TEXTURE_2D, container->levelCount, container->format.internalFormat,
+                   container->width, container->height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, container->levelCount - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, container->levelCount - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                    container->levelCount > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    if (checkGlError("glTexStorage2D")) {
+        failTexture(texture);
+        return;
+    }
+    texture->levelCount = container->levelCount;
+    texture->nextLevel = container->levelCount - 1;
+    texture->nextRow = 0;
+    texture->residentLevel = container->levelCount;
+    std::lock_guard<std::mutex> lock(mutex);
+    texture->stage = STREAM_UPLOADING;
+}
+
+// 从 PBO 上传一个片段并插入 fence，级别的最后一个片段上传后该级别即可使用
+static void uploadSlot(PboSlot *slot) {
+    StreamTexture *texture = &textures[slot->texture];
+    const TextureFormat *format = &texture->container.format;
+    const TextureLevel *level = &texture->container.levels[slot->level];
+    int y = slot->rowBegin * format->blockHeight;
+    int height = slot->rowCount * format->blockHeight;
+    if (height > level->height - y) {
+        height = level->height - y;
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot->buffer);
+    if (!glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER)) {
+        // 映射期间内容被系统破坏（例如屏幕模式切换），这一片段的数据不可靠
+        ALOGE("%s: PBO contents lost while mapped\n", texture->path);
+    }
+    slot->mapped = NULL;
+    glBindTexture(GL_TEXTURE_2D, texture->texture);
+    if (format->compressed) {
+        glCompressedTexSubImage2D(GL_TEXTURE_2D, slot->level, 0, y, level->width, height,
+                                  format->internalFormat, (GLsizei) slot->size, (const void *) 0);
+    } else {
+        glTexSubImage2D(GL_TEXTURE_2D, slot->level, 0, y, level->width, height, format->format,
+                        format->type, (const void *) 0);
+    }
+    slot->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    stats.bytesUploaded += (long) slot->size;
+    stats.chunksUploaded++;
+    if (slot->rowBegin + slot->rowCount == level->blockRows) {
+        texture->residentLevel = slot->level;
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, slot->level);
+        stats.levelsCompleted++;
+        if (slot->level == 0) {
+            // 全部级别已上传，I/O 线程也不再读取，解除文件映射
+            textureContainerClose(&texture->container);
+            pendingCount--;
+            std::lock_guard<std::mutex> lock(mutex);
+            texture->stage = STREAM_COMPLETE;
+        }
+    }
+}
+
+// 所有纹理中剩余最粗级别的那个，保证先让每个纹理都有低分辨率版本
+static int nextStreamTexture() {
+    int best = -1;
+    int i;
+    for (i = 0; i < textureCount; i++) {
+        const StreamTexture *texture = &textures[i];
+        if (texture->stage == STREAM_UPLOADING && texture->nextLevel >= 0 &&
+            (best < 0 || texture->nextLevel > textures[best].nextLevel)) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+// 把下一个片段分配给空闲的 PBO：映射后交给 I/O 线程拷贝
+static bool assignSlot(PboSlot *slot, int index) {
+    StreamTexture *texture = &textures[index];
+    const TextureLevel *level = &texture->container.levels[texture->nextLevel];
+    int rows = (int) ((size_t) slotSize / level->rowBytes);
+    if (rows > level->blockRows - texture->nextRow) {
+        rows = level->blockRows - texture->nextRow;
+    }
+    slot->texture = index;
+    slot->level = texture->nextLevel;
+    slot->rowBegin = texture->nextRow;
+    slot->rowCount = rows;
+    slot->offset = (size_t) texture->nextRow * level->rowBytes;
+    slot->size = (size_t) rows * level->rowBytes;
+    // fence 已经触发，GPU 不再读取这个 PBO，可以不同步地映射
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot->buffer);
+    slot->mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, (GLsizeiptr) slot->size,
+                                    GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT |
+                                    GL_MAP_UNSYNCHRONIZED_BIT);
+    if (!slot->mapped) {
+        checkGlError("glMapBufferRange");
+        return false;
+    }
+    texture->nextRow += rows;
+    if (texture->nextRow == level->blockRows) {
+        texture->nextLevel--;
+        texture->nextRow = 0;
+    }
+    return true;
+}
+
+void textureStreamerPoll() {
+    bool opened[MAX_STREAM_TEXTURES];
+    bool openFailed[MAX_STREAM_TEXTURES];
+    bool filled[TEXTURE_PBO_COUNT];
+    int i;
+    if (!initialized) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (i = 0; i < textureCount; i++) {
+            opened[i] = textures[i].stage == STREAM_OPENED;
+            openFailed[i] = textures[i].stage == STREAM_OPEN_FAILED;
+        }
+        for (i = 0; i < TEXTURE_PBO_COUNT; i++) {
+            filled[i] = slots[i].stage == SLOT_FILLED;
+        }
+    }
+    for (i = 0; i < textureCount; i++) {
+        if (opened[i]) {
+            allocateStorage(&textures[i]);
+        } else if (openFailed[i]) {
+            failTexture(&textures[i]);
+        }
+    }
+
+    // 按分配顺序上传拷贝完成的片段，最早的片段还在拷贝时留到下一帧，不等待
+    while (filled[nextUpload]) {
+        PboSlot *slot = &slots[nextUpload];
+        filled[nextUpload] = false;
+        uploadSlot(slot);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            slot->stage = SLOT_IN_FLIGHT;
+        }
+        nextUpload = (nextUpload + 1) % TEXTURE_PBO_COUNT;
+    }
+    if (slots[nextUpload].stage == SLOT_COPYING) {
+        stats.ioWaits++;
+    }
+
+    // 回收 GPU 已经读完的 PBO
+    for (i = 0; i < TEXTURE_PBO_COUNT; i++) {
+        PboSlot *slot = &slots[i];
+        if (slot->stage != SLOT_IN_FLIGHT) {
+            continue;
+        }
+        GLenum status = glClientWaitSync(slot->fence, 0, 0);
+        if (status == GL_TIMEOUT_EXPIRED) {
+            continue;
+        }
+        glDeleteSync(slot->fence);
+        slot->fence = 0;
+        std::lock_guard<std::mutex> lock(mutex);
+        slot->stage = SLOT_FREE;
+    }
+
+    // 按环的顺序把空闲的 PBO 分配给下一个片段
+    for (;;) {
+        PboSlot *slot = &slots[nextAssign];
+        int index = nextStreamTexture();
+        if (index < 0) {
+            break;
+        }
+        if (slot->stage != SLOT_FREE) {
+            if (slot->stage == SLOT_IN_FLIGHT) {
+                stats.fenceWaits++;
+            }
+            break;
+        }
+        if (!assignSlot(slot, index)) {
+            break;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            slot->stage = SLOT_COPYING;
+            jobs.push_back(IoJob{false, nextAssign});
+        }
+        wake.notify_one();
+        nextAssign = (nextAssign + 1) % TEXTURE_PBO_COUNT;
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+TextureState textureStreamerState(TextureHandle handle) {
+    if (handle < 0 || handle >= textureCount) {
+        return TEXTURE_FAILED;
+    }
+    StreamTexture *texture = &textures[handle];
+    std::lock_guard<std::mutex> lock(mutex);
+    switch (texture->stage) {
+        case STREAM_COMPLETE:
+            return TEXTURE_COMPLETE;
+        case STREAM_FAILED:
+        case STREAM_OPEN_FAILED:
+            return TEXTURE_FAILED;
+        case STREAM_UPLOADING:
+            return texture->residentLevel < texture->levelCount ? TEXTURE_PARTIAL : TEXTURE_PENDING;
+        default:
+            return TEXTURE_PENDING;
+    }
+}
+
+GLuint textureStreamerGet(TextureHandle handle) {
+    if (handle < 0 || handle >= textureCount) {
+        return placeholder;
+    }
+    StreamTexture *texture = &textures[handle];
+    // texture、residentLevel 只在 GL 线程修改
+    if (texture->texture && texture->residentLevel < texture->levelCount) {
+        return texture->texture;
+    }
+    return placeholder;
+}
+
+int textureStreamerResidentLevel(TextureHandle handle) {
+    if (handle < 0 || handle >= textureCount) {
+        return -1;
+    }
+    StreamTexture *texture = &textures[handle];
+    return texture->texture && texture->residentLevel < texture->levelCount ? texture->residentLevel
+                                                                            : -1;
+}
+
+int textureStreamerPendingCount() {
+    return pendingCount;
+}
+
+const TextureStreamStats *textureStreamerStats() {
+    return &stats;
+}
+
+void textureStreamerRelease() {
+    stopWorker();
+    if (initialized) {
+        resetState(true);
+    }
+}
@@ -0,0 +1,136 @@
+#include "include/thread-pool.h"
+
+//工作线程所属的线程池及队列编号
+static thread_local const ThreadPool *currentPool = nullptr;
+static thread_local int currentIndex = 0;
+
+ThreadPool::ThreadPool(int numThreads) {
+    if (numThreads <= 0) {
+        numThreads = (int) std::thread::hardware_concurrency();
+    }
+    if (numThreads <= 0) {
+        numThreads = 1;
+    }
+    for (int i = 0; i < numThreads; i++) {
+        queues.emplace_back(new WorkQueue());
+    }
+    for (int i = 1; i < numThreads; i++) {
+        workers.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+}
+
+int ThreadPool::queueIndex() const {
+    return currentPool == this ? currentIndex : 0;
+}
+
+bool ThreadPool::runOne(int index) {
+    Chunk chunk;
+    bool found = false;
+    int count = (int) queues.size();
+    int i;
+    // 自己的队列从头部取，保持块的顺序和缓存局部性
+    {
+        WorkQueue &own = *queues[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.chunks.empty()) {
+            chunk = own.chunks.front();
+            own.chunks.pop_front();
+            found = true;
+        }
+    }
+    // 其他队列从尾部窃取，与队列主人的取用方向相反，减少冲突
+    for (i = 1; !found && i < count; i++) {
+        WorkQueue &victim = *queues[(index + i) % count];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.chunks.empty()) {
+            chunk = victim.chunks.back();
+            victim.chunks.pop_back();
+            found = true;
+            stealCount.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    if (!found) {
+        return false;
+    }
+    queuedChunks.fetch_sub(1, std::memory_order_relaxed);
+    (*chunk.job->fn)(chunk.begin, chunk.end);
+    chunk.job->remaining.fetch_sub(1, std::memory_order_release);
+    return true;
+}
+
+void ThreadPool::workerLoop(int index) {
+    currentPool = this;
+    currentIndex = index;
+    for (;;) {
+        if (runOne(index)) {
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        wake.wait(lock, [&] {
+            return stopping || queuedChunks.load(std::memory_order_relaxed) > 0;
+        });
+        if (stopping) {
+            return;
+        }
+    }
+}
+
+void ThreadPool::parallelFor(int begin, int end, int grain,
+                             const std::function<void(int, int)> &fn) {
+    if (begin >= end) {
+        return;
+    }
+    if (grain < 1) {
+        grain = 1;
+    }
+    if (workers.empty() || end - begin <= grain) {
+        fn(begin, end);
+        return;
+    }
+    int numChunks = (end - begin + grain - 1) / grain;
+    int numQueues = (int) queues.size();
+    int self = queueIndex();
+    int q, c;
+    Job job;
+    job.fn = &fn;
+    job.remaining.store(numChunks, std::memory_order_relaxed);
+    // 第 q 份连续的块放进 (self + q) 号队列，调用线程从第一份开始做
+    for (q = 0; q < numQueues; q++) {
+        int first = (int) ((long) numChunks * q / numQueues);
+        int last = (int) ((long) numChunks * (q + 1) / numQueues);
+        if (first == last) {
+            continue;
+        }
+        WorkQueue &queue = *queues[(self + q) % numQueues];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        for (c = first; c < last; c++) {
+            int chunkBegin = begin + c * grain;
+            int chunkEnd = chunkBegin + grain < end ? chunkBegin + grain : end;
+            queue.chunks.push_back(Chunk{&job, chunkBegin, chunkEnd});
+        }
+    }
+    queuedChunks.fetch_add(numChunks, std::memory_order_relaxed);
+    {
+        // 加锁后再通知，工作线程在锁内检查 queuedChunks，不会错过唤醒
+        std::lock_guard<std::mutex> lock(mutex);
+    }
+    wake.notify_all();
+
+    // 等待期间执行任意任务（包括其他 parallelFor 的块），最后几块在其他线程上时让出 CPU
+    while (job.remaining.load(std::memory_order_acquire) > 0) {
+        if (!runOne(self)) {
+            std::this_thread::yield();
+        }
+    }
+}
@@ -1,6 +1,16 @@
 #include <GLES3/gl3.h>
 #include <android/log.h>
+#include <android/native_window_jni.h>
 #include "include/es-util.h"
+#include "include/gl-buffer.h"
+#include "include/command-buffer.h"
+#include "include/render-thread.h"
+#include "include/instance-recorder.h"
+#include "include/program-cache.h"
+#include "include/program-builder.h"
+#include "include/texture-streamer.h"
+#include "include/shader-variant.h"
+#include "include/gpu-generator.h"
 
 #define LOG_TAG "TRIANGLE-LIB"
 #define ALOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
@@ -8,53 +18,315 @@
 #include <jni.h>
 #include <stdlib.h>
 
-static const char VERTEX_SHADER[] =
+//三角形和三角形阵列共用的着色器模板，按特性生成变体（见 shader-variant.h）；
+//实例属性的声明（INSTANCE_ATTRIBS_GLSL）在运行时插入到两段之间
+static const char UBER_VERTEX_HEADER[] =
         "#version 300 es\n"
         "layout(location = 0) in vec4 vPosition;\n"
+        "#ifdef INSTANCED\n";
+static const char UBER_VERTEX_BODY[] =
+        "out vec4 vColor;\n"
+        "#endif\n"
         "void main(){\n"
+        "#ifdef INSTANCED\n"
+        "gl_Position = instanceMatrix * vPosition;\n"
+        "vColor = instanceColor;\n"
+        "#else\n"
         "gl_Position = vPosition;\n"
+        "#endif\n"
         "}\n";
-static const char FRAGMENT_SHADER[] =
+//没有任何特性的组合即占位程序（灰色），与其他组合使用相同的顶点属性
+static const char UBER_FRAGMENT_SHADER[] =
         "#version 300 es\n"
         "precision mediump float;\n"
+        "#ifdef INSTANCED\n"
+        "in vec4 vColor;\n"
+        "#endif\n"
         "out vec4 fragColor;\n"
         "void main(){\n"
-        "fragColor = vec4(1.0,0.0,0.0,1.0);\n"
+        "#if defined(INSTANCED)\n"
+        "fragColor = vColor;\n"
+        "#elif defined(SOLID_COLOR)\n"
+        "fragColor = SOLID_COLOR;\n"
+        "#else\n"
+        "fragColor = vec4(0.5,0.5,0.5,1.0);\n"
+        "#endif\n"
         "}\n";
+#define FEATURE_INSTANCED (1u << 0)
+#define FEATURE_SOLID_COLOR (1u << 1)
+static const ShaderFeature UBER_FEATURES[] = {
+        {"INSTANCED",   NULL},
+        {"SOLID_COLOR", "vec4(1.0,0.0,0.0,1.0)"},
+};
 static const GLfloat VERTEX[] = {
         0.0f, 0.5f, 0.0f,
         -0.5f, -0.5f, 0.0f,
         0.5f, -0.5f, 0.0f
 };
 
-GLuint program;
+//程序二进制缓存的容量上限
+#define PROGRAM_CACHE_MAX_BYTES (4 * 1024 * 1024)
+//纹理上传环中每个 PBO 的大小，2048 宽的 RGBA8 纹理一次可以上传 128 行
+#define TEXTURE_PBO_SIZE (1024 * 1024)
+//阵列中每个物体是一个低精度球体，半径不超过物体的包围球半径
+#define FIELD_SPHERE_SLICES 8
+#define FIELD_SPHERE_RADIUS 0.7f
+//录制线程最多领先渲染线程的帧数，超过时跳过录制而不是等待；
+//实例流据此保证录制线程写入的段已被 GPU 读完
+#define MAX_FRAMES_IN_FLIGHT (INSTANCE_STREAM_SEGMENTS - 2)
+//三角形阵列的边长，阵列略大于屏幕，边缘的三角形会被剔除
+#define FIELD_SIZE 64
+#define FIELD_COUNT (FIELD_SIZE * FIELD_SIZE)
+#define FIELD_EXTENT 1.1f
+//动态分辨率的帧耗时预算，60Hz 时留出余量
+#define FRAME_BUDGET_MS 14.0f
+
+// 每个 Surface 对应一个渲染器，Java 端持有其指针；
+// program/triangle 只在渲染线程中通过 CMD_CALL 创建和使用，录制线程只传递它们的地址
+typedef struct {
+    RenderThread renderThread;
+    char *cacheDir;
+    std::atomic<bool> failed;
+    ProgramHandle program;
+    //三角形顶点在初始化时上传到 VBO，之后每帧只绑定 VAO
+    MeshBuffer triangle;
+
+    //三角形阵列：录制线程用线程池并行计算变换，直接写入实例流中当前帧的那一段
+    ThreadPool pool;
+    RecordObject *field;
+    InstanceRecorder recorder;
+    long frame;
+    ProgramHandle instancedProgram;
+    MeshBuffer fieldMesh;
+    InstanceStream stream;
+} TriangleRenderer;
+
+// 以下两个函数在渲染线程执行，releaseResources 由 RenderThread::stop 调用
+static void createResources(void *data) {
+    TriangleRenderer *renderer = (TriangleRenderer *) data;
+    char vertexShader[1024];
+    char *placeholderVtx;
+    char *placeholderFrag;
+    snprintf(vertexShader, sizeof(vertexShader), "%s%s%s", UBER_VERTEX_HEADER,
+             INSTANCE_ATTRIBS_GLSL, UBER_VERTEX_BODY);
+    ShaderTemplate uber = shaderTemplateCreate(vertexShader, UBER_FRAGMENT_SHADER, UBER_FEATURES,
+                                               sizeof(UBER_FEATURES) / sizeof(UBER_FEATURES[0]));
+    if (uber < 0 || !shaderVariantAssemble(uber, 0, &placeholderVtx, &placeholderFrag)) {
+        ALOGE("Could not create shader template");
+        renderer->failed.store(true);
+        return;
+    }
+    programCacheInit(renderer->cacheDir, PROGRAM_CACHE_MAX_BYTES);
+    bool placeholderBuilt = programBuilderInit(placeholderVtx, placeholderFrag);
+    free(placeholderVtx);
+    free(placeholderFrag);
+    if (!placeholderBuilt) {
+        ALOGE("Could not create placeholder program");
+        renderer->failed.store(true);
+        return;
+    }
+    // 一次提交场景用到的全部组合，不等待编译完成，就绪之前用占位程序绘制
+    const ShaderVariantKey variants[] = {
+            {uber, FEATURE_SOLID_COLOR},
+            {uber, FEATURE_INSTANCED},
+    };
+    if (shaderVariantPrecompile(variants, sizeof(variants) / sizeof(variants[0])) < 0) {
+        ALOGE("Could not submit shader variants");
+    }
+    renderer->program = shaderVariantFind(uber, FEATURE_SOLID_COLOR);
+    renderer->instancedProgram = shaderVariantFind(uber, FEATURE_INSTANCED);
+    // 阵列的球体在 GPU 上生成，不支持时退回到三角形
+    bool fieldSphere = gpuGeneratorInit() &&
+                       gpuCreateSphereMesh(&renderer->fieldMesh, FIELD_SPHERE_SLICES,
+                                           FIELD_SPHERE_RADIUS);
+    gpuGeneratorRelease();
+    if (!createMeshBuffer(&renderer->triangle, 3, VERTEX, NULL, NULL, 0, NULL) ||
+        (!fieldSphere &&
+         !createMeshBuffer(&renderer->fieldMesh, 3, VERTEX, NULL, NULL, 0, NULL))) {
+        ALOGE("Could not create vertex buffers");
+        renderer->failed.store(true);
+        return;
+    }
+    // 初始化失败时不绘制阵列，三角形照常绘制
+    if (!instanceStreamInit(&renderer->stream, &renderer->fieldMesh, FIELD_COUNT)) {
+        ALOGE("Could not create instance stream");
+    }
+    // 纹理由 textureStreamerLoad 按需加载，渲染线程每帧推进上传
+    if (!textureStreamerInit(TEXTURE_PBO_SIZE)) {
+        ALOGE("Could not create texture upload ring");
+    }
+}
+
+static void releaseResources(void *data) {
+    TriangleRenderer *renderer = (TriangleRenderer *) data;
+    if (renderer->stream.buffer) {
+        instanceStreamRelease(&renderer->stream);
+    }
+    deleteMeshBuffer(&renderer->fieldMesh);
+    deleteMeshBuffer(&renderer->triangle);
+    textureStreamerRelease();
+    shaderVariantRelease();
+    // 停止编译工作线程，它的共享上下文必须在渲染上下文之前销毁
+    programBuilderRelease();
+}
+
+//在当前线程的命令通道中录制并提交，缓冲区用尽时返回 false
+static bool record(TriangleRenderer *renderer, bool (*fn)(TriangleRenderer *, CommandBuffer *)) {
+    CommandChannel *channel = renderer->renderThread.channel();
+    CommandBuffer *buffer = channel ? channel->begin() : NULL;
+    if (!buffer) {
+        return false;
+    }
+    if (!fn(renderer, buffer)) {
+        // 录制失败的缓冲区清空后仍然提交，由渲染线程归还
+        commandBufferReset(buffer);
+    }
+    return renderer->renderThread.submit(channel, buffer);
+}
 
+static bool recordInit(TriangleRenderer *renderer, CommandBuffer *buffer) {
+    return commandCall(buffer, createResources, renderer) &&
+           commandClearColor(buffer, 0, 0, 0, 0);
+}
+
+static void initField(RecordObject *field) {
+    int i;
+    for (i = 0; i < FIELD_COUNT; i++) {
+        RecordObject *object = &field[i];
+        float u = (float) (i % FIELD_SIZE) / (FIELD_SIZE - 1);
+        float v = (float) (i / FIELD_SIZE) / (FIELD_SIZE - 1);
+        object->position[0] = (2.0f * u - 1.0f) * FIELD_EXTENT;
+        object->position[1] = (2.0f * v - 1.0f) * FIELD_EXTENT;
+        object->position[2] = 0.0f;
+        object->axis[0] = 0.0f;
+        object->axis[1] = 0.0f;
+        object->axis[2] = 1.0f;
+        object->angle = 0.0f;
+        object->scale = FIELD_EXTENT / FIELD_SIZE;
+        // VERTEX 的外接圆半径
+        object->radius = 0.71f;
+        object->color[0] = u;
+        object->color[1] = v;
+        object->color[2] = 1.0f - u;
+        object->color[3] = 1.0f;
+    }
+}
+
+//更新阵列并录制到实例流中本帧的那一段，实例流还没初始化时不录制
+static bool recordField(TriangleRenderer *renderer, CommandBuffer *buffer, long frame) {
+    int segment = (int) (frame % INSTANCE_STREAM_SEGMENTS);
+    InstanceData *instances = instanceStreamSegment(&renderer->stream, segment);
+    RecordObject *field = renderer->field;
+    Matrix viewProj;
+    Frustum frustum;
+    if (!instances) {
+        return true;
+    }
+    renderer->pool.parallelFor(0, FIELD_COUNT, RECORD_CHUNK, [&](int begin, int end) {
+        for (int i = begin; i < end; i++) {
+            field[i].angle = (float) ((frame * 2 + i * 7) % 360);
+        }
+    });
+    matrixLoadIdentity(&viewProj);
+    frustumFromMatrix(&frustum, &viewProj);
+    int count = recordInstances(&renderer->recorder, field, FIELD_COUNT, &viewProj, &frustum,
+                                instances, FIELD_COUNT, &renderer->pool);
+    // 即使没有可见实例也要提交，渲染线程按帧轮换该段的 fence
+    return commandDrawInstances(buffer, &renderer->stream, &renderer->instancedProgram, segment,
+                                count, 0.5f);
+}
+
+static bool recordFrame(TriangleRenderer *renderer, CommandBuffer *buffer) {
+    return commandClear(buffer, GL_COLOR_BUFFER_BIT) &&
+           recordField(renderer, buffer, renderer->frame++) &&
+           commandDrawMesh(buffer, &renderer->triangle, &renderer->program, 0, 0.0f) &&
+           commandPresent(buffer);
+}
+
+static void destroyRenderer(TriangleRenderer *renderer) {
+    instanceRecorderRelease(&renderer->recorder);
+    free(renderer->field);
+    free(renderer->cacheDir);
+    delete renderer;
+}
 
 extern "C"
-JNIEXPORT jboolean JNICALL
-Java_com_vegeta_glndk_TriangleRenderer_init(JNIEnv *env, jobject thiz) {
-    program = createProgram(VERTEX_SHADER, FRAGMENT_SHADER);
-    if (!program) {
-        ALOGE("程序创建失败");
-        return JNI_FALSE;
+JNIEXPORT jlong JNICALL
+Java_com_vegeta_glndk_TriangleRenderer_init(JNIEnv *env, jobject thiz, jobject surface,
+                                            jstring cacheDir) {
+    ANativeWindow *window = ANativeWindow_fromSurface(env, surface);
+    if (!window) {
+        ALOGE("Could not get ANativeWindow from Surface");
+        return 0;
+    }
+    TriangleRenderer *renderer = new TriangleRenderer();
+    const char *dir = env->GetStringUTFChars(cacheDir, NULL);
+    renderer->cacheDir = strdup(dir);
+    env->ReleaseStringUTFChars(cacheDir, dir);
+    renderer->failed.store(false);
+    renderer->program = -1;
+    renderer->instancedProgram = -1;
+    renderer->frame = 0;
+    memset(&renderer->triangle, 0, sizeof(MeshBuffer));
+    memset(&renderer->fieldMesh, 0, sizeof(MeshBuffer));
+    renderer->stream.buffer = 0;
+    renderer->stream.ready.store(false);
+    renderer->field = (RecordObject *) malloc(sizeof(RecordObject) * FIELD_COUNT);
+    if (!renderer->field || !instanceRecorderInit(&renderer->recorder, FIELD_COUNT)) {
+        ANativeWindow_release(window);
+        destroyRenderer(renderer);
+        return 0;
     }
-    glClearColor(0, 0, 0, 0);
-    return JNI_TRUE;
+    initField(renderer->field);
+    renderer->renderThread.enableAdaptiveResolution(FRAME_BUDGET_MS);
+    bool started = renderer->renderThread.start(window);
+    // 渲染线程持有自己的引用
+    ANativeWindow_release(window);
+    if (!started || !record(renderer, recordInit)) {
+        destroyRenderer(renderer);
+        return 0;
+    }
+    return (jlong) renderer;
 }
 
 extern "C"
 JNIEXPORT void JNICALL
-Java_com_vegeta_glndk_TriangleRenderer_resize(JNIEnv *env, jobject thiz, jint width, jint height) {
-    glViewport(0, 0, width, height);
-    glClear(GL_COLOR_BUFFER_BIT);
+Java_com_vegeta_glndk_TriangleRenderer_resize(JNIEnv *env, jobject thiz, jlong handle, jint width,
+                                              jint height) {
+    TriangleRenderer *renderer = (TriangleRenderer *) handle;
+    CommandChannel *channel = renderer->renderThread.channel();
+    CommandBuffer *buffer = channel ? channel->begin() : NULL;
+    if (!buffer) {
+        return;
+    }
+    commandViewport(buffer, 0, 0, width, height);
+    renderer->renderThread.submit(channel, buffer);
 }
 
 extern "C"
 JNIEXPORT void JNICALL
-Java_com_vegeta_glndk_TriangleRenderer_step(JNIEnv *env, jobject thiz) {
-    glClear(GL_COLOR_BUFFER_BIT);
-    glUseProgram(program);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, VERTEX);
-    glEnableVertexAttribArray(0);
-    glDrawArrays(GL_TRIANGLES, 0, 3);
+Java_com_vegeta_glndk_TriangleRenderer_step(JNIEnv *env, jobject thiz, jlong handle) {
+    TriangleRenderer *renderer = (TriangleRenderer *) handle;
+    CommandChannel *channel = renderer->renderThread.channel();
+    if (renderer->failed.load(std::memory_order_relaxed) || !channel) {
+        return;
+    }
+    // 渲染线程落后太多时丢弃本帧，不阻塞调用线程
+    if (channel->framesInFlight() >= MAX_FRAMES_IN_FLIGHT) {
+        return;
+    }
+    record(renderer, recordFrame);
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_vegeta_glndk_TriangleRenderer_release(JNIEnv *env, jobject thiz, jlong handle) {
+    TriangleRenderer *renderer = (TriangleRenderer *) handle;
+    if (!renderer) {
+        return;
+    }
+    // stop 先执行完已提交的命令，再在渲染线程释放资源并销毁上下文；
+    // 不经过命令缓冲区，缓冲区用尽或提交失败时资源也不会泄漏
+    renderer->renderThread.stop(releaseResources, renderer);
+    destroyRenderer(renderer);
 }
@@ -0,0 +1,370 @@
+#include "include/vertex-format.h"
+#include "include/mesh-generator.h"
+#include "include/mesh-optimizer.h"
+
+// 球体分块打包时每块的行数
+#define SPHERE_PACK_ROWS 64
+
+const char OCT_DECODE_GLSL[] =
+        "vec3 octDecode(vec2 e) {\n"
+        "    vec3 n = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));\n"
+        "    float t = max(-n.z, 0.0);\n"
+        "    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);\n"
+        "    return normalize(n);\n"
+        "}\n";
+
+GLushort floatToHalf(float value) {
+    GLuint bits;
+    memcpy(&bits, &value, sizeof(bits));
+    GLuint sign = (bits >> 16) & 0x8000u;
+    GLuint exponent = (bits >> 23) & 0xffu;
+    GLuint mantissa = bits & 0x7fffffu;
+    if (exponent == 0xffu) {
+        // inf / nan
+        return (GLushort) (sign | 0x7c00u | (mantissa ? 0x200u : 0u));
+    }
+    int e = (int) exponent - 127 + 15;
+    if (e >= 31) {
+        return (GLushort) (sign | 0x7c00u);
+    }
+    if (e <= 0) {
+        // 非规格化数
+        if (e < -10) {
+            return (GLushort) sign;
+        }
+        mantissa |= 0x800000u;
+        int shift = 14 - e;
+        GLuint half = mantissa >> shift;
+        GLuint rest = mantissa & ((1u << shift) - 1);
+        GLuint halfway = 1u << (shift - 1);
+        if (rest > halfway || (rest == halfway && (half & 1u))) {
+            half++;
+        }
+        return (GLushort) (sign | half);
+    }
+    GLuint half = ((GLuint) e << 10) | (mantissa >> 13);
+    GLuint rest = mantissa & 0x1fffu;
+    // 进位可能溢出到指数位，结果依然正确（最大变为 inf）
+    if (rest > 0x1000u || (rest == 0x1000u && (half & 1u))) {
+        half++;
+    }
+    return (GLushort) (sign | half);
+}
+
+static inline GLfloat signNotZero(GLfloat v) {
+    return v >= 0.0f ? 1.0f : -1.0f;
+}
+
+void octEncode(const GLfloat normal[3], GLfloat result[2]) {
+    GLfloat l1 = fabsf(normal[0]) + fabsf(normal[1]) + fabsf(normal[2]);
+    if (l1 == 0.0f) {
+        result[0] = result[1] = 0.0f;
+        return;
+    }
+    GLfloat x = normal[0] / l1;
+    GLfloat y = normal[1] / l1;
+    if (normal[2] < 0.0f) {
+        GLfloat ox = (1.0f - fabsf(y)) * signNotZero(x);
+        GLfloat oy = (1.0f - fabsf(x)) * signNotZero(y);
+        x = ox;
+        y = oy;
+    }
+    result[0] = x;
+    result[1] = y;
+}
+
+static inline GLshort toSnorm16(GLfloat v) {
+    v = v < -1.0f ? -1.0f : (v > 1.0f ? 1.0f : v);
+    return (GLshort) lrintf(v * 32767.0f);
+}
+
+static inline GLushort toUnorm16(GLfloat v) {
+    v = v < 0.0f ? 0.0f : (v > 1.0f ? 1.0f : v);
+    return (GLushort) lrintf(v * 65535.0f);
+}
+
+static inline GLuint toSnorm10(GLfloat v) {
+    v = v < -1.0f ? -1.0f : (v > 1.0f ? 1.0f : v);
+    return (GLuint) (lrintf(v * 511.0f) & 0x3ff);
+}
+
+static void addAttrib(VertexLayout *layout, GLuint location, GLint size, GLenum type,
+                      GLboolean normalized, GLuint bytes) {
+    VertexAttrib *attrib = &layout->attribs[layout->numAttribs++];
+    attrib->location = location;
+    attrib->size = size;
+    attrib->type = type;
+    attrib->normalized = normalized;
+    attrib->offset = (GLuint) layout->stride;
+    layout->stride += bytes;
+}
+
+void vertexLayoutInit(VertexLayout *layout, const VertexFormat *format, int numVertices,
+                      int numIndices) {
+    memset(layout, 0, sizeof(VertexLayout));
+    if (format->position == POSITION_HALF) {
+        addAttrib(layout, VERTEX_ATTRIB_POSITION, 4, GL_HALF_FLOAT, GL_FALSE, 8);
+    } else {
+        addAttrib(layout, VERTEX_ATTRIB_POSITION, 3, GL_FLOAT, GL_FALSE, 12);
+    }
+    switch (format->normal) {
+        case NORMAL_FLOAT:
+            addAttrib(layout, VERTEX_ATTRIB_NORMAL, 3, GL_FLOAT, GL_FALSE, 12);
+            break;
+        case NORMAL_OCT16:
+            addAttrib(layout, VERTEX_ATTRIB_NORMAL, 2, GL_SHORT, GL_TRUE, 4);
+            break;
+        case NORMAL_INT_2_10_10_10:
+            addAttrib(layout, VERTEX_ATTRIB_NORMAL, 4, GL_INT_2_10_10_10_REV, GL_TRUE, 4);
+            break;
+        default:
+            break;
+    }
+    switch (format->texCoord) {
+        case TEXCOORD_FLOAT:
+            addAttrib(layout, VERTEX_ATTRIB_TEXCOORD, 2, GL_FLOAT, GL_FALSE, 8);
+            break;
+        case TEXCOORD_UNORM16:
+            addAttrib(layout, VERTEX_ATTRIB_TEXCOORD, 2, GL_UNSIGNED_SHORT, GL_TRUE, 4);
+            break;
+        default:
+            break;
+    }
+    layout->numVertices = numVertices;
+    layout->numIndices = numIndices;
+    if (numVertices <= 65536) {
+        layout->indexType = GL_UNSIGNED_SHORT;
+        layout->indexSize = sizeof(GLushort);
+    } else {
+        layout->indexType = GL_UNSIGNED_INT;
+        layout->indexSize = sizeof(GLuint);
+    }
+}
+
+void packVertices(const VertexLayout *layout, const VertexFormat *format, int first, int count,
+                  const GLfloat *positions, const GLfloat *normals, const GLfloat *texCoords,
+                  const GLuint *remap, void *dst) {
+    int i;
+    for (i = 0; i < count; i++) {
+        size_t target = remap ? remap[first + i] : (size_t) (first + i);
+        GLubyte *p = (GLubyte *) dst + target * layout->stride;
+        const GLfloat *pos = positions + i * 3;
+        if (format->position == POSITION_HALF) {
+            GLushort half[4] = {floatToHalf(pos[0]), floatToHalf(pos[1]), floatToHalf(pos[2]),
+                                floatToHalf(1.0f)};
+            memcpy(p, half, sizeof(half));
+            p += sizeof(half);
+        } else {
+            memcpy(p, pos, sizeof(GLfloat) * 3);
+            p += sizeof(GLfloat) * 3;
+        }
+        if (format->normal != NORMAL_NONE) {
+            const GLfloat *n = normals + i * 3;
+            if (format->normal == NORMAL_FLOAT) {
+                memcpy(p, n, sizeof(GLfloat) * 3);
+                p += sizeof(GLfloat) * 3;
+            } else if (format->normal == NORMAL_OCT16) {
+                GLfloat oct[2];
+                octEncode(n, oct);
+                GLshort packed[2] = {toSnorm16(oct[0]), toSnorm16(oct[1])};
+                memcpy(p, packed, sizeof(packed));
+                p += sizeof(packed);
+            } else {
+                GLuint packed = toSnorm10(n[0]) | (toSnorm10(n[1]) << 10) |
+                                (toSnorm10(n[2]) << 20);
+                memcpy(p, &packed, sizeof(packed));
+                p += sizeof(packed);
+            }
+        }
+        if (format->texCoord != TEXCOORD_NONE) {
+            const GLfloat *t = texCoords + i * 2;
+            if (format->texCoord == TEXCOORD_FLOAT) {
+                memcpy(p, t, sizeof(GLfloat) * 2);
+            } else {
+                GLushort packed[2] = {toUnorm16(t[0]), toUnorm16(t[1])};
+                memcpy(p, packed, sizeof(packed));
+            }
+        }
+    }
+}
+
+void packIndices(const VertexLayout *layout, int first, int count, const GLuint *src, void *dst) {
+    int i;
+    if (layout->indexType == GL_UNSIGNED_SHORT) {
+        GLushort *out = (GLushort *) dst + first;
+        for (i = 0; i < count; i++) {
+            out[i] = (GLushort) src[i];
+        }
+    } else {
+        memcpy((GLuint *) dst + first, src, sizeof(GLuint) * count);
+    }
+}
+
+void applyVertexLayout(const VertexLayout *layout, const void *base) {
+    int i;
+    for (i = 0; i < layout->numAttribs; i++) {
+        const VertexAttrib *attrib = &layout->attribs[i];
+        glVertexAttribPointer(attrib->location, attrib->size, attrib->type, attrib->normalized,
+                              layout->stride, (const GLubyte *) base + attrib->offset);
+        glEnableVertexAttribArray(attrib->location);
+    }
+}
+
+// 交错格式生成失败时释放输出缓冲区并把指针置为 NULL
+static void freeInterleaved(void **vertices, void **indices) {
+    if (vertices != NULL) {
+        free(*vertices);
+        *vertices = NULL;
+    }
+    if (indices != NULL) {
+        free(*indices);
+        *indices = NULL;
+    }
+}
+
+int createCubeInterleaved(float scale, const VertexFormat *format, void **vertices,
+                          void **indices, VertexLayout *layout, bool optimize) {
+    GLfloat *positions = NULL;
+    GLfloat *normals = NULL;
+    GLfloat *texCoords = NULL;
+    GLuint *indices32 = NULL;
+    int numVertices = CUBE_VERTEX_COUNT;
+    int numIndices;
+    if (vertices != NULL) {
+        *vertices = NULL;
+    }
+    if (indices != NULL) {
+        *indices = NULL;
+    }
+    numIndices = createCube(scale, &positions,
+                            format->normal != NORMAL_NONE ? &normals : NULL,
+                            format->texCoord != TEXCOORD_NONE ? &texCoords : NULL,
+                            indices ? &indices32 : NULL, optimize);
+    if (numIndices == 0) {
+        return 0;
+    }
+    vertexLayoutInit(layout, format, numVertices, numIndices);
+    if (vertices != NULL) {
+        *vertices = malloc((size_t) numVertices * layout->stride);
+        if (!*vertices) {
+            goto fail;
+        }
+        packVertices(layout, format, 0, numVertices, positions, normals, texCoords, NULL,
+                     *vertices);
+    }
+    if (indices != NULL) {
+        *indices = malloc((size_t) numIndices * layout->indexSize);
+        if (!*indices) {
+            goto fail;
+        }
+        packIndices(layout, 0, numIndices, indices32, *indices);
+    }
+    free(positions);
+    free(normals);
+    free(texCoords);
+    free(indices32);
+    return numIndices;
+    fail:
+    ALOGE("Failed to allocate interleaved cube");
+    freeInterleaved(vertices, indices);
+    free(positions);
+    free(normals);
+    free(texCoords);
+    free(indices32);
+    return 0;
+}
+
+int createSphereInterleaved(int numSlices, float radius, const VertexFormat *format,
+                            void **vertices, void **indices, VertexLayout *layout,
+                            bool optimize, MeshOptimizeStats *stats) {
+    SphereGenerator gen;
+    int rowVertices = numSlices + 1;
+    int rowIndices = numSlices * 6;
+    int row;
+    GLuint *remap = NULL;
+    GLuint *indices32 = NULL;
+    GLfloat *vertexChunk = NULL;
+    GLuint *indexChunk = NULL;
+    if (vertices != NULL) {
+        *vertices = NULL;
+    }
+    if (indices != NULL) {
+        *indices = NULL;
+    }
+    if (stats) {
+        memset(stats, 0, sizeof(MeshOptimizeStats));
+    }
+    if (!sphereGeneratorInit(&gen, numSlices, radius)) {
+        return 0;
+    }
+    vertexLayoutInit(layout, format, sphereVertexCount(numSlices), sphereIndexCount(numSlices));
+    if (vertices != NULL) {
+        *vertices = malloc((size_t) layout->numVertices * layout->stride);
+        vertexChunk = (GLfloat *) malloc(sizeof(GLfloat) * 8 * rowVertices * SPHERE_PACK_ROWS);
+        if (!*vertices || !vertexChunk) {
+            goto fail;
+        }
+    }
+    if (indices != NULL) {
+        *indices = malloc((size_t) layout->numIndices * layout->indexSize);
+        if (!*indices) {
+            goto fail;
+        }
+    }
+    if (optimize) {
+        // 先根据拓扑算出优化后的索引和顶点编号，顶点打包时直接写到新位置；内存不足时不做优化
+        indices32 = (GLuint *) malloc(sizeof(GLuint) * layout->numIndices);
+        remap = (GLuint *) malloc(sizeof(GLuint) * layout->numVertices);
+        if (indices32 && remap) {
+            sphereGeneratorIndices(&gen, 0, gen.numParallels, indices32);
+            optimizeMesh(indices32, layout->numIndices, layout->numVertices, remap, stats);
+            if (indices != NULL) {
+                packIndices(layout, 0, layout->numIndices, indices32, *indices);
+            }
+        } else {
+            free(remap);
+            remap = NULL;
+        }
+        free(indices32);
+        indices32 = NULL;
+    }
+    if (vertices != NULL) {
+        GLfloat *normals = format->normal != NORMAL_NONE
+                           ? vertexChunk + 3 * rowVertices * SPHERE_PACK_ROWS : NULL;
+        GLfloat *texCoords = format->texCoord != TEXCOORD_NONE
+                             ? vertexChunk + 6 * rowVertices * SPHERE_PACK_ROWS : NULL;
+        for (row = 0; row < gen.numParallels + 1; row += SPHERE_PACK_ROWS) {
+            int end = row + SPHERE_PACK_ROWS < gen.numParallels + 1 ? row + SPHERE_PACK_ROWS
+                                                                   : gen.numParallels + 1;
+            sphereGeneratorVertices(&gen, row, end, vertexChunk, normals, texCoords);
+            packVertices(layout, format, row * rowVertices, (end - row) * rowVertices,
+                         vertexChunk, normals, texCoords, remap, *vertices);
+        }
+    }
+    // 优化后的索引已经写入
+    if (indices != NULL && !remap) {
+        indexChunk = (GLuint *) malloc(sizeof(GLuint) * rowIndices * SPHERE_PACK_ROWS);
+        if (!indexChunk) {
+            goto fail;
+        }
+        for (row = 0; row < gen.numParallels; row += SPHERE_PACK_ROWS) {
+            int end = row + SPHERE_PACK_ROWS < gen.numParallels ? row + SPHERE_PACK_ROWS
+                                                               : gen.numParallels;
+            sphereGeneratorIndices(&gen, row, end, indexChunk);
+            packIndices(layout, row * rowIndices, (end - row) * rowIndices, indexChunk, *indices);
+        }
+    }
+    free(vertexChunk);
+    free(indexChunk);
+    free(remap);
+    sphereGeneratorRelease(&gen);
+    return layout->numIndices;
+    fail:
+    ALOGE("Failed to allocate interleaved sphere with %d slices", numSlices);
+    freeInterleaved(vertices, indices);
+    free(vertexChunk);
+    free(indexChunk);
+    free(remap);
+    sphereGeneratorRelease(&gen);
+    return 0;
+}
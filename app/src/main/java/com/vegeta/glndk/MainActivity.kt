@@ -2,12 +2,14 @@ package com.vegeta.glndk
 
 import android.opengl.GLSurfaceView
 import android.os.Bundle
+import android.view.SurfaceView
 import android.view.View
 import android.view.WindowManager
 import android.widget.FrameLayout
 import android.widget.Toast
 import androidx.appcompat.app.AppCompatActivity
 import com.vegeta.glndk.databinding.ActivityMainBinding
+import java.io.File
 
 class MainActivity : AppCompatActivity() {
   companion object {
@@ -28,15 +30,15 @@ class MainActivity : AppCompatActivity() {
         FrameLayout.LayoutParams.MATCH_PARENT,
         FrameLayout.LayoutParams.MATCH_PARENT
       )
-      val glSurfaceView: GLSurfaceView
+      val glSurfaceView: SurfaceView
 //        renderMode = GLSurfaceView.RENDERMODE_CONTINUOUSLY
       when (view.id) {
         R.id.btnTriangle -> {
-          glSurfaceView = GLSurfaceView(this).apply {
+          // 渲染线程自己创建 EGL 上下文，使用普通 SurfaceView
+          glSurfaceView = SurfaceView(this).apply {
             layoutParams = lp
-            setEGLContextClientVersion(3)
           }
-          glSurfaceView.setRenderer(TriangleRenderer())
+          glSurfaceView.holder.addCallback(TriangleRenderer(File(cacheDir, "programs").absolutePath))
         }
 //        R.id.btnPic -> {
 //          glSurfaceView = PicGLSurfaceView(this).apply {
@@ -78,9 +80,11 @@ class MainActivity : AppCompatActivity() {
 
   override fun onBackPressed() {
     val glSurfaceView = binding.parent.getChildAt(binding.parent.childCount - 1)
-    if (glSurfaceView is GLSurfaceView) {
-      // 点击返回键，退出GLSurfaceView页面
+    if (glSurfaceView is SurfaceView) {
+      // 点击返回键，退出GLSurfaceView页面，同时显示帧耗时统计并导出 trace
       binding.parent.removeView(glSurfaceView)
+      exportTrace(File(cacheDir, "trace.json").absolutePath)
+      Toast.makeText(this, getFrameStats(), Toast.LENGTH_LONG).show()
     } else {
       super.onBackPressed()
     }
@@ -88,6 +92,10 @@ class MainActivity : AppCompatActivity() {
 
   external fun getABIString(): String
 
+  external fun getFrameStats(): String
+
+  external fun exportTrace(path: String): Boolean
+
   external fun cInvokeJava(): String
   fun setText(count: Int) {
     Toast.makeText(this, "toast indirectly by C\ncount: $count", Toast.LENGTH_SHORT).show()
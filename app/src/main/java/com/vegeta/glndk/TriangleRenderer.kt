@@ -1,24 +1,46 @@
 package com.vegeta.glndk
 
-import android.opengl.GLSurfaceView
-import javax.microedition.khronos.egl.EGLConfig
-import javax.microedition.khronos.opengles.GL10
+import android.view.Choreographer
+import android.view.Surface
+import android.view.SurfaceHolder
 
-class TriangleRenderer : GLSurfaceView.Renderer {
-  override fun onSurfaceCreated(gl: GL10?, config: EGLConfig?) {
-    init()
+// GL 调用全部在 native 渲染线程执行，这里只在 UI 线程按垂直同步录制每一帧的命令
+class TriangleRenderer(private val cacheDir: String) : SurfaceHolder.Callback,
+  Choreographer.FrameCallback {
+  private var handle = 0L
+
+  override fun surfaceCreated(holder: SurfaceHolder) {
+    handle = init(holder.surface, cacheDir)
+    if (handle != 0L) {
+      Choreographer.getInstance().postFrameCallback(this)
+    }
+  }
+
+  override fun surfaceChanged(holder: SurfaceHolder, format: Int, width: Int, height: Int) {
+    if (handle != 0L) {
+      resize(handle, width, height)
+    }
   }
 
-  override fun onSurfaceChanged(gl: GL10?, width: Int, height: Int) {
-    resize(width, height)
+  override fun surfaceDestroyed(holder: SurfaceHolder) {
+    Choreographer.getInstance().removeFrameCallback(this)
+    if (handle != 0L) {
+      // 等待渲染线程释放 EGL surface 后才能返回
+      release(handle)
+      handle = 0L
+    }
   }
 
-  override fun onDrawFrame(gl: GL10?) {
-    step()
+  override fun doFrame(frameTimeNanos: Long) {
+    if (handle != 0L) {
+      step(handle)
+      Choreographer.getInstance().postFrameCallback(this)
+    }
   }
 
 
-  private external fun init(): Boolean
-  private external fun resize(width: Int, height: Int)
-  private external fun step()
-}
\ No newline at end of file
+  private external fun init(surface: Surface, cacheDir: String): Long
+  private external fun resize(handle: Long, width: Int, height: Int)
+  private external fun step(handle: Long)
+  private external fun release(handle: Long)
+}